@@ -74,6 +74,11 @@ esp_err_t heap_trace_summary(heap_trace_summary_t *summary)
     return ESP_ERR_NOT_SUPPORTED;
 }
 
+esp_err_t heap_trace_dump_binary(heap_trace_write_cb_t write_cb, void *arg)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
 void heap_trace_dump(void)
 {
     return;
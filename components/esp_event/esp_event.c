@@ -46,6 +46,10 @@ static SLIST_HEAD(esp_event_loop_instance_list_t, esp_event_loop_instance) s_eve
 static portMUX_TYPE s_event_loops_spinlock = portMUX_INITIALIZER_UNLOCKED;
 #endif
 
+#ifdef CONFIG_ESP_EVENT_LOOP_DISPATCH_INDEX
+static atomic_uint s_handler_generation;
+#endif
+
 /* ------------------------- Static Functions ------------------------------- */
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
@@ -92,6 +96,102 @@ static int esp_event_dump_prepare(void)
 
     return size;
 }
+
+static void latency_record(esp_event_latency_t* latency, int64_t duration)
+{
+    uint32_t us = duration <= 0 ? 0 : (duration >= UINT32_MAX ? UINT32_MAX : (uint32_t) duration);
+
+    // Bucket i >= 1 holds durations of i significant bits
+    size_t bucket = us ? 32 - __builtin_clz(us) : 0;
+    if (bucket >= ESP_EVENT_LATENCY_BUCKETS) {
+        bucket = ESP_EVENT_LATENCY_BUCKETS - 1;
+    }
+
+    if (latency->count == 0 || us < latency->min) {
+        latency->min = us;
+    }
+    if (us > latency->max) {
+        latency->max = us;
+    }
+    latency->count++;
+    latency->buckets[bucket]++;
+}
+
+static uint32_t latency_percentile(const esp_event_latency_t* latency, uint32_t percent)
+{
+    // Rank of the percentile among the recorded durations, rounded up
+    uint64_t rank = ((uint64_t) latency->count * percent + 99) / 100;
+    uint64_t seen = 0;
+    uint32_t value = latency->max;
+
+    for (size_t i = 0; i < ESP_EVENT_LATENCY_BUCKETS - 1; i++) {
+        seen += latency->buckets[i];
+        if (seen >= rank) {
+            value = i ? (UINT32_C(1) << i) - 1 : 0;
+            break;
+        }
+    }
+
+    if (value < latency->min) {
+        value = latency->min;
+    }
+    return value > latency->max ? latency->max : value;
+}
+
+static void latency_get_stats(const esp_event_latency_t* latency, esp_event_latency_stats_t* stats)
+{
+    stats->count = latency->count;
+    stats->min_us = latency->min;
+    stats->max_us = latency->max;
+    stats->p50_us = latency->count ? latency_percentile(latency, 50) : 0;
+    stats->p99_us = latency->count ? latency_percentile(latency, 99) : 0;
+    memcpy(stats->buckets, latency->buckets, sizeof(stats->buckets));
+}
+
+static bool handler_is_registered(esp_event_loop_instance_t* loop, esp_event_handler_node_t* handler)
+{
+    esp_event_loop_node_t* loop_node;
+    esp_event_base_node_t* base_node;
+    esp_event_id_node_t* id_node;
+    esp_event_handler_node_t* handler_node;
+
+    SLIST_FOREACH(loop_node, &(loop->loop_nodes), next) {
+        SLIST_FOREACH(handler_node, &(loop_node->handlers), next) {
+            if (handler_node == handler) {
+                return true;
+            }
+        }
+        SLIST_FOREACH(base_node, &(loop_node->base_nodes), next) {
+            SLIST_FOREACH(handler_node, &(base_node->handlers), next) {
+                if (handler_node == handler) {
+                    return true;
+                }
+            }
+            SLIST_FOREACH(id_node, &(base_node->id_nodes), next) {
+                SLIST_FOREACH(handler_node, &(id_node->handlers), next) {
+                    if (handler_node == handler) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+// Records the dispatch of an event, pending is the number of events still queued behind it
+static void dispatch_record(esp_event_loop_instance_t* loop, esp_event_post_instance_t* post, uint32_t pending)
+{
+    int64_t latency = esp_timer_get_time() - post->post_time;
+
+    xSemaphoreTake(loop->profiling_mutex, portMAX_DELAY);
+    if (pending + 1 > loop->queue_high_water) {
+        loop->queue_high_water = pending + 1;
+    }
+    latency_record(&loop->dispatch_latency, latency);
+    xSemaphoreGive(loop->profiling_mutex);
+}
 #endif
 
 static void esp_event_loop_run_task(void* args)
@@ -112,30 +212,41 @@ static void esp_event_loop_run_task(void* args)
     vTaskSuspend(NULL);
 }
 
-static void handler_execute(esp_event_loop_instance_t* loop, esp_event_handler_node_t *handler, esp_event_post_instance_t post)
+static inline uint32_t __attribute__((always_inline)) event_hash(esp_event_base_t base, int32_t id)
 {
-    ESP_LOGD(TAG, "running post %s:%"PRIu32" with handler %p and context %p on loop %p", post.base, post.id, handler->handler_ctx->handler, &handler->handler_ctx, loop);
+    uint32_t hash = (uint32_t)(uintptr_t) base ^ ((uint32_t) id * 2654435761u);
+    return hash ^ (hash >> 16);
+}
 
-#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
-    int64_t start, diff;
-    start = esp_timer_get_time();
-#endif
-    // Execute the handler
+static inline void* post_data(esp_event_post_instance_t* post)
+{
 #if CONFIG_ESP_EVENT_POST_FROM_ISR
     void* data_ptr = NULL;
 
-    if (post.data_set) {
-        if (post.data_allocated) {
-            data_ptr = post.data.ptr;
+    if (post->data_set) {
+        if (post->data_allocated) {
+            data_ptr = post->data.ptr;
         } else {
-            data_ptr = &post.data.val;
+            data_ptr = &post->data.val;
         }
     }
 
-    (*(handler->handler_ctx->handler))(handler->handler_ctx->arg, post.base, post.id, data_ptr);
+    return data_ptr;
 #else
-    (*(handler->handler_ctx->handler))(handler->handler_ctx->arg, post.base, post.id, post.data);
+    return post->data;
+#endif
+}
+
+static void handler_execute(esp_event_loop_instance_t* loop, esp_event_handler_node_t *handler, esp_event_post_instance_t post)
+{
+    ESP_LOGD(TAG, "running post %s:%"PRIu32" with handler %p and context %p on loop %p", post.base, post.id, handler->handler_ctx->handler, &handler->handler_ctx, loop);
+
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+    int64_t start, diff;
+    start = esp_timer_get_time();
 #endif
+    // Execute the handler
+    (*(handler->handler_ctx->handler))(handler->handler_ctx->arg, post.base, post.id, post_data(&post));
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     diff = esp_timer_get_time() - start;
@@ -145,21 +256,27 @@ static void handler_execute(esp_event_loop_instance_t* loop, esp_event_handler_n
     // At this point handler may be already unregistered.
     // This happens in "handler instance can unregister itself" test case.
     // To prevent memory corruption error it's necessary to check if pointer is still valid.
-    esp_event_loop_node_t* loop_node;
-    esp_event_handler_node_t* handler_node;
-    SLIST_FOREACH(loop_node, &(loop->loop_nodes), next) {
-        SLIST_FOREACH(handler_node, &(loop_node->handlers), next) {
-            if (handler_node == handler) {
-                handler->invoked++;
-                handler->time += diff;
-            }
-        }
+    if (handler_is_registered(loop, handler)) {
+        handler->invoked++;
+        handler->time += diff;
+        latency_record(&handler->run_time, diff);
     }
 
     xSemaphoreGive(loop->profiling_mutex);
 #endif
 }
 
+// Drops a reference to the registration of a handler, the last one frees it
+static void handler_ctx_release(esp_event_handler_instance_context_t* handler_ctx)
+{
+#ifdef CONFIG_ESP_EVENT_LOOP_MULTI_TASK
+    if (atomic_fetch_sub(&(handler_ctx->refs), 1) != 1) {
+        return;
+    }
+#endif
+    free(handler_ctx);
+}
+
 static esp_err_t handler_instances_add(esp_event_handler_nodes_t* handlers, esp_event_handler_t event_handler, void* event_handler_arg, esp_event_handler_instance_context_t **handler_ctx, bool legacy)
 {
     esp_event_handler_node_t *handler_instance = calloc(1, sizeof(*handler_instance));
@@ -177,7 +294,14 @@ static esp_err_t handler_instances_add(esp_event_handler_nodes_t* handlers, esp_
 
     context->handler = event_handler;
     context->arg = event_handler_arg;
+#ifdef CONFIG_ESP_EVENT_LOOP_MULTI_TASK
+    atomic_init(&(context->refs), 1);
+    atomic_init(&(context->removed), false);
+#endif
     handler_instance->handler_ctx = context;
+#ifdef CONFIG_ESP_EVENT_LOOP_DISPATCH_INDEX
+    handler_instance->generation = atomic_fetch_add(&s_handler_generation, 1);
+#endif
 
     if (SLIST_EMPTY(handlers)) {
         SLIST_INSERT_HEAD(handlers, handler_instance, next);
@@ -316,7 +440,9 @@ static esp_err_t loop_node_add_handler(esp_event_loop_node_t* loop_node,
     }
 }
 
-static esp_err_t handler_instances_remove(esp_event_handler_nodes_t* handlers, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
+// The registration of the removed handler is stored in removed_ctx, for the caller to release it
+static esp_err_t handler_instances_remove(esp_event_handler_nodes_t* handlers, esp_event_handler_instance_context_t* handler_ctx,
+                                          bool legacy, esp_event_handler_instance_context_t** removed_ctx)
 {
     esp_event_handler_node_t *it, *temp;
 
@@ -324,118 +450,737 @@ static esp_err_t handler_instances_remove(esp_event_handler_nodes_t* handlers, e
         if (legacy) {
             if (it->handler_ctx->handler == handler_ctx->handler) {
                 SLIST_REMOVE(handlers, it, esp_event_handler_node, next);
-                free(it->handler_ctx);
+                *removed_ctx = it->handler_ctx;
                 free(it);
                 return ESP_OK;
             }
         } else {
             if (it->handler_ctx == handler_ctx) {
                 SLIST_REMOVE(handlers, it, esp_event_handler_node, next);
-                free(it->handler_ctx);
+                *removed_ctx = it->handler_ctx;
                 free(it);
                 return ESP_OK;
             }
         }
     }
 
-    return ESP_ERR_NOT_FOUND;
+    return ESP_ERR_NOT_FOUND;
+}
+
+static esp_err_t base_node_remove_handler(esp_event_base_node_t* base_node, int32_t id, esp_event_handler_instance_context_t* handler_ctx,
+                                          bool legacy, esp_event_handler_instance_context_t** removed_ctx)
+{
+    if (id == ESP_EVENT_ANY_ID) {
+        return handler_instances_remove(&(base_node->handlers), handler_ctx, legacy, removed_ctx);
+    } else {
+        esp_event_id_node_t *it, *temp;
+        SLIST_FOREACH_SAFE(it, &(base_node->id_nodes), next, temp) {
+            if (it->id == id) {
+                esp_err_t res = handler_instances_remove(&(it->handlers), handler_ctx, legacy, removed_ctx);
+
+                if (res == ESP_OK) {
+                    if (SLIST_EMPTY(&(it->handlers))) {
+                        SLIST_REMOVE(&(base_node->id_nodes), it, esp_event_id_node, next);
+                        free(it);
+                    }
+                    return ESP_OK;
+                }
+            }
+        }
+    }
+
+    return ESP_ERR_NOT_FOUND;
+}
+
+static esp_err_t loop_node_remove_handler(esp_event_loop_node_t* loop_node, esp_event_base_t base, int32_t id, esp_event_handler_instance_context_t* handler_ctx,
+                                          bool legacy, esp_event_handler_instance_context_t** removed_ctx)
+{
+    if (base == esp_event_any_base && id == ESP_EVENT_ANY_ID) {
+        return handler_instances_remove(&(loop_node->handlers), handler_ctx, legacy, removed_ctx);
+    } else {
+        esp_event_base_node_t *it, *temp;
+        SLIST_FOREACH_SAFE(it, &(loop_node->base_nodes), next, temp) {
+            if (it->base == base) {
+                esp_err_t res = base_node_remove_handler(it, id, handler_ctx, legacy, removed_ctx);
+
+                if (res == ESP_OK) {
+                    if (SLIST_EMPTY(&(it->handlers)) && SLIST_EMPTY(&(it->id_nodes))) {
+                        SLIST_REMOVE(&(loop_node->base_nodes), it, esp_event_base_node, next);
+                        free(it);
+                    }
+                    return ESP_OK;
+                }
+            }
+        }
+    }
+
+    return ESP_ERR_NOT_FOUND;
+}
+
+static void handler_instances_remove_all(esp_event_handler_nodes_t* handlers)
+{
+    esp_event_handler_node_t *it, *temp;
+    SLIST_FOREACH_SAFE(it, handlers, next, temp) {
+        SLIST_REMOVE(handlers, it, esp_event_handler_node, next);
+        handler_ctx_release(it->handler_ctx);
+        free(it);
+    }
+}
+
+static void base_node_remove_all_handler(esp_event_base_node_t* base_node)
+{
+    handler_instances_remove_all(&(base_node->handlers));
+
+    esp_event_id_node_t *it, *temp;
+    SLIST_FOREACH_SAFE(it, &(base_node->id_nodes), next, temp) {
+        handler_instances_remove_all(&(it->handlers));
+        SLIST_REMOVE(&(base_node->id_nodes), it, esp_event_id_node, next);
+        free(it);
+    }
+}
+
+static void loop_node_remove_all_handler(esp_event_loop_node_t* loop_node)
+{
+    handler_instances_remove_all(&(loop_node->handlers));
+
+    esp_event_base_node_t *it, *temp;
+    SLIST_FOREACH_SAFE(it, &(loop_node->base_nodes), next, temp) {
+        base_node_remove_all_handler(it);
+        SLIST_REMOVE(&(loop_node->base_nodes), it, esp_event_base_node, next);
+        free(it);
+    }
+}
+
+static bool handlers_execute_all(esp_event_loop_instance_t* loop, esp_event_post_instance_t post)
+{
+    bool exec = false;
+
+    esp_event_handler_node_t *handler, *temp_handler;
+    esp_event_loop_node_t *loop_node, *temp_node;
+    esp_event_base_node_t *base_node, *temp_base;
+    esp_event_id_node_t *id_node, *temp_id_node;
+
+    SLIST_FOREACH_SAFE(loop_node, &(loop->loop_nodes), next, temp_node) {
+        // Execute loop level handlers
+        SLIST_FOREACH_SAFE(handler, &(loop_node->handlers), next, temp_handler) {
+            handler_execute(loop, handler, post);
+            exec |= true;
+        }
+
+        SLIST_FOREACH_SAFE(base_node, &(loop_node->base_nodes), next, temp_base) {
+            if (base_node->base == post.base) {
+                // Execute base level handlers
+                SLIST_FOREACH_SAFE(handler, &(base_node->handlers), next, temp_handler) {
+                    handler_execute(loop, handler, post);
+                    exec |= true;
+                }
+
+                SLIST_FOREACH_SAFE(id_node, &(base_node->id_nodes), next, temp_id_node) {
+                    if (id_node->id == post.id) {
+                        // Execute id level handlers
+                        SLIST_FOREACH_SAFE(handler, &(id_node->handlers), next, temp_handler) {
+                            handler_execute(loop, handler, post);
+                            exec |= true;
+                        }
+                        // Skip to next base node
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    return exec;
+}
+
+#ifdef CONFIG_ESP_EVENT_LOOP_DISPATCH_INDEX
+
+// Collects the handlers of an event in the order handlers_execute_all() executes them. Returns the number of
+// handlers, of which at most max are stored in handlers. If find is set, stops once it has been collected.
+static size_t handlers_collect(esp_event_loop_instance_t* loop, esp_event_base_t base, int32_t id,
+                               esp_event_dispatch_handler_t* handlers, size_t max, esp_event_handler_node_t* find)
+{
+    size_t count = 0;
+
+    esp_event_handler_node_t *handler;
+    esp_event_loop_node_t *loop_node;
+    esp_event_base_node_t *base_node;
+    esp_event_id_node_t *id_node;
+
+#define COLLECT(h) do { \
+                        if (count < max) { \
+                            handlers[count].node = (h); \
+                            handlers[count].generation = (h)->generation; \
+                        } \
+                        count++; \
+                        if ((h) == find) { \
+                            return count; \
+                        } \
+                    } while(0)
+
+    SLIST_FOREACH(loop_node, &(loop->loop_nodes), next) {
+        SLIST_FOREACH(handler, &(loop_node->handlers), next) {
+            COLLECT(handler);
+        }
+
+        SLIST_FOREACH(base_node, &(loop_node->base_nodes), next) {
+            if (base_node->base == base) {
+                SLIST_FOREACH(handler, &(base_node->handlers), next) {
+                    COLLECT(handler);
+                }
+
+                SLIST_FOREACH(id_node, &(base_node->id_nodes), next) {
+                    if (id_node->id == id) {
+                        SLIST_FOREACH(handler, &(id_node->handlers), next) {
+                            COLLECT(handler);
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+#undef COLLECT
+
+    return find ? 0 : count;
+}
+
+static inline size_t dispatch_index_slot(esp_event_base_t base, int32_t id)
+{
+    return event_hash(base, id) % CONFIG_ESP_EVENT_LOOP_DISPATCH_INDEX_SIZE;
+}
+
+// Returns the entry holding the current handlers of the event, rebuilding it if necessary.
+// Returns NULL if there is not enough memory for the handler list.
+static esp_event_dispatch_entry_t* dispatch_index_get(esp_event_loop_instance_t* loop, esp_event_base_t base, int32_t id)
+{
+    esp_event_dispatch_entry_t* entry = &(loop->dispatch_index[dispatch_index_slot(base, id)]);
+
+    if (entry->handlers_version == loop->handlers_version && entry->base == base && entry->id == id) {
+        return entry;
+    }
+
+    size_t count = handlers_collect(loop, base, id, entry->handlers, entry->handler_capacity, NULL);
+
+    if (count > entry->handler_capacity) {
+        esp_event_dispatch_handler_t* handlers = realloc(entry->handlers, count * sizeof(*handlers));
+
+        if (!handlers) {
+            entry->handlers_version = 0;
+            return NULL;
+        }
+
+        entry->handlers = handlers;
+        entry->handler_capacity = count;
+        handlers_collect(loop, base, id, entry->handlers, entry->handler_capacity, NULL);
+    }
+
+    entry->base = base;
+    entry->id = id;
+    entry->handler_count = count;
+    entry->handlers_version = loop->handlers_version;
+
+    return entry;
+}
+
+static void dispatch_index_invalidate(esp_event_loop_instance_t* loop)
+{
+    // Version 0 marks unused entries
+    if (++loop->handlers_version == 0) {
+        ++loop->handlers_version;
+        for (size_t i = 0; i < CONFIG_ESP_EVENT_LOOP_DISPATCH_INDEX_SIZE; i++) {
+            loop->dispatch_index[i].handlers_version = 0;
+        }
+    }
+}
+
+static void dispatch_index_delete(esp_event_loop_instance_t* loop)
+{
+    if (loop->dispatch_index) {
+        for (size_t i = 0; i < CONFIG_ESP_EVENT_LOOP_DISPATCH_INDEX_SIZE; i++) {
+            free(loop->dispatch_index[i].handlers);
+        }
+        free(loop->dispatch_index);
+    }
+}
+
+static bool handlers_execute_indexed(esp_event_loop_instance_t* loop, esp_event_post_instance_t post)
+{
+    esp_event_dispatch_entry_t* entry = NULL;
+
+    // Handlers may run the loop themselves, in which case the entry used by the outer dispatch must not change
+    if (loop->dispatch_depth == 0) {
+        entry = dispatch_index_get(loop, post.base, post.id);
+    }
+
+    if (!entry) {
+        return handlers_execute_all(loop, post);
+    }
+
+    uint32_t version = loop->handlers_version;
+    loop->dispatch_depth++;
+
+    for (size_t i = 0; i < entry->handler_count; i++) {
+        esp_event_handler_node_t* handler = entry->handlers[i].node;
+
+        // A handler changed the registrations, skip handlers which have been unregistered in the meantime. The node
+        // of an unregistered handler may have been reused by a new registration, which has another generation.
+        if (loop->handlers_version != version &&
+                (handlers_collect(loop, post.base, post.id, NULL, 0, handler) == 0 ||
+                 handler->generation != entry->handlers[i].generation)) {
+            continue;
+        }
+
+        handler_execute(loop, handler, post);
+    }
+
+    loop->dispatch_depth--;
+
+    return entry->handler_count > 0;
+}
+#endif
+
+static inline bool handlers_execute(esp_event_loop_instance_t* loop, esp_event_post_instance_t post)
+{
+#ifdef CONFIG_ESP_EVENT_LOOP_DISPATCH_INDEX
+    return handlers_execute_indexed(loop, post);
+#else
+    return handlers_execute_all(loop, post);
+#endif
+}
+
+#define DATA_POOL_BITMAP_WORDS(block_count)   (((block_count) + 31) / 32)
+#define DATA_POOL_BLOCK_ALIGN                   8
+
+static esp_err_t data_pool_create(esp_event_loop_instance_t* loop, size_t block_size, size_t block_count)
+{
+    if (block_size == 0 || block_count == 0) {
+        return ESP_OK;
+    }
+
+    block_size = (block_size + DATA_POOL_BLOCK_ALIGN - 1) & ~(DATA_POOL_BLOCK_ALIGN - 1);
+    size_t words = DATA_POOL_BITMAP_WORDS(block_count);
+
+    // Blocks and bitmap share one allocation, the bitmap follows the blocks
+    loop->data_pool = malloc(block_size * block_count + words * sizeof(*(loop->data_pool_free)));
+    if (loop->data_pool == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    loop->data_pool_block_size = block_size;
+    loop->data_pool_block_count = block_count;
+    loop->data_pool_free = (atomic_uint_least32_t*) (loop->data_pool + block_size * block_count);
+
+    for (size_t i = 0; i < words; i++) {
+        size_t blocks = (i == words - 1 && block_count % 32) ? block_count % 32 : 32;
+        atomic_init(&(loop->data_pool_free[i]), blocks == 32 ? UINT32_MAX : (UINT32_C(1) << blocks) - 1);
+    }
+
+    return ESP_OK;
+}
+
+// Takes a free block from the pool of the loop, may be called concurrently by all tasks posting to the loop
+static void* data_pool_alloc(esp_event_loop_instance_t* loop, size_t size)
+{
+    if (size > loop->data_pool_block_size) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < DATA_POOL_BITMAP_WORDS(loop->data_pool_block_count); i++) {
+        uint_least32_t free_blocks = atomic_load(&(loop->data_pool_free[i]));
+
+        while (free_blocks) {
+            uint_least32_t block = free_blocks & (~free_blocks + 1);
+
+            if (atomic_compare_exchange_weak(&(loop->data_pool_free[i]), &free_blocks, free_blocks & ~block)) {
+                return loop->data_pool + (i * 32 + __builtin_ctz(block)) * loop->data_pool_block_size;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+// Returns the block to the pool of the loop, returns false if data is not part of the pool
+static bool data_pool_free(esp_event_loop_instance_t* loop, void* data)
+{
+    uint8_t* block = (uint8_t*) data;
+
+    if (loop->data_pool == NULL || block < loop->data_pool ||
+            block >= loop->data_pool + loop->data_pool_block_size * loop->data_pool_block_count) {
+        return false;
+    }
+
+    size_t index = (block - loop->data_pool) / loop->data_pool_block_size;
+    atomic_fetch_or(&(loop->data_pool_free[index / 32]), UINT32_C(1) << (index % 32));
+
+    return true;
+}
+
+static void data_release_none(void* event_data)
+{
+}
+
+static void inline __attribute__((always_inline)) post_instance_delete(esp_event_loop_instance_t* loop, esp_event_post_instance_t* post)
+{
+#if CONFIG_ESP_EVENT_POST_FROM_ISR
+    void* data = post->data_allocated ? post->data.ptr : NULL;
+#else
+    void* data = post->data;
+#endif
+    if (post->release) {
+        post->release(data);
+    } else if (data && !data_pool_free(loop, data)) {
+        free(data);
+    }
+    memset(post, 0, sizeof(*post));
+}
+
+// Returns the queue of the task dispatching the event
+static inline QueueHandle_t __attribute__((always_inline)) post_queue(esp_event_loop_instance_t* loop, esp_event_post_instance_t* post)
+{
+#ifdef CONFIG_ESP_EVENT_LOOP_MULTI_TASK
+    if (loop->workers) {
+        return loop->workers[event_hash(post->base, post->id) % loop->worker_count].queue;
+    }
+#endif
+    return loop->queue;
+}
+
+// Returns whether the current task is a dedicated task of the loop
+static bool loop_task_is_current(esp_event_loop_instance_t* loop)
+{
+    TaskHandle_t current = xTaskGetCurrentTaskHandle();
+
+#ifdef CONFIG_ESP_EVENT_LOOP_MULTI_TASK
+    if (loop->workers) {
+        for (size_t i = 0; i < loop->worker_count; i++) {
+            if (loop->workers[i].task == current) {
+                return true;
+            }
+        }
+        return false;
+    }
+#endif
+    return loop->task == current;
+}
+
+static esp_err_t post_instance_send(esp_event_loop_instance_t* loop, esp_event_post_instance_t* post, TickType_t ticks_to_wait)
+{
+    BaseType_t result = pdFALSE;
+
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+    post->post_time = esp_timer_get_time();
+#endif
+
+    // Find the task that currently executes the loop. It is safe to query loop->task since it is
+    // not mutated since loop creation. ENSURE THIS REMAINS TRUE.
+    if (loop->task == NULL) {
+        // The loop has no dedicated task. Find out what task is currently running it.
+        result = xSemaphoreTakeRecursive(loop->mutex, ticks_to_wait);
+
+        if (result == pdTRUE) {
+            if (loop->running_task != xTaskGetCurrentTaskHandle()) {
+                xSemaphoreGiveRecursive(loop->mutex);
+                result = xQueueSendToBack(loop->queue, post, ticks_to_wait);
+            } else {
+                xSemaphoreGiveRecursive(loop->mutex);
+                result = xQueueSendToBack(loop->queue, post, 0);
+            }
+        }
+    } else {
+        // The loop has a dedicated task, or several tasks which may post to each other's queue.
+        if (!loop_task_is_current(loop)) {
+            result = xQueueSendToBack(post_queue(loop, post), post, ticks_to_wait);
+        } else {
+            result = xQueueSendToBack(post_queue(loop, post), post, 0);
+        }
+    }
+
+    if (result != pdTRUE) {
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+        atomic_fetch_add(&loop->events_dropped, 1);
+#endif
+        return ESP_ERR_TIMEOUT;
+    }
+
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+    atomic_fetch_add(&loop->events_recieved, 1);
+#endif
+
+    return ESP_OK;
+}
+
+#ifdef CONFIG_ESP_EVENT_LOOP_MULTI_TASK
+#ifndef CONFIG_ESP_EVENT_LOOP_PROFILING
+// Copies the handlers of an event in the order they are executed. Returns the number of handlers,
+// of which at most max are stored in handlers.
+static size_t handlers_snapshot(esp_event_loop_instance_t* loop, esp_event_base_t base, int32_t id,
+                                esp_event_handler_snapshot_t* handlers, size_t max)
+{
+    size_t count = 0;
+
+#define SNAPSHOT(h) do { \
+                        if (count < max) { \
+                            handlers[count].handler = (h)->handler_ctx->handler; \
+                            handlers[count].arg = (h)->handler_ctx->arg; \
+                            handlers[count].ctx = (h)->handler_ctx; \
+                        } \
+                        count++; \
+                    } while(0)
+
+#ifdef CONFIG_ESP_EVENT_LOOP_DISPATCH_INDEX
+    esp_event_dispatch_entry_t* entry = dispatch_index_get(loop, base, id);
+
+    if (entry) {
+        for (size_t i = 0; i < entry->handler_count; i++) {
+            SNAPSHOT(entry->handlers[i].node);
+        }
+        return count;
+    }
+#endif
+
+    esp_event_handler_node_t *handler;
+    esp_event_loop_node_t *loop_node;
+    esp_event_base_node_t *base_node;
+    esp_event_id_node_t *id_node;
+
+    SLIST_FOREACH(loop_node, &(loop->loop_nodes), next) {
+        SLIST_FOREACH(handler, &(loop_node->handlers), next) {
+            SNAPSHOT(handler);
+        }
+
+        SLIST_FOREACH(base_node, &(loop_node->base_nodes), next) {
+            if (base_node->base == base) {
+                SLIST_FOREACH(handler, &(base_node->handlers), next) {
+                    SNAPSHOT(handler);
+                }
+
+                SLIST_FOREACH(id_node, &(base_node->id_nodes), next) {
+                    if (id_node->id == id) {
+                        SLIST_FOREACH(handler, &(id_node->handlers), next) {
+                            SNAPSHOT(handler);
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+#undef SNAPSHOT
+
+    return count;
+}
+
+// Copies the handlers of the events received by the worker, returns false if there is not enough memory
+static bool worker_snapshot_handlers(esp_event_loop_worker_t* worker)
+{
+    esp_event_loop_instance_t* loop = worker->loop;
+    size_t total = 0;
+
+    for (size_t i = 0; i < worker->post_count; i++) {
+        size_t available = total < worker->handler_capacity ? worker->handler_capacity - total : 0;
+        worker->handler_counts[i] = handlers_snapshot(loop, worker->posts[i].base, worker->posts[i].id,
+                                                      worker->handlers + (available ? total : 0), available);
+        total += worker->handler_counts[i];
+    }
+
+    if (total > worker->handler_capacity) {
+        esp_event_handler_snapshot_t* handlers = realloc(worker->handlers, total * sizeof(*handlers));
+
+        if (!handlers) {
+            return false;
+        }
+
+        worker->handlers = handlers;
+        worker->handler_capacity = total;
+
+        total = 0;
+        for (size_t i = 0; i < worker->post_count; i++) {
+            handlers_snapshot(loop, worker->posts[i].base, worker->posts[i].id, worker->handlers + total, worker->handler_counts[i]);
+            total += worker->handler_counts[i];
+        }
+    }
+
+    // Unregistering a handler waits until the task is done with it
+    for (size_t i = 0; i < total; i++) {
+        atomic_fetch_add(&(worker->handlers[i].ctx->refs), 1);
+    }
+    worker->handler_index = 0;
+    worker->handler_total = total;
+
+    return true;
+}
+#endif
+
+// Waits until the tasks of the loop are done with an unregistered handler. The current task may be one of them,
+// executing the handler, which then only skips the handler for the events it has yet to dispatch.
+static void workers_wait_handler(esp_event_loop_instance_t* loop, esp_event_handler_instance_context_t* handler_ctx)
+{
+    unsigned own_refs = 0;
+    TaskHandle_t current = xTaskGetCurrentTaskHandle();
+
+    for (size_t i = 0; i < loop->worker_count; i++) {
+        esp_event_loop_worker_t* worker = &(loop->workers[i]);
+
+        if (worker->task == current) {
+            for (size_t j = worker->handler_index; j < worker->handler_total; j++) {
+                if (worker->handlers[j].ctx == handler_ctx) {
+                    own_refs++;
+                }
+            }
+            break;
+        }
+    }
+
+    while (atomic_load(&(handler_ctx->refs)) > own_refs + 1) {
+        vTaskDelay(1);
+    }
 }
 
-static esp_err_t base_node_remove_handler(esp_event_base_node_t* base_node, int32_t id, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
+static void esp_event_loop_run_worker(void* args)
 {
-    if (id == ESP_EVENT_ANY_ID) {
-        return handler_instances_remove(&(base_node->handlers), handler_ctx, legacy);
-    } else {
-        esp_event_id_node_t *it, *temp;
-        SLIST_FOREACH_SAFE(it, &(base_node->id_nodes), next, temp) {
-            if (it->id == id) {
-                esp_err_t res = handler_instances_remove(&(it->handlers), handler_ctx, legacy);
+    esp_event_loop_worker_t* worker = (esp_event_loop_worker_t*) args;
+    esp_event_loop_instance_t* loop = worker->loop;
 
-                if (res == ESP_OK) {
-                    if (SLIST_EMPTY(&(it->handlers))) {
-                        SLIST_REMOVE(&(base_node->id_nodes), it, esp_event_id_node, next);
-                        free(it);
-                        return ESP_OK;
+    ESP_LOGD(TAG, "running task %p for loop %p", worker, loop);
+
+    while (1) {
+        if (xQueueReceive(worker->queue, &(worker->posts[0]), portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        worker->post_count = 1;
+        while (worker->post_count < loop->batch_size &&
+                xQueueReceive(worker->queue, &(worker->posts[worker->post_count]), 0) == pdTRUE) {
+            worker->post_count++;
+        }
+
+        // Loop deletion waits until the received events have been dispatched
+        xSemaphoreTake(worker->mutex, portMAX_DELAY);
+        xSemaphoreTakeRecursive(loop->mutex, portMAX_DELAY);
+
+#ifndef CONFIG_ESP_EVENT_LOOP_PROFILING
+        if (worker_snapshot_handlers(worker)) {
+            xSemaphoreGiveRecursive(loop->mutex);
+
+            for (size_t i = 0; i < worker->post_count; i++) {
+                esp_event_post_instance_t* post = &(worker->posts[i]);
+                void* data = post_data(post);
+
+                for (size_t j = 0; j < worker->handler_counts[i]; j++, worker->handler_index++) {
+                    esp_event_handler_snapshot_t* handler = &(worker->handlers[worker->handler_index]);
+
+                    if (!atomic_load(&(handler->ctx->removed))) {
+                        (*(handler->handler))(handler->arg, post->base, post->id, data);
                     }
+                    handler_ctx_release(handler->ctx);
                 }
+                post_instance_delete(loop, post);
             }
+            worker->handler_total = 0;
+        } else
+#endif
+        {
+            // Dispatch while holding the loop mutex, as a single task does
+            for (size_t i = 0; i < worker->post_count; i++) {
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+                dispatch_record(loop, &(worker->posts[i]),
+                                uxQueueMessagesWaiting(worker->queue) + worker->post_count - i - 1);
+#endif
+                handlers_execute(loop, worker->posts[i]);
+                post_instance_delete(loop, &(worker->posts[i]));
+            }
+            xSemaphoreGiveRecursive(loop->mutex);
         }
-    }
 
-    return ESP_ERR_NOT_FOUND;
+        worker->post_count = 0;
+        xSemaphoreGive(worker->mutex);
+    }
 }
 
-static esp_err_t loop_node_remove_handler(esp_event_loop_node_t* loop_node, esp_event_base_t base, int32_t id, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
+static void workers_delete(esp_event_loop_instance_t* loop)
 {
-    if (base == esp_event_any_base && id == ESP_EVENT_ANY_ID) {
-        return handler_instances_remove(&(loop_node->handlers), handler_ctx, legacy);
-    } else {
-        esp_event_base_node_t *it, *temp;
-        SLIST_FOREACH_SAFE(it, &(loop_node->base_nodes), next, temp) {
-            if (it->base == base) {
-                esp_err_t res = base_node_remove_handler(it, id, handler_ctx, legacy);
+    for (size_t i = 0; i < loop->worker_count; i++) {
+        esp_event_loop_worker_t* worker = &(loop->workers[i]);
 
-                if (res == ESP_OK) {
-                    if (SLIST_EMPTY(&(it->handlers)) && SLIST_EMPTY(&(it->id_nodes))) {
-                        SLIST_REMOVE(&(loop_node->base_nodes), it, esp_event_base_node, next);
-                        free(it);
-                        return ESP_OK;
-                    }
-                }
+        if (worker->task != NULL) {
+            vTaskDelete(worker->task);
+        }
+
+        if (worker->posts != NULL) {
+            for (size_t j = 0; j < worker->post_count; j++) {
+                post_instance_delete(loop, &(worker->posts[j]));
             }
         }
+
+        if (worker->queue != NULL) {
+            esp_event_post_instance_t post;
+            while (xQueueReceive(worker->queue, &post, 0) == pdTRUE) {
+                post_instance_delete(loop, &post);
+            }
+            vQueueDelete(worker->queue);
+        }
+
+        if (worker->mutex != NULL) {
+            vSemaphoreDelete(worker->mutex);
+        }
+
+        free(worker->posts);
+        free(worker->handler_counts);
+        free(worker->handlers);
     }
 
-    return ESP_ERR_NOT_FOUND;
+    free(loop->workers);
+    loop->workers = NULL;
+    loop->worker_count = 0;
 }
 
-static void handler_instances_remove_all(esp_event_handler_nodes_t* handlers)
+static esp_err_t workers_create(esp_event_loop_instance_t* loop, const esp_event_loop_args_t* event_loop_args)
 {
-    esp_event_handler_node_t *it, *temp;
-    SLIST_FOREACH_SAFE(it, handlers, next, temp) {
-        SLIST_REMOVE(handlers, it, esp_event_handler_node, next);
-        free(it->handler_ctx);
-        free(it);
+    loop->workers = calloc(event_loop_args->task_count, sizeof(*(loop->workers)));
+    if (loop->workers == NULL) {
+        return ESP_ERR_NO_MEM;
     }
-}
 
-static void base_node_remove_all_handler(esp_event_base_node_t* base_node)
-{
-    handler_instances_remove_all(&(base_node->handlers));
+    loop->worker_count = event_loop_args->task_count;
 
-    esp_event_id_node_t *it, *temp;
-    SLIST_FOREACH_SAFE(it, &(base_node->id_nodes), next, temp) {
-        handler_instances_remove_all(&(it->handlers));
-        SLIST_REMOVE(&(base_node->id_nodes), it, esp_event_id_node, next);
-        free(it);
-    }
-}
+    for (size_t i = 0; i < loop->worker_count; i++) {
+        esp_event_loop_worker_t* worker = &(loop->workers[i]);
 
-static void loop_node_remove_all_handler(esp_event_loop_node_t* loop_node)
-{
-    handler_instances_remove_all(&(loop_node->handlers));
+        worker->loop = loop;
+        worker->queue = xQueueCreate(event_loop_args->queue_size, sizeof(esp_event_post_instance_t));
+        worker->mutex = xSemaphoreCreateMutex();
+        worker->posts = calloc(loop->batch_size, sizeof(*(worker->posts)));
+        worker->handler_counts = calloc(loop->batch_size, sizeof(*(worker->handler_counts)));
 
-    esp_event_base_node_t *it, *temp;
-    SLIST_FOREACH_SAFE(it, &(loop_node->base_nodes), next, temp) {
-        base_node_remove_all_handler(it);
-        SLIST_REMOVE(&(loop_node->base_nodes), it, esp_event_base_node, next);
-        free(it);
+        if (worker->queue == NULL || worker->mutex == NULL || worker->posts == NULL || worker->handler_counts == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
     }
+
+    return ESP_OK;
 }
 
-static void inline __attribute__((always_inline)) post_instance_delete(esp_event_post_instance_t* post)
+static esp_err_t workers_start(esp_event_loop_instance_t* loop, const esp_event_loop_args_t* event_loop_args)
 {
-#if CONFIG_ESP_EVENT_POST_FROM_ISR
-    if (post->data_allocated && post->data.ptr) {
-        free(post->data.ptr);
-    }
-#else
-    if (post->data) {
-        free(post->data);
+    for (size_t i = 0; i < loop->worker_count; i++) {
+        BaseType_t task_created = xTaskCreatePinnedToCore(esp_event_loop_run_worker, event_loop_args->task_name,
+                                                          event_loop_args->task_stack_size, (void*) &(loop->workers[i]),
+                                                          event_loop_args->task_priority, &(loop->workers[i].task),
+                                                          event_loop_args->task_core_id);
+
+        if (task_created != pdPASS) {
+            loop->workers[i].task = NULL;
+            return ESP_FAIL;
+        }
     }
-#endif
-    memset(post, 0, sizeof(*post));
+
+    return ESP_OK;
 }
+#endif
 
 /* ---------------------------- Public API --------------------------------- */
 
@@ -451,6 +1196,15 @@ esp_err_t esp_event_loop_create(const esp_event_loop_args_t* event_loop_args, es
         return ESP_ERR_INVALID_ARG;
     }
 
+    bool multi_task = event_loop_args->task_name != NULL && event_loop_args->task_count > 1;
+
+#ifndef CONFIG_ESP_EVENT_LOOP_MULTI_TASK
+    if (multi_task) {
+        ESP_LOGE(TAG, "event loops with several tasks require CONFIG_ESP_EVENT_LOOP_MULTI_TASK");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+#endif
+
     esp_event_loop_instance_t* loop;
     esp_err_t err = ESP_ERR_NO_MEM; // most likely error
 
@@ -460,10 +1214,22 @@ esp_err_t esp_event_loop_create(const esp_event_loop_args_t* event_loop_args, es
         return err;
     }
 
-    loop->queue = xQueueCreate(event_loop_args->queue_size, sizeof(esp_event_post_instance_t));
-    if (loop->queue == NULL) {
-        ESP_LOGE(TAG, "create event loop queue failed");
-        goto on_err;
+    loop->batch_size = event_loop_args->batch_size ? event_loop_args->batch_size : 1;
+
+#ifdef CONFIG_ESP_EVENT_LOOP_MULTI_TASK
+    if (multi_task) {
+        if (workers_create(loop, event_loop_args) != ESP_OK) {
+            ESP_LOGE(TAG, "create event loop task queues failed");
+            goto on_err;
+        }
+    } else
+#endif
+    {
+        loop->queue = xQueueCreate(event_loop_args->queue_size, sizeof(esp_event_post_instance_t));
+        if (loop->queue == NULL) {
+            ESP_LOGE(TAG, "create event loop queue failed");
+            goto on_err;
+        }
     }
 
     loop->mutex = xSemaphoreCreateRecursiveMutex();
@@ -482,7 +1248,36 @@ esp_err_t esp_event_loop_create(const esp_event_loop_args_t* event_loop_args, es
 
     SLIST_INIT(&(loop->loop_nodes));
 
+    if (data_pool_create(loop, event_loop_args->data_pool_block_size, event_loop_args->data_pool_block_count) != ESP_OK) {
+        ESP_LOGE(TAG, "alloc for event data pool failed");
+        goto on_err;
+    }
+
+#ifdef CONFIG_ESP_EVENT_LOOP_DISPATCH_INDEX
+    loop->dispatch_index = calloc(CONFIG_ESP_EVENT_LOOP_DISPATCH_INDEX_SIZE, sizeof(*(loop->dispatch_index)));
+    if (loop->dispatch_index == NULL) {
+        ESP_LOGE(TAG, "alloc for event loop dispatch index failed");
+        goto on_err;
+    }
+
+    loop->handlers_version = 1;
+#endif
+
     // Create the loop task if requested
+#ifdef CONFIG_ESP_EVENT_LOOP_MULTI_TASK
+    if (multi_task) {
+        if (workers_start(loop, event_loop_args) != ESP_OK) {
+            ESP_LOGE(TAG, "create tasks for loop failed");
+            err = ESP_FAIL;
+            goto on_err;
+        }
+
+        loop->task = loop->workers[0].task;
+        loop->name = event_loop_args->task_name;
+
+        ESP_LOGD(TAG, "created %"PRIu32" tasks for loop %p", event_loop_args->task_count, loop);
+    } else
+#endif
     if (event_loop_args->task_name != NULL) {
         BaseType_t task_created = xTaskCreatePinnedToCore(esp_event_loop_run_task, event_loop_args->task_name,
                                                           event_loop_args->task_stack_size, (void*) loop,
@@ -517,6 +1312,12 @@ esp_err_t esp_event_loop_create(const esp_event_loop_args_t* event_loop_args, es
     return ESP_OK;
 
 on_err:
+#ifdef CONFIG_ESP_EVENT_LOOP_MULTI_TASK
+    if (loop->workers != NULL) {
+        workers_delete(loop);
+    }
+#endif
+
     if (loop->queue != NULL) {
         vQueueDelete(loop->queue);
     }
@@ -531,6 +1332,11 @@ on_err:
     }
 #endif
 
+#ifdef CONFIG_ESP_EVENT_LOOP_DISPATCH_INDEX
+    dispatch_index_delete(loop);
+#endif
+
+    free(loop->data_pool);
     free(loop);
 
     return err;
@@ -547,6 +1353,15 @@ esp_err_t esp_event_loop_run(esp_event_loop_handle_t event_loop, TickType_t tick
     assert(event_loop);
 
     esp_event_loop_instance_t* loop = (esp_event_loop_instance_t*) event_loop;
+
+#ifdef CONFIG_ESP_EVENT_LOOP_MULTI_TASK
+    // Each task of the loop dispatches the events from its own queue
+    if (loop->workers != NULL) {
+        ESP_LOGE(TAG, "loop %p is run by its tasks", event_loop);
+        return ESP_ERR_INVALID_STATE;
+    }
+#endif
+
     esp_event_post_instance_t post;
     TickType_t marker = xTaskGetTickCount();
     TickType_t end = 0;
@@ -563,68 +1378,44 @@ esp_err_t esp_event_loop_run(esp_event_loop_handle_t event_loop, TickType_t tick
 
         loop->running_task = xTaskGetCurrentTaskHandle();
 
-        bool exec = false;
+        size_t dispatched = 0;
+        bool expired = false;
 
-        esp_event_handler_node_t *handler, *temp_handler;
-        esp_event_loop_node_t *loop_node, *temp_node;
-        esp_event_base_node_t *base_node, *temp_base;
-        esp_event_id_node_t *id_node, *temp_id_node;
+        // Dispatch the events waiting in the queue up to the batch size before releasing the mutex
+        do {
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+            dispatch_record(loop, &post, uxQueueMessagesWaiting(loop->queue));
+#endif
+            bool exec = handlers_execute(loop, post);
 
-        SLIST_FOREACH_SAFE(loop_node, &(loop->loop_nodes), next, temp_node) {
-            // Execute loop level handlers
-            SLIST_FOREACH_SAFE(handler, &(loop_node->handlers), next, temp_handler) {
-                handler_execute(loop, handler, post);
-                exec |= true;
+            if (!exec) {
+                // No handlers were registered, not even loop/base level handlers
+                ESP_LOGD(TAG, "no handlers have been registered for event %s:%"PRIu32" posted to loop %p", post.base, post.id, event_loop);
             }
 
-            SLIST_FOREACH_SAFE(base_node, &(loop_node->base_nodes), next, temp_base) {
-                if (base_node->base == post.base) {
-                    // Execute base level handlers
-                    SLIST_FOREACH_SAFE(handler, &(base_node->handlers), next, temp_handler) {
-                        handler_execute(loop, handler, post);
-                        exec |= true;
-                    }
+            post_instance_delete(loop, &post);
 
-                    SLIST_FOREACH_SAFE(id_node, &(base_node->id_nodes), next, temp_id_node) {
-                        if (id_node->id == post.id) {
-                            // Execute id level handlers
-                            SLIST_FOREACH_SAFE(handler, &(id_node->handlers), next, temp_handler) {
-                                handler_execute(loop, handler, post);
-                                exec |= true;
-                            }
-                            // Skip to next base node
-                            break;
-                        }
-                    }
+            if (ticks_to_run != portMAX_DELAY) {
+                end = xTaskGetTickCount();
+                remaining_ticks -= end - marker;
+                // If the ticks to run expired, return to the caller
+                if (remaining_ticks <= 0) {
+                    expired = true;
+                    break;
+                } else {
+                    marker = end;
                 }
             }
-        }
-
-        esp_event_base_t base = post.base;
-        int32_t id = post.id;
+        } while (++dispatched < loop->batch_size && xQueueReceive(loop->queue, &post, 0) == pdTRUE);
 
-        post_instance_delete(&post);
-
-        if (ticks_to_run != portMAX_DELAY) {
-            end = xTaskGetTickCount();
-            remaining_ticks -= end - marker;
-            // If the ticks to run expired, return to the caller
-            if (remaining_ticks <= 0) {
-                xSemaphoreGiveRecursive(loop->mutex);
-                break;
-            } else {
-                marker = end;
-            }
+        if (expired) {
+            xSemaphoreGiveRecursive(loop->mutex);
+            break;
         }
 
         loop->running_task = NULL;
 
         xSemaphoreGiveRecursive(loop->mutex);
-
-        if (!exec) {
-            // No handlers were registered, not even loop/base level handlers
-            ESP_LOGD(TAG, "no handlers have been registered for event %s:%"PRIu32" posted to loop %p", base, id, event_loop);
-        }
     }
 
     return ESP_OK;
@@ -641,6 +1432,13 @@ esp_err_t esp_event_loop_delete(esp_event_loop_handle_t event_loop)
     SemaphoreHandle_t loop_profiling_mutex = loop->profiling_mutex;
 #endif
 
+#ifdef CONFIG_ESP_EVENT_LOOP_MULTI_TASK
+    // Wait until the tasks have dispatched the events they received
+    for (size_t i = 0; i < loop->worker_count; i++) {
+        xSemaphoreTake(loop->workers[i].mutex, portMAX_DELAY);
+    }
+#endif
+
     xSemaphoreTakeRecursive(loop->mutex, portMAX_DELAY);
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
@@ -651,6 +1449,16 @@ esp_err_t esp_event_loop_delete(esp_event_loop_handle_t event_loop)
 #endif
 
     // Delete the task if it was created
+#ifdef CONFIG_ESP_EVENT_LOOP_MULTI_TASK
+    if (loop->workers != NULL) {
+        for (size_t i = 0; i < loop->worker_count; i++) {
+            vTaskDelete(loop->workers[i].task);
+            loop->workers[i].task = NULL;
+            xSemaphoreGive(loop->workers[i].mutex);
+        }
+        workers_delete(loop);
+    } else
+#endif
     if (loop->task != NULL) {
         vTaskDelete(loop->task);
     }
@@ -664,13 +1472,20 @@ esp_err_t esp_event_loop_delete(esp_event_loop_handle_t event_loop)
     }
 
     // Drop existing posts on the queue
-    esp_event_post_instance_t post;
-    while (xQueueReceive(loop->queue, &post, 0) == pdTRUE) {
-        post_instance_delete(&post);
+    if (loop->queue != NULL) {
+        esp_event_post_instance_t post;
+        while (xQueueReceive(loop->queue, &post, 0) == pdTRUE) {
+            post_instance_delete(loop, &post);
+        }
+
+        vQueueDelete(loop->queue);
     }
 
     // Cleanup loop
-    vQueueDelete(loop->queue);
+#ifdef CONFIG_ESP_EVENT_LOOP_DISPATCH_INDEX
+    dispatch_index_delete(loop);
+#endif
+    free(loop->data_pool);
     free(loop);
     // Free loop mutex before deleting
     xSemaphoreGiveRecursive(loop_mutex);
@@ -741,6 +1556,12 @@ esp_err_t esp_event_handler_register_with_internal(esp_event_loop_handle_t event
         err = loop_node_add_handler(last_loop_node, event_base, event_id, event_handler, event_handler_arg, handler_ctx_arg, legacy);
     }
 
+#ifdef CONFIG_ESP_EVENT_LOOP_DISPATCH_INDEX
+    if (err == ESP_OK) {
+        dispatch_index_invalidate(loop);
+    }
+#endif
+
 on_err:
     xSemaphoreGiveRecursive(loop->mutex);
     return err;
@@ -775,22 +1596,48 @@ esp_err_t esp_event_handler_unregister_with_internal(esp_event_loop_handle_t eve
     }
 
     esp_event_loop_instance_t* loop = (esp_event_loop_instance_t*) event_loop;
+    esp_event_handler_instance_context_t* removed_ctx;
 
-    xSemaphoreTakeRecursive(loop->mutex, portMAX_DELAY);
+    // A legacy handler may be registered several times, in different lists, one is removed at a time
+    do {
+        removed_ctx = NULL;
 
-    esp_event_loop_node_t *it, *temp;
+        xSemaphoreTakeRecursive(loop->mutex, portMAX_DELAY);
 
-    SLIST_FOREACH_SAFE(it, &(loop->loop_nodes), next, temp) {
-        esp_err_t res = loop_node_remove_handler(it, event_base, event_id, handler_ctx, legacy);
+        esp_event_loop_node_t *it, *temp;
 
-        if (res == ESP_OK && SLIST_EMPTY(&(it->base_nodes)) && SLIST_EMPTY(&(it->handlers))) {
-            SLIST_REMOVE(&(loop->loop_nodes), it, esp_event_loop_node, next);
-            free(it);
-            break;
+        SLIST_FOREACH_SAFE(it, &(loop->loop_nodes), next, temp) {
+            esp_err_t res = loop_node_remove_handler(it, event_base, event_id, handler_ctx, legacy, &removed_ctx);
+
+            if (res == ESP_OK) {
+                if (SLIST_EMPTY(&(it->base_nodes)) && SLIST_EMPTY(&(it->handlers))) {
+                    SLIST_REMOVE(&(loop->loop_nodes), it, esp_event_loop_node, next);
+                    free(it);
+                }
+                break;
+            }
         }
-    }
 
-    xSemaphoreGiveRecursive(loop->mutex);
+#ifdef CONFIG_ESP_EVENT_LOOP_DISPATCH_INDEX
+        dispatch_index_invalidate(loop);
+#endif
+
+#ifdef CONFIG_ESP_EVENT_LOOP_MULTI_TASK
+        if (removed_ctx) {
+            // Snapshots taken from now on do not include the handler, the ones taken before skip it
+            atomic_store(&(removed_ctx->removed), true);
+        }
+#endif
+
+        xSemaphoreGiveRecursive(loop->mutex);
+
+        if (removed_ctx) {
+#ifdef CONFIG_ESP_EVENT_LOOP_MULTI_TASK
+            workers_wait_handler(loop, removed_ctx);
+#endif
+            handler_ctx_release(removed_ctx);
+        }
+    } while (legacy && removed_ctx);
 
     return ESP_OK;
 }
@@ -831,7 +1678,11 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t
 
     if (event_data != NULL && event_data_size != 0) {
         // Make persistent copy of event data on heap.
-        void* event_data_copy = calloc(1, event_data_size);
+        void* event_data_copy = data_pool_alloc(loop, event_data_size);
+
+        if (event_data_copy == NULL) {
+            event_data_copy = calloc(1, event_data_size);
+        }
 
         if (event_data_copy == NULL) {
             return ESP_ERR_NO_MEM;
@@ -849,46 +1700,43 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t
     post.base = event_base;
     post.id = event_id;
 
-    BaseType_t result = pdFALSE;
-
-    // Find the task that currently executes the loop. It is safe to query loop->task since it is
-    // not mutated since loop creation. ENSURE THIS REMAINS TRUE.
-    if (loop->task == NULL) {
-        // The loop has no dedicated task. Find out what task is currently running it.
-        result = xSemaphoreTakeRecursive(loop->mutex, ticks_to_wait);
+    esp_err_t err = post_instance_send(loop, &post, ticks_to_wait);
 
-        if (result == pdTRUE) {
-            if (loop->running_task != xTaskGetCurrentTaskHandle()) {
-                xSemaphoreGiveRecursive(loop->mutex);
-                result = xQueueSendToBack(loop->queue, &post, ticks_to_wait);
-            } else {
-                xSemaphoreGiveRecursive(loop->mutex);
-                result = xQueueSendToBack(loop->queue, &post, 0);
-            }
-        }
-    } else {
-        // The loop has a dedicated task.
-        if (loop->task != xTaskGetCurrentTaskHandle()) {
-            result = xQueueSendToBack(loop->queue, &post, ticks_to_wait);
-        } else {
-            result = xQueueSendToBack(loop->queue, &post, 0);
-        }
+    if (err != ESP_OK) {
+        post_instance_delete(loop, &post);
     }
 
-    if (result != pdTRUE) {
-        post_instance_delete(&post);
+    return err;
+}
 
-#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
-        atomic_fetch_add(&loop->events_dropped, 1);
-#endif
-        return ESP_ERR_TIMEOUT;
+esp_err_t esp_event_post_to_no_copy(esp_event_loop_handle_t event_loop, esp_event_base_t event_base, int32_t event_id,
+                                    void* event_data, esp_event_data_release_t release, TickType_t ticks_to_wait)
+{
+    assert(event_loop);
+
+    if (event_base == ESP_EVENT_ANY_BASE || event_id == ESP_EVENT_ANY_ID) {
+        return ESP_ERR_INVALID_ARG;
     }
 
-#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
-    atomic_fetch_add(&loop->events_recieved, 1);
+    esp_event_loop_instance_t* loop = (esp_event_loop_instance_t*) event_loop;
+
+    esp_event_post_instance_t post;
+    memset((void*)(&post), 0, sizeof(post));
+
+#if CONFIG_ESP_EVENT_POST_FROM_ISR
+    post.data.ptr = event_data;
+    post.data_allocated = true;
+    post.data_set = (event_data != NULL);
+#else
+    post.data = event_data;
 #endif
+    // The data is never freed by the loop, even without release function
+    post.release = release ? release : data_release_none;
+    post.base = event_base;
+    post.id = event_id;
 
-    return ESP_OK;
+    // On failure, the data remains owned by the caller
+    return post_instance_send(loop, &post, ticks_to_wait);
 }
 
 #if CONFIG_ESP_EVENT_POST_FROM_ISR
@@ -917,14 +1765,17 @@ esp_err_t esp_event_isr_post_to(esp_event_loop_handle_t event_loop, esp_event_ba
     }
     post.base = event_base;
     post.id = event_id;
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+    post.post_time = esp_timer_get_time();
+#endif
 
     BaseType_t result = pdFALSE;
 
     // Post the event from an ISR,
-    result = xQueueSendToBackFromISR(loop->queue, &post, task_unblocked);
+    result = xQueueSendToBackFromISR(post_queue(loop, &post), &post, task_unblocked);
 
     if (result != pdTRUE) {
-        post_instance_delete(&post);
+        post_instance_delete(loop, &post);
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
         atomic_fetch_add(&loop->events_dropped, 1);
@@ -1012,3 +1863,76 @@ esp_err_t esp_event_dump(FILE* file)
 #endif
     return ESP_OK;
 }
+
+esp_err_t esp_event_loop_get_stats(esp_event_loop_handle_t event_loop, esp_event_loop_stats_t* loop_stats,
+                                   esp_event_handler_stats_t* handler_stats, size_t* handler_count)
+{
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+    assert(event_loop);
+
+    if (handler_stats != NULL && handler_count == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_event_loop_instance_t* loop = (esp_event_loop_instance_t*) event_loop;
+    esp_event_loop_node_t* loop_node;
+    esp_event_base_node_t* base_node;
+    esp_event_id_node_t* id_node;
+    esp_event_handler_node_t* handler;
+    size_t capacity = handler_stats ? *handler_count : 0;
+    size_t count = 0;
+
+#define HANDLER_STATS_ADD(event_base, event_id, node) do { \
+        if (count < capacity) { \
+            esp_event_handler_stats_t* stats = &handler_stats[count]; \
+            stats->base = (event_base) == esp_event_any_base ? ESP_EVENT_ANY_BASE : (event_base); \
+            stats->id = (event_id); \
+            stats->handler = (node)->handler_ctx->handler; \
+            stats->handler_arg = (node)->handler_ctx->arg; \
+            stats->invoked = (node)->invoked; \
+            stats->time_us = (node)->time; \
+            latency_get_stats(&(node)->run_time, &stats->run_time); \
+        } \
+        count++; \
+    } while (0)
+
+    xSemaphoreTakeRecursive(loop->mutex, portMAX_DELAY);
+    xSemaphoreTake(loop->profiling_mutex, portMAX_DELAY);
+
+    if (loop_stats != NULL) {
+        loop_stats->events_received = atomic_load(&loop->events_recieved);
+        loop_stats->events_dropped = atomic_load(&loop->events_dropped);
+        loop_stats->queue_high_water = loop->queue_high_water;
+        latency_get_stats(&loop->dispatch_latency, &loop_stats->dispatch_latency);
+    }
+
+    SLIST_FOREACH(loop_node, &(loop->loop_nodes), next) {
+        SLIST_FOREACH(handler, &(loop_node->handlers), next) {
+            HANDLER_STATS_ADD(ESP_EVENT_ANY_BASE, ESP_EVENT_ANY_ID, handler);
+        }
+        SLIST_FOREACH(base_node, &(loop_node->base_nodes), next) {
+            SLIST_FOREACH(handler, &(base_node->handlers), next) {
+                HANDLER_STATS_ADD(base_node->base, ESP_EVENT_ANY_ID, handler);
+            }
+            SLIST_FOREACH(id_node, &(base_node->id_nodes), next) {
+                SLIST_FOREACH(handler, &(id_node->handlers), next) {
+                    HANDLER_STATS_ADD(base_node->base, id_node->id, handler);
+                }
+            }
+        }
+    }
+
+#undef HANDLER_STATS_ADD
+
+    xSemaphoreGive(loop->profiling_mutex);
+    xSemaphoreGiveRecursive(loop->mutex);
+
+    if (handler_count != NULL) {
+        *handler_count = count;
+    }
+
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
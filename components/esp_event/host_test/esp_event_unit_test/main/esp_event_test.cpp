@@ -8,6 +8,12 @@
 */
 
 #include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <chrono>
+#include <deque>
+#include <initializer_list>
+#include <vector>
 #include "esp_event.h"
 
 #include <catch2/catch_test_macros.hpp>
@@ -40,6 +46,80 @@ static esp_event_loop_args_t test_event_get_default_loop_args(void)
 
 void dummy_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data) { }
 
+void counting_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    (*static_cast<size_t*>(event_handler_arg))++;
+}
+
+/**
+ * In-memory replacement of the mocked event loop queue, used to dispatch events without a scheduler.
+ */
+std::deque<std::vector<uint8_t> > s_queue_items;
+size_t s_queue_item_size;
+
+QueueHandle_t queue_create_stub(const UBaseType_t uxQueueLength, const UBaseType_t uxItemSize, const uint8_t ucQueueType, int cmock_num_calls)
+{
+    s_queue_item_size = uxItemSize;
+    return reinterpret_cast<QueueHandle_t>(0xdeadbeef);
+}
+
+BaseType_t queue_send_stub(QueueHandle_t xQueue, const void * const pvItemToQueue, TickType_t xTicksToWait, const BaseType_t xCopyPosition, int cmock_num_calls)
+{
+    const uint8_t *item = static_cast<const uint8_t*>(pvItemToQueue);
+    s_queue_items.emplace_back(item, item + s_queue_item_size);
+    return pdTRUE;
+}
+
+BaseType_t queue_receive_stub(QueueHandle_t xQueue, void * const pvBuffer, TickType_t xTicksToWait, int cmock_num_calls)
+{
+    if (s_queue_items.empty()) {
+        return pdFALSE;
+    }
+    memcpy(pvBuffer, s_queue_items.front().data(), s_queue_item_size);
+    s_queue_items.pop_front();
+    return pdTRUE;
+}
+
+void queue_stubs_set(void)
+{
+    xQueueGenericCreate_Stub(queue_create_stub);
+    xQueueGenericSend_Stub(queue_send_stub);
+    xQueueReceive_Stub(queue_receive_stub);
+    vQueueDelete_Ignore();
+    xQueueTakeMutexRecursive_IgnoreAndReturn(pdTRUE);
+    xQueueGiveMutexRecursive_IgnoreAndReturn(pdTRUE);
+    xTaskGetCurrentTaskHandle_IgnoreAndReturn(nullptr);
+    xTaskGetTickCount_IgnoreAndReturn(0);
+}
+
+void queue_stubs_reset(void)
+{
+    xTaskGetTickCount_StopIgnore();
+    xTaskGetCurrentTaskHandle_StopIgnore();
+    xQueueGiveMutexRecursive_StopIgnore();
+    xQueueTakeMutexRecursive_StopIgnore();
+    vQueueDelete_StopIgnore();
+    xQueueReceive_Stub(nullptr);
+    xQueueGenericSend_Stub(nullptr);
+    xQueueGenericCreate_Stub(nullptr);
+}
+
+/**
+ * Posts event_count events in rounds filling the queue and dispatches them, returns the events dispatched per second.
+ */
+double dispatch_rate(esp_event_loop_handle_t loop, esp_event_base_t base, int32_t id, size_t event_count)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (size_t posted = 0; posted < event_count; posted += QUEUE_SIZE) {
+        for (size_t i = 0; i < QUEUE_SIZE; i++) {
+            REQUIRE(ESP_OK == esp_event_post_to(loop, base, id, nullptr, 0, 0));
+        }
+        REQUIRE(ESP_OK == esp_event_loop_run(loop, portMAX_DELAY));
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return event_count / elapsed.count();
+}
+
 }
 
 // TODO: IDF-2693, function definition just to satisfy linker, implement esp_common instead
@@ -149,3 +229,72 @@ TEST_CASE("registering with ANY_BASE but specific ID fails")
                                           dummy_handler,
                                           nullptr) == ESP_ERR_INVALID_ARG);
 }
+
+ESP_EVENT_DEFINE_BASE(s_bench_base0);
+ESP_EVENT_DEFINE_BASE(s_bench_base1);
+ESP_EVENT_DEFINE_BASE(s_bench_base2);
+ESP_EVENT_DEFINE_BASE(s_bench_base3);
+
+TEST_CASE("benchmark event dispatch with increasing number of registered handlers")
+{
+    const esp_event_base_t bases[] = { s_bench_base0, s_bench_base1, s_bench_base2, s_bench_base3 };
+    const size_t BASE_COUNT = sizeof(bases) / sizeof(bases[0]);
+    const size_t EVENT_COUNT = 64 * QUEUE_SIZE;
+
+    CMockFix fix;
+    MockMutex sem(CreateAnd::IGNORE);
+    queue_stubs_set();
+
+    for (size_t handler_count : { 1, 10, 100, 1000 }) {
+        esp_event_loop_handle_t loop = nullptr;
+        esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+        loop_args.task_name = nullptr;
+        REQUIRE(ESP_OK == esp_event_loop_create(&loop_args, &loop));
+
+        // Spread the handlers over several bases and ids, the event posted is handled by the last one
+        size_t executed = 0;
+        for (size_t i = 0; i < handler_count; i++) {
+            REQUIRE(ESP_OK == esp_event_handler_register_with(loop, bases[i % BASE_COUNT], i / BASE_COUNT, counting_handler, &executed));
+        }
+        esp_event_base_t base = bases[(handler_count - 1) % BASE_COUNT];
+        int32_t id = (handler_count - 1) / BASE_COUNT;
+
+        double rate = dispatch_rate(loop, base, id, EVENT_COUNT);
+
+        CHECK(executed == EVENT_COUNT);
+        printf("%4zu handlers registered: %.0f events/s\n", handler_count, rate);
+
+        CHECK(ESP_OK == esp_event_loop_delete(loop));
+    }
+
+    queue_stubs_reset();
+}
+
+TEST_CASE("benchmark event dispatch with increasing batch size")
+{
+    const size_t EVENT_COUNT = 64 * QUEUE_SIZE;
+
+    CMockFix fix;
+    MockMutex sem(CreateAnd::IGNORE);
+    queue_stubs_set();
+
+    for (uint32_t batch_size : { 1, 4, 16, 32 }) {
+        esp_event_loop_handle_t loop = nullptr;
+        esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+        loop_args.task_name = nullptr;
+        loop_args.batch_size = batch_size;
+        REQUIRE(ESP_OK == esp_event_loop_create(&loop_args, &loop));
+
+        size_t executed = 0;
+        REQUIRE(ESP_OK == esp_event_handler_register_with(loop, s_bench_base0, 0, counting_handler, &executed));
+
+        double rate = dispatch_rate(loop, s_bench_base0, 0, EVENT_COUNT);
+
+        CHECK(executed == EVENT_COUNT);
+        printf("batch size %2" PRIu32 ": %.0f events/s\n", batch_size, rate);
+
+        CHECK(ESP_OK == esp_event_loop_delete(loop));
+    }
+
+    queue_stubs_reset();
+}
@@ -29,6 +29,19 @@ typedef struct {
     uint32_t task_stack_size;                   /**< stack size of the event loop task, ignored if task name is NULL */
     BaseType_t task_core_id;                    /**< core to which the event loop task is pinned to,
                                                         ignored if task name is NULL */
+    size_t data_pool_block_size;                /**< size of the blocks of the event data pool of the loop; posted event
+                                                        data which fits into a free block is copied there instead of
+                                                        into memory allocated from the heap */
+    size_t data_pool_block_count;               /**< number of blocks of the event data pool of the loop, the loop
+                                                        has no pool if this or the block size is 0 */
+    uint32_t batch_size;                        /**< maximum number of queued events dispatched in a row without
+                                                        releasing the lock of the loop, 0 is the same as 1 */
+    uint32_t task_count;                        /**< number of tasks running the loop, 0 is the same as 1. Several
+                                                        tasks require CONFIG_ESP_EVENT_LOOP_MULTI_TASK; events with
+                                                        the same base and id are dispatched by the same task in the
+                                                        order they were posted. Unregistering a handler waits until
+                                                        the other tasks are done executing it. Ignored if task name
+                                                        is NULL */
 } esp_event_loop_args_t;
 
 /**
@@ -102,6 +115,7 @@ esp_err_t esp_event_loop_delete_default(void);
  *
  * @return
  *  - ESP_OK: Success
+ *  - ESP_ERR_INVALID_STATE: The loop is run by several dedicated tasks
  *  - Others: Fail
  */
 esp_err_t esp_event_loop_run(esp_event_loop_handle_t event_loop, TickType_t ticks_to_run);
@@ -395,6 +409,57 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop,
                             size_t event_data_size,
                             TickType_t ticks_to_wait);
 
+/**
+ * @brief Posts an event to the system default event loop without copying the event data.
+ *
+ * The ownership of event_data passes to the event loop if the event is posted successfully. The event loop
+ * calls release with event_data once the handlers have been executed for the event, or when the event is
+ * dropped because the loop is deleted. The handlers receive event_data itself.
+ *
+ * @param[in] event_base the event base that identifies the event
+ * @param[in] event_id the event ID that identifies the event
+ * @param[in] event_data the data, specific to the event occurrence, that gets passed to the handler
+ * @param[in] release function releasing event_data, can be NULL if event_data outlives the event
+ * @param[in] ticks_to_wait number of ticks to block on a full event queue
+ *
+ * @return
+ *  - ESP_OK: Success
+ *  - ESP_ERR_TIMEOUT: Time to wait for event queue to unblock expired, event_data is still owned by the caller
+ *  - ESP_ERR_INVALID_ARG: Invalid combination of event base and event ID
+ *  - Others: Fail
+ */
+esp_err_t esp_event_post_no_copy(esp_event_base_t event_base,
+                                 int32_t event_id,
+                                 void *event_data,
+                                 esp_event_data_release_t release,
+                                 TickType_t ticks_to_wait);
+
+/**
+ * @brief Posts an event to the specified event loop without copying the event data.
+ *
+ * This function behaves in the same manner as esp_event_post_no_copy, except the additional specification of
+ * the event loop to post the event to.
+ *
+ * @param[in] event_loop the event loop to post to, must not be NULL
+ * @param[in] event_base the event base that identifies the event
+ * @param[in] event_id the event ID that identifies the event
+ * @param[in] event_data the data, specific to the event occurrence, that gets passed to the handler
+ * @param[in] release function releasing event_data, can be NULL if event_data outlives the event
+ * @param[in] ticks_to_wait number of ticks to block on a full event queue
+ *
+ * @return
+ *  - ESP_OK: Success
+ *  - ESP_ERR_TIMEOUT: Time to wait for event queue to unblock expired, event_data is still owned by the caller
+ *  - ESP_ERR_INVALID_ARG: Invalid combination of event base and event ID
+ *  - Others: Fail
+ */
+esp_err_t esp_event_post_to_no_copy(esp_event_loop_handle_t event_loop,
+                                    esp_event_base_t event_base,
+                                    int32_t event_id,
+                                    void *event_data,
+                                    esp_event_data_release_t release,
+                                    TickType_t ticks_to_wait);
+
 #if CONFIG_ESP_EVENT_POST_FROM_ISR
 /**
  * @brief Special variant of esp_event_post for posting events from interrupt handlers.
@@ -501,6 +566,71 @@ esp_err_t esp_event_isr_post_to(esp_event_loop_handle_t event_loop,
  */
 esp_err_t esp_event_dump(FILE *file);
 
+/// Number of buckets of the duration histograms in event loop statistics
+#define ESP_EVENT_LATENCY_BUCKETS   16
+
+/**
+ * @brief Distribution of durations, in microseconds
+ *
+ * Bucket 0 counts durations shorter than 1 us, bucket i counts durations from 2^(i-1) us up to 2^i us excluded,
+ * and the last bucket also counts all longer durations. The percentiles are estimated from the histogram: they are
+ * the upper bound of the bucket they fall into, limited to the range of the recorded durations.
+ */
+typedef struct {
+    uint32_t count;                                 /**< number of recorded durations */
+    uint32_t min_us;                                /**< shortest duration, 0 if none was recorded */
+    uint32_t max_us;                                /**< longest duration */
+    uint32_t p50_us;                                /**< estimated median */
+    uint32_t p99_us;                                /**< estimated 99th percentile */
+    uint32_t buckets[ESP_EVENT_LATENCY_BUCKETS];    /**< histogram of the durations */
+} esp_event_latency_stats_t;
+
+/// Statistics of a handler registered to an event loop
+typedef struct {
+    esp_event_base_t base;                          /**< base of the events the handler is registered for,
+                                                         ESP_EVENT_ANY_BASE for all bases */
+    int32_t id;                                     /**< ID of the events the handler is registered for,
+                                                         ESP_EVENT_ANY_ID for all IDs */
+    esp_event_handler_t handler;                    /**< the handler function */
+    void *handler_arg;                              /**< argument passed to the handler */
+    uint32_t invoked;                               /**< number of times the handler has been invoked */
+    int64_t time_us;                                /**< total run time of the handler */
+    esp_event_latency_stats_t run_time;             /**< distribution of the run time of the handler */
+} esp_event_handler_stats_t;
+
+/// Statistics of an event loop
+typedef struct {
+    uint32_t events_received;                       /**< number of events successfully posted to the loop */
+    uint32_t events_dropped;                        /**< number of events dropped due to the queue being full */
+    uint32_t queue_high_water;                      /**< highest number of queued events, including the one
+                                                         being dispatched, seen when dispatching an event */
+    esp_event_latency_stats_t dispatch_latency;     /**< distribution of the time from posting events to
+                                                         dispatching them */
+} esp_event_loop_stats_t;
+
+/**
+ * @brief Gets the statistics of an event loop and of its handlers
+ *
+ * Unlike esp_event_dump, the statistics are returned as structures, which can be forwarded to monitoring
+ * without parsing text. The counters are cumulative since the loop was created.
+ *
+ * @param[in] event_loop event loop to get the statistics of, must not be NULL
+ * @param[out] loop_stats statistics of the loop, can be NULL
+ * @param[out] handler_stats array receiving the statistics of the registered handlers, can be NULL
+ * @param[inout] handler_count number of entries of handler_stats on input, number of registered handlers on output,
+ *               which may be larger. Can be NULL if handler_stats is NULL.
+ *
+ * @note The run time of a handler is only recorded while it is registered, and the percentiles are estimates,
+ *       see esp_event_latency_stats_t
+ *
+ * @return
+ *  - ESP_OK: Success
+ *  - ESP_ERR_INVALID_ARG: handler_stats is not NULL but handler_count is
+ *  - ESP_ERR_NOT_SUPPORTED: CONFIG_ESP_EVENT_LOOP_PROFILING is disabled
+ */
+esp_err_t esp_event_loop_get_stats(esp_event_loop_handle_t event_loop, esp_event_loop_stats_t *loop_stats,
+                                   esp_event_handler_stats_t *handler_stats, size_t *handler_count);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -24,6 +24,8 @@ typedef void (*esp_event_handler_t)(void* event_handler_arg,
                                     int32_t event_id,
                                     void* event_data); /**< function called when an event is posted to the queue */
 typedef void*        esp_event_handler_instance_t; /**< context identifying an instance of a registered event handler */
+typedef void (*esp_event_data_release_t)(void* event_data); /**< function called when the event loop is done with
+                                                                 event data posted without copy */
 
 // Defines for registering/unregistering event handlers
 #define ESP_EVENT_ANY_BASE     NULL             /**< register handler for any event base */
@@ -18,9 +18,25 @@ extern "C" {
 
 typedef SLIST_HEAD(base_nodes, base_node) base_nodes_t;
 
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+/// Distribution of durations in microseconds, see esp_event_latency_stats_t for the bucket bounds
+typedef struct esp_event_latency {
+    uint32_t count;                                                 /**< number of durations recorded */
+    uint32_t min;                                                   /**< shortest duration */
+    uint32_t max;                                                   /**< longest duration */
+    uint32_t buckets[ESP_EVENT_LATENCY_BUCKETS];                    /**< histogram of the durations */
+} esp_event_latency_t;
+#endif
+
 typedef struct esp_event_handler_context {
     esp_event_handler_t handler;                                    /**< event handler function*/
     void* arg;
+#ifdef CONFIG_ESP_EVENT_LOOP_MULTI_TASK
+    atomic_uint refs;                                               /**< 1 while registered, plus the number of events
+                                                                            received by tasks of the loop which are
+                                                                            still to be dispatched to the handler */
+    atomic_bool removed;                                            /**< set once the handler is unregistered */
+#endif
 } esp_event_handler_instance_context_t;                             /**< event handler argument */
 
 /// Event handler
@@ -29,6 +45,11 @@ typedef struct esp_event_handler_node {
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     uint32_t invoked;                                               /**< number of times this handler has been invoked */
     int64_t time;                                                   /**< total runtime of this handler across all calls */
+    esp_event_latency_t run_time;                                   /**< distribution of the runtime of this handler */
+#endif
+#ifdef CONFIG_ESP_EVENT_LOOP_DISPATCH_INDEX
+    uint32_t generation;                                            /**< tells this handler from a later one
+                                                                            allocated at the same address */
 #endif
     SLIST_ENTRY(esp_event_handler_node) next;                   /**< next event handler in the list */
 } esp_event_handler_node_t;
@@ -65,6 +86,30 @@ typedef struct esp_event_loop_node {
 
 typedef SLIST_HEAD(esp_event_loop_nodes, esp_event_loop_node) esp_event_loop_nodes_t;
 
+#ifdef CONFIG_ESP_EVENT_LOOP_DISPATCH_INDEX
+/// Handler in the handler list of an event
+typedef struct esp_event_dispatch_handler {
+    esp_event_handler_node_t* node;                                 /**< handler */
+    uint32_t generation;                                            /**< generation of the handler when the list
+                                                                            was built */
+} esp_event_dispatch_handler_t;
+
+/// Handlers of one event, in the order they are executed
+typedef struct esp_event_dispatch_entry {
+    esp_event_base_t base;                                          /**< base identifier of the event */
+    int32_t id;                                                     /**< id number of the event */
+    uint32_t handlers_version;                                      /**< handlers version of the loop the list was
+                                                                            built for, 0 if the entry is unused */
+    size_t handler_count;                                           /**< number of handlers in the list */
+    size_t handler_capacity;                                        /**< number of handlers the list can hold */
+    esp_event_dispatch_handler_t* handlers;                         /**< handlers to be executed for the event */
+} esp_event_dispatch_entry_t;
+#endif
+
+#ifdef CONFIG_ESP_EVENT_LOOP_MULTI_TASK
+struct esp_event_loop_worker;
+#endif
+
 /// Event loop
 typedef struct esp_event_loop_instance {
     const char* name;                                               /**< name of this event loop */
@@ -75,10 +120,34 @@ typedef struct esp_event_loop_instance {
     SemaphoreHandle_t mutex;                                        /**< mutex for updating the events linked list */
     esp_event_loop_nodes_t loop_nodes;                              /**< set of linked lists containing the
                                                                             registered handlers for the loop */
+#ifdef CONFIG_ESP_EVENT_LOOP_DISPATCH_INDEX
+    esp_event_dispatch_entry_t* dispatch_index;                     /**< handler lists of recently dispatched events,
+                                                                            hashed by event base and id */
+    uint32_t handlers_version;                                      /**< changed on every handler registration and
+                                                                            unregistration */
+    uint32_t dispatch_depth;                                        /**< number of events being dispatched by the
+                                                                            task running the loop */
+#endif
+    uint8_t* data_pool;                                             /**< blocks of the event data pool, NULL if
+                                                                            the loop has no pool */
+    size_t data_pool_block_size;                                    /**< size of the event data pool blocks */
+    size_t data_pool_block_count;                                   /**< number of event data pool blocks */
+    atomic_uint_least32_t* data_pool_free;                          /**< bitmap of free event data pool blocks */
+    size_t batch_size;                                              /**< maximum number of events dispatched while
+                                                                            holding the mutex */
+#ifdef CONFIG_ESP_EVENT_LOOP_MULTI_TASK
+    struct esp_event_loop_worker* workers;                          /**< tasks running the loop, NULL if the loop
+                                                                            has a single or no dedicated task */
+    size_t worker_count;                                            /**< number of tasks running the loop */
+#endif
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     atomic_uint_least32_t events_recieved;                          /**< number of events successfully posted to the loop */
     atomic_uint_least32_t events_dropped;                           /**< number of events dropped due to queue being full */
     SemaphoreHandle_t profiling_mutex;                              /**< mutex used for profiliing */
+    uint32_t queue_high_water;                                      /**< highest number of queued events seen when
+                                                                            dispatching an event */
+    esp_event_latency_t dispatch_latency;                           /**< distribution of the time from posting to
+                                                                            dispatching events */
     SLIST_ENTRY(esp_event_loop_instance) next;                      /**< next event loop in the list */
 #endif
 } esp_event_loop_instance_t;
@@ -95,14 +164,45 @@ typedef void* esp_event_post_data_t;
 /// Event posted to the event queue
 typedef struct esp_event_post_instance {
 #if CONFIG_ESP_EVENT_POST_FROM_ISR
-    bool data_allocated;                                             /**< indicates whether data is allocated from heap */
+    bool data_allocated;                                             /**< indicates whether data points to a buffer */
     bool data_set;                                                   /**< indicates if data is null */
 #endif
     esp_event_base_t base;                                           /**< the event base */
     int32_t id;                                                      /**< the event id */
     esp_event_post_data_t data;                                      /**< data associated with the event */
+    esp_event_data_release_t release;                                /**< releases data posted without copy, NULL if
+                                                                            the data is owned by the loop */
+#ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
+    int64_t post_time;                                               /**< time the event was posted */
+#endif
 } esp_event_post_instance_t;
 
+#ifdef CONFIG_ESP_EVENT_LOOP_MULTI_TASK
+/// Handler copied from the registered handlers, executed without holding the loop mutex
+typedef struct esp_event_handler_snapshot {
+    esp_event_handler_t handler;                                     /**< event handler function */
+    void* arg;                                                       /**< event handler argument */
+    esp_event_handler_instance_context_t* ctx;                       /**< registration of the handler, referenced
+                                                                            until the handler is executed or skipped */
+} esp_event_handler_snapshot_t;
+
+/// One of several tasks running an event loop
+typedef struct esp_event_loop_worker {
+    esp_event_loop_instance_t* loop;                                 /**< the loop the task runs */
+    QueueHandle_t queue;                                             /**< events dispatched by this task */
+    TaskHandle_t task;                                               /**< the task */
+    SemaphoreHandle_t mutex;                                         /**< held while the task dispatches events */
+    esp_event_post_instance_t* posts;                                /**< events received by the task */
+    size_t post_count;                                               /**< number of events received by the task */
+    size_t* handler_counts;                                          /**< number of handlers of each received event */
+    esp_event_handler_snapshot_t* handlers;                          /**< handlers of the received events */
+    size_t handler_capacity;                                         /**< number of handlers the list can hold */
+    size_t handler_total;                                            /**< number of handlers in the list, 0 unless
+                                                                            the task dispatches from the list */
+    size_t handler_index;                                            /**< handler of the list being executed */
+} esp_event_loop_worker_t;
+#endif
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
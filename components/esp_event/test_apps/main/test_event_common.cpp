@@ -897,6 +897,132 @@ TEST_CASE("handler instance can unregister itself", "[event][linux]")
     TEST_ASSERT_EQUAL(1, test_data.count);
 }
 
+#if CONFIG_ESP_EVENT_LOOP_DISPATCH_INDEX
+// Without the dispatch index, the handler list may not be changed beyond the running handler during dispatch
+static void test_handler_instance_unregister_other(void* event_handler_arg,
+                                                   esp_event_base_t event_base,
+                                                   int32_t event_id,
+                                                   void* event_data)
+{
+    unregister_test_data_t *test_data = (unregister_test_data_t*) event_handler_arg;
+
+    // Unregister the handler executed after this one
+    if (test_data->context) {
+        TEST_ESP_OK(esp_event_handler_instance_unregister_with(test_data->loop, event_base, event_id, test_data->context));
+        test_data->context = NULL;
+    }
+}
+
+TEST_CASE("handler unregistered by earlier handler of same event is not executed", "[event][linux]")
+{
+    EV_LoopFix loop_fix;
+
+    unregister_test_data_t test_data = {
+        .context = NULL,
+        .loop = loop_fix.loop,
+        .count = 0,
+    };
+
+    int count = 0;
+    esp_event_handler_instance_t ctx_unregister;
+    esp_event_handler_instance_t ctx_inc;
+
+    TEST_ESP_OK(esp_event_handler_instance_register_with(loop_fix.loop,
+                                                         s_test_base1,
+                                                         TEST_EVENT_BASE1_EV1,
+                                                         test_handler_instance_unregister_other,
+                                                         &test_data,
+                                                         &ctx_unregister));
+    TEST_ESP_OK(esp_event_handler_instance_register_with(loop_fix.loop,
+                                                         s_test_base1,
+                                                         TEST_EVENT_BASE1_EV1,
+                                                         test_handler_inc,
+                                                         &count,
+                                                         &ctx_inc));
+
+    // The first event is dispatched to both handlers
+    TEST_ESP_OK(esp_event_post_to(loop_fix.loop, s_test_base1, TEST_EVENT_BASE1_EV1, NULL, 0, portMAX_DELAY));
+    TEST_ESP_OK(esp_event_loop_run(loop_fix.loop, ZERO_DELAY));
+    TEST_ASSERT_EQUAL(1, count);
+
+    test_data.context = ctx_inc;
+
+    TEST_ESP_OK(esp_event_post_to(loop_fix.loop, s_test_base1, TEST_EVENT_BASE1_EV1, NULL, 0, portMAX_DELAY));
+    TEST_ESP_OK(esp_event_post_to(loop_fix.loop, s_test_base1, TEST_EVENT_BASE1_EV1, NULL, 0, portMAX_DELAY));
+    TEST_ESP_OK(esp_event_loop_run(loop_fix.loop, ZERO_DELAY));
+
+    TEST_ASSERT_EQUAL(1, count);
+    TEST_ASSERT_NULL(test_data.context);
+
+    TEST_ESP_OK(esp_event_handler_instance_unregister_with(loop_fix.loop, s_test_base1, TEST_EVENT_BASE1_EV1, ctx_unregister));
+}
+
+typedef struct {
+    esp_event_loop_handle_t loop;
+    esp_event_handler_instance_t replaced;
+    esp_event_handler_instance_t replacement;
+    int replaced_count;
+    int replacement_count;
+} replace_test_data_t;
+
+static void test_handler_replaced(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    ((replace_test_data_t*) event_handler_arg)->replaced_count++;
+}
+
+static void test_handler_replacement(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    ((replace_test_data_t*) event_handler_arg)->replacement_count++;
+}
+
+static void test_handler_replace_other(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    replace_test_data_t *test_data = (replace_test_data_t*) event_handler_arg;
+
+    // Unregister the handler executed after this one and register another one, which is likely to get the memory
+    // of the unregistered handler node
+    if (test_data->replaced) {
+        TEST_ESP_OK(esp_event_handler_instance_unregister_with(test_data->loop, event_base, event_id, test_data->replaced));
+        test_data->replaced = NULL;
+        TEST_ESP_OK(esp_event_handler_instance_register_with(test_data->loop, event_base, event_id, test_handler_replacement,
+                                                             test_data, &test_data->replacement));
+    }
+}
+
+TEST_CASE("handler registered in place of one unregistered during dispatch is not executed", "[event][linux]")
+{
+    EV_LoopFix loop_fix;
+
+    replace_test_data_t test_data = {
+        .loop = loop_fix.loop,
+        .replaced = NULL,
+        .replacement = NULL,
+        .replaced_count = 0,
+        .replacement_count = 0,
+    };
+
+    esp_event_handler_instance_t ctx_replace;
+    TEST_ESP_OK(esp_event_handler_instance_register_with(loop_fix.loop, s_test_base1, TEST_EVENT_BASE1_EV1,
+                                                         test_handler_replace_other, &test_data, &ctx_replace));
+    TEST_ESP_OK(esp_event_handler_instance_register_with(loop_fix.loop, s_test_base1, TEST_EVENT_BASE1_EV1,
+                                                         test_handler_replaced, &test_data, &test_data.replaced));
+
+    TEST_ESP_OK(esp_event_post_to(loop_fix.loop, s_test_base1, TEST_EVENT_BASE1_EV1, NULL, 0, portMAX_DELAY));
+    TEST_ESP_OK(esp_event_loop_run(loop_fix.loop, ZERO_DELAY));
+    TEST_ASSERT_EQUAL(0, test_data.replaced_count);
+    TEST_ASSERT_EQUAL(0, test_data.replacement_count);
+
+    // The new handler is executed for the next event
+    TEST_ESP_OK(esp_event_post_to(loop_fix.loop, s_test_base1, TEST_EVENT_BASE1_EV1, NULL, 0, portMAX_DELAY));
+    TEST_ESP_OK(esp_event_loop_run(loop_fix.loop, ZERO_DELAY));
+    TEST_ASSERT_EQUAL(0, test_data.replaced_count);
+    TEST_ASSERT_EQUAL(1, test_data.replacement_count);
+
+    TEST_ESP_OK(esp_event_handler_instance_unregister_with(loop_fix.loop, s_test_base1, TEST_EVENT_BASE1_EV1, ctx_replace));
+    TEST_ESP_OK(esp_event_handler_instance_unregister_with(loop_fix.loop, s_test_base1, TEST_EVENT_BASE1_EV1, test_data.replacement));
+}
+#endif // CONFIG_ESP_EVENT_LOOP_DISPATCH_INDEX
+
 typedef struct {
     size_t counter;
     size_t test_data[4];
@@ -1385,6 +1511,233 @@ static void save_ev_data(void* handler_arg, esp_event_base_t base, int32_t id, v
     }
 }
 
+typedef struct {
+    int next[3];
+    int errors;
+    SemaphoreHandle_t dispatched;
+} ordered_events_test_data_t;
+
+static void test_handler_check_order(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    ordered_events_test_data_t *test_data = (ordered_events_test_data_t*) event_handler_arg;
+    int *next = &(test_data->next[event_base == s_test_base1 ? event_id : 2]);
+
+    if (*((int*) event_data) != *next) {
+        (test_data->errors)++;
+    }
+    (*next)++;
+
+    if (test_data->dispatched) {
+        xSemaphoreGive(test_data->dispatched);
+    }
+}
+
+TEST_CASE("events are dispatched in batches in the order they are posted", "[event][linux]")
+{
+    esp_event_loop_handle_t loop;
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+    loop_args.task_name = NULL;
+    loop_args.queue_size = 16;
+    loop_args.batch_size = 4;
+    TEST_ESP_OK(esp_event_loop_create(&loop_args, &loop));
+
+    ordered_events_test_data_t test_data = {};
+    TEST_ESP_OK(esp_event_handler_register_with(loop, s_test_base1, TEST_EVENT_BASE1_EV1, test_handler_check_order, &test_data));
+
+    for (int i = 0; i < 10; i++) {
+        TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, &i, sizeof(i), portMAX_DELAY));
+    }
+
+    // Running the loop for no time dispatches a single event
+    TEST_ESP_OK(esp_event_loop_run(loop, ZERO_DELAY));
+    TEST_ASSERT_EQUAL(1, test_data.next[TEST_EVENT_BASE1_EV1]);
+
+    TEST_ESP_OK(esp_event_loop_run(loop, pdMS_TO_TICKS(10)));
+    TEST_ASSERT_EQUAL(10, test_data.next[TEST_EVENT_BASE1_EV1]);
+    TEST_ASSERT_EQUAL(0, test_data.errors);
+
+    TEST_ESP_OK(esp_event_loop_delete(loop));
+}
+
+#if CONFIG_ESP_EVENT_LOOP_MULTI_TASK
+TEST_CASE("loop with several tasks dispatches events with same base and id in order", "[event][linux]")
+{
+    const int EVENT_COUNT = 30;
+
+    esp_event_loop_handle_t loop;
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+    loop_args.queue_size = 8;
+    loop_args.batch_size = 4;
+    loop_args.task_count = 3;
+    TEST_ESP_OK(esp_event_loop_create(&loop_args, &loop));
+
+    ordered_events_test_data_t test_data = {};
+    test_data.dispatched = xSemaphoreCreateCounting(3 * EVENT_COUNT, 0);
+    TEST_ASSERT(test_data.dispatched);
+
+    TEST_ESP_OK(esp_event_handler_register_with(loop, ESP_EVENT_ANY_BASE, ESP_EVENT_ANY_ID, test_handler_check_order, &test_data));
+
+    for (int i = 0; i < EVENT_COUNT; i++) {
+        TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, &i, sizeof(i), portMAX_DELAY));
+        TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV2, &i, sizeof(i), portMAX_DELAY));
+        TEST_ESP_OK(esp_event_post_to(loop, s_test_base2, TEST_EVENT_BASE2_EV1, &i, sizeof(i), portMAX_DELAY));
+    }
+
+    for (int i = 0; i < 3 * EVENT_COUNT; i++) {
+        TEST_ASSERT_EQUAL(pdTRUE, xSemaphoreTake(test_data.dispatched, pdMS_TO_TICKS(1000)));
+    }
+
+    TEST_ESP_OK(esp_event_loop_delete(loop));
+
+    TEST_ASSERT_EQUAL(EVENT_COUNT, test_data.next[0]);
+    TEST_ASSERT_EQUAL(EVENT_COUNT, test_data.next[1]);
+    TEST_ASSERT_EQUAL(EVENT_COUNT, test_data.next[2]);
+    TEST_ASSERT_EQUAL(0, test_data.errors);
+
+    vSemaphoreDelete(test_data.dispatched);
+}
+
+TEST_CASE("loop with several tasks can not be run by another task", "[event][linux]")
+{
+    esp_event_loop_handle_t loop;
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+    loop_args.task_count = 2;
+    TEST_ESP_OK(esp_event_loop_create(&loop_args, &loop));
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, esp_event_loop_run(loop, ZERO_DELAY));
+
+    TEST_ESP_OK(esp_event_loop_delete(loop));
+}
+
+typedef struct {
+    SemaphoreHandle_t started;
+    volatile bool done;
+} slow_handler_test_data_t;
+
+static void test_handler_slow(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    slow_handler_test_data_t *test_data = (slow_handler_test_data_t*) event_handler_arg;
+
+    xSemaphoreGive(test_data->started);
+    vTaskDelay(pdMS_TO_TICKS(50));
+    test_data->done = true;
+}
+
+TEST_CASE("unregistering waits for the handler executed by another task of the loop", "[event][linux]")
+{
+    esp_event_loop_handle_t loop;
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+    loop_args.task_count = 2;
+    TEST_ESP_OK(esp_event_loop_create(&loop_args, &loop));
+
+    slow_handler_test_data_t test_data = {};
+    test_data.started = xSemaphoreCreateBinary();
+    TEST_ASSERT(test_data.started);
+
+    esp_event_handler_instance_t instance;
+    TEST_ESP_OK(esp_event_handler_instance_register_with(loop, s_test_base1, TEST_EVENT_BASE1_EV1, test_handler_slow, &test_data, &instance));
+    TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, NULL, 0, portMAX_DELAY));
+    TEST_ASSERT_EQUAL(pdTRUE, xSemaphoreTake(test_data.started, pdMS_TO_TICKS(1000)));
+
+    // The handler argument may be released once the handler is unregistered
+    TEST_ESP_OK(esp_event_handler_instance_unregister_with(loop, s_test_base1, TEST_EVENT_BASE1_EV1, instance));
+    TEST_ASSERT_TRUE(test_data.done);
+
+    TEST_ESP_OK(esp_event_loop_delete(loop));
+    vSemaphoreDelete(test_data.started);
+}
+
+TEST_CASE("handler instance unregistering itself is not executed for the rest of the batch", "[event][linux]")
+{
+    esp_event_loop_handle_t loop;
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+    loop_args.batch_size = 4;
+    loop_args.task_count = 2;
+    TEST_ESP_OK(esp_event_loop_create(&loop_args, &loop));
+
+    unregister_test_data_t test_data = {
+        .context = NULL,
+        .loop = loop,
+        .count = 0,
+    };
+
+    TEST_ESP_OK(esp_event_handler_instance_register_with(loop,
+                                                         s_test_base1,
+                                                         TEST_EVENT_BASE1_EV1,
+                                                         test_handler_instance_unregister_itself,
+                                                         &test_data,
+                                                         &(test_data.context)));
+
+    // The loop tasks do not preempt this task, they receive the events in a single batch
+    for (int i = 0; i < 3; i++) {
+        TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, NULL, 0, portMAX_DELAY));
+    }
+    vTaskDelay(pdMS_TO_TICKS(10));
+
+    TEST_ASSERT_EQUAL(1, test_data.count);
+
+    TEST_ESP_OK(esp_event_loop_delete(loop));
+}
+#endif // CONFIG_ESP_EVENT_LOOP_MULTI_TASK
+
+#if CONFIG_ESP_EVENT_LOOP_PROFILING
+TEST_CASE("loop statistics count dispatched events and handler invocations", "[event][linux]")
+{
+    EV_LoopFix loop_fix(8);
+    int count_loop = 0;
+    int count_id = 0;
+
+    TEST_ESP_OK(esp_event_handler_register_with(loop_fix.loop, ESP_EVENT_ANY_BASE, ESP_EVENT_ANY_ID, test_handler_inc, &count_loop));
+    TEST_ESP_OK(esp_event_handler_register_with(loop_fix.loop, s_test_base1, TEST_EVENT_BASE1_EV1, test_handler_inc, &count_id));
+
+    for (int i = 0; i < 5; i++) {
+        TEST_ESP_OK(esp_event_post_to(loop_fix.loop, s_test_base1, TEST_EVENT_BASE1_EV1, NULL, 0, portMAX_DELAY));
+    }
+    TEST_ESP_OK(esp_event_post_to(loop_fix.loop, s_test_base2, TEST_EVENT_BASE2_EV1, NULL, 0, portMAX_DELAY));
+    TEST_ESP_OK(esp_event_loop_run(loop_fix.loop, pdMS_TO_TICKS(10)));
+    TEST_ASSERT_EQUAL(6, count_loop);
+    TEST_ASSERT_EQUAL(5, count_id);
+
+    esp_event_loop_stats_t loop_stats;
+    esp_event_handler_stats_t handler_stats[2];
+    size_t handler_count = 1;
+
+    // The number of handlers is returned even if the array is too small
+    TEST_ESP_OK(esp_event_loop_get_stats(loop_fix.loop, &loop_stats, handler_stats, &handler_count));
+    TEST_ASSERT_EQUAL(2, handler_count);
+
+    TEST_ASSERT_EQUAL(6, loop_stats.events_received);
+    TEST_ASSERT_EQUAL(0, loop_stats.events_dropped);
+    TEST_ASSERT_EQUAL(6, loop_stats.queue_high_water);
+    TEST_ASSERT_EQUAL(6, loop_stats.dispatch_latency.count);
+    TEST_ASSERT_LESS_OR_EQUAL(loop_stats.dispatch_latency.p50_us, loop_stats.dispatch_latency.min_us);
+    TEST_ASSERT_LESS_OR_EQUAL(loop_stats.dispatch_latency.p99_us, loop_stats.dispatch_latency.p50_us);
+    TEST_ASSERT_LESS_OR_EQUAL(loop_stats.dispatch_latency.max_us, loop_stats.dispatch_latency.p99_us);
+
+    TEST_ESP_OK(esp_event_loop_get_stats(loop_fix.loop, NULL, handler_stats, &handler_count));
+    TEST_ASSERT_EQUAL(2, handler_count);
+
+    // Loop level handlers come first
+    TEST_ASSERT_EQUAL_PTR(ESP_EVENT_ANY_BASE, handler_stats[0].base);
+    TEST_ASSERT_EQUAL(ESP_EVENT_ANY_ID, handler_stats[0].id);
+    TEST_ASSERT_EQUAL_PTR(&count_loop, handler_stats[0].handler_arg);
+    TEST_ASSERT_EQUAL(6, handler_stats[0].invoked);
+    TEST_ASSERT_EQUAL(6, handler_stats[0].run_time.count);
+
+    TEST_ASSERT_EQUAL_PTR(s_test_base1, handler_stats[1].base);
+    TEST_ASSERT_EQUAL(TEST_EVENT_BASE1_EV1, handler_stats[1].id);
+    TEST_ASSERT_EQUAL_PTR(&count_id, handler_stats[1].handler_arg);
+    TEST_ASSERT_EQUAL(5, handler_stats[1].invoked);
+    TEST_ASSERT_EQUAL(5, handler_stats[1].run_time.count);
+
+    uint32_t bucket_total = 0;
+    for (int i = 0; i < ESP_EVENT_LATENCY_BUCKETS; i++) {
+        bucket_total += handler_stats[1].run_time.buckets[i];
+    }
+    TEST_ASSERT_EQUAL(5, bucket_total);
+}
+#endif // CONFIG_ESP_EVENT_LOOP_PROFILING
+
 TEST_CASE("event data null", "[event][linux]")
 {
     EV_LoopFix loop_fix;
@@ -1532,6 +1885,131 @@ TEST_CASE("event data many bytes are copied on post", "[event][linux]")
     TEST_ASSERT_EQUAL_HEX8_ARRAY(ev_data_expected, saved_ev_data.event_data, EventData::MAX_SIZE);
 }
 
+static void test_handler_sum_data(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    int *sum = (int*) event_handler_arg;
+    *sum += *((int*) event_data);
+}
+
+TEST_CASE("event data is copied into data pool or heap", "[event][linux]")
+{
+    esp_event_loop_handle_t loop;
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+    loop_args.task_name = NULL;
+    loop_args.data_pool_block_size = sizeof(int);
+    loop_args.data_pool_block_count = 2;
+    TEST_ESP_OK(esp_event_loop_create(&loop_args, &loop));
+
+    int sum = 0;
+    TEST_ESP_OK(esp_event_handler_register_with(loop, s_test_base1, TEST_EVENT_BASE1_EV1, test_handler_sum_data, &sum));
+
+    // The third event finds the pool exhausted, the last one does not fit into a block
+    int ev_data[8] = {1, 2, 4, 8};
+    for (int round = 0; round < 2; round++) {
+        for (int i = 0; i < 3; i++) {
+            TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, &ev_data[i], sizeof(int), portMAX_DELAY));
+        }
+        TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, &ev_data[3], sizeof(ev_data) - 3 * sizeof(int), portMAX_DELAY));
+        memset(ev_data, 0, sizeof(ev_data));
+        TEST_ESP_OK(esp_event_loop_run(loop, ZERO_DELAY));
+        TEST_ESP_OK(esp_event_loop_run(loop, ZERO_DELAY));
+        TEST_ESP_OK(esp_event_loop_run(loop, ZERO_DELAY));
+        TEST_ESP_OK(esp_event_loop_run(loop, ZERO_DELAY));
+
+        TEST_ASSERT_EQUAL(15, sum);
+        ev_data[0] = 1;
+        ev_data[1] = 2;
+        ev_data[2] = 4;
+        ev_data[3] = 8;
+        sum = 0;
+    }
+
+    TEST_ESP_OK(esp_event_loop_delete(loop));
+}
+
+typedef struct {
+    int data;
+    int released;
+} no_copy_test_data_t;
+
+static void test_release_no_copy_data(void* event_data)
+{
+    no_copy_test_data_t *test_data = (no_copy_test_data_t*) event_data;
+    (test_data->released)++;
+}
+
+static void test_handler_check_no_copy_data(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    no_copy_test_data_t *test_data = (no_copy_test_data_t*) event_handler_arg;
+    TEST_ASSERT_EQUAL_PTR(test_data, event_data);
+    TEST_ASSERT_EQUAL(0, test_data->released);
+    (test_data->data)++;
+}
+
+TEST_CASE("event data posted without copy is released after dispatch", "[event][linux]")
+{
+    EV_LoopFix loop_fix;
+    no_copy_test_data_t test_data = {
+        .data = 0,
+        .released = 0,
+    };
+
+    TEST_ESP_OK(esp_event_handler_register_with(loop_fix.loop,
+                                                s_test_base1,
+                                                TEST_EVENT_BASE1_EV1,
+                                                test_handler_check_no_copy_data,
+                                                &test_data));
+    TEST_ESP_OK(esp_event_handler_register_with(loop_fix.loop,
+                                                s_test_base1,
+                                                ESP_EVENT_ANY_ID,
+                                                test_handler_check_no_copy_data,
+                                                &test_data));
+
+    TEST_ESP_OK(esp_event_post_to_no_copy(loop_fix.loop,
+                                          s_test_base1,
+                                          TEST_EVENT_BASE1_EV1,
+                                          &test_data,
+                                          test_release_no_copy_data,
+                                          portMAX_DELAY));
+    TEST_ASSERT_EQUAL(0, test_data.released);
+    TEST_ESP_OK(esp_event_loop_run(loop_fix.loop, ZERO_DELAY));
+
+    TEST_ASSERT_EQUAL(2, test_data.data);
+    TEST_ASSERT_EQUAL(1, test_data.released);
+
+    // Without release function, the data just has to outlive the event
+    TEST_ESP_OK(esp_event_post_to_no_copy(loop_fix.loop, s_test_base1, TEST_EVENT_BASE1_EV1, &test_data, NULL, portMAX_DELAY));
+    test_data.released = 0;
+    TEST_ESP_OK(esp_event_loop_run(loop_fix.loop, ZERO_DELAY));
+
+    TEST_ASSERT_EQUAL(4, test_data.data);
+    TEST_ASSERT_EQUAL(0, test_data.released);
+}
+
+TEST_CASE("event data posted without copy is released when loop is deleted", "[event][linux]")
+{
+    esp_event_loop_handle_t loop;
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+    loop_args.task_name = NULL;
+    loop_args.queue_size = 1;
+    TEST_ESP_OK(esp_event_loop_create(&loop_args, &loop));
+
+    no_copy_test_data_t test_data = {
+        .data = 0,
+        .released = 0,
+    };
+
+    TEST_ESP_OK(esp_event_post_to_no_copy(loop, s_test_base1, TEST_EVENT_BASE1_EV1, &test_data, test_release_no_copy_data, ZERO_DELAY));
+
+    // Posting to the full queue fails and leaves the data to the caller
+    TEST_ASSERT_EQUAL(ESP_ERR_TIMEOUT,
+                      esp_event_post_to_no_copy(loop, s_test_base1, TEST_EVENT_BASE1_EV1, &test_data, test_release_no_copy_data, ZERO_DELAY));
+    TEST_ASSERT_EQUAL(0, test_data.released);
+
+    TEST_ESP_OK(esp_event_loop_delete(loop));
+    TEST_ASSERT_EQUAL(1, test_data.released);
+}
+
 TEST_CASE("default loop: registering fails on uninitialized default loop", "[event][default][linux]")
 {
     esp_event_handler_instance_t instance;
@@ -1597,3 +2075,39 @@ TEST_CASE("default event loop: registering event handler instance without instan
 
     TEST_ESP_OK(esp_event_loop_delete_default());
 }
+
+#if CONFIG_ESP_EVENT_DEFAULT_LOOP_DATA_POOL_BLOCKS
+TEST_CASE("default loop: event data is copied into data pool or heap", "[event][default][linux]")
+{
+    TEST_ESP_OK(esp_event_loop_create_default());
+
+    if (TEST_PROTECT()) {
+        SemaphoreHandle_t waiter = xSemaphoreCreateBinary();
+        int sum = 0;
+
+        TEST_ESP_OK(esp_event_handler_register(s_test_base1, TEST_EVENT_BASE1_EV1, test_handler_sum_data, &sum));
+        TEST_ESP_OK(esp_event_handler_register(s_test_base1, TEST_EVENT_BASE1_EV2, test_handler_give_sem, waiter));
+
+        // More events than pool blocks, the last one does not fit into a block
+        int expected = 0;
+        for (int i = 1; i <= CONFIG_ESP_EVENT_DEFAULT_LOOP_DATA_POOL_BLOCKS + 2; i++) {
+            TEST_ESP_OK(esp_event_post(s_test_base1, TEST_EVENT_BASE1_EV1, &i, sizeof(i), portMAX_DELAY));
+            expected += i;
+        }
+        int large_data[CONFIG_ESP_EVENT_DEFAULT_LOOP_DATA_POOL_BLOCK_SIZE / sizeof(int) + 1] = { 100 };
+        TEST_ESP_OK(esp_event_post(s_test_base1, TEST_EVENT_BASE1_EV1, large_data, sizeof(large_data), portMAX_DELAY));
+        expected += 100;
+
+        // Events are dispatched in order, all the data has been summed once the last event is handled
+        TEST_ESP_OK(esp_event_post(s_test_base1, TEST_EVENT_BASE1_EV2, NULL, 0, portMAX_DELAY));
+        TEST_ASSERT_EQUAL(pdTRUE, xSemaphoreTake(waiter, pdMS_TO_TICKS(1000)));
+        TEST_ASSERT_EQUAL(expected, sum);
+
+        TEST_ESP_OK(esp_event_handler_unregister(s_test_base1, TEST_EVENT_BASE1_EV1, test_handler_sum_data));
+        TEST_ESP_OK(esp_event_handler_unregister(s_test_base1, TEST_EVENT_BASE1_EV2, test_handler_give_sem));
+        vSemaphoreDelete(waiter);
+    }
+
+    TEST_ESP_OK(esp_event_loop_delete_default());
+}
+#endif // CONFIG_ESP_EVENT_DEFAULT_LOOP_DATA_POOL_BLOCKS
@@ -1,4 +1,4 @@
-# SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+# SPDX-FileCopyrightText: 2022-2024 Espressif Systems (Shanghai) CO LTD
 # SPDX-License-Identifier: CC0-1.0
 
 import pytest
@@ -9,6 +9,15 @@ from pytest_embedded import Dut
 @pytest.mark.esp32s2
 @pytest.mark.esp32c3
 @pytest.mark.generic
+@pytest.mark.parametrize(
+    'config',
+    [
+        'default',
+        'dispatch_index',
+        'data_pool',
+        'multi_task',
+    ]
+)
 def test_esp_event(dut: Dut) -> None:
     dut.run_all_single_board_cases()
 
@@ -25,6 +34,15 @@ def test_esp_event_qemu(dut: Dut) -> None:
 
 @pytest.mark.linux
 @pytest.mark.host_test
+@pytest.mark.parametrize(
+    'config',
+    [
+        'default',
+        'dispatch_index',
+        'data_pool',
+        'multi_task',
+    ]
+)
 def test_esp_event_posix_simulator(dut: Dut) -> None:
     dut.expect_exact('Press ENTER to see the list of tests.')
     dut.write('*')
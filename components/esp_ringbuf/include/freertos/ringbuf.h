@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2023-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -41,9 +41,31 @@ typedef enum {
      * time.
      */
     RINGBUF_TYPE_BYTEBUF,
+    /**
+     * Single-producer/single-consumer byte buffers behave like byte buffers,
+     * but support only one sender and one receiver (each of them either a task
+     * or an ISR). Sending, receiving and returning data use atomic indexes
+     * instead of a critical section, and a task only blocks (on a task
+     * notification) when the buffer is full or empty. These buffers cannot be
+     * added to queue sets.
+     *
+     * Creating these buffers fails unless CONFIG_RINGBUF_SPSC_BYTEBUF is enabled.
+     * The notification used is the last one of the task's notification array
+     * (CONFIG_FREERTOS_TASK_NOTIFICATION_ARRAY_ENTRIES must be at least 2 for that),
+     * which the sending and receiving tasks should not use for anything else.
+     */
+    RINGBUF_TYPE_BYTEBUF_SPSC,
     RINGBUF_TYPE_MAX,
 } RingbufferType_t;
 
+/**
+ * @brief Fragment of an item sent with xRingbufferSendFragments()
+ */
+typedef struct {
+    const void *pvData;     /**< Data of the fragment. NULL is allowed if xSize is 0 */
+    size_t xSize;           /**< Size of the fragment in bytes */
+} RingbufferFragment_t;
+
 /**
  * @brief Struct that is equivalent in size to the ring buffer's data structure
  *
@@ -168,6 +190,52 @@ BaseType_t xRingbufferSendFromISR(RingbufHandle_t xRingbuffer,
                                   size_t xItemSize,
                                   BaseType_t *pxHigherPriorityTaskWoken);
 
+/**
+ * @brief       Insert an item gathered from several fragments into the ring buffer
+ *
+ * Attempt to insert into the ring buffer a single item made of the concatenation
+ * of the fragments, copying each fragment directly into the ring buffer. This is
+ * equivalent to calling xRingbufferSend() on a staging buffer holding the
+ * concatenated fragments. This function will block until enough free space is
+ * available or until it times out.
+ *
+ * @param[in]   xRingbuffer     Ring buffer to insert the item into
+ * @param[in]   pxFragments     Array of fragments making up the item, in order
+ * @param[in]   uxFragmentCount Number of fragments in the array, must be at least 1
+ * @param[in]   xTicksToWait    Ticks to wait for room in the ring buffer.
+ *
+ * @note    The size of the item is the sum of the sizes of the fragments. The
+ *          notes of xRingbufferSend() about the item size apply.
+ *
+ * @return
+ *      - pdTRUE if succeeded
+ *      - pdFALSE on time-out or when the data is larger than the maximum permissible size of the buffer
+ */
+BaseType_t xRingbufferSendFragments(RingbufHandle_t xRingbuffer,
+                                    const RingbufferFragment_t *pxFragments,
+                                    UBaseType_t uxFragmentCount,
+                                    TickType_t xTicksToWait);
+
+/**
+ * @brief       Insert an item gathered from several fragments into the ring buffer in an ISR
+ *
+ * Same as xRingbufferSendFragments(), but returns immediately if there is
+ * insufficient free space in the buffer.
+ *
+ * @param[in]   xRingbuffer     Ring buffer to insert the item into
+ * @param[in]   pxFragments     Array of fragments making up the item, in order
+ * @param[in]   uxFragmentCount Number of fragments in the array, must be at least 1
+ * @param[out]  pxHigherPriorityTaskWoken   Value pointed to will be set to pdTRUE if the function woke up a higher priority task.
+ *
+ * @return
+ *      - pdTRUE if succeeded
+ *      - pdFALSE when the ring buffer does not have space.
+ */
+BaseType_t xRingbufferSendFragmentsFromISR(RingbufHandle_t xRingbuffer,
+                                           const RingbufferFragment_t *pxFragments,
+                                           UBaseType_t uxFragmentCount,
+                                           BaseType_t *pxHigherPriorityTaskWoken);
+
 /**
  * @brief Acquire memory from the ring buffer to be written to by an external
  *        source and to be sent later.
@@ -233,6 +301,31 @@ BaseType_t xRingbufferSendComplete(RingbufHandle_t xRingbuffer, void *pvItem);
  */
 void *xRingbufferReceive(RingbufHandle_t xRingbuffer, size_t *pxItemSize, TickType_t xTicksToWait);
 
+/**
+ * @brief   Retrieve several items from a no-split ring buffer at once
+ *
+ * Attempt to retrieve up to uxMaxItems items, in FIFO order, in a single call.
+ * This function will block until at least one item is available or until it
+ * times out, then retrieves all the items available, up to uxMaxItems.
+ *
+ * @param[in]   xRingbuffer     Ring buffer to retrieve the items from
+ * @param[out]  ppvItems        Array of at least uxMaxItems entries, filled with the pointers to the retrieved items
+ * @param[out]  pxItemSizes     Array of at least uxMaxItems entries, filled with the sizes of the retrieved items
+ * @param[in]   uxMaxItems      Maximum number of items to retrieve
+ * @param[in]   xTicksToWait    Ticks to wait for items in the ring buffer.
+ *
+ * @note    This function should only be called on no-split buffers
+ * @note    The retrieved items must be returned, either one by one with
+ *          vRingbufferReturnItem() or together with vRingbufferReturnItems().
+ *
+ * @return  Number of items retrieved, 0 on timeout.
+ */
+UBaseType_t uxRingbufferReceiveItems(RingbufHandle_t xRingbuffer,
+                                     void **ppvItems,
+                                     size_t *pxItemSizes,
+                                     UBaseType_t uxMaxItems,
+                                     TickType_t xTicksToWait);
+
 /**
  * @brief   Retrieve an item from the ring buffer in an ISR
  *
@@ -254,6 +347,27 @@ void *xRingbufferReceive(RingbufHandle_t xRingbuffer, size_t *pxItemSize, TickTy
  */
 void *xRingbufferReceiveFromISR(RingbufHandle_t xRingbuffer, size_t *pxItemSize);
 
+/**
+ * @brief   Retrieve an item from the ring buffer without waiting for its spinlock
+ *
+ * Same as xRingbufferReceiveFromISR(), except that it returns NULL instead of
+ * spinning if the spinlock of the ring buffer is held by another core. This is meant
+ * for the panic handler, which stalls the other core, possibly while it holds the
+ * spinlock.
+ *
+ * @param[in]   xRingbuffer     Ring buffer to retrieve the item from
+ * @param[out]  pxItemSize      Pointer to a variable to which the size of the
+ *                              retrieved item will be written.
+ *
+ * @note    A call to vRingbufferReturnItemFromISR() is required after this to free the item retrieved.
+ *          It waits for the spinlock, which is free once this function has retrieved an item.
+ *
+ * @return
+ *      - Pointer to the retrieved item on success; *pxItemSize filled with the length of the item.
+ *      - NULL when the ring buffer is empty or its spinlock is held, *pxItemSize is untouched in that case.
+ */
+void *xRingbufferTryReceiveFromISR(RingbufHandle_t xRingbuffer, size_t *pxItemSize);
+
 /**
  * @brief   Retrieve a split item from an allow-split ring buffer
  *
@@ -384,6 +498,18 @@ void vRingbufferReturnItem(RingbufHandle_t xRingbuffer, void *pvItem);
  */
 void vRingbufferReturnItemFromISR(RingbufHandle_t xRingbuffer, void *pvItem, BaseType_t *pxHigherPriorityTaskWoken);
 
+/**
+ * @brief   Return several previously-retrieved items to the ring buffer at once
+ *
+ * Equivalent to calling vRingbufferReturnItem() on each item, but the ring
+ * buffer is only locked once.
+ *
+ * @param[in]   xRingbuffer Ring buffer the items were retrieved from
+ * @param[in]   ppvItems    Array of the items that were received earlier, e.g. by uxRingbufferReceiveItems()
+ * @param[in]   uxItemCount Number of items in the array
+ */
+void vRingbufferReturnItems(RingbufHandle_t xRingbuffer, void **ppvItems, UBaseType_t uxItemCount);
+
 /**
  * @brief   Delete a ring buffer
  *
@@ -444,6 +570,8 @@ size_t xRingbufferGetCurFreeSize(RingbufHandle_t xRingbuffer);
  * @param[in]   xRingbuffer     Ring buffer to add to the queue set
  * @param[in]   xQueueSet       Queue set to add the ring buffer to
  *
+ * @note    RINGBUF_TYPE_BYTEBUF_SPSC buffers cannot be added to queue sets.
+ *
  * @return
  *      - pdTRUE on success, pdFALSE otherwise
  */
@@ -27,6 +27,14 @@
 #define rbBUFFER_FULL_FLAG          ( ( UBaseType_t ) 4 )   //The ring buffer is currently full (write pointer == free pointer)
 #define rbBUFFER_STATIC_FLAG        ( ( UBaseType_t ) 8 )   //The ring buffer is statically allocated
 #define rbUSING_QUEUE_SET           ( ( UBaseType_t ) 16 )  //The ring buffer has been added to a queue set
+#define rbSPSC_FLAG                 ( ( UBaseType_t ) 32 )  //The ring buffer is a single-producer/single-consumer byte buffer
+
+//Task notification used by SPSC byte buffers to block on full/empty. The last index is used to avoid clashing with the application
+#define rbSPSC_NOTIFY_INDEX         ( configTASK_NOTIFICATION_ARRAY_ENTRIES - 1 )
+
+#if CONFIG_RINGBUF_SPSC_BYTEBUF
+_Static_assert(rbSPSC_NOTIFY_INDEX > 0, "SPSC byte buffers must not share the notification index 0 used by xTaskNotifyGive()");
+#endif
 
 //Item flags
 #define rbITEM_FREE_FLAG            ( ( UBaseType_t ) 1 )   //Item has been retrieved and returned by application, free to overwrite
@@ -41,9 +49,16 @@ typedef struct {
 } ItemHeader_t;
 
 #define rbHEADER_SIZE     sizeof(ItemHeader_t)
+
+//Data to copy into the ring buffer, gathered from one or more fragments
+typedef struct {
+    const RingbufferFragment_t *pxFragment;     //Fragment holding the next byte to copy
+    size_t xOffset;                             //Offset of the next byte to copy in the fragment
+} ItemSource_t;
+
 typedef struct RingbufferDefinition Ringbuffer_t;
 typedef BaseType_t (*CheckItemFitsFunction_t)(Ringbuffer_t *pxRingbuffer, size_t xItemSize);
-typedef void (*CopyItemFunction_t)(Ringbuffer_t *pxRingbuffer, const uint8_t *pcItem, size_t xItemSize);
+typedef void (*CopyItemFunction_t)(Ringbuffer_t *pxRingbuffer, ItemSource_t *pxSource, size_t xItemSize);
 typedef BaseType_t (*CheckItemAvailFunction_t)(Ringbuffer_t *pxRingbuffer);
 typedef void *(*GetItemFunction_t)(Ringbuffer_t *pxRingbuffer, BaseType_t *pxIsSplit, size_t xMaxSize, size_t *pxItemSize);
 typedef void (*ReturnItemFunction_t)(Ringbuffer_t *pxRingbuffer, uint8_t *pvItem);
@@ -68,8 +83,19 @@ typedef struct RingbufferDefinition {
     uint8_t *pucTail;                           //Pointer to the end of the ring buffer storage area
 
     BaseType_t xItemsWaiting;                   //Number of items/bytes(for byte buffers) currently in ring buffer that have not yet been read
-    List_t xTasksWaitingToSend;                 //List of tasks that are blocked waiting to send/acquire onto this ring buffer. Stored in priority order.
-    List_t xTasksWaitingToReceive;              //List of tasks that are blocked waiting to receive from this ring buffer. Stored in priority order.
+    union {
+        struct {
+            List_t xTasksWaitingToSend;         //List of tasks that are blocked waiting to send/acquire onto this ring buffer. Stored in priority order.
+            List_t xTasksWaitingToReceive;      //List of tasks that are blocked waiting to receive from this ring buffer. Stored in priority order.
+        };
+        struct {
+            size_t xHead;                       //Write index in [0, 2 * xSize). Only written by the sender
+            size_t xTail;                       //Free index in [0, 2 * xSize). Only written by the receiver
+            size_t xReadLen;                    //Length of the data retrieved but not returned yet. Only accessed by the receiver
+            TaskHandle_t xWaitingSender;        //Sending task blocked on a full buffer, if any
+            TaskHandle_t xWaitingReceiver;      //Receiving task blocked on an empty buffer, if any
+        } xSpsc;                                //State of SPSC byte buffers, which have no task lists
+    };
     QueueSetHandle_t xQueueSet;                 //Ring buffer's read queue set handle.
 
     portMUX_TYPE mux;                           //Spinlock required for SMP
@@ -112,7 +138,7 @@ Exit:
     - pucAcquire and pucWrite updated.
     - Dummy item added if necessary
 */
-static void prvCopyItemNoSplit(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize);
+static void prvCopyItemNoSplit(Ringbuffer_t *pxRingbuffer, ItemSource_t *pxSource, size_t xItemSize);
 
 /*
 Copies an item to a allow-split ring buffer
@@ -123,10 +149,13 @@ Exit:
     - pucAcquire and pucWrite updated
     - Item may be split
 */
-static void prvCopyItemAllowSplit(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize);
+static void prvCopyItemAllowSplit(Ringbuffer_t *pxRingbuffer, ItemSource_t *pxSource, size_t xItemSize);
 
 //Copies an item to a byte buffer. Only call this function  after calling prvCheckItemFitsByteBuffer()
-static void prvCopyItemByteBuf(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize);
+static void prvCopyItemByteBuf(Ringbuffer_t *pxRingbuffer, ItemSource_t *pxSource, size_t xItemSize);
+
+//Copies the next xLen bytes of the source fragments to pucDest and advances the source
+static void prvCopyFromSource(uint8_t *pucDest, ItemSource_t *pxSource, size_t xLen);
 
 //Retrieve item from no-split/allow-split ring buffer. *pxIsSplit is set to pdTRUE if the retrieved item is split
 /*
@@ -171,11 +200,11 @@ static size_t prvGetCurMaxSizeByteBuf(Ringbuffer_t *pxRingbuffer);
 
 /*
 Generic function used to send or acquire an item/buffer.
-- If sending, set ppvItem to NULL. pvItem remains unchanged on failure.
-- If acquiring, set pvItem to NULL. ppvItem remains unchanged on failure.
+- If sending, set ppvItem to NULL. The item is gathered from the fragments of pxSource.
+- If acquiring, set pxSource to NULL. ppvItem remains unchanged on failure.
 */
 static BaseType_t prvSendAcquireGeneric(Ringbuffer_t *pxRingbuffer,
-                                        const void *pvItem,
+                                        ItemSource_t *pxSource,
                                         void **ppvItem,
                                         size_t xItemSize,
                                         TickType_t xTicksToWait);
@@ -194,13 +223,35 @@ static BaseType_t prvReceiveGeneric(Ringbuffer_t *pxRingbuffer,
                                     size_t xMaxSize,
                                     TickType_t xTicksToWait);
 
-//From ISR version of prvReceiveGeneric()
+//From ISR version of prvReceiveGeneric(). With xNoWait, fails instead of spinning if the spinlock is held
 static BaseType_t prvReceiveGenericFromISR(Ringbuffer_t *pxRingbuffer,
                                            void **pvItem1,
                                            void **pvItem2,
                                            size_t *xItemSize1,
                                            size_t *xItemSize2,
-                                           size_t xMaxSize);
+                                           size_t xMaxSize,
+                                           BaseType_t xNoWait);
+
+/*
+SPSC byte buffer functions. They never enter the critical section, the sender and the
+receiver only synchronize through xHead/xTail, see the comment ahead of their definitions.
+- prvSpscTrySend() copies the whole item or nothing, and returns the xTail it checked the free space against
+- prvSpscTryReceive() retrieves contiguous data, and returns the xHead it checked the stored data against
+- prvSpscReturnItem() frees the data retrieved by prvSpscTryReceive()
+- prvSpscTakeWaiter() returns (and clears) the task to notify after moving xHead/xTail, if any
+*/
+static BaseType_t prvSpscTrySend(Ringbuffer_t *pxRingbuffer, ItemSource_t *pxSource, size_t xItemSize, size_t *pxTail);
+
+static BaseType_t prvSpscTryReceive(Ringbuffer_t *pxRingbuffer, void **ppvItem, size_t *pxItemSize, size_t xMaxSize, size_t *pxHead);
+
+static void prvSpscReturnItem(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem);
+
+static TaskHandle_t prvSpscTakeWaiter(TaskHandle_t *pxWaiter);
+
+//Blocking send/receive of SPSC byte buffers
+static BaseType_t prvSendSpsc(Ringbuffer_t *pxRingbuffer, ItemSource_t *pxSource, size_t xItemSize, TickType_t xTicksToWait);
+
+static BaseType_t prvReceiveSpsc(Ringbuffer_t *pxRingbuffer, void **pvItem, size_t *xItemSize, size_t xMaxSize, TickType_t xTicksToWait);
 
 // ------------------------------------------------ Static Functions ---------------------------------------------------
 
@@ -243,6 +294,10 @@ static void prvInitializeNewRingbuffer(size_t xBufferSize,
         pxNewRingbuffer->xGetCurMaxSize = prvGetCurMaxSizeAllowSplit;
     } else { //Byte Buffer
         pxNewRingbuffer->uxRingbufferFlags |= rbBYTE_BUFFER_FLAG;
+        if (xBufferType == RINGBUF_TYPE_BYTEBUF_SPSC) {
+            //SPSC byte buffers bypass the function pointers and the pointers below on the data path
+            pxNewRingbuffer->uxRingbufferFlags |= rbSPSC_FLAG;
+        }
         pxNewRingbuffer->xCheckItemFits = prvCheckItemFitsByteBuffer;
         pxNewRingbuffer->vCopyItem = prvCopyItemByteBuf;
         pxNewRingbuffer->pvGetItem = prvGetItemByteBuf;
@@ -252,8 +307,14 @@ static void prvInitializeNewRingbuffer(size_t xBufferSize,
         pxNewRingbuffer->xGetCurMaxSize = prvGetCurMaxSizeByteBuf;
     }
 
-    vListInitialise(&pxNewRingbuffer->xTasksWaitingToSend);
-    vListInitialise(&pxNewRingbuffer->xTasksWaitingToReceive);
+    if (pxNewRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        //The indexes run over twice the buffer size to tell a full buffer from an empty one
+        configASSERT(xBufferSize <= SIZE_MAX / 2);
+        memset(&pxNewRingbuffer->xSpsc, 0, sizeof(pxNewRingbuffer->xSpsc));
+    } else {
+        vListInitialise(&pxNewRingbuffer->xTasksWaitingToSend);
+        vListInitialise(&pxNewRingbuffer->xTasksWaitingToReceive);
+    }
     pxNewRingbuffer->xQueueSet = NULL;
 
     portMUX_INITIALIZE(&pxNewRingbuffer->mux);
@@ -405,14 +466,33 @@ static void prvSendItemDoneNoSplit(Ringbuffer_t *pxRingbuffer, uint8_t* pucItem)
     }
 }
 
-static void prvCopyItemNoSplit(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize)
+static void prvCopyFromSource(uint8_t *pucDest, ItemSource_t *pxSource, size_t xLen)
+{
+    while (xLen > 0) {
+        size_t xCopyLen = pxSource->pxFragment->xSize - pxSource->xOffset;    //Length left in the current fragment
+        if (xCopyLen > xLen) {
+            xCopyLen = xLen;
+        }
+        memcpy(pucDest, (const uint8_t *)pxSource->pxFragment->pvData + pxSource->xOffset, xCopyLen);
+        pucDest += xCopyLen;
+        xLen -= xCopyLen;
+        pxSource->xOffset += xCopyLen;
+        if (pxSource->xOffset == pxSource->pxFragment->xSize && xLen > 0) {
+            //Move on to the next fragment
+            pxSource->pxFragment++;
+            pxSource->xOffset = 0;
+        }
+    }
+}
+
+static void prvCopyItemNoSplit(Ringbuffer_t *pxRingbuffer, ItemSource_t *pxSource, size_t xItemSize)
 {
     uint8_t* item_addr = prvAcquireItemNoSplit(pxRingbuffer, xItemSize);
-    memcpy(item_addr, pucItem, xItemSize);
+    prvCopyFromSource(item_addr, pxSource, xItemSize);
     prvSendItemDoneNoSplit(pxRingbuffer, item_addr);
 }
 
-static void prvCopyItemAllowSplit(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize)
+static void prvCopyItemAllowSplit(Ringbuffer_t *pxRingbuffer, ItemSource_t *pxSource, size_t xItemSize)
 {
     //Check arguments and buffer state
     size_t xAlignedItemSize = rbALIGN_SIZE(xItemSize);                  //Rounded up aligned item size
@@ -430,10 +510,9 @@ static void prvCopyItemAllowSplit(Ringbuffer_t *pxRingbuffer, const uint8_t *puc
         pxRingbuffer->pucAcquire += rbHEADER_SIZE;            //Advance pucAcquire past header
         xRemLen -= rbHEADER_SIZE;
         if (xRemLen > 0) {
-            memcpy(pxRingbuffer->pucAcquire, pucItem, xRemLen);
+            prvCopyFromSource(pxRingbuffer->pucAcquire, pxSource, xRemLen);
             pxRingbuffer->xItemsWaiting++;
             //Update item arguments to account for data already copied
-            pucItem += xRemLen;
             xItemSize -= xRemLen;
             xAlignedItemSize -= xRemLen;
             pxFirstHeader->uxItemFlags |= rbITEM_SPLIT_FLAG;        //There must be more data
@@ -449,7 +528,7 @@ static void prvCopyItemAllowSplit(Ringbuffer_t *pxRingbuffer, const uint8_t *puc
     pxSecondHeader->xItemLen = xItemSize;
     pxSecondHeader->uxItemFlags = 0;
     pxRingbuffer->pucAcquire += rbHEADER_SIZE;     //Advance acquire pointer past header
-    memcpy(pxRingbuffer->pucAcquire, pucItem, xItemSize);
+    prvCopyFromSource(pxRingbuffer->pucAcquire, pxSource, xItemSize);
     pxRingbuffer->xItemsWaiting++;
     pxRingbuffer->pucAcquire += xAlignedItemSize;  //Advance pucAcquire past item to next aligned address
 
@@ -467,7 +546,7 @@ static void prvCopyItemAllowSplit(Ringbuffer_t *pxRingbuffer, const uint8_t *puc
     pxRingbuffer->pucWrite = pxRingbuffer->pucAcquire;
 }
 
-static void prvCopyItemByteBuf(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize)
+static void prvCopyItemByteBuf(Ringbuffer_t *pxRingbuffer, ItemSource_t *pxSource, size_t xItemSize)
 {
     //Check arguments and buffer state
     configASSERT(pxRingbuffer->pucAcquire >= pxRingbuffer->pucHead && pxRingbuffer->pucAcquire < pxRingbuffer->pucTail);    //Check acquire pointer is within bounds
@@ -475,15 +554,14 @@ static void prvCopyItemByteBuf(Ringbuffer_t *pxRingbuffer, const uint8_t *pucIte
     size_t xRemLen = pxRingbuffer->pucTail - pxRingbuffer->pucAcquire;    //Length from pucAcquire until end of buffer
     if (xRemLen < xItemSize) {
         //Copy as much as possible into remaining length
-        memcpy(pxRingbuffer->pucAcquire, pucItem, xRemLen);
+        prvCopyFromSource(pxRingbuffer->pucAcquire, pxSource, xRemLen);
         pxRingbuffer->xItemsWaiting += xRemLen;
         //Update item arguments to account for data already written
-        pucItem += xRemLen;
         xItemSize -= xRemLen;
         pxRingbuffer->pucAcquire = pxRingbuffer->pucHead;     //Reset acquire pointer to start of buffer
     }
     //Copy all or remaining portion of the item
-    memcpy(pxRingbuffer->pucAcquire, pucItem, xItemSize);
+    prvCopyFromSource(pxRingbuffer->pucAcquire, pxSource, xItemSize);
     pxRingbuffer->xItemsWaiting += xItemSize;
     pxRingbuffer->pucAcquire += xItemSize;
 
@@ -743,7 +821,7 @@ static size_t prvGetCurMaxSizeByteBuf(Ringbuffer_t *pxRingbuffer)
 }
 
 static BaseType_t prvSendAcquireGeneric(Ringbuffer_t *pxRingbuffer,
-                                        const void *pvItem,
+                                        ItemSource_t *pxSource,
                                         void **ppvItem,
                                         size_t xItemSize,
                                         TickType_t xTicksToWait)
@@ -763,7 +841,7 @@ static BaseType_t prvSendAcquireGeneric(Ringbuffer_t *pxRingbuffer,
                 *ppvItem = prvAcquireItemNoSplit(pxRingbuffer, xItemSize);
             } else {
                 //Copy item into buffer
-                pxRingbuffer->vCopyItem(pxRingbuffer, pvItem, xItemSize);
+                pxRingbuffer->vCopyItem(pxRingbuffer, pxSource, xItemSize);
                 if (pxRingbuffer->xQueueSet) {
                     //If ring buffer was added to a queue set, notify the queue set
                     xNotifyQueueSet = pdTRUE;
@@ -829,6 +907,10 @@ static BaseType_t prvReceiveGeneric(Ringbuffer_t *pxRingbuffer,
     }
 #endif /*__clang_analyzer__ */
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return prvReceiveSpsc(pxRingbuffer, pvItem1, xItemSize1, xMaxSize, xTicksToWait);
+    }
+
     while (xExitLoop == pdFALSE) {
         portENTER_CRITICAL(&pxRingbuffer->mux);
         if (prvCheckItemAvail(pxRingbuffer) == pdTRUE) {
@@ -884,7 +966,8 @@ static BaseType_t prvReceiveGenericFromISR(Ringbuffer_t *pxRingbuffer,
                                            void **pvItem2,
                                            size_t *xItemSize1,
                                            size_t *xItemSize2,
-                                           size_t xMaxSize)
+                                           size_t xMaxSize,
+                                           BaseType_t xNoWait)
 {
     BaseType_t xReturn = pdFALSE;
 
@@ -895,7 +978,26 @@ static BaseType_t prvReceiveGenericFromISR(Ringbuffer_t *pxRingbuffer,
     }
 #endif /*__clang_analyzer__ */
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        size_t xHead;
+        if (pxRingbuffer->xSpsc.xReadLen != 0) {
+            return pdFALSE;     //Data retrieved last has not been returned yet
+        }
+        return prvSpscTryReceive(pxRingbuffer, pvItem1, xItemSize1, xMaxSize, &xHead);
+    }
+
+#ifdef portTRY_ENTER_CRITICAL_ISR
+    if (xNoWait == pdTRUE) {
+        if (portTRY_ENTER_CRITICAL_ISR(&pxRingbuffer->mux, portMUX_TRY_LOCK) != pdTRUE) {
+            return pdFALSE;
+        }
+    } else {
+        portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
+    }
+#else
+    (void)xNoWait;
     portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
+#endif
     if (prvCheckItemAvail(pxRingbuffer) == pdTRUE) {
         BaseType_t xIsSplit = pdFALSE;
         if (pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) {
@@ -924,15 +1026,198 @@ static BaseType_t prvReceiveGenericFromISR(Ringbuffer_t *pxRingbuffer,
     return xReturn;
 }
 
+/*
+ * SPSC byte buffers store data like byte buffers, but support only one sender and
+ * one receiver, each of them being a task or an ISR. The sender only writes xHead
+ * and the receiver only writes xTail, each side publishing its index with a release
+ * store once the data has been copied/read, and loading the other side's index
+ * with an acquire. Hence the data path needs no critical section. The indexes run
+ * over [0, 2 * xSize) so that a full buffer (xHead - xTail == xSize) is told apart
+ * from an empty one without a flag written by both sides.
+ *
+ * A task only blocks when the buffer is full (sender) or empty (receiver). It then
+ * publishes its handle in xWaitingSender/xWaitingReceiver and checks the other
+ * side's index again before waiting for a task notification. The other side
+ * checks the waiter after moving its index, the two full barriers ensuring that at
+ * least one of them sees the other's store.
+ */
+
+static inline size_t prvSpscOffset(Ringbuffer_t *pxRingbuffer, size_t xIndex)
+{
+    return (xIndex < pxRingbuffer->xSize) ? xIndex : xIndex - pxRingbuffer->xSize;
+}
+
+static inline size_t prvSpscAdvance(Ringbuffer_t *pxRingbuffer, size_t xIndex, size_t xLen)
+{
+    xIndex += xLen;
+    return (xIndex < 2 * pxRingbuffer->xSize) ? xIndex : xIndex - 2 * pxRingbuffer->xSize;
+}
+
+static inline size_t prvSpscGetUsedSize(Ringbuffer_t *pxRingbuffer, size_t xHead, size_t xTail)
+{
+    return (xHead >= xTail) ? xHead - xTail : xHead + 2 * pxRingbuffer->xSize - xTail;
+}
+
+static BaseType_t prvSpscTrySend(Ringbuffer_t *pxRingbuffer, ItemSource_t *pxSource, size_t xItemSize, size_t *pxTail)
+{
+    size_t xHead = pxRingbuffer->xSpsc.xHead;
+    size_t xTail = __atomic_load_n(&pxRingbuffer->xSpsc.xTail, __ATOMIC_ACQUIRE);   //The receiver is done with the data before xTail
+
+    *pxTail = xTail;
+    if (pxRingbuffer->xSize - prvSpscGetUsedSize(pxRingbuffer, xHead, xTail) < xItemSize) {
+        return pdFALSE;
+    }
+    size_t xOffset = prvSpscOffset(pxRingbuffer, xHead);
+    size_t xRemLen = pxRingbuffer->xSize - xOffset;     //Length from xHead until end of buffer
+    if (xRemLen < xItemSize) {
+        prvCopyFromSource(pxRingbuffer->pucHead + xOffset, pxSource, xRemLen);
+        prvCopyFromSource(pxRingbuffer->pucHead, pxSource, xItemSize - xRemLen);
+    } else {
+        prvCopyFromSource(pxRingbuffer->pucHead + xOffset, pxSource, xItemSize);
+    }
+    //Publish the data to the receiver
+    __atomic_store_n(&pxRingbuffer->xSpsc.xHead, prvSpscAdvance(pxRingbuffer, xHead, xItemSize), __ATOMIC_RELEASE);
+    return pdTRUE;
+}
+
+static BaseType_t prvSpscTryReceive(Ringbuffer_t *pxRingbuffer, void **ppvItem, size_t *pxItemSize, size_t xMaxSize, size_t *pxHead)
+{
+    size_t xTail = pxRingbuffer->xSpsc.xTail;
+    size_t xHead = __atomic_load_n(&pxRingbuffer->xSpsc.xHead, __ATOMIC_ACQUIRE);   //The sender is done with the data before xHead
+
+    *pxHead = xHead;
+    size_t xLen = prvSpscGetUsedSize(pxRingbuffer, xHead, xTail);
+    if (xLen == 0) {
+        return pdFALSE;
+    }
+    //Like byte buffers, only retrieve the contiguous data up to the end of the buffer, or xMaxSize
+    size_t xOffset = prvSpscOffset(pxRingbuffer, xTail);
+    if (xLen > pxRingbuffer->xSize - xOffset) {
+        xLen = pxRingbuffer->xSize - xOffset;
+    }
+    if (xMaxSize != 0 && xLen > xMaxSize) {
+        xLen = xMaxSize;
+    }
+    pxRingbuffer->xSpsc.xReadLen = xLen;
+    *ppvItem = pxRingbuffer->pucHead + xOffset;
+    *pxItemSize = xLen;
+    return pdTRUE;
+}
+
+static void prvSpscReturnItem(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem)
+{
+    size_t xTail = pxRingbuffer->xSpsc.xTail;
+
+    //Check that the returned data is the one retrieved last
+    configASSERT(pxRingbuffer->xSpsc.xReadLen > 0);
+    configASSERT(pucItem == pxRingbuffer->pucHead + prvSpscOffset(pxRingbuffer, xTail));
+    xTail = prvSpscAdvance(pxRingbuffer, xTail, pxRingbuffer->xSpsc.xReadLen);
+    pxRingbuffer->xSpsc.xReadLen = 0;
+    //Hand the space back to the sender
+    __atomic_store_n(&pxRingbuffer->xSpsc.xTail, xTail, __ATOMIC_RELEASE);
+}
+
+static TaskHandle_t prvSpscTakeWaiter(TaskHandle_t *pxWaiter)
+{
+    //Order the index store before the load of the waiter, pairs with the barrier in prvSpscWait()
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    TaskHandle_t xWaiter = __atomic_load_n(pxWaiter, __ATOMIC_RELAXED);
+    if (xWaiter != NULL) {
+        /*
+        Notify the waiter only once. There is a single task on each side, so clearing a
+        handle it has just published again is harmless: the notification that follows
+        wakes that same task up.
+        */
+        __atomic_store_n(pxWaiter, NULL, __ATOMIC_RELAXED);
+    }
+    return xWaiter;
+}
+
+/*
+Blocks the calling task until notified by the other side, unless the index of the
+other side already moved from xSeenIndex. Returns pdFALSE once timed out.
+*/
+static BaseType_t prvSpscWait(TaskHandle_t *pxWaiter,
+                              const size_t *pxOtherIndex,
+                              size_t xSeenIndex,
+                              TimeOut_t *pxTimeOut,
+                              BaseType_t *pxEntryTimeSet,
+                              TickType_t *pxTicksToWait)
+{
+    if (*pxTicksToWait == (TickType_t) 0) {
+        //No block time. Return immediately.
+        return pdFALSE;
+    } else if (*pxEntryTimeSet == pdFALSE) {
+        //This is our first block. Set entry time
+        vTaskSetTimeOutState(pxTimeOut);
+        *pxEntryTimeSet = pdTRUE;
+    } else if (xTaskCheckForTimeOut(pxTimeOut, pxTicksToWait) == pdTRUE) {
+        //We have timed out
+        return pdFALSE;
+    }
+    __atomic_store_n(pxWaiter, xTaskGetCurrentTaskHandle(), __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(pxOtherIndex, __ATOMIC_RELAXED) == xSeenIndex) {
+        //A notification left over from an earlier wake up only causes an extra loop in the caller
+        (void) ulTaskNotifyTakeIndexed(rbSPSC_NOTIFY_INDEX, pdTRUE, *pxTicksToWait);
+    }
+    __atomic_store_n(pxWaiter, NULL, __ATOMIC_RELAXED);
+    return pdTRUE;
+}
+
+static BaseType_t prvSendSpsc(Ringbuffer_t *pxRingbuffer, ItemSource_t *pxSource, size_t xItemSize, TickType_t xTicksToWait)
+{
+    TimeOut_t xTimeOut;
+    BaseType_t xEntryTimeSet = pdFALSE;
+    size_t xTail;
+
+    while (prvSpscTrySend(pxRingbuffer, pxSource, xItemSize, &xTail) == pdFALSE) {
+        //Buffer is full
+        if (prvSpscWait(&pxRingbuffer->xSpsc.xWaitingSender, &pxRingbuffer->xSpsc.xTail, xTail,
+                        &xTimeOut, &xEntryTimeSet, &xTicksToWait) == pdFALSE) {
+            return pdFALSE;
+        }
+    }
+    TaskHandle_t xWaiter = prvSpscTakeWaiter(&pxRingbuffer->xSpsc.xWaitingReceiver);
+    if (xWaiter != NULL) {
+        xTaskNotifyGiveIndexed(xWaiter, rbSPSC_NOTIFY_INDEX);
+    }
+    return pdTRUE;
+}
+
+static BaseType_t prvReceiveSpsc(Ringbuffer_t *pxRingbuffer, void **pvItem, size_t *xItemSize, size_t xMaxSize, TickType_t xTicksToWait)
+{
+    TimeOut_t xTimeOut;
+    BaseType_t xEntryTimeSet = pdFALSE;
+    size_t xHead;
+
+    if (pxRingbuffer->xSpsc.xReadLen != 0) {
+        return pdFALSE;     //Like byte buffers, the data retrieved last must be returned first. Waiting would not change that
+    }
+    while (prvSpscTryReceive(pxRingbuffer, pvItem, xItemSize, xMaxSize, &xHead) == pdFALSE) {
+        //Buffer is empty
+        if (prvSpscWait(&pxRingbuffer->xSpsc.xWaitingReceiver, &pxRingbuffer->xSpsc.xHead, xHead,
+                        &xTimeOut, &xEntryTimeSet, &xTicksToWait) == pdFALSE) {
+            return pdFALSE;
+        }
+    }
+    return pdTRUE;
+}
+
 // ------------------------------------------------ Public Functions ---------------------------------------------------
 
 RingbufHandle_t xRingbufferCreate(size_t xBufferSize, RingbufferType_t xBufferType)
 {
     configASSERT(xBufferSize > 0);
     configASSERT(xBufferType < RINGBUF_TYPE_MAX);
+#if !CONFIG_RINGBUF_SPSC_BYTEBUF
+    if (xBufferType == RINGBUF_TYPE_BYTEBUF_SPSC) {
+        return NULL;    //Requires CONFIG_RINGBUF_SPSC_BYTEBUF
+    }
+#endif
 
     //Allocate memory
-    if (xBufferType != RINGBUF_TYPE_BYTEBUF) {
+    if (xBufferType != RINGBUF_TYPE_BYTEBUF && xBufferType != RINGBUF_TYPE_BYTEBUF_SPSC) {
         xBufferSize = rbALIGN_SIZE(xBufferSize);    //xBufferSize is rounded up for no-split/allow-split buffers
     }
     Ringbuffer_t *pxNewRingbuffer = calloc(1, sizeof(Ringbuffer_t));
@@ -965,7 +1250,12 @@ RingbufHandle_t xRingbufferCreateStatic(size_t xBufferSize,
     configASSERT(xBufferSize > 0);
     configASSERT(xBufferType < RINGBUF_TYPE_MAX);
     configASSERT(pucRingbufferStorage != NULL && pxStaticRingbuffer != NULL);
-    if (xBufferType != RINGBUF_TYPE_BYTEBUF) {
+#if !CONFIG_RINGBUF_SPSC_BYTEBUF
+    if (xBufferType == RINGBUF_TYPE_BYTEBUF_SPSC) {
+        return NULL;    //Requires CONFIG_RINGBUF_SPSC_BYTEBUF
+    }
+#endif
+    if (xBufferType != RINGBUF_TYPE_BYTEBUF && xBufferType != RINGBUF_TYPE_BYTEBUF_SPSC) {
         //No-split/allow-split buffer sizes must be 32-bit aligned
         configASSERT(rbCHECK_ALIGNED(xBufferSize));
     }
@@ -1032,44 +1322,88 @@ BaseType_t xRingbufferSend(RingbufHandle_t xRingbuffer,
                            const void *pvItem,
                            size_t xItemSize,
                            TickType_t xTicksToWait)
+{
+    RingbufferFragment_t xFragment = { .pvData = pvItem, .xSize = xItemSize };
+    return xRingbufferSendFragments(xRingbuffer, &xFragment, 1, xTicksToWait);
+}
+
+BaseType_t xRingbufferSendFromISR(RingbufHandle_t xRingbuffer,
+                                  const void *pvItem,
+                                  size_t xItemSize,
+                                  BaseType_t *pxHigherPriorityTaskWoken)
+{
+    RingbufferFragment_t xFragment = { .pvData = pvItem, .xSize = xItemSize };
+    return xRingbufferSendFragmentsFromISR(xRingbuffer, &xFragment, 1, pxHigherPriorityTaskWoken);
+}
+
+BaseType_t xRingbufferSendFragments(RingbufHandle_t xRingbuffer,
+                                    const RingbufferFragment_t *pxFragments,
+                                    UBaseType_t uxFragmentCount,
+                                    TickType_t xTicksToWait)
 {
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    ItemSource_t xSource = { .pxFragment = pxFragments, .xOffset = 0 };
+    size_t xItemSize = 0;
 
     //Check arguments
     configASSERT(pxRingbuffer);
-    configASSERT(pvItem != NULL || xItemSize == 0);
+    configASSERT(pxFragments != NULL && uxFragmentCount > 0);
+    for (UBaseType_t i = 0; i < uxFragmentCount; i++) {
+        configASSERT(pxFragments[i].pvData != NULL || pxFragments[i].xSize == 0);
+        xItemSize += pxFragments[i].xSize;
+    }
     if (xItemSize > pxRingbuffer->xMaxItemSize) {
         return pdFALSE;     //Data will never ever fit in the queue.
     }
     if ((pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) && xItemSize == 0) {
         return pdTRUE;      //Sending 0 bytes to byte buffer has no effect
     }
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return prvSendSpsc(pxRingbuffer, &xSource, xItemSize, xTicksToWait);
+    }
 
-    return prvSendAcquireGeneric(pxRingbuffer, pvItem, NULL, xItemSize, xTicksToWait);
+    return prvSendAcquireGeneric(pxRingbuffer, &xSource, NULL, xItemSize, xTicksToWait);
 }
 
-BaseType_t xRingbufferSendFromISR(RingbufHandle_t xRingbuffer,
-                                  const void *pvItem,
-                                  size_t xItemSize,
-                                  BaseType_t *pxHigherPriorityTaskWoken)
+BaseType_t xRingbufferSendFragmentsFromISR(RingbufHandle_t xRingbuffer,
+                                           const RingbufferFragment_t *pxFragments,
+                                           UBaseType_t uxFragmentCount,
+                                           BaseType_t *pxHigherPriorityTaskWoken)
 {
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    ItemSource_t xSource = { .pxFragment = pxFragments, .xOffset = 0 };
+    size_t xItemSize = 0;
     BaseType_t xNotifyQueueSet = pdFALSE;
     BaseType_t xReturn;
 
     //Check arguments
     configASSERT(pxRingbuffer);
-    configASSERT(pvItem != NULL || xItemSize == 0);
+    configASSERT(pxFragments != NULL && uxFragmentCount > 0);
+    for (UBaseType_t i = 0; i < uxFragmentCount; i++) {
+        configASSERT(pxFragments[i].pvData != NULL || pxFragments[i].xSize == 0);
+        xItemSize += pxFragments[i].xSize;
+    }
     if (xItemSize > pxRingbuffer->xMaxItemSize) {
         return pdFALSE;     //Data will never ever fit in the queue.
     }
     if ((pxRingbuffer->uxRingbufferFlags & rbBYTE_BUFFER_FLAG) && xItemSize == 0) {
         return pdTRUE;      //Sending 0 bytes to byte buffer has no effect
     }
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        size_t xTail;
+        xReturn = prvSpscTrySend(pxRingbuffer, &xSource, xItemSize, &xTail);
+        if (xReturn == pdTRUE) {
+            TaskHandle_t xWaiter = prvSpscTakeWaiter(&pxRingbuffer->xSpsc.xWaitingReceiver);
+            if (xWaiter != NULL) {
+                vTaskNotifyGiveIndexedFromISR(xWaiter, rbSPSC_NOTIFY_INDEX, pxHigherPriorityTaskWoken);
+            }
+        }
+        return xReturn;
+    }
 
     portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
     if (pxRingbuffer->xCheckItemFits(xRingbuffer, xItemSize) == pdTRUE) {
-        pxRingbuffer->vCopyItem(xRingbuffer, pvItem, xItemSize);
+        pxRingbuffer->vCopyItem(xRingbuffer, &xSource, xItemSize);
         if (pxRingbuffer->xQueueSet) {
             //If ring buffer was added to a queue set, notify the queue set
             xNotifyQueueSet = pdTRUE;
@@ -1112,6 +1446,61 @@ void *xRingbufferReceive(RingbufHandle_t xRingbuffer, size_t *pxItemSize, TickTy
     }
 }
 
+UBaseType_t uxRingbufferReceiveItems(RingbufHandle_t xRingbuffer,
+                                     void **ppvItems,
+                                     size_t *pxItemSizes,
+                                     UBaseType_t uxMaxItems,
+                                     TickType_t xTicksToWait)
+{
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    UBaseType_t uxReturn = 0;
+    BaseType_t xExitLoop = pdFALSE;
+    BaseType_t xEntryTimeSet = pdFALSE;
+    TimeOut_t xTimeOut;
+
+    //Check arguments
+    configASSERT(pxRingbuffer && ppvItems && pxItemSizes);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG)) == 0);    //Only supported in no-split buffers
+
+    if (uxMaxItems == 0) {
+        return 0;
+    }
+    while (xExitLoop == pdFALSE) {
+        portENTER_CRITICAL(&pxRingbuffer->mux);
+        if (prvCheckItemAvail(pxRingbuffer) == pdTRUE) {
+            //Retrieve all available items, up to uxMaxItems, in the same critical section
+            do {
+                BaseType_t xIsSplit;
+                ppvItems[uxReturn] = pxRingbuffer->pvGetItem(pxRingbuffer, &xIsSplit, 0, &pxItemSizes[uxReturn]);
+                uxReturn++;
+            } while (uxReturn < uxMaxItems && prvCheckItemAvail(pxRingbuffer) == pdTRUE);
+            xExitLoop = pdTRUE;
+            goto loop_end;
+        } else if (xTicksToWait == (TickType_t) 0) {
+            //No block time. Return immediately.
+            xExitLoop = pdTRUE;
+            goto loop_end;
+        } else if (xEntryTimeSet == pdFALSE) {
+            //This is our first block. Set entry time
+            vTaskInternalSetTimeOutState(&xTimeOut);
+            xEntryTimeSet = pdTRUE;
+        }
+
+        if (xTaskCheckForTimeOut(&xTimeOut, &xTicksToWait) == pdFALSE) {
+            //Not timed out yet. Block the current task
+            vTaskPlaceOnEventList(&pxRingbuffer->xTasksWaitingToReceive, xTicksToWait);
+            portYIELD_WITHIN_API();
+        } else {
+            //We have timed out.
+            xExitLoop = pdTRUE;
+        }
+loop_end:
+        portEXIT_CRITICAL(&pxRingbuffer->mux);
+    }
+
+    return uxReturn;
+}
+
 void *xRingbufferReceiveFromISR(RingbufHandle_t xRingbuffer, size_t *pxItemSize)
 {
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
@@ -1121,7 +1510,23 @@ void *xRingbufferReceiveFromISR(RingbufHandle_t xRingbuffer, size_t *pxItemSize)
 
     //Attempt to retrieve an item
     void *pvTempItem;
-    if (prvReceiveGenericFromISR(pxRingbuffer, &pvTempItem, NULL, pxItemSize, NULL, 0) == pdTRUE) {
+    if (prvReceiveGenericFromISR(pxRingbuffer, &pvTempItem, NULL, pxItemSize, NULL, 0, pdFALSE) == pdTRUE) {
+        return pvTempItem;
+    } else {
+        return NULL;
+    }
+}
+
+void *xRingbufferTryReceiveFromISR(RingbufHandle_t xRingbuffer, size_t *pxItemSize)
+{
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+
+    //Check arguments
+    configASSERT(pxRingbuffer && pxItemSize);
+
+    //Attempt to retrieve an item, unless the spinlock is held
+    void *pvTempItem;
+    if (prvReceiveGenericFromISR(pxRingbuffer, &pvTempItem, NULL, pxItemSize, NULL, 0, pdTRUE) == pdTRUE) {
         return pvTempItem;
     } else {
         return NULL;
@@ -1156,7 +1561,7 @@ BaseType_t xRingbufferReceiveSplitFromISR(RingbufHandle_t xRingbuffer,
     configASSERT(pxRingbuffer && ppvHeadItem && ppvTailItem && pxHeadItemSize && pxTailItemSize);
     configASSERT(pxRingbuffer->uxRingbufferFlags & rbALLOW_SPLIT_FLAG);
 
-    return prvReceiveGenericFromISR(pxRingbuffer, ppvHeadItem, ppvTailItem, pxHeadItemSize, pxTailItemSize, 0);
+    return prvReceiveGenericFromISR(pxRingbuffer, ppvHeadItem, ppvTailItem, pxHeadItemSize, pxTailItemSize, 0, pdFALSE);
 }
 
 void *xRingbufferReceiveUpTo(RingbufHandle_t xRingbuffer,
@@ -1195,7 +1600,7 @@ void *xRingbufferReceiveUpToFromISR(RingbufHandle_t xRingbuffer, size_t *pxItemS
     }
     //Attempt to retrieve up to xMaxSize bytes
     void *pvTempItem;
-    if (prvReceiveGenericFromISR(pxRingbuffer, &pvTempItem, NULL, pxItemSize, NULL, xMaxSize) == pdTRUE) {
+    if (prvReceiveGenericFromISR(pxRingbuffer, &pvTempItem, NULL, pxItemSize, NULL, xMaxSize, pdFALSE) == pdTRUE) {
         return pvTempItem;
     } else {
         return NULL;
@@ -1208,6 +1613,15 @@ void vRingbufferReturnItem(RingbufHandle_t xRingbuffer, void *pvItem)
     configASSERT(pxRingbuffer);
     configASSERT(pvItem != NULL);
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        prvSpscReturnItem(pxRingbuffer, (uint8_t *)pvItem);
+        TaskHandle_t xWaiter = prvSpscTakeWaiter(&pxRingbuffer->xSpsc.xWaitingSender);
+        if (xWaiter != NULL) {
+            xTaskNotifyGiveIndexed(xWaiter, rbSPSC_NOTIFY_INDEX);
+        }
+        return;
+    }
+
     portENTER_CRITICAL(&pxRingbuffer->mux);
     pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)pvItem);
     //If a task was waiting for space to send, unblock it immediately.
@@ -1226,6 +1640,15 @@ void vRingbufferReturnItemFromISR(RingbufHandle_t xRingbuffer, void *pvItem, Bas
     configASSERT(pxRingbuffer);
     configASSERT(pvItem != NULL);
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        prvSpscReturnItem(pxRingbuffer, (uint8_t *)pvItem);
+        TaskHandle_t xWaiter = prvSpscTakeWaiter(&pxRingbuffer->xSpsc.xWaitingSender);
+        if (xWaiter != NULL) {
+            vTaskNotifyGiveIndexedFromISR(xWaiter, rbSPSC_NOTIFY_INDEX, pxHigherPriorityTaskWoken);
+        }
+        return;
+    }
+
     portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
     pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)pvItem);
     //If a task was waiting for space to send, unblock it immediately.
@@ -1240,6 +1663,38 @@ void vRingbufferReturnItemFromISR(RingbufHandle_t xRingbuffer, void *pvItem, Bas
     portEXIT_CRITICAL_ISR(&pxRingbuffer->mux);
 }
 
+void vRingbufferReturnItems(RingbufHandle_t xRingbuffer, void **ppvItems, UBaseType_t uxItemCount)
+{
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(ppvItems != NULL || uxItemCount == 0);
+
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        for (UBaseType_t i = 0; i < uxItemCount; i++) {
+            vRingbufferReturnItem(xRingbuffer, ppvItems[i]);
+        }
+        return;
+    }
+
+    portENTER_CRITICAL(&pxRingbuffer->mux);
+    for (UBaseType_t i = 0; i < uxItemCount; i++) {
+        configASSERT(ppvItems[i] != NULL);
+        pxRingbuffer->vReturnItem(pxRingbuffer, (uint8_t *)ppvItems[i]);
+    }
+    //Unblock as many tasks waiting for space to send as returning the items one by one would
+    BaseType_t xYieldRequired = pdFALSE;
+    for (UBaseType_t i = 0; i < uxItemCount && listLIST_IS_EMPTY(&pxRingbuffer->xTasksWaitingToSend) == pdFALSE; i++) {
+        if (xTaskRemoveFromEventList(&pxRingbuffer->xTasksWaitingToSend) == pdTRUE) {
+            xYieldRequired = pdTRUE;
+        }
+    }
+    if (xYieldRequired == pdTRUE) {
+        //An unblocked task will preempt us. Trigger a yield here.
+        portYIELD_WITHIN_API();
+    }
+    portEXIT_CRITICAL(&pxRingbuffer->mux);
+}
+
 void vRingbufferDelete(RingbufHandle_t xRingbuffer)
 {
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
@@ -1265,6 +1720,11 @@ size_t xRingbufferGetCurFreeSize(RingbufHandle_t xRingbuffer)
     configASSERT(pxRingbuffer);
 
     size_t xFreeSize;
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return pxRingbuffer->xSize - prvSpscGetUsedSize(pxRingbuffer,
+                                                        __atomic_load_n(&pxRingbuffer->xSpsc.xHead, __ATOMIC_ACQUIRE),
+                                                        __atomic_load_n(&pxRingbuffer->xSpsc.xTail, __ATOMIC_ACQUIRE));
+    }
     portENTER_CRITICAL(&pxRingbuffer->mux);
     xFreeSize = pxRingbuffer->xGetCurMaxSize(pxRingbuffer);
     portEXIT_CRITICAL(&pxRingbuffer->mux);
@@ -1278,6 +1738,10 @@ BaseType_t xRingbufferAddToQueueSetRead(RingbufHandle_t xRingbuffer, QueueSetHan
 
     configASSERT(pxRingbuffer && xQueueSet);
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        return pdFALSE;     //Notifying a queue set would require a critical section on the data path
+    }
+
     portENTER_CRITICAL(&pxRingbuffer->mux);
     if (pxRingbuffer->xQueueSet != NULL || prvCheckItemAvail(pxRingbuffer) == pdTRUE) {
         /*
@@ -1329,6 +1793,29 @@ void vRingbufferGetInfo(RingbufHandle_t xRingbuffer,
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
     configASSERT(pxRingbuffer);
 
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        //Map the indexes of SPSC byte buffers to the pointers of byte buffers
+        size_t xHead = __atomic_load_n(&pxRingbuffer->xSpsc.xHead, __ATOMIC_ACQUIRE);
+        size_t xTail = __atomic_load_n(&pxRingbuffer->xSpsc.xTail, __ATOMIC_ACQUIRE);
+        size_t xReadLen = pxRingbuffer->xSpsc.xReadLen;
+        if (uxFree != NULL) {
+            *uxFree = (UBaseType_t)prvSpscOffset(pxRingbuffer, xTail);
+        }
+        if (uxRead != NULL) {
+            *uxRead = (UBaseType_t)prvSpscOffset(pxRingbuffer, prvSpscAdvance(pxRingbuffer, xTail, xReadLen));
+        }
+        if (uxWrite != NULL) {
+            *uxWrite = (UBaseType_t)prvSpscOffset(pxRingbuffer, xHead);
+        }
+        if (uxAcquire != NULL) {
+            *uxAcquire = (UBaseType_t)prvSpscOffset(pxRingbuffer, xHead);
+        }
+        if (uxItemsWaiting != NULL) {
+            *uxItemsWaiting = (UBaseType_t)(prvSpscGetUsedSize(pxRingbuffer, xHead, xTail) - xReadLen);
+        }
+        return;
+    }
+
     portENTER_CRITICAL(&pxRingbuffer->mux);
     if (uxFree != NULL) {
         *uxFree = (UBaseType_t)(pxRingbuffer->pucFree - pxRingbuffer->pucHead);
@@ -1352,6 +1839,14 @@ void xRingbufferPrintInfo(RingbufHandle_t xRingbuffer)
 {
     Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
     configASSERT(pxRingbuffer);
+    if (pxRingbuffer->uxRingbufferFlags & rbSPSC_FLAG) {
+        UBaseType_t uxFree, uxRead, uxWrite;
+        vRingbufferGetInfo(xRingbuffer, &uxFree, &uxRead, &uxWrite, NULL, NULL);
+        printf("Rb size:%" PRId32 "\tfree: %" PRId32 "\trptr: %" PRId32 "\tfreeptr: %" PRId32 "\twptr: %" PRId32 "\n",
+               (int32_t)pxRingbuffer->xSize, (int32_t)xRingbufferGetCurFreeSize(xRingbuffer),
+               (int32_t)uxRead, (int32_t)uxFree, (int32_t)uxWrite);
+        return;
+    }
     printf("Rb size:%" PRId32 "\tfree: %" PRId32 "\trptr: %" PRId32 "\tfreeptr: %" PRId32 "\twptr: %" PRId32 ", aptr: %" PRId32 "\n",
            (int32_t)pxRingbuffer->xSize, (int32_t)prvGetFreeSize(pxRingbuffer),
            (int32_t)(pxRingbuffer->pucRead - pxRingbuffer->pucHead),
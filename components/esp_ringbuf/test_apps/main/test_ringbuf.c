@@ -6,6 +6,7 @@
 
 #include "sdkconfig.h"
 #include <stdio.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -16,11 +17,20 @@
 #include "esp_private/spi_flash_os.h"
 #include "esp_memory_utils.h"
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "spi_flash_mmap.h"
 #include "unity.h"
 #include "esp_rom_sys.h"
 
 //Definitions used in multiple test cases
+
+//SPSC byte buffers, the last type, can only be created with CONFIG_RINGBUF_SPSC_BYTEBUF
+#if CONFIG_RINGBUF_SPSC_BYTEBUF
+#define TEST_RINGBUF_TYPE_END           RINGBUF_TYPE_MAX
+#else
+#define TEST_RINGBUF_TYPE_END           RINGBUF_TYPE_BYTEBUF_SPSC
+#endif
+
 #define TIMEOUT_TICKS               10
 #define NO_OF_RB_TYPES              3
 #define ITEM_HDR_SIZE               8
@@ -946,7 +956,7 @@ TEST_CASE("Test ring buffer SMP", "[esp_ringbuf]")
 {
     setup();
     //Iterate through buffer types (No split, split, then byte buff)
-    for (RingbufferType_t buf_type = 0; buf_type < RINGBUF_TYPE_MAX; buf_type++) {
+    for (RingbufferType_t buf_type = 0; buf_type < TEST_RINGBUF_TYPE_END; buf_type++) {
         //Create buffer
         task_args_t task_args;
         task_args.buffer = xRingbufferCreate(CONT_DATA_TEST_BUFF_LEN, buf_type); //Create buffer of selected type
@@ -978,7 +988,7 @@ TEST_CASE("Test static ring buffer SMP", "[esp_ringbuf]")
 {
     setup();
     //Iterate through buffer types (No split, split, then byte buff)
-    for (RingbufferType_t buf_type = 0; buf_type < RINGBUF_TYPE_MAX; buf_type++) {
+    for (RingbufferType_t buf_type = 0; buf_type < TEST_RINGBUF_TYPE_END; buf_type++) {
         StaticRingbuffer_t *buffer_struct;
         uint8_t *buffer_storage;
         //Allocate memory and create semaphores
@@ -1123,3 +1133,244 @@ TEST_CASE("Test ringbuffer with caps", "[esp_ringbuf]")
     // Free the ring buffer
     vRingbufferDeleteWithCaps(rb_handle);
 }
+
+#if CONFIG_RINGBUF_SPSC_BYTEBUF
+/* ----------------------- Test SPSC byte buffer --------------------------------
+ * The following test case tests the behavior specific to RINGBUF_TYPE_BYTEBUF_SPSC
+ * buffers when full/empty. Sending and receiving between tasks is covered by the
+ * SMP test cases.
+ */
+
+TEST_CASE("Test SPSC byte buffer", "[esp_ringbuf]")
+{
+    RingbufHandle_t spsc_rb = xRingbufferCreate(BUFFER_SIZE, RINGBUF_TYPE_BYTEBUF_SPSC);
+    TEST_ASSERT_NOT_EQUAL(NULL, spsc_rb);
+    TEST_ASSERT_EQUAL(BUFFER_SIZE, xRingbufferGetMaxItemSize(spsc_rb));
+
+    uint8_t data[BUFFER_SIZE];
+    for (int i = 0; i < BUFFER_SIZE; i++) {
+        data[i] = i;
+    }
+    size_t item_size;
+
+    //Data that does not fit is not sent partially
+    TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSend(spsc_rb, data, BUFFER_SIZE - SMALL_ITEM_SIZE, 0));
+    TEST_ASSERT_EQUAL(SMALL_ITEM_SIZE, xRingbufferGetCurFreeSize(spsc_rb));
+    TEST_ASSERT_EQUAL(pdFALSE, xRingbufferSend(spsc_rb, data, SMALL_ITEM_SIZE + 1, TIMEOUT_TICKS));
+
+    //Data must be returned before retrieving more
+    uint8_t *item = xRingbufferReceiveUpTo(spsc_rb, &item_size, 0, BUFFER_SIZE / 2);
+    TEST_ASSERT_NOT_EQUAL(NULL, item);
+    TEST_ASSERT_EQUAL(BUFFER_SIZE / 2, item_size);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(data, item, item_size);
+    TEST_ASSERT_EQUAL(NULL, xRingbufferReceive(spsc_rb, &item_size, 0));
+    vRingbufferReturnItem(spsc_rb, item);
+
+    //Fill the buffer completely, so that the data wraps around
+    TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSend(spsc_rb, data, BUFFER_SIZE / 2 + SMALL_ITEM_SIZE, 0));
+    TEST_ASSERT_EQUAL(0, xRingbufferGetCurFreeSize(spsc_rb));
+    item = xRingbufferReceive(spsc_rb, &item_size, 0);
+    TEST_ASSERT_EQUAL(BUFFER_SIZE / 2, item_size);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(&data[BUFFER_SIZE / 2], item, BUFFER_SIZE / 2 - SMALL_ITEM_SIZE);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(data, item + BUFFER_SIZE / 2 - SMALL_ITEM_SIZE, SMALL_ITEM_SIZE);
+    vRingbufferReturnItem(spsc_rb, item);
+    item = xRingbufferReceive(spsc_rb, &item_size, 0);
+    TEST_ASSERT_EQUAL(BUFFER_SIZE / 2, item_size);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(&data[SMALL_ITEM_SIZE], item, item_size);
+    vRingbufferReturnItem(spsc_rb, item);
+
+    //Empty buffer times out, and cannot be added to a queue set
+    TEST_ASSERT_EQUAL(NULL, xRingbufferReceive(spsc_rb, &item_size, TIMEOUT_TICKS));
+    QueueSetHandle_t queue_set = xQueueCreateSet(1);
+    TEST_ASSERT_EQUAL(pdFALSE, xRingbufferAddToQueueSetRead(spsc_rb, queue_set));
+    vQueueDelete(queue_set);
+
+    //Waiting does not consume the notifications of the first entry of the notification array
+    xTaskNotifyGive(xTaskGetCurrentTaskHandle());
+    TEST_ASSERT_EQUAL(NULL, xRingbufferReceive(spsc_rb, &item_size, TIMEOUT_TICKS));
+    TEST_ASSERT_EQUAL(1, ulTaskNotifyTake(pdTRUE, 0));
+
+    vRingbufferDelete(spsc_rb);
+}
+#endif //CONFIG_RINGBUF_SPSC_BYTEBUF
+
+/* ------------------- Test fragmented send and batched receive -----------------
+ * The following test case sends items gathered from several fragments to each
+ * type of ring buffer, then retrieves and returns several items at once from a
+ * no-split buffer.
+ */
+
+#define BATCH_ITEM_COUNT                4
+
+TEST_CASE("Test ring buffer fragmented send and batched receive", "[esp_ringbuf]")
+{
+    uint8_t data[MEDIUM_ITEM_SIZE];
+    for (int i = 0; i < MEDIUM_ITEM_SIZE; i++) {
+        data[i] = i;
+    }
+    //Empty fragments are allowed anywhere in the item
+    const RingbufferFragment_t fragments[] = {
+        { .pvData = data, .xSize = 3 },
+        { .pvData = NULL, .xSize = 0 },
+        { .pvData = &data[3], .xSize = 1 },
+        { .pvData = &data[4], .xSize = MEDIUM_ITEM_SIZE - 4 },
+    };
+    const UBaseType_t fragment_count = sizeof(fragments) / sizeof(fragments[0]);
+
+    for (int type = 0; type < TEST_RINGBUF_TYPE_END; type++) {
+        RingbufHandle_t buffer_handle = xRingbufferCreate(BUFFER_SIZE, type);
+        TEST_ASSERT_NOT_EQUAL(NULL, buffer_handle);
+        BaseType_t task_woken = pdFALSE;
+        TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSendFragments(buffer_handle, fragments, fragment_count, 0));
+        TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSendFragmentsFromISR(buffer_handle, fragments, fragment_count, &task_woken));
+        for (int i = 0; i < 2; i++) {
+            //Receive the whole item
+            uint8_t received[MEDIUM_ITEM_SIZE];
+            size_t received_size = 0;
+            if (type == RINGBUF_TYPE_ALLOWSPLIT) {
+                void *item1, *item2;
+                size_t item_size1, item_size2;
+                TEST_ASSERT_EQUAL(pdTRUE, xRingbufferReceiveSplit(buffer_handle, &item1, &item2, &item_size1, &item_size2, 0));
+                memcpy(received, item1, item_size1);
+                received_size = item_size1;
+                vRingbufferReturnItem(buffer_handle, item1);
+                if (item2 != NULL) {
+                    memcpy(&received[received_size], item2, item_size2);
+                    received_size += item_size2;
+                    vRingbufferReturnItem(buffer_handle, item2);
+                }
+            } else if (type == RINGBUF_TYPE_NOSPLIT) {
+                size_t item_size;
+                uint8_t *item = xRingbufferReceive(buffer_handle, &item_size, 0);
+                TEST_ASSERT_NOT_EQUAL(NULL, item);
+                memcpy(received, item, item_size);
+                received_size = item_size;
+                vRingbufferReturnItem(buffer_handle, item);
+            } else {
+                //Data may wrap around in byte buffers
+                while (received_size < MEDIUM_ITEM_SIZE) {
+                    size_t item_size;
+                    uint8_t *item = xRingbufferReceiveUpTo(buffer_handle, &item_size, 0, MEDIUM_ITEM_SIZE - received_size);
+                    TEST_ASSERT_NOT_EQUAL(NULL, item);
+                    memcpy(&received[received_size], item, item_size);
+                    received_size += item_size;
+                    vRingbufferReturnItem(buffer_handle, item);
+                }
+            }
+            TEST_ASSERT_EQUAL(MEDIUM_ITEM_SIZE, received_size);
+            TEST_ASSERT_EQUAL_HEX8_ARRAY(data, received, MEDIUM_ITEM_SIZE);
+        }
+        vRingbufferDelete(buffer_handle);
+    }
+
+    RingbufHandle_t buffer_handle = xRingbufferCreate(BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT);
+    TEST_ASSERT_NOT_EQUAL(NULL, buffer_handle);
+    void *items[BATCH_ITEM_COUNT];
+    size_t item_sizes[BATCH_ITEM_COUNT];
+
+    //Empty buffer times out
+    TEST_ASSERT_EQUAL(0, uxRingbufferReceiveItems(buffer_handle, items, item_sizes, BATCH_ITEM_COUNT, TIMEOUT_TICKS));
+
+    //Only the available items are retrieved, up to the maximum number of items
+    for (int i = 0; i < BATCH_ITEM_COUNT + 2; i++) {
+        TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSend(buffer_handle, &data[i], SMALL_ITEM_SIZE, 0));
+    }
+    TEST_ASSERT_EQUAL(BATCH_ITEM_COUNT, uxRingbufferReceiveItems(buffer_handle, items, item_sizes, BATCH_ITEM_COUNT, 0));
+    for (int i = 0; i < BATCH_ITEM_COUNT; i++) {
+        TEST_ASSERT_EQUAL(SMALL_ITEM_SIZE, item_sizes[i]);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(&data[i], items[i], SMALL_ITEM_SIZE);
+    }
+    vRingbufferReturnItems(buffer_handle, items, BATCH_ITEM_COUNT);
+    TEST_ASSERT_EQUAL(2, uxRingbufferReceiveItems(buffer_handle, items, item_sizes, BATCH_ITEM_COUNT, 0));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(&data[BATCH_ITEM_COUNT], items[0], SMALL_ITEM_SIZE);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(&data[BATCH_ITEM_COUNT + 1], items[1], SMALL_ITEM_SIZE);
+    //Items retrieved in a batch can also be returned one by one, in any order
+    vRingbufferReturnItem(buffer_handle, items[1]);
+    vRingbufferReturnItem(buffer_handle, items[0]);
+
+    //All the space is freed once the items are returned
+    TEST_ASSERT_EQUAL(xRingbufferGetMaxItemSize(buffer_handle), xRingbufferGetCurFreeSize(buffer_handle));
+    vRingbufferDelete(buffer_handle);
+}
+
+/* ------------------- Test ring buffer byte stream throughput -----------------
+ * The following test case streams data from a sending task to a receiving task
+ * (on different cores when possible) through a byte buffer and through an SPSC
+ * byte buffer, and prints the throughput of both for several chunk sizes.
+ */
+
+#define THROUGHPUT_BUFF_LEN             1024
+#define THROUGHPUT_DATA_LEN             (256 * 1024)
+
+typedef struct {
+    RingbufHandle_t buffer;
+    size_t chunk_size;
+    SemaphoreHandle_t done;
+} throughput_args_t;
+
+static void throughput_send_task(void *args)
+{
+    throughput_args_t *task_args = (throughput_args_t *)args;
+    static uint8_t chunk[THROUGHPUT_BUFF_LEN];
+
+    for (size_t sent = 0; sent < THROUGHPUT_DATA_LEN; sent += task_args->chunk_size) {
+        for (size_t i = 0; i < task_args->chunk_size; i++) {
+            chunk[i] = (uint8_t)(sent + i);
+        }
+        TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSend(task_args->buffer, chunk, task_args->chunk_size, portMAX_DELAY));
+    }
+    xSemaphoreGive(task_args->done);
+    vTaskDelete(NULL);
+}
+
+static void throughput_rec_task(void *args)
+{
+    throughput_args_t *task_args = (throughput_args_t *)args;
+
+    for (size_t received = 0; received < THROUGHPUT_DATA_LEN;) {
+        size_t item_size;
+        uint8_t *item = xRingbufferReceive(task_args->buffer, &item_size, portMAX_DELAY);
+        TEST_ASSERT_NOT_EQUAL(NULL, item);
+        for (size_t i = 0; i < item_size; i++) {
+            TEST_ASSERT_EQUAL_UINT8((uint8_t)(received + i), item[i]);
+        }
+        received += item_size;
+        vRingbufferReturnItem(task_args->buffer, item);
+    }
+    xSemaphoreGive(task_args->done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("Test ring buffer byte stream throughput", "[esp_ringbuf][qemu-ignore]")
+{
+#if CONFIG_RINGBUF_SPSC_BYTEBUF
+    const RingbufferType_t types[] = { RINGBUF_TYPE_BYTEBUF, RINGBUF_TYPE_BYTEBUF_SPSC };
+#else
+    const RingbufferType_t types[] = { RINGBUF_TYPE_BYTEBUF };
+#endif
+    const size_t chunk_sizes[] = { 4, 64, 256 };
+    throughput_args_t task_args;
+    task_args.done = xSemaphoreCreateCounting(2, 0);
+    TEST_ASSERT_NOT_EQUAL(NULL, task_args.done);
+
+    for (int i = 0; i < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]); i++) {
+        for (int j = 0; j < sizeof(types) / sizeof(types[0]); j++) {
+            task_args.buffer = xRingbufferCreate(THROUGHPUT_BUFF_LEN, types[j]);
+            task_args.chunk_size = chunk_sizes[i];
+            TEST_ASSERT_NOT_EQUAL(NULL, task_args.buffer);
+
+            int64_t start = esp_timer_get_time();
+            xTaskCreatePinnedToCore(throughput_rec_task, "rec tsk", 2048, (void *)&task_args, 10, NULL, 0);
+            xTaskCreatePinnedToCore(throughput_send_task, "send tsk", 2048, (void *)&task_args, 10, NULL, CONFIG_FREERTOS_NUMBER_OF_CORES - 1);
+            xSemaphoreTake(task_args.done, portMAX_DELAY);
+            xSemaphoreTake(task_args.done, portMAX_DELAY);
+            int64_t elapsed_us = esp_timer_get_time() - start;
+
+            printf("%s, %d byte chunks: %" PRId32 " KB/s\n", (types[j] == RINGBUF_TYPE_BYTEBUF) ? "Byte buffer" : "SPSC byte buffer",
+                   (int)chunk_sizes[i], (int32_t)((int64_t)THROUGHPUT_DATA_LEN * 1000000 / 1024 / elapsed_us));
+            vTaskDelay(5);  //Allow idle to clean up
+            vRingbufferDelete(task_args.buffer);
+        }
+    }
+    vSemaphoreDelete(task_args.done);
+}
@@ -1,4 +1,4 @@
-# SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+# SPDX-FileCopyrightText: 2022-2024 Espressif Systems (Shanghai) CO LTD
 # SPDX-License-Identifier: CC0-1.0
 
 import pytest
@@ -13,7 +13,8 @@ from pytest_embedded import Dut
     'config',
     [
         'default',
-        'ringbuf_flash'
+        'ringbuf_flash',
+        'spsc'
     ]
 )
 def test_esp_ringbuf(dut: Dut) -> None:
@@ -28,7 +29,8 @@ def test_esp_ringbuf(dut: Dut) -> None:
     'config',
     [
         'default',
-        'ringbuf_flash'
+        'ringbuf_flash',
+        'spsc'
     ]
 )
 def test_esp_ringbuf_qemu(dut: Dut) -> None:
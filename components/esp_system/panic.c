@@ -58,6 +58,10 @@
 #include "esp_gdbstub.h"
 #endif
 
+#if CONFIG_LOG_ASYNC && !CONFIG_ESP_SYSTEM_PANIC_SILENT_REBOOT
+#include "esp_log.h"
+#endif
+
 #if CONFIG_ESP_CONSOLE_USB_SERIAL_JTAG || CONFIG_ESP_CONSOLE_SECONDARY_USB_SERIAL_JTAG
 #include "hal/usb_serial_jtag_ll.h"
 #endif
@@ -358,6 +362,12 @@ void esp_panic_handler(panic_info_t *info)
 
     panic_print_str("\r\n");
 
+#if CONFIG_LOG_ASYNC && !CONFIG_ESP_SYSTEM_PANIC_SILENT_REBOOT
+    panic_print_str("Pending log messages:\r\n");
+    esp_log_async_panic_flush(panic_print_str);
+    panic_print_str("\r\n");
+#endif // CONFIG_LOG_ASYNC && !CONFIG_ESP_SYSTEM_PANIC_SILENT_REBOOT
+
 #if CONFIG_APPTRACE_ENABLE
     disable_all_wdts();
 #if CONFIG_APPTRACE_SV_ENABLE
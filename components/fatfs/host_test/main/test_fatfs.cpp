@@ -1,16 +1,19 @@
 /*
- * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2023-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
 #include <stdio.h>
 #include <string.h>
+#include <chrono>
 
 #include "ff.h"
 #include "esp_partition.h"
+#include "esp_private/partition_linux.h"
 #include "wear_levelling.h"
 #include "diskio_impl.h"
 #include "diskio_wl.h"
+#include "vfs_fat_stream.h"
 
 #include <catch2/catch_test_macros.hpp>
 
@@ -282,3 +285,183 @@ TEST_CASE("Test mounting 2 volumes, writing data and formating the 2nd one, read
     esp_result = wl_unmount(wl_handle1);
     REQUIRE(esp_result == ESP_OK);
 }
+
+// Size of the benchmark file, 16 clusters of 4 sectors
+#define STREAM_FILE_SIZE (256 * 1024)
+// Size of each read or write, as done by stdio or small application buffers
+#define STREAM_TRANSFER_SIZE 512
+// Number of random reads and writes
+#define STREAM_RANDOM_COUNT 256
+
+typedef struct {
+    size_t seq_write_ops;
+    size_t seq_read_ops;
+    size_t random_read_ops;
+    size_t random_write_ops;
+    double seq_write_s;
+    double seq_read_s;
+    double random_s;
+} stream_bench_result_t;
+
+static void fill_pattern(uint8_t *buf, size_t offset, size_t size, uint32_t seed)
+{
+    for (size_t i = 0; i < size; i += sizeof(uint32_t)) {
+        *((uint32_t *)(buf + i)) = (uint32_t)(offset + i) ^ seed;
+    }
+}
+
+static bool check_pattern(const uint8_t *buf, size_t offset, size_t size, uint32_t seed)
+{
+    for (size_t i = 0; i < size; i += sizeof(uint32_t)) {
+        if (*((const uint32_t *)(buf + i)) != ((uint32_t)(offset + i) ^ seed)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Accesses the file with f_read/f_write/f_lseek, or through the streaming buffer if stream is not NULL
+static FRESULT bench_read(vfs_fat_stream_t *stream, FIL *file, void *dst, UINT size, UINT *read)
+{
+    return stream ? vfs_fat_stream_read(stream, file, dst, size, read) : f_read(file, dst, size, read);
+}
+
+static FRESULT bench_write(vfs_fat_stream_t *stream, FIL *file, const void *src, UINT size, UINT *written)
+{
+    return stream ? vfs_fat_stream_write(stream, file, src, size, written) : f_write(file, src, size, written);
+}
+
+static FRESULT bench_seek(vfs_fat_stream_t *stream, FIL *file, FSIZE_t pos)
+{
+    return stream ? vfs_fat_stream_seek(stream, file, pos) : f_lseek(file, pos);
+}
+
+static void run_stream_bench(const char *path, size_t stream_clusters, stream_bench_result_t *result)
+{
+    FIL file;
+    vfs_fat_stream_t stream;
+    vfs_fat_stream_t *s = NULL;
+    UINT bw;
+    uint8_t buf[STREAM_TRANSFER_SIZE];
+
+    REQUIRE(f_open(&file, path, FA_CREATE_ALWAYS | FA_READ | FA_WRITE) == FR_OK);
+    if (stream_clusters > 0) {
+        REQUIRE(vfs_fat_stream_init(&stream, &file, stream_clusters) == FR_OK);
+        s = &stream;
+    }
+    esp_partition_clear_stats();
+
+    // Sequential write
+    auto start = std::chrono::steady_clock::now();
+    for (size_t offset = 0; offset < STREAM_FILE_SIZE; offset += sizeof(buf)) {
+        fill_pattern(buf, offset, sizeof(buf), 0);
+        REQUIRE(bench_write(s, &file, buf, sizeof(buf), &bw) == FR_OK);
+        REQUIRE(bw == sizeof(buf));
+    }
+    REQUIRE((s ? vfs_fat_stream_flush(s, &file) : FR_OK) == FR_OK);
+    REQUIRE(f_sync(&file) == FR_OK);
+    REQUIRE(f_size(&file) == STREAM_FILE_SIZE);
+    auto seq_write_end = std::chrono::steady_clock::now();
+    result->seq_write_ops = esp_partition_get_write_ops();
+
+    // Sequential read
+    esp_partition_clear_stats();
+    REQUIRE(bench_seek(s, &file, 0) == FR_OK);
+    for (size_t offset = 0; offset < STREAM_FILE_SIZE; offset += sizeof(buf)) {
+        REQUIRE(bench_read(s, &file, buf, sizeof(buf), &bw) == FR_OK);
+        REQUIRE(bw == sizeof(buf));
+        REQUIRE(check_pattern(buf, offset, sizeof(buf), 0));
+    }
+    REQUIRE(bench_read(s, &file, buf, sizeof(buf), &bw) == FR_OK);
+    REQUIRE(bw == 0);
+    auto seq_read_end = std::chrono::steady_clock::now();
+    result->seq_read_ops = esp_partition_get_read_ops();
+
+    // Random reads and writes, every 4th transfer rewrites a block with another pattern
+    esp_partition_clear_stats();
+    uint32_t rnd = 12345;
+    for (size_t i = 0; i < STREAM_RANDOM_COUNT; i++) {
+        rnd = rnd * 1103515245 + 12345;
+        const size_t offset = (rnd >> 8) % (STREAM_FILE_SIZE / sizeof(buf)) * sizeof(buf);
+        REQUIRE(bench_seek(s, &file, offset) == FR_OK);
+        if (i % 4 == 0) {
+            fill_pattern(buf, offset, sizeof(buf), 0xA5A5A5A5);
+            REQUIRE(bench_write(s, &file, buf, sizeof(buf), &bw) == FR_OK);
+            REQUIRE(bw == sizeof(buf));
+        } else {
+            REQUIRE(bench_read(s, &file, buf, sizeof(buf), &bw) == FR_OK);
+            REQUIRE(bw == sizeof(buf));
+            REQUIRE((check_pattern(buf, offset, sizeof(buf), 0) || check_pattern(buf, offset, sizeof(buf), 0xA5A5A5A5)));
+        }
+    }
+    if (s) {
+        REQUIRE(vfs_fat_stream_deinit(s, &file) == FR_OK);
+    }
+    REQUIRE(f_close(&file) == FR_OK);
+    auto random_end = std::chrono::steady_clock::now();
+
+    result->random_read_ops = esp_partition_get_read_ops();
+    result->random_write_ops = esp_partition_get_write_ops();
+    result->seq_write_s = std::chrono::duration<double>(seq_write_end - start).count();
+    result->seq_read_s = std::chrono::duration<double>(seq_read_end - seq_write_end).count();
+    result->random_s = std::chrono::duration<double>(random_end - seq_read_end).count();
+
+    // Check the whole file after the random writes
+    REQUIRE(f_open(&file, path, FA_READ) == FR_OK);
+    for (size_t offset = 0; offset < STREAM_FILE_SIZE; offset += sizeof(buf)) {
+        REQUIRE(f_read(&file, buf, sizeof(buf), &bw) == FR_OK);
+        REQUIRE(bw == sizeof(buf));
+        REQUIRE((check_pattern(buf, offset, sizeof(buf), 0) || check_pattern(buf, offset, sizeof(buf), 0xA5A5A5A5)));
+    }
+    REQUIRE(f_close(&file) == FR_OK);
+}
+
+/*
+ * Compares small transfers done with f_read/f_write to the streaming buffer used by the VFS FATFS
+ * streaming mode (CONFIG_FATFS_VFS_STREAM_MODE), which reads ahead and batches writes in whole clusters
+ */
+TEST_CASE("Streaming buffer reduces disk operations of small sequential transfers", "[fatfs]")
+{
+    const esp_partition_t *partition = NULL;
+    wl_handle_t wl_handle = WL_INVALID_HANDLE;
+    BYTE pdrv = UINT8_MAX;
+    FATFS fs;
+
+    prepare_fatfs("storage", &partition, &wl_handle, &pdrv);
+    char drv[3] = {(char)('0' + pdrv), ':', 0};
+
+    // Format with clusters of 4 sectors, so that a cluster is written with a single multi-sector disk_write
+    const size_t workbuf_size = 4096;
+    void *workbuf = ff_memalloc(workbuf_size);
+    REQUIRE(workbuf != NULL);
+    const MKFS_PARM opt = {(BYTE)(FM_ANY | FM_SFD), 0, 0, 0, 4 * CONFIG_WL_SECTOR_SIZE};
+    REQUIRE(f_mkfs(drv, &opt, workbuf, workbuf_size) == FR_OK);
+    free(workbuf);
+    REQUIRE(f_mount(&fs, drv, 1) == FR_OK);
+    REQUIRE(fs.csize == 4);
+
+    char path[16];
+    snprintf(path, sizeof(path), "%s/bench.bin", drv);
+    stream_bench_result_t direct;
+    stream_bench_result_t streamed;
+    run_stream_bench(path, 0, &direct);
+    run_stream_bench(path, 2, &streamed);
+
+    const stream_bench_result_t *results[] = {&direct, &streamed};
+    const char *names[] = {"f_read/f_write", "streaming"};
+    printf("%d bytes transfers, %d bytes file, partition operations and time:\n", STREAM_TRANSFER_SIZE, STREAM_FILE_SIZE);
+    for (size_t i = 0; i < 2; i++) {
+        const stream_bench_result_t *r = results[i];
+        printf("  %-16s seq write %zu ops %.2f ms, seq read %zu ops %.2f ms, random %zu read ops %zu write ops %.2f ms\n",
+               names[i], r->seq_write_ops, r->seq_write_s * 1000, r->seq_read_ops, r->seq_read_s * 1000,
+               r->random_read_ops, r->random_write_ops, r->random_s * 1000);
+    }
+    // Random transfers are not batched, the read-ahead is skipped after each seek
+    REQUIRE(streamed.seq_write_ops < direct.seq_write_ops);
+    REQUIRE(streamed.seq_read_ops < direct.seq_read_ops);
+
+    REQUIRE(f_mount(0, drv, 0) == FR_OK);
+    ff_diskio_unregister(pdrv);
+    ff_diskio_clear_pdrv_wl(wl_handle);
+    REQUIRE(wl_unmount(wl_handle) == ESP_OK);
+}
@@ -161,6 +161,22 @@ TEST_CASE("(WL) pwrite() works well", "[fatfs][wear_levelling]")
     test_teardown();
 }
 
+TEST_CASE("(WL) readv() and writev() work well", "[fatfs][wear_levelling]")
+{
+    test_setup();
+    test_fatfs_readv_writev_file("/spiflash/hello.txt");
+    test_teardown();
+}
+
+#if CONFIG_FATFS_VFS_STREAM_MODE
+TEST_CASE("(WL) streaming mode buffers reads and writes", "[fatfs][wear_levelling]")
+{
+    test_setup();
+    test_fatfs_stream_mode("/spiflash/stream.bin");
+    test_teardown();
+}
+#endif
+
 TEST_CASE("(WL) can open maximum number of files", "[fatfs][wear_levelling]")
 {
     size_t max_files = FOPEN_MAX - 3; /* account for stdin, stdout, stderr */
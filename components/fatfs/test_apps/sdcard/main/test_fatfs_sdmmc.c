@@ -166,6 +166,14 @@ TEST_CASE("(SD) pwrite() works well", "[fatfs][sdmmc]")
     test_teardown_sdmmc(card);
 }
 
+TEST_CASE("(SD) readv() and writev() work well", "[fatfs][sdmmc]")
+{
+    sdmmc_card_t *card = NULL;
+    test_setup_sdmmc(&card);
+    test_fatfs_readv_writev_file(test_filename);
+    test_teardown_sdmmc(card);
+}
+
 TEST_CASE("(SD) overwrite and append file", "[fatfs][sdmmc]")
 {
     sdmmc_card_t *card = NULL;
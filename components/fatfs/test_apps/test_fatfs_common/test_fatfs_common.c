@@ -11,8 +11,11 @@
 #include <time.h>
 #include <fcntl.h>
 #include <sys/time.h>
+#include <sys/param.h>
 #include <sys/unistd.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/ioctl.h>
 #include <errno.h>
 #include <utime.h>
 #include "unity.h"
@@ -197,6 +200,130 @@ void test_fatfs_pwrite_file(const char *filename)
     test_file_content(filename, "Hello, Dolly!");
 }
 
+void test_fatfs_readv_writev_file(const char *filename)
+{
+    int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC);
+    TEST_ASSERT_NOT_EQUAL(-1, fd);
+
+    const struct iovec wr_iov[] = {
+        { .iov_base = (void *) "Hello", .iov_len = 5 },
+        { .iov_base = NULL, .iov_len = 0 },
+        { .iov_base = (void *) ", world!", .iov_len = 8 },
+    };
+    TEST_ASSERT_EQUAL(13, writev(fd, wr_iov, 3));
+    TEST_ASSERT_EQUAL(13, lseek(fd, 0, SEEK_CUR));
+
+    // The last buffer is only partially filled, at the end of the file
+    char buf1[4] = { 0 };
+    char buf2[7] = { 0 };
+    char buf3[16] = { 0 };
+    const struct iovec rd_iov[] = {
+        { .iov_base = buf1, .iov_len = sizeof(buf1) },
+        { .iov_base = buf2, .iov_len = sizeof(buf2) },
+        { .iov_base = buf3, .iov_len = sizeof(buf3) },
+    };
+    TEST_ASSERT_EQUAL(0, lseek(fd, 0, SEEK_SET));
+    TEST_ASSERT_EQUAL(13, readv(fd, rd_iov, 3));
+    TEST_ASSERT_EQUAL_INT8_ARRAY("Hell", buf1, sizeof(buf1));
+    TEST_ASSERT_EQUAL_INT8_ARRAY("o, worl", buf2, sizeof(buf2));
+    TEST_ASSERT_EQUAL_STRING("d!", buf3);
+    TEST_ASSERT_EQUAL(0, readv(fd, rd_iov, 3));
+
+    // Rewriting in the middle of the file
+    const struct iovec rewr_iov[] = {
+        { .iov_base = (void *) "Dol", .iov_len = 3 },
+        { .iov_base = (void *) "ly", .iov_len = 2 },
+    };
+    TEST_ASSERT_EQUAL(7, lseek(fd, 7, SEEK_SET));
+    TEST_ASSERT_EQUAL(5, writev(fd, rewr_iov, 2));
+    TEST_ASSERT_EQUAL(0, close(fd));
+    test_file_content(filename, "Hello, Dolly!");
+}
+
+#if CONFIG_FATFS_VFS_STREAM_MODE
+void test_fatfs_stream_mode(const char* filename)
+{
+    const size_t file_size = 3 * 4096 + 1000;
+    uint8_t *data = malloc(file_size);
+    uint8_t *buf = malloc(file_size);
+    TEST_ASSERT_NOT_NULL(data);
+    TEST_ASSERT_NOT_NULL(buf);
+    for (size_t i = 0; i < file_size; ++i) {
+        data[i] = i % 251;
+    }
+
+    int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC);
+    TEST_ASSERT_NOT_EQUAL(-1, fd);
+    int clusters = -1;
+    TEST_ASSERT_EQUAL(0, ioctl(fd, ESP_VFS_FAT_G_STREAM_CLUSTERS, &clusters));
+    TEST_ASSERT_EQUAL(0, clusters);
+    TEST_ASSERT_EQUAL(-1, ioctl(fd, ESP_VFS_FAT_S_STREAM_CLUSTERS, -1));
+    TEST_ASSERT_EQUAL(EINVAL, errno);
+    TEST_ASSERT_EQUAL(0, ioctl(fd, ESP_VFS_FAT_S_STREAM_CLUSTERS, 1));
+    TEST_ASSERT_EQUAL(0, ioctl(fd, ESP_VFS_FAT_G_STREAM_CLUSTERS, &clusters));
+    TEST_ASSERT_EQUAL(1, clusters);
+
+    // Small writes, the first ones are still in the buffer
+    const size_t chunk = 100;
+    for (size_t i = 0; i < 10; ++i) {
+        TEST_ASSERT_EQUAL(chunk, write(fd, data + i * chunk, chunk));
+    }
+    struct stat st;
+    TEST_ASSERT_EQUAL(0, fstat(fd, &st));
+    TEST_ASSERT_EQUAL(10 * chunk, st.st_size);
+
+    // pread writes the buffered data first
+    TEST_ASSERT_EQUAL(chunk, pread(fd, buf, chunk, 500));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data + 500, buf, chunk);
+    TEST_ASSERT_EQUAL(10 * chunk, lseek(fd, 0, SEEK_CUR));
+
+    // The rest of the file crosses the cluster boundaries
+    for (size_t pos = 10 * chunk; pos < file_size; pos += chunk) {
+        const size_t len = MIN(chunk, file_size - pos);
+        TEST_ASSERT_EQUAL(len, write(fd, data + pos, len));
+    }
+    TEST_ASSERT_EQUAL(0, fstat(fd, &st));
+    TEST_ASSERT_EQUAL(file_size, st.st_size);
+#if CONFIG_FATFS_IMMEDIATE_FSYNC
+    // stat writes the buffered data of the open files, which syncs them
+    TEST_ASSERT_EQUAL(0, stat(filename, &st));
+    TEST_ASSERT_EQUAL(file_size, st.st_size);
+#endif
+
+    // Small reads, from the data read ahead
+    TEST_ASSERT_EQUAL(0, lseek(fd, 0, SEEK_SET));
+    memset(buf, 0, file_size);
+    for (size_t pos = 0; pos < file_size; pos += 7) {
+        const size_t len = MIN(7, file_size - pos);
+        TEST_ASSERT_EQUAL(len, read(fd, buf + pos, len));
+    }
+    TEST_ASSERT_EQUAL(0, read(fd, buf, 1));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, buf, file_size);
+
+    // Rewriting in the middle of the file, the data is written when the streaming mode is disabled
+    TEST_ASSERT_EQUAL(4000, lseek(fd, 4000, SEEK_SET));
+    memset(data + 4000, 0xa5, 200);
+    TEST_ASSERT_EQUAL(200, write(fd, data + 4000, 200));
+    TEST_ASSERT_EQUAL(0, ioctl(fd, ESP_VFS_FAT_S_STREAM_CLUSTERS, 0));
+    TEST_ASSERT_EQUAL(0, ioctl(fd, ESP_VFS_FAT_G_STREAM_CLUSTERS, &clusters));
+    TEST_ASSERT_EQUAL(0, clusters);
+    TEST_ASSERT_EQUAL(4200, lseek(fd, 0, SEEK_CUR));
+    TEST_ASSERT_EQUAL(0, close(fd));
+
+    TEST_ASSERT_EQUAL(0, stat(filename, &st));
+    TEST_ASSERT_EQUAL(file_size, st.st_size);
+    fd = open(filename, O_RDONLY);
+    TEST_ASSERT_NOT_EQUAL(-1, fd);
+    memset(buf, 0, file_size);
+    TEST_ASSERT_EQUAL(file_size, read(fd, buf, file_size));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, buf, file_size);
+    TEST_ASSERT_EQUAL(0, close(fd));
+
+    free(buf);
+    free(data);
+}
+#endif // CONFIG_FATFS_VFS_STREAM_MODE
+
 void test_fatfs_open_max_files(const char* filename_prefix, size_t files_count)
 {
     FILE** files = calloc(files_count, sizeof(FILE*));
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -41,6 +41,10 @@ void test_fatfs_pread_file(const char* filename);
 
 void test_fatfs_pwrite_file(const char* filename);
 
+void test_fatfs_readv_writev_file(const char* filename);
+
+void test_fatfs_stream_mode(const char* filename);
+
 void test_fatfs_open_max_files(const char* filename_prefix, size_t files_count);
 
 void test_fatfs_lseek(const char* filename);
@@ -25,6 +25,16 @@ typedef struct {
     size_t max_files;      /*!< Maximum number of files which can be open at the same time. */
 } esp_vfs_fat_conf_t;
 
+/**
+ * @brief ioctl() requests of the files opened through the FATFS VFS
+ *
+ * Only available if CONFIG_FATFS_VFS_STREAM_MODE is enabled.
+ */
+typedef enum {
+    ESP_VFS_FAT_S_STREAM_CLUSTERS,  /*!< Set the size of the streaming buffer in clusters (int), 0 to disable the streaming mode */
+    ESP_VFS_FAT_G_STREAM_CLUSTERS,  /*!< Get the size of the streaming buffer in clusters (int *), 0 if the streaming mode is disabled */
+} esp_vfs_fat_ioctl_opt_t;
+
 /**
  * @brief Register FATFS with VFS component
  *
@@ -17,6 +17,7 @@
 #include "esp_log.h"
 #include "ff.h"
 #include "diskio_impl.h"
+#include "vfs_fat_stream.h"
 
 #define F_WRITE_MALLOC_ZEROING_BUF_SIZE_LIMIT 512
 
@@ -29,6 +30,9 @@ typedef struct {
     char tmp_path_buf[FILENAME_MAX+3];  /* temporary buffer used to prepend drive name to the path */
     char tmp_path_buf2[FILENAME_MAX+3]; /* as above; used in functions which take two path arguments */
     bool *o_append;  /* O_APPEND is stored here for each max_files entries (because O_APPEND is not compatible with FA_OPEN_APPEND) */
+#if CONFIG_FATFS_VFS_STREAM_MODE
+    vfs_fat_stream_t *streams;  /* streaming buffer of each max_files entries, buf is NULL if the streaming mode is disabled */
+#endif
     FIL files[0];   /* array with max_files entries; must be the final member of the structure */
 } vfs_fat_ctx_t;
 
@@ -66,10 +70,15 @@ static off_t vfs_fat_lseek(void* p, int fd, off_t size, int mode);
 static ssize_t vfs_fat_read(void* ctx, int fd, void * dst, size_t size);
 static ssize_t vfs_fat_pread(void *ctx, int fd, void *dst, size_t size, off_t offset);
 static ssize_t vfs_fat_pwrite(void *ctx, int fd, const void *src, size_t size, off_t offset);
+static ssize_t vfs_fat_readv(void *ctx, int fd, const struct iovec *iov, int iovcnt);
+static ssize_t vfs_fat_writev(void *ctx, int fd, const struct iovec *iov, int iovcnt);
 static int vfs_fat_open(void* ctx, const char * path, int flags, int mode);
 static int vfs_fat_close(void* ctx, int fd);
 static int vfs_fat_fstat(void* ctx, int fd, struct stat * st);
 static int vfs_fat_fsync(void* ctx, int fd);
+#if CONFIG_FATFS_VFS_STREAM_MODE
+static int vfs_fat_ioctl(void* ctx, int fd, int cmd, va_list args);
+#endif
 #ifdef CONFIG_VFS_SUPPORT_DIR
 static int vfs_fat_stat(void* ctx, const char * path, struct stat * st);
 static int vfs_fat_link(void* ctx, const char* n1, const char* n2);
@@ -143,10 +152,15 @@ esp_err_t esp_vfs_fat_register_cfg(const esp_vfs_fat_conf_t* conf, FATFS** out_f
         .read_p = &vfs_fat_read,
         .pread_p = &vfs_fat_pread,
         .pwrite_p = &vfs_fat_pwrite,
+        .readv_p = &vfs_fat_readv,
+        .writev_p = &vfs_fat_writev,
         .open_p = &vfs_fat_open,
         .close_p = &vfs_fat_close,
         .fstat_p = &vfs_fat_fstat,
         .fsync_p = &vfs_fat_fsync,
+#if CONFIG_FATFS_VFS_STREAM_MODE
+        .ioctl_p = &vfs_fat_ioctl,
+#endif
 #ifdef CONFIG_VFS_SUPPORT_DIR
         .stat_p = &vfs_fat_stat,
         .link_p = &vfs_fat_link,
@@ -184,12 +198,24 @@ esp_err_t esp_vfs_fat_register_cfg(const esp_vfs_fat_conf_t* conf, FATFS** out_f
         return ESP_ERR_NO_MEM;
     }
     memset(fat_ctx->o_append, 0, max_files * sizeof(bool));
+#if CONFIG_FATFS_VFS_STREAM_MODE
+    fat_ctx->streams = ff_memalloc(max_files * sizeof(vfs_fat_stream_t));
+    if (fat_ctx->streams == NULL) {
+        free(fat_ctx->o_append);
+        free(fat_ctx);
+        return ESP_ERR_NO_MEM;
+    }
+    memset(fat_ctx->streams, 0, max_files * sizeof(vfs_fat_stream_t));
+#endif
     fat_ctx->max_files = max_files;
     strlcpy(fat_ctx->fat_drive, conf->fat_drive, sizeof(fat_ctx->fat_drive) - 1);
     strlcpy(fat_ctx->base_path, conf->base_path, sizeof(fat_ctx->base_path) - 1);
 
     esp_err_t err = esp_vfs_register(conf->base_path, &vfs, fat_ctx);
     if (err != ESP_OK) {
+#if CONFIG_FATFS_VFS_STREAM_MODE
+        free(fat_ctx->streams);
+#endif
         free(fat_ctx->o_append);
         free(fat_ctx);
         return err;
@@ -218,6 +244,9 @@ esp_err_t esp_vfs_fat_unregister_path(const char* base_path)
         return err;
     }
     _lock_close(&fat_ctx->lock);
+#if CONFIG_FATFS_VFS_STREAM_MODE
+    free(fat_ctx->streams);
+#endif
     free(fat_ctx->o_append);
     free(fat_ctx);
     s_fat_ctxs[ctx] = NULL;
@@ -325,6 +354,98 @@ static void file_cleanup(vfs_fat_ctx_t* ctx, int fd)
     memset(&ctx->files[fd], 0, sizeof(FIL));
 }
 
+/*
+ * The following functions access the file through its streaming buffer if it has one,
+ * they are called with ctx->lock acquired if CONFIG_FATFS_VFS_STREAM_MODE is enabled.
+ */
+static inline vfs_fat_stream_t* file_stream(vfs_fat_ctx_t* ctx, int fd)
+{
+#if CONFIG_FATFS_VFS_STREAM_MODE
+    if (ctx->streams[fd].buf != NULL) {
+        return &ctx->streams[fd];
+    }
+#endif
+    return NULL;
+}
+
+static FRESULT file_read(vfs_fat_ctx_t* ctx, int fd, void* dst, UINT size, UINT* read)
+{
+#if CONFIG_FATFS_VFS_STREAM_MODE
+    vfs_fat_stream_t* stream = file_stream(ctx, fd);
+    if (stream) {
+        return vfs_fat_stream_read(stream, &ctx->files[fd], dst, size, read);
+    }
+#endif
+    return f_read(&ctx->files[fd], dst, size, read);
+}
+
+static FRESULT file_write(vfs_fat_ctx_t* ctx, int fd, const void* src, UINT size, UINT* written)
+{
+#if CONFIG_FATFS_VFS_STREAM_MODE
+    vfs_fat_stream_t* stream = file_stream(ctx, fd);
+    if (stream) {
+        return vfs_fat_stream_write(stream, &ctx->files[fd], src, size, written);
+    }
+#endif
+    return f_write(&ctx->files[fd], src, size, written);
+}
+
+static FRESULT file_seek(vfs_fat_ctx_t* ctx, int fd, FSIZE_t pos)
+{
+#if CONFIG_FATFS_VFS_STREAM_MODE
+    vfs_fat_stream_t* stream = file_stream(ctx, fd);
+    if (stream) {
+        return vfs_fat_stream_seek(stream, &ctx->files[fd], pos);
+    }
+#endif
+    return f_lseek(&ctx->files[fd], pos);
+}
+
+static FSIZE_t file_tell(vfs_fat_ctx_t* ctx, int fd)
+{
+#if CONFIG_FATFS_VFS_STREAM_MODE
+    vfs_fat_stream_t* stream = file_stream(ctx, fd);
+    if (stream) {
+        return stream->pos;
+    }
+#endif
+    return f_tell(&ctx->files[fd]);
+}
+
+static FSIZE_t file_size(vfs_fat_ctx_t* ctx, int fd)
+{
+#if CONFIG_FATFS_VFS_STREAM_MODE
+    vfs_fat_stream_t* stream = file_stream(ctx, fd);
+    if (stream) {
+        return vfs_fat_stream_size(stream, &ctx->files[fd]);
+    }
+#endif
+    return f_size(&ctx->files[fd]);
+}
+
+/* Writes the buffered data, so that the FatFs functions can be used on the file directly */
+static FRESULT file_flush(vfs_fat_ctx_t* ctx, int fd)
+{
+#if CONFIG_FATFS_VFS_STREAM_MODE
+    vfs_fat_stream_t* stream = file_stream(ctx, fd);
+    if (stream) {
+        return vfs_fat_stream_flush(stream, &ctx->files[fd]);
+    }
+#endif
+    return FR_OK;
+}
+
+/* Called after the file pointer was moved by the FatFs functions */
+static void file_update_pos(vfs_fat_ctx_t* ctx, int fd)
+{
+#if CONFIG_FATFS_VFS_STREAM_MODE
+    vfs_fat_stream_t* stream = file_stream(ctx, fd);
+    if (stream) {
+        stream->pos = f_tell(&ctx->files[fd]);
+    }
+#endif
+}
+
 /**
  * @brief Prepend drive letters to path names
  * This function returns new path path pointers, pointing to a temporary buffer
@@ -418,7 +539,7 @@ static ssize_t vfs_fat_write(void* ctx, int fd, const void * data, size_t size)
     FRESULT res;
     _lock_acquire(&fat_ctx->lock);
     if (fat_ctx->o_append[fd]) {
-        if ((res = f_lseek(file, f_size(file))) != FR_OK) {
+        if ((res = file_seek(fat_ctx, fd, file_size(fat_ctx, fd))) != FR_OK) {
             ESP_LOGD(TAG, "%s: fresult=%d", __func__, res);
             errno = fresult_to_errno(res);
             _lock_release(&fat_ctx->lock);
@@ -426,7 +547,7 @@ static ssize_t vfs_fat_write(void* ctx, int fd, const void * data, size_t size)
         }
     }
     unsigned written = 0;
-    res = f_write(file, data, size, &written);
+    res = file_write(fat_ctx, fd, data, size, &written);
     if (((written == 0) && (size != 0)) && (res == 0)) {
         errno = ENOSPC;
         _lock_release(&fat_ctx->lock);
@@ -442,7 +563,8 @@ static ssize_t vfs_fat_write(void* ctx, int fd, const void * data, size_t size)
     }
 
 #if CONFIG_FATFS_IMMEDIATE_FSYNC
-    if (written > 0) {
+    // the streaming buffer syncs the file when it writes the buffered data
+    if (written > 0 && file_stream(fat_ctx, fd) == NULL) {
         res = f_sync(file);
         if (res != FR_OK) {
             ESP_LOGD(TAG, "%s: fresult=%d", __func__, res);
@@ -459,9 +581,14 @@ static ssize_t vfs_fat_write(void* ctx, int fd, const void * data, size_t size)
 static ssize_t vfs_fat_read(void* ctx, int fd, void * dst, size_t size)
 {
     vfs_fat_ctx_t* fat_ctx = (vfs_fat_ctx_t*) ctx;
-    FIL* file = &fat_ctx->files[fd];
     unsigned read = 0;
-    FRESULT res = f_read(file, dst, size, &read);
+#if CONFIG_FATFS_VFS_STREAM_MODE
+    _lock_acquire(&fat_ctx->lock);
+#endif
+    FRESULT res = file_read(fat_ctx, fd, dst, size, &read);
+#if CONFIG_FATFS_VFS_STREAM_MODE
+    _lock_release(&fat_ctx->lock);
+#endif
     if (res != FR_OK) {
         ESP_LOGD(TAG, "%s: fresult=%d", __func__, res);
         errno = fresult_to_errno(res);
@@ -472,15 +599,101 @@ static ssize_t vfs_fat_read(void* ctx, int fd, void * dst, size_t size)
     return read;
 }
 
+static ssize_t vfs_fat_readv(void *ctx, int fd, const struct iovec *iov, int iovcnt)
+{
+    vfs_fat_ctx_t* fat_ctx = (vfs_fat_ctx_t*) ctx;
+    ssize_t total = 0;
+    _lock_acquire(&fat_ctx->lock);
+    for (int i = 0; i < iovcnt; i++) {
+        unsigned read = 0;
+        FRESULT res = file_read(fat_ctx, fd, iov[i].iov_base, iov[i].iov_len, &read);
+        total += read;
+        if (res != FR_OK) {
+            ESP_LOGD(TAG, "%s: fresult=%d", __func__, res);
+            errno = fresult_to_errno(res);
+            if (total == 0) {
+                total = -1;
+            }
+            break;
+        }
+        if (read < iov[i].iov_len) {
+            break;
+        }
+    }
+    _lock_release(&fat_ctx->lock);
+    return total;
+}
+
+static ssize_t vfs_fat_writev(void *ctx, int fd, const struct iovec *iov, int iovcnt)
+{
+    vfs_fat_ctx_t* fat_ctx = (vfs_fat_ctx_t*) ctx;
+    FIL* file = &fat_ctx->files[fd];
+    FRESULT res;
+    _lock_acquire(&fat_ctx->lock);
+    if (fat_ctx->o_append[fd]) {
+        if ((res = file_seek(fat_ctx, fd, file_size(fat_ctx, fd))) != FR_OK) {
+            ESP_LOGD(TAG, "%s: fresult=%d", __func__, res);
+            errno = fresult_to_errno(res);
+            _lock_release(&fat_ctx->lock);
+            return -1;
+        }
+    }
+    // All the buffers are written under a single lock and, with CONFIG_FATFS_IMMEDIATE_FSYNC, a single sync
+    ssize_t total = 0;
+    bool failed = false;
+    for (int i = 0; i < iovcnt; i++) {
+        unsigned written = 0;
+        res = file_write(fat_ctx, fd, iov[i].iov_base, iov[i].iov_len, &written);
+        total += written;
+        if (res != FR_OK) {
+            ESP_LOGD(TAG, "%s: fresult=%d", __func__, res);
+            errno = fresult_to_errno(res);
+            failed = true;
+            break;
+        }
+        if (written < iov[i].iov_len) {
+            if (total == 0) {
+                errno = ENOSPC;
+                failed = true;
+            }
+            break;
+        }
+    }
+    if (failed && total == 0) {
+        _lock_release(&fat_ctx->lock);
+        return -1;
+    }
+
+#if CONFIG_FATFS_IMMEDIATE_FSYNC
+    if (total > 0 && file_stream(fat_ctx, fd) == NULL) {
+        res = f_sync(file);
+        if (res != FR_OK) {
+            ESP_LOGD(TAG, "%s: fresult=%d", __func__, res);
+            errno = fresult_to_errno(res);
+            _lock_release(&fat_ctx->lock);
+            return -1;
+        }
+    }
+#endif
+    _lock_release(&fat_ctx->lock);
+    return total;
+}
+
 static ssize_t vfs_fat_pread(void *ctx, int fd, void *dst, size_t size, off_t offset)
 {
     ssize_t ret = -1;
     vfs_fat_ctx_t *fat_ctx = (vfs_fat_ctx_t *) ctx;
     _lock_acquire(&fat_ctx->lock);
     FIL *file = &fat_ctx->files[fd];
+    FRESULT f_res = file_flush(fat_ctx, fd);
+    if (f_res != FR_OK) {
+        ESP_LOGD(TAG, "%s: fresult=%d", __func__, f_res);
+        errno = fresult_to_errno(f_res);
+        goto pread_release;
+    }
     const off_t prev_pos = f_tell(file);
 
-    FRESULT f_res = f_lseek(file, offset);
+    f_res = f_lseek(file, offset);
 
     if (f_res != FR_OK) {
         ESP_LOGD(TAG, "%s: fresult=%d", __func__, f_res);
@@ -518,9 +731,15 @@ static ssize_t vfs_fat_pwrite(void *ctx, int fd, const void *src, size_t size, o
     vfs_fat_ctx_t *fat_ctx = (vfs_fat_ctx_t *) ctx;
     _lock_acquire(&fat_ctx->lock);
     FIL *file = &fat_ctx->files[fd];
+    FRESULT f_res = file_flush(fat_ctx, fd);
+    if (f_res != FR_OK) {
+        ESP_LOGD(TAG, "%s: fresult=%d", __func__, f_res);
+        errno = fresult_to_errno(f_res);
+        goto pwrite_release;
+    }
     const off_t prev_pos = f_tell(file);
 
-    FRESULT f_res = f_lseek(file, offset);
+    f_res = f_lseek(file, offset);
 
     if (f_res != FR_OK) {
         ESP_LOGD(TAG, "%s: fresult=%d", __func__, f_res);
@@ -572,7 +791,16 @@ static int vfs_fat_fsync(void* ctx, int fd)
 {
     vfs_fat_ctx_t* fat_ctx = (vfs_fat_ctx_t*) ctx;
     FIL* file = &fat_ctx->files[fd];
+#if CONFIG_FATFS_VFS_STREAM_MODE
+    _lock_acquire(&fat_ctx->lock);
+    FRESULT res = file_flush(fat_ctx, fd);
+    if (res == FR_OK) {
+        res = f_sync(file);
+    }
+    _lock_release(&fat_ctx->lock);
+#else
     FRESULT res = f_sync(file);
+#endif
     int rc = 0;
     if (res != FR_OK) {
         ESP_LOGD(TAG, "%s: fresult=%d", __func__, res);
@@ -593,7 +821,19 @@ static int vfs_fat_close(void* ctx, int fd)
     file->cltbl = NULL;
 #endif
 
+#if CONFIG_FATFS_VFS_STREAM_MODE
+    FRESULT stream_res = FR_OK;
+    if (file_stream(fat_ctx, fd)) {
+        stream_res = vfs_fat_stream_deinit(&fat_ctx->streams[fd], file);
+    }
+#endif
     FRESULT res = f_close(file);
+#if CONFIG_FATFS_VFS_STREAM_MODE
+    if (res == FR_OK) {
+        // report the error of the buffered data
+        res = stream_res;
+    }
+#endif
     file_cleanup(fat_ctx, fd);
     _lock_release(&fat_ctx->lock);
     int rc = 0;
@@ -608,27 +848,35 @@ static int vfs_fat_close(void* ctx, int fd)
 static off_t vfs_fat_lseek(void* ctx, int fd, off_t offset, int mode)
 {
     vfs_fat_ctx_t* fat_ctx = (vfs_fat_ctx_t*) ctx;
-    FIL* file = &fat_ctx->files[fd];
     off_t new_pos;
+#if CONFIG_FATFS_VFS_STREAM_MODE
+    _lock_acquire(&fat_ctx->lock);
+#endif
     if (mode == SEEK_SET) {
         new_pos = offset;
     } else if (mode == SEEK_CUR) {
-        off_t cur_pos = f_tell(file);
+        off_t cur_pos = file_tell(fat_ctx, fd);
         new_pos = cur_pos + offset;
     } else if (mode == SEEK_END) {
-        off_t size = f_size(file);
+        off_t size = file_size(fat_ctx, fd);
         new_pos = size + offset;
     } else {
+#if CONFIG_FATFS_VFS_STREAM_MODE
+        _lock_release(&fat_ctx->lock);
+#endif
         errno = EINVAL;
         return -1;
     }
 
 #if FF_FS_EXFAT
-    ESP_LOGD(TAG, "%s: offset=%ld, filesize:=%" PRIu64, __func__, new_pos, f_size(file));
+    ESP_LOGD(TAG, "%s: offset=%ld, filesize:=%" PRIu64, __func__, new_pos, file_size(fat_ctx, fd));
 #else
-    ESP_LOGD(TAG, "%s: offset=%ld, filesize:=%" PRIu32, __func__, new_pos, f_size(file));
+    ESP_LOGD(TAG, "%s: offset=%ld, filesize:=%" PRIu32, __func__, new_pos, file_size(fat_ctx, fd));
+#endif
+    FRESULT res = file_seek(fat_ctx, fd, new_pos);
+#if CONFIG_FATFS_VFS_STREAM_MODE
+    _lock_release(&fat_ctx->lock);
 #endif
-    FRESULT res = f_lseek(file, new_pos);
     if (res != FR_OK) {
         ESP_LOGD(TAG, "%s: fresult=%d", __func__, res);
         errno = fresult_to_errno(res);
@@ -640,9 +888,14 @@ static off_t vfs_fat_lseek(void* ctx, int fd, off_t offset, int mode)
 static int vfs_fat_fstat(void* ctx, int fd, struct stat * st)
 {
     vfs_fat_ctx_t* fat_ctx = (vfs_fat_ctx_t*) ctx;
-    FIL* file = &fat_ctx->files[fd];
     memset(st, 0, sizeof(*st));
-    st->st_size = f_size(file);
+#if CONFIG_FATFS_VFS_STREAM_MODE
+    _lock_acquire(&fat_ctx->lock);
+    st->st_size = file_size(fat_ctx, fd);
+    _lock_release(&fat_ctx->lock);
+#else
+    st->st_size = file_size(fat_ctx, fd);
+#endif
     st->st_mode = S_IRWXU | S_IRWXG | S_IRWXO | S_IFREG;
     st->st_mtime = 0;
     st->st_atime = 0;
@@ -651,6 +904,65 @@ static int vfs_fat_fstat(void* ctx, int fd, struct stat * st)
     return 0;
 }
 
+#if CONFIG_FATFS_VFS_STREAM_MODE
+static int vfs_fat_ioctl(void* ctx, int fd, int cmd, va_list args)
+{
+    vfs_fat_ctx_t* fat_ctx = (vfs_fat_ctx_t*) ctx;
+    vfs_fat_stream_t* stream = &fat_ctx->streams[fd];
+    FIL* file = &fat_ctx->files[fd];
+    FRESULT res = FR_OK;
+    int ret = 0;
+    _lock_acquire(&fat_ctx->lock);
+    switch (cmd) {
+    case ESP_VFS_FAT_S_STREAM_CLUSTERS: ;
+        int clusters = va_arg(args, int);
+        if (clusters < 0) {
+            errno = EINVAL;
+            ret = -1;
+            break;
+        }
+        if (stream->buf != NULL && stream->clusters == (size_t) clusters) {
+            break;
+        }
+        if (stream->buf != NULL) {
+            // the buffer is kept if its data can't be written
+            res = vfs_fat_stream_flush(stream, file);
+            if (res == FR_OK) {
+                res = vfs_fat_stream_deinit(stream, file);
+            }
+        }
+        if (res == FR_OK && clusters > 0) {
+            res = vfs_fat_stream_init(stream, file, clusters);
+#if CONFIG_FATFS_IMMEDIATE_FSYNC
+            stream->sync_on_flush = true;
+#endif
+        }
+        if (res != FR_OK) {
+            ESP_LOGD(TAG, "%s: fresult=%d", __func__, res);
+            errno = fresult_to_errno(res);
+            ret = -1;
+        }
+        break;
+    case ESP_VFS_FAT_G_STREAM_CLUSTERS: ;
+        int* out_clusters = va_arg(args, int*);
+        if (out_clusters == NULL) {
+            errno = EINVAL;
+            ret = -1;
+            break;
+        }
+        *out_clusters = (stream->buf != NULL) ? (int) stream->clusters : 0;
+        break;
+    default:
+        // unsupported operation
+        errno = ENOSYS;
+        ret = -1;
+        break;
+    }
+    _lock_release(&fat_ctx->lock);
+    return ret;
+}
+#endif // CONFIG_FATFS_VFS_STREAM_MODE
+
 #ifdef CONFIG_VFS_SUPPORT_DIR
 
 static inline mode_t get_stat_mode(bool is_dir)
@@ -659,6 +971,26 @@ static inline mode_t get_stat_mode(bool is_dir)
             ((is_dir) ? S_IFDIR : S_IFREG);
 }
 
+/*
+ * Writes the buffered data of the open files, so that the path based functions see it like the data
+ * written to files without streaming buffer. A write error is reported by the next call on the file,
+ * the data which couldn't be written is kept in its buffer.
+ */
+static void flush_streams(vfs_fat_ctx_t* ctx)
+{
+#if CONFIG_FATFS_VFS_STREAM_MODE
+    for (size_t i = 0; i < ctx->max_files; ++i) {
+        vfs_fat_stream_t* stream = file_stream(ctx, i);
+        if (stream && stream->dirty) {
+            FRESULT res = vfs_fat_stream_flush(stream, &ctx->files[i]);
+            if (res != FR_OK) {
+                ESP_LOGD(TAG, "%s: fd=%d, fresult=%d", __func__, (int) i, res);
+            }
+        }
+    }
+#endif
+}
+
 static int vfs_fat_stat(void* ctx, const char * path, struct stat * st)
 {
     if (strcmp(path, "/") == 0) {
@@ -672,6 +1004,7 @@ static int vfs_fat_stat(void* ctx, const char * path, struct stat * st)
 
     vfs_fat_ctx_t* fat_ctx = (vfs_fat_ctx_t*) ctx;
     _lock_acquire(&fat_ctx->lock);
+    flush_streams(fat_ctx);
     prepend_drive_to_path(fat_ctx, &path, NULL);
     FILINFO info;
     FRESULT res = f_stat(path, &info);
@@ -726,6 +1059,7 @@ static int vfs_fat_link(void* ctx, const char* n1, const char* n2)
 {
     vfs_fat_ctx_t* fat_ctx = (vfs_fat_ctx_t*) ctx;
     _lock_acquire(&fat_ctx->lock);
+    flush_streams(fat_ctx);
     prepend_drive_to_path(fat_ctx, &n1, &n2);
 
     FRESULT res = FR_OK;
@@ -812,6 +1146,7 @@ static int vfs_fat_rename(void* ctx, const char *src, const char *dst)
 {
     vfs_fat_ctx_t* fat_ctx = (vfs_fat_ctx_t*) ctx;
     _lock_acquire(&fat_ctx->lock);
+    flush_streams(fat_ctx);
     prepend_drive_to_path(fat_ctx, &src, &dst);
     FRESULT res = f_rename(src, dst);
     _lock_release(&fat_ctx->lock);
@@ -1055,6 +1390,7 @@ static int vfs_fat_truncate(void* ctx, const char *path, off_t length)
     }
 
     _lock_acquire(&fat_ctx->lock);
+    flush_streams(fat_ctx);
     prepend_drive_to_path(fat_ctx, &path, NULL);
 
     file = (FIL*) ff_memalloc(sizeof(FIL));
@@ -1186,6 +1522,11 @@ static int vfs_fat_ftruncate(void* ctx, int fd, off_t length)
         goto out;
     }
 
+    res = file_flush(fat_ctx, fd);
+    if (res != FR_OK) {
+        goto fail;
+    }
+
     FSIZE_t seek_ptr_pos = (FSIZE_t) f_tell(file); // current seek pointer position
     FSIZE_t sz = (FSIZE_t) f_size(file); // current file size (end of file position)
 
@@ -1242,6 +1583,7 @@ static int vfs_fat_ftruncate(void* ctx, int fd, off_t length)
 #endif
 
 out:
+    file_update_pos(fat_ctx, fd);
     _lock_release(&fat_ctx->lock);
     return ret;
 
@@ -0,0 +1,222 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <sys/param.h>
+#include "vfs_fat_stream.h"
+
+static size_t get_cluster_size(FIL *file)
+{
+    FATFS *fs = file->obj.fs;
+    size_t sector_size = FF_MIN_SS;
+#if FF_MAX_SS != FF_MIN_SS
+    sector_size = fs->ssize;
+#endif
+    return fs->csize * sector_size;
+}
+
+/* Number of bytes from pos to the next buffer boundary */
+static inline size_t get_space(const vfs_fat_stream_t *stream, FSIZE_t pos)
+{
+    return stream->size - (size_t)(pos % stream->size);
+}
+
+static FRESULT write_back(vfs_fat_stream_t *stream, FIL *file)
+{
+    FRESULT res = FR_OK;
+    if (f_tell(file) != stream->buf_pos) {
+        res = f_lseek(file, stream->buf_pos);
+    }
+    UINT written = 0;
+    if (res == FR_OK) {
+        res = f_write(file, stream->buf, stream->buf_len, &written);
+    }
+    if (res == FR_OK && written < stream->buf_len) {
+        // The volume is full
+        res = FR_DENIED;
+    }
+    // Only the written data is dropped, the rest is kept so that the write can be retried
+    stream->buf_pos += written;
+    stream->buf_len -= written;
+    if (stream->buf_len > 0) {
+        memmove(stream->buf, stream->buf + written, stream->buf_len);
+    } else {
+        stream->dirty = false;
+    }
+    if (res == FR_OK && stream->sync_on_flush) {
+        res = f_sync(file);
+    }
+    return res;
+}
+
+FRESULT vfs_fat_stream_init(vfs_fat_stream_t *stream, FIL *file, size_t clusters)
+{
+    if (clusters == 0 || file->obj.fs == NULL) {
+        return FR_INVALID_PARAMETER;
+    }
+    const size_t size = clusters * get_cluster_size(file);
+    uint8_t *buf = ff_memalloc(size);
+    if (buf == NULL) {
+        return FR_NOT_ENOUGH_CORE;
+    }
+    memset(stream, 0, sizeof(*stream));
+    stream->buf = buf;
+    stream->size = size;
+    stream->clusters = clusters;
+    stream->pos = f_tell(file);
+    return FR_OK;
+}
+
+FRESULT vfs_fat_stream_deinit(vfs_fat_stream_t *stream, FIL *file)
+{
+    FRESULT res = vfs_fat_stream_flush(stream, file);
+    ff_memfree(stream->buf);
+    memset(stream, 0, sizeof(*stream));
+    return res;
+}
+
+FRESULT vfs_fat_stream_flush(vfs_fat_stream_t *stream, FIL *file)
+{
+    if (stream->dirty) {
+        return write_back(stream, file);
+    }
+    stream->buf_len = 0;
+    if (f_tell(file) != stream->pos) {
+        return f_lseek(file, stream->pos);
+    }
+    return FR_OK;
+}
+
+FRESULT vfs_fat_stream_read(vfs_fat_stream_t *stream, FIL *file, void *dst, UINT size, UINT *read)
+{
+    FRESULT res = FR_OK;
+    *read = 0;
+    if (stream->dirty) {
+        res = write_back(stream, file);
+        if (res != FR_OK) {
+            return res;
+        }
+    }
+    while (size > 0) {
+        if (stream->pos >= stream->buf_pos && stream->pos < stream->buf_pos + stream->buf_len) {
+            const size_t offset = stream->pos - stream->buf_pos;
+            const UINT len = MIN(size, stream->buf_len - offset);
+            memcpy((uint8_t *)dst + *read, stream->buf + offset, len);
+            stream->pos += len;
+            *read += len;
+            size -= len;
+            continue;
+        }
+        stream->buf_len = 0;
+        if (f_tell(file) != stream->pos) {
+            res = f_lseek(file, stream->pos);
+            if (res != FR_OK) {
+                break;
+            }
+        }
+        UINT len = 0;
+        if (size >= stream->size || stream->seeked) {
+            // Large reads don't need the buffer, FatFs reads the whole sectors directly to dst.
+            // Random reads don't either, the read-ahead starts if the next read follows this one.
+            stream->seeked = false;
+            res = f_read(file, (uint8_t *)dst + *read, size, &len);
+            stream->pos += len;
+            *read += len;
+            break;
+        }
+        // Read ahead up to the next buffer boundary
+        res = f_read(file, stream->buf, get_space(stream, stream->pos), &len);
+        stream->buf_pos = stream->pos;
+        stream->buf_len = len;
+        if (res != FR_OK || len == 0) {
+            // Error or end of file
+            break;
+        }
+    }
+    return res;
+}
+
+FRESULT vfs_fat_stream_write(vfs_fat_stream_t *stream, FIL *file, const void *src, UINT size, UINT *written)
+{
+    FRESULT res = FR_OK;
+    *written = 0;
+    if (!(file->flag & FA_WRITE)) {
+        // Fail now rather than when the buffer is flushed
+        return FR_DENIED;
+    }
+    if (!stream->dirty) {
+        // Drop the read-ahead data
+        res = vfs_fat_stream_flush(stream, file);
+        if (res != FR_OK) {
+            return res;
+        }
+    }
+    while (size > 0) {
+        if (stream->buf_len == 0) {
+            stream->buf_pos = stream->pos;
+        }
+        const size_t space = get_space(stream, stream->buf_pos) - stream->buf_len;
+        if (stream->buf_len == 0 && size >= space) {
+            // Write the data up to the last buffer boundary directly, FatFs writes the whole sectors from src
+            const UINT len = space + (size - space) / stream->size * stream->size;
+            UINT len_written = 0;
+            if (f_tell(file) != stream->pos) {
+                res = f_lseek(file, stream->pos);
+            }
+            if (res == FR_OK) {
+                res = f_write(file, (const uint8_t *)src + *written, len, &len_written);
+            }
+            if (res == FR_OK && stream->sync_on_flush) {
+                res = f_sync(file);
+            }
+            stream->pos += len_written;
+            *written += len_written;
+            size -= len_written;
+            if (res != FR_OK || len_written < len) {
+                break;
+            }
+            continue;
+        }
+        const UINT len = MIN(size, space);
+        memcpy(stream->buf + stream->buf_len, (const uint8_t *)src + *written, len);
+        stream->buf_len += len;
+        stream->dirty = true;
+        stream->pos += len;
+        *written += len;
+        size -= len;
+        if (len == space) {
+            res = write_back(stream, file);
+            if (res != FR_OK) {
+                break;
+            }
+        }
+    }
+    return res;
+}
+
+FRESULT vfs_fat_stream_seek(vfs_fat_stream_t *stream, FIL *file, FSIZE_t pos)
+{
+    if (pos == stream->pos) {
+        // e.g. appending to the written data
+        return FR_OK;
+    }
+    if (!stream->dirty && pos >= stream->buf_pos && pos < stream->buf_pos + stream->buf_len) {
+        stream->pos = pos;
+        return FR_OK;
+    }
+    if (stream->dirty) {
+        FRESULT res = write_back(stream, file);
+        if (res != FR_OK) {
+            // The stream isn't moved, the data which is still in the buffer follows it
+            return res;
+        }
+    }
+    stream->buf_len = 0;
+    stream->seeked = true;
+    FRESULT res = f_lseek(file, pos);
+    stream->pos = f_tell(file);
+    return res;
+}
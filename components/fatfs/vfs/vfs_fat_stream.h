@@ -0,0 +1,103 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "ff.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Streaming buffer of an open file
+ *
+ * Small sequential reads are served from a read-ahead buffer of whole clusters, which is filled
+ * by a single f_read, so FatFs transfers whole sectors directly instead of going through the
+ * sector window of the file. Small sequential writes are collected in the same buffer and given
+ * to f_write when the buffer is full, so FatFs writes them with multi-sector disk_write calls.
+ * The buffer ends at a cluster boundary, so all the transfers but the first one are cluster-aligned.
+ * The first read after a seek out of the buffer doesn't read ahead, so random reads don't transfer
+ * more data than without the buffer.
+ *
+ * The buffer holds either read-ahead data or written data. The file pointer of the FIL object
+ * is not the stream position while the buffer is not empty, vfs_fat_stream_flush() makes them
+ * equal again.
+ */
+typedef struct {
+    uint8_t *buf;           /*!< Read-ahead data, or written data not given to f_write yet */
+    size_t size;            /*!< Size of buf, a multiple of the cluster size */
+    size_t clusters;        /*!< Size of buf in clusters */
+    FSIZE_t buf_pos;        /*!< File offset of buf[0] */
+    size_t buf_len;         /*!< Number of valid bytes in buf */
+    bool dirty;             /*!< buf holds written data */
+    bool sync_on_flush;     /*!< Call f_sync after the written data is given to f_write */
+    bool seeked;            /*!< The stream was moved out of buf, the next read doesn't read ahead */
+    FSIZE_t pos;            /*!< Stream position, file offset of the next read or write */
+} vfs_fat_stream_t;
+
+/**
+ * @brief Allocate the buffer and start streaming at the current file pointer
+ *
+ * @param stream   stream to initialize
+ * @param file     open file
+ * @param clusters size of the buffer in clusters, at least 1
+ *
+ * @return FR_OK, FR_INVALID_PARAMETER or FR_NOT_ENOUGH_CORE
+ */
+FRESULT vfs_fat_stream_init(vfs_fat_stream_t *stream, FIL *file, size_t clusters);
+
+/**
+ * @brief Flush the stream and free the buffer, the file pointer is the stream position afterwards
+ *
+ * The buffer is freed even if the flush fails, the written data which is still in it is lost then.
+ */
+FRESULT vfs_fat_stream_deinit(vfs_fat_stream_t *stream, FIL *file);
+
+/**
+ * @brief Give the written data to f_write and drop the read-ahead data
+ *
+ * The file pointer is the stream position afterwards. If f_write fails, the data which wasn't written
+ * is kept in the buffer and written again by the next flush, read, seek or write filling the buffer.
+ */
+FRESULT vfs_fat_stream_flush(vfs_fat_stream_t *stream, FIL *file);
+
+/**
+ * @brief Read from the stream position, same arguments as f_read
+ */
+FRESULT vfs_fat_stream_read(vfs_fat_stream_t *stream, FIL *file, void *dst, UINT size, UINT *read);
+
+/**
+ * @brief Write at the stream position, same arguments as f_write
+ *
+ * The data can be kept in the buffer until a later call, whose result then reports the f_write error.
+ * *written counts the data which was put in the buffer, even if writing the buffer then failed.
+ */
+FRESULT vfs_fat_stream_write(vfs_fat_stream_t *stream, FIL *file, const void *src, UINT size, UINT *written);
+
+/**
+ * @brief Move the stream position, same arguments as f_lseek
+ *
+ * The read-ahead data is kept if the new position is inside it. The stream isn't moved if the written
+ * data can't be written.
+ */
+FRESULT vfs_fat_stream_seek(vfs_fat_stream_t *stream, FIL *file, FSIZE_t pos);
+
+/**
+ * @brief Size of the file including the written data which is still in the buffer
+ */
+static inline FSIZE_t vfs_fat_stream_size(const vfs_fat_stream_t *stream, FIL *file)
+{
+    const FSIZE_t end = stream->buf_pos + stream->buf_len;
+    return (stream->dirty && end > f_size(file)) ? end : f_size(file);
+}
+
+#ifdef __cplusplus
+}
+#endif
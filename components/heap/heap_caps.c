@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -30,6 +30,7 @@
 static void *heap_caps_realloc_base( void *ptr, size_t size, uint32_t caps );
 static void *heap_caps_calloc_base( size_t n, size_t size, uint32_t caps );
 static void *heap_caps_malloc_base( size_t size, uint32_t caps );
+static void *heap_caps_malloc_from_heaps(size_t size, uint32_t caps);
 
 /*
 This file, combined with a region allocator that supports multiple heaps, solves the problem that the ESP32 has RAM
@@ -113,6 +114,296 @@ bool heap_caps_match(const heap_t *heap, uint32_t caps)
     return heap->heap != NULL && ((get_all_caps(heap) & caps) == caps);
 }
 
+/* Iterates over the registered heaps able to satisfy some capabilities, in the order they are tried */
+typedef struct {
+    const heap_caps_lookup_t *lookup;
+    heap_t *const *heaps;   // candidate set of the capabilities, NULL to walk lookup->prio_entries
+    size_t count;
+    size_t index;
+    uint32_t caps;
+} heap_caps_candidate_iter_t;
+
+HEAP_IRAM_ATTR static inline void candidate_iter_init(heap_caps_candidate_iter_t *iter, uint32_t caps)
+{
+    heap_caps_lookup_t *lookup = heap_caps_lookup_acquire();
+    iter->lookup = lookup;
+    iter->heaps = NULL;
+    iter->count = 0;
+    iter->index = 0;
+    iter->caps = caps;
+    if (lookup != NULL) {
+        iter->heaps = heap_caps_lookup_get_candidates(lookup, caps, &iter->count);
+        if (iter->heaps == NULL) {
+            iter->count = lookup->prio_entry_count;
+        }
+    }
+}
+
+HEAP_IRAM_ATTR static inline heap_t *candidate_iter_next(heap_caps_candidate_iter_t *iter)
+{
+    while (iter->index < iter->count) {
+        heap_t *heap;
+        if (iter->heaps != NULL) {
+            heap = iter->heaps[iter->index++];
+        } else {
+            //Heap has at least one of the caps requested at this priority, and all of them across priorities
+            const heap_caps_prio_entry_t *entry = &iter->lookup->prio_entries[iter->index++];
+            if ((entry->caps & iter->caps) == 0 || (entry->all_caps & iter->caps) != iter->caps) {
+                continue;
+            }
+            heap = entry->heap;
+        }
+        if (heap->heap != NULL) {
+            return heap;
+        }
+    }
+    return NULL;
+}
+
+/* Must be called once done with the heaps returned by candidate_iter_next() */
+HEAP_IRAM_ATTR static inline void candidate_iter_end(heap_caps_candidate_iter_t *iter)
+{
+    heap_caps_lookup_release();
+}
+
+/* Called by heap_caps_lookup_release() when the last reader releases its table */
+HEAP_IRAM_ATTR void heap_caps_lookup_free_retired(void)
+{
+    heap_caps_lookup_t *retired = __atomic_exchange_n(&registered_heaps_lookup_retired, NULL, __ATOMIC_SEQ_CST);
+    if (retired == NULL) {
+        return;
+    }
+    // The retired tables were replaced before being taken here, so only readers counted earlier can hold them
+    if (__atomic_load_n(&registered_heaps_lookup_readers, __ATOMIC_SEQ_CST) != 0) {
+        // Put them back, they are freed when the current readers release their table
+        heap_caps_lookup_t *last = retired;
+        while (last->retired_next != NULL) {
+            last = last->retired_next;
+        }
+        last->retired_next = __atomic_load_n(&registered_heaps_lookup_retired, __ATOMIC_SEQ_CST);
+        while (!__atomic_compare_exchange_n(&registered_heaps_lookup_retired, &last->retired_next, retired,
+                                            false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+        }
+        return;
+    }
+    while (retired != NULL) {
+        heap_caps_lookup_t *next = retired->retired_next;
+        heap_caps_free(retired);
+        retired = next;
+    }
+}
+
+#if CONFIG_HEAP_SMALL_OBJECT_CACHE
+/*
+Small allocations which any internal RAM can satisfy are served from a cache of free blocks of the current core,
+so that tasks running on different cores don't contend on the lock of the heap they allocate from. Each core has a
+cache per size class. An empty cache is refilled with a batch of blocks allocated from the heaps, and a full cache
+frees a batch of blocks back to their heaps.
+
+Cached blocks are allocated blocks as far as multi_heap is concerned. heap_caps_get_info() and
+heap_caps_get_free_size() count them as free memory.
+*/
+
+// Capabilities of the memory in the caches, only allocations requesting a subset of them use the caches
+#define CACHE_CAPS (MALLOC_CAP_DEFAULT | MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT | MALLOC_CAP_32BIT)
+#define CACHE_CLASS_COUNT 3
+#define CACHE_DEPTH CONFIG_HEAP_SMALL_OBJECT_CACHE_DEPTH
+#define CACHE_BATCH (CACHE_DEPTH / 2)
+
+// Block sizes of the classes, as given to multi_heap_malloc()
+static const size_t cache_class_size[CACHE_CLASS_COUNT] = { 16, 32, 64 };
+
+typedef struct {
+    void *block;    // Block as returned by multi_heap_malloc()
+    heap_t *heap;
+} cached_block_t;
+
+typedef struct {
+    multi_heap_lock_t lock;
+    size_t count[CACHE_CLASS_COUNT];
+    cached_block_t blocks[CACHE_CLASS_COUNT][CACHE_DEPTH];  // Most recently freed last
+} core_cache_t;
+
+static core_cache_t core_caches[portNUM_PROCESSORS] = {
+    [0 ... portNUM_PROCESSORS - 1] = { .lock = MULTI_HEAP_LOCK_STATIC_INITIALIZER }
+};
+
+HEAP_IRAM_ATTR static inline core_cache_t *cache_of_current_core(void)
+{
+    // The task may be moved to the other core once this returns, in which case it uses the
+    // cache of the other core. This is fine, the lock of the cache is taken anyway.
+    return &core_caches[xPortGetCoreID()];
+}
+
+/* Allocate a block of at least 'size' bytes from the cache of the current core. Returns NULL if the
+   allocation doesn't use the caches, or if no memory is left for them. */
+HEAP_IRAM_ATTR static void *cache_malloc(size_t size, uint32_t caps)
+{
+    if ((caps & ~CACHE_CAPS) != 0 || size > cache_class_size[CACHE_CLASS_COUNT - 1]) {
+        return NULL;
+    }
+    int class = 0;
+    while (cache_class_size[class] < size) {
+        class++;
+    }
+
+    core_cache_t *cache = cache_of_current_core();
+    void *block = NULL;
+    MULTI_HEAP_LOCK(&cache->lock);
+    if (cache->count[class] > 0) {
+        block = cache->blocks[class][--cache->count[class]].block;
+    }
+    MULTI_HEAP_UNLOCK(&cache->lock);
+    if (block != NULL) {
+        return block;
+    }
+
+    // Refill with a batch of blocks, the first one is returned
+    cached_block_t batch[CACHE_BATCH];
+    size_t count = 0;
+    heap_caps_candidate_iter_t iter;
+    candidate_iter_init(&iter, CACHE_CAPS);
+    heap_t *heap;
+    while (count < CACHE_BATCH && (heap = candidate_iter_next(&iter)) != NULL) {
+        while (count < CACHE_BATCH) {
+            block = multi_heap_malloc(heap->heap, cache_class_size[class]);
+            if (block == NULL) {
+                break;
+            }
+            batch[count].block = block;
+            batch[count].heap = heap;
+            count++;
+        }
+    }
+    candidate_iter_end(&iter);
+    if (count == 0) {
+        return NULL;
+    }
+
+    size_t cached = 1;
+    MULTI_HEAP_LOCK(&cache->lock);
+    while (cached < count && cache->count[class] < CACHE_DEPTH) {
+        cache->blocks[class][cache->count[class]++] = batch[cached++];
+    }
+    MULTI_HEAP_UNLOCK(&cache->lock);
+    // The cache was refilled meanwhile by another task
+    for (size_t i = cached; i < count; i++) {
+        multi_heap_free(batch[i].heap->heap, batch[i].block);
+    }
+    return batch[0].block;
+}
+
+/* Put a block being freed in the cache of the current core. Returns false if it must be freed to its heap. */
+HEAP_IRAM_ATTR static bool cache_free(heap_t *heap, void *block)
+{
+    if ((get_all_caps(heap) & CACHE_CAPS) != CACHE_CAPS) {
+        return false;
+    }
+    size_t size = multi_heap_get_allocated_size(heap->heap, block);
+    if (size < cache_class_size[0] || size > cache_class_size[CACHE_CLASS_COUNT - 1]) {
+        return false;
+    }
+    int class = CACHE_CLASS_COUNT - 1;
+    while (cache_class_size[class] > size) {
+        class--;
+    }
+
+    core_cache_t *cache = cache_of_current_core();
+    cached_block_t batch[CACHE_BATCH];
+    size_t count = 0;
+    MULTI_HEAP_LOCK(&cache->lock);
+    if (cache->count[class] == CACHE_DEPTH) {
+        // Free the least recently freed blocks, the others are more likely to be in the data cache
+        cached_block_t *blocks = cache->blocks[class];
+        count = CACHE_BATCH;
+        memcpy(batch, blocks, sizeof(batch));
+        memmove(blocks, blocks + CACHE_BATCH, (CACHE_DEPTH - CACHE_BATCH) * sizeof(cached_block_t));
+        cache->count[class] -= CACHE_BATCH;
+    }
+    cache->blocks[class][cache->count[class]++] = (cached_block_t) { .block = block, .heap = heap };
+    MULTI_HEAP_UNLOCK(&cache->lock);
+
+    for (size_t i = 0; i < count; i++) {
+        multi_heap_free(batch[i].heap->heap, batch[i].block);
+    }
+    return true;
+}
+
+/* Free the blocks of the caches of all cores to their heaps. Returns false if the caches were empty. */
+static HEAP_IRAM_ATTR bool cache_flush(void)
+{
+    bool flushed = false;
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        core_cache_t *cache = &core_caches[core];
+        for (int class = 0; class < CACHE_CLASS_COUNT; class++) {
+            cached_block_t batch[CACHE_DEPTH];
+            MULTI_HEAP_LOCK(&cache->lock);
+            size_t count = cache->count[class];
+            memcpy(batch, cache->blocks[class], count * sizeof(cached_block_t));
+            cache->count[class] = 0;
+            MULTI_HEAP_UNLOCK(&cache->lock);
+
+            for (size_t i = 0; i < count; i++) {
+                multi_heap_free(batch[i].heap->heap, batch[i].block);
+            }
+            flushed = flushed || count > 0;
+        }
+    }
+    return flushed;
+}
+
+/* Size of the blocks of a heap held by the caches */
+static size_t cache_get_cached_size(const heap_t *heap, size_t *blocks)
+{
+    size_t size = 0;
+    *blocks = 0;
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        core_cache_t *cache = &core_caches[core];
+        MULTI_HEAP_LOCK(&cache->lock);
+        for (int class = 0; class < CACHE_CLASS_COUNT; class++) {
+            for (size_t i = 0; i < cache->count[class]; i++) {
+                const cached_block_t *cached = &cache->blocks[class][i];
+                if (cached->heap == heap) {
+                    size += multi_heap_get_allocated_size(heap->heap, cached->block);
+                    (*blocks)++;
+                }
+            }
+        }
+        MULTI_HEAP_UNLOCK(&cache->lock);
+    }
+    return size;
+}
+
+#else // CONFIG_HEAP_SMALL_OBJECT_CACHE
+
+HEAP_IRAM_ATTR static inline void *cache_malloc(size_t size, uint32_t caps)
+{
+    return NULL;
+}
+
+HEAP_IRAM_ATTR static inline bool cache_free(heap_t *heap, void *block)
+{
+    return false;
+}
+
+static inline bool cache_flush(void)
+{
+    return false;
+}
+
+static inline size_t cache_get_cached_size(const heap_t *heap, size_t *blocks)
+{
+    *blocks = 0;
+    return 0;
+}
+
+#endif // CONFIG_HEAP_SMALL_OBJECT_CACHE
+
+void heap_caps_flush_cache(void)
+{
+    cache_flush();
+}
+
 
 /*
 This function should not be called directly as it does not
@@ -148,46 +439,60 @@ HEAP_IRAM_ATTR static void *heap_caps_malloc_base( size_t size, uint32_t caps)
         size = (size + 3) & (~3); // int overflow checked above
     }
 
-    for (int prio = 0; prio < SOC_MEMORY_TYPE_NO_PRIOS; prio++) {
-        //Iterate over heaps and check capabilities at this priority
-        heap_t *heap;
-        SLIST_FOREACH(heap, &registered_heaps, next) {
-            if (heap->heap == NULL) {
-                continue;
+    ret = cache_malloc(MULTI_HEAP_ADD_BLOCK_OWNER_SIZE(size), caps);
+    if (ret != NULL) {
+        MULTI_HEAP_SET_BLOCK_OWNER(ret);
+        ret = MULTI_HEAP_ADD_BLOCK_OWNER_OFFSET(ret);
+        CALL_HOOK(esp_heap_trace_alloc_hook, ret, size, caps);
+        return ret;
+    }
+
+    ret = heap_caps_malloc_from_heaps(size, caps);
+    if (ret == NULL && cache_flush()) {
+        //The memory needed may be held by the caches
+        ret = heap_caps_malloc_from_heaps(size, caps);
+    }
+    return ret;
+}
+
+HEAP_IRAM_ATTR static void *heap_caps_malloc_from_heaps(size_t size, uint32_t caps)
+{
+    void *ret = NULL;
+
+    //Iterate over the heaps which can satisfy all the requested capabilities, by priority
+    heap_caps_candidate_iter_t iter;
+    candidate_iter_init(&iter, caps);
+    heap_t *heap;
+    while ((heap = candidate_iter_next(&iter)) != NULL) {
+        //See if we can grab some memory using this heap.
+        // If MALLOC_CAP_EXEC is requested but the DRAM and IRAM are on the same addresses (like on esp32c6)
+        // proceed as for a default allocation.
+        if ((caps & MALLOC_CAP_EXEC) && !esp_dram_match_iram() && esp_ptr_in_diram_dram((void *)heap->start)) {
+            //This is special, insofar that what we're going to get back is a DRAM address. If so,
+            //we need to 'invert' it (lowest address in DRAM == highest address in IRAM and vice-versa) and
+            //add a pointer to the DRAM equivalent before the address we're going to return.
+            ret = multi_heap_malloc(heap->heap, MULTI_HEAP_ADD_BLOCK_OWNER_SIZE(size) + 4);  // int overflow checked above
+            if (ret != NULL) {
+                MULTI_HEAP_SET_BLOCK_OWNER(ret);
+                ret = MULTI_HEAP_ADD_BLOCK_OWNER_OFFSET(ret);
+                uint32_t *iptr = dram_alloc_to_iram_addr(ret, size + 4);  // int overflow checked above
+                CALL_HOOK(esp_heap_trace_alloc_hook, iptr, size, caps);
+                candidate_iter_end(&iter);
+                return iptr;
             }
-            if ((heap->caps[prio] & caps) != 0) {
-                //Heap has at least one of the caps requested. If caps has other bits set that this prio
-                //doesn't cover, see if they're available in other prios.
-                if ((get_all_caps(heap) & caps) == caps) {
-                    //This heap can satisfy all the requested capabilities. See if we can grab some memory using it.
-                    // If MALLOC_CAP_EXEC is requested but the DRAM and IRAM are on the same addresses (like on esp32c6)
-                    // proceed as for a default allocation.
-                    if ((caps & MALLOC_CAP_EXEC) && !esp_dram_match_iram() && esp_ptr_in_diram_dram((void *)heap->start)) {
-                        //This is special, insofar that what we're going to get back is a DRAM address. If so,
-                        //we need to 'invert' it (lowest address in DRAM == highest address in IRAM and vice-versa) and
-                        //add a pointer to the DRAM equivalent before the address we're going to return.
-                        ret = multi_heap_malloc(heap->heap, MULTI_HEAP_ADD_BLOCK_OWNER_SIZE(size) + 4);  // int overflow checked above
-                        if (ret != NULL) {
-                            MULTI_HEAP_SET_BLOCK_OWNER(ret);
-                            ret = MULTI_HEAP_ADD_BLOCK_OWNER_OFFSET(ret);
-                            uint32_t *iptr = dram_alloc_to_iram_addr(ret, size + 4);  // int overflow checked above
-                            CALL_HOOK(esp_heap_trace_alloc_hook, iptr, size, caps);
-                            return iptr;
-                        }
-                    } else {
-                        //Just try to alloc, nothing special.
-                        ret = multi_heap_malloc(heap->heap, MULTI_HEAP_ADD_BLOCK_OWNER_SIZE(size));
-                        if (ret != NULL) {
-                            MULTI_HEAP_SET_BLOCK_OWNER(ret);
-                            ret = MULTI_HEAP_ADD_BLOCK_OWNER_OFFSET(ret);
-                            CALL_HOOK(esp_heap_trace_alloc_hook, ret, size, caps);
-                            return ret;
-                        }
-                    }
-                }
+        } else {
+            //Just try to alloc, nothing special.
+            ret = multi_heap_malloc(heap->heap, MULTI_HEAP_ADD_BLOCK_OWNER_SIZE(size));
+            if (ret != NULL) {
+                MULTI_HEAP_SET_BLOCK_OWNER(ret);
+                ret = MULTI_HEAP_ADD_BLOCK_OWNER_OFFSET(ret);
+                CALL_HOOK(esp_heap_trace_alloc_hook, ret, size, caps);
+                candidate_iter_end(&iter);
+                return ret;
             }
         }
     }
+    candidate_iter_end(&iter);
 
     //Nothing usable found.
     return NULL;
@@ -364,14 +669,9 @@ HEAP_IRAM_ATTR void *heap_caps_calloc_prefer( size_t n, size_t size, size_t num,
 */
 HEAP_IRAM_ATTR static heap_t *find_containing_heap(void *ptr )
 {
-    intptr_t p = (intptr_t)ptr;
-    heap_t *heap;
-    SLIST_FOREACH(heap, &registered_heaps, next) {
-        if (heap->heap != NULL && p >= heap->start && p < heap->end) {
-            return heap;
-        }
-    }
-    return NULL;
+    heap_t *heap = heap_caps_lookup_find_containing(heap_caps_lookup_acquire(), (intptr_t)ptr);
+    heap_caps_lookup_release();
+    return heap;
 }
 
 HEAP_IRAM_ATTR void heap_caps_free( void *ptr)
@@ -390,7 +690,9 @@ HEAP_IRAM_ATTR void heap_caps_free( void *ptr)
     void *block_owner_ptr = MULTI_HEAP_REMOVE_BLOCK_OWNER_OFFSET(ptr);
     heap_t *heap = find_containing_heap(block_owner_ptr);
     assert(heap != NULL && "free() target pointer is outside heap areas");
-    multi_heap_free(heap->heap, block_owner_ptr);
+    if (!cache_free(heap, block_owner_ptr)) {
+        multi_heap_free(heap->heap, block_owner_ptr);
+    }
 
     CALL_HOOK(esp_heap_trace_free_hook, ptr);
 }
@@ -549,7 +851,8 @@ size_t heap_caps_get_free_size( uint32_t caps )
     heap_t *heap;
     SLIST_FOREACH(heap, &registered_heaps, next) {
         if (heap_caps_match(heap, caps)) {
-            ret += multi_heap_free_size(heap->heap);
+            size_t cached_blocks;
+            ret += multi_heap_free_size(heap->heap) + cache_get_cached_size(heap, &cached_blocks);
         }
     }
     return ret;
@@ -633,6 +936,17 @@ esp_err_t heap_caps_monitor_local_minimum_free_size_stop(void)
 }
 
 
+/* Information of a heap, where the blocks held by the caches are free */
+static void get_heap_info(heap_t *heap, multi_heap_info_t *info)
+{
+    multi_heap_get_info(heap->heap, info);
+    size_t cached_blocks;
+    size_t cached_bytes = cache_get_cached_size(heap, &cached_blocks);
+    info->total_free_bytes += cached_bytes;
+    info->total_allocated_bytes -= cached_bytes;
+    info->allocated_blocks -= cached_blocks;
+}
+
 void heap_caps_get_info( multi_heap_info_t *info, uint32_t caps )
 {
     memset(info, 0, sizeof(multi_heap_info_t));
@@ -641,7 +955,7 @@ void heap_caps_get_info( multi_heap_info_t *info, uint32_t caps )
     SLIST_FOREACH(heap, &registered_heaps, next) {
         if (heap_caps_match(heap, caps)) {
             multi_heap_info_t hinfo;
-            multi_heap_get_info(heap->heap, &hinfo);
+            get_heap_info(heap, &hinfo);
 
             info->total_free_bytes += hinfo.total_free_bytes - MULTI_HEAP_BLOCK_OWNER_SIZE();
             info->total_allocated_bytes += (hinfo.total_allocated_bytes -
@@ -657,6 +971,33 @@ void heap_caps_get_info( multi_heap_info_t *info, uint32_t caps )
     }
 }
 
+void heap_caps_get_fragmentation_info( multi_heap_frag_info_t *info, uint32_t caps )
+{
+    memset(info, 0, sizeof(multi_heap_frag_info_t));
+
+    heap_t *heap;
+    SLIST_FOREACH(heap, &registered_heaps, next) {
+        if (heap_caps_match(heap, caps)) {
+            multi_heap_frag_info_t hinfo;
+            size_t cached_blocks;
+            multi_heap_get_fragmentation_info(heap->heap, &hinfo);
+
+            info->total_free_bytes += hinfo.total_free_bytes - MULTI_HEAP_BLOCK_OWNER_SIZE();
+            info->total_free_bytes += cache_get_cached_size(heap, &cached_blocks);
+            info->largest_free_block = MAX(info->largest_free_block, hinfo.largest_free_block);
+            info->free_blocks += hinfo.free_blocks;
+            for (int i = 0; i < MULTI_HEAP_HISTOGRAM_SIZE; i++) {
+                info->free_block_count[i] += hinfo.free_block_count[i];
+                info->free_block_bytes[i] += hinfo.free_block_bytes[i];
+                info->alloc_count[i] += hinfo.alloc_count[i];
+                info->alloc_failures[i] += hinfo.alloc_failures[i];
+            }
+        }
+    }
+    info->largest_free_block -= info->largest_free_block ? MULTI_HEAP_BLOCK_OWNER_SIZE() : 0;
+    info->fragmentation_index = multi_heap_fragmentation_index(info->largest_free_block, info->total_free_bytes);
+}
+
 void heap_caps_print_heap_info( uint32_t caps )
 {
     multi_heap_info_t info;
@@ -664,7 +1005,7 @@ void heap_caps_print_heap_info( uint32_t caps )
     heap_t *heap;
     SLIST_FOREACH(heap, &registered_heaps, next) {
         if (heap_caps_match(heap, caps)) {
-            multi_heap_get_info(heap->heap, &info);
+            get_heap_info(heap, &info);
 
             printf("  At 0x%08x len %d free %d allocated %d min_free %d\n",
                    heap->start, heap->end - heap->start, info.total_free_bytes, info.total_allocated_bytes, info.minimum_free_bytes);
@@ -739,30 +1080,23 @@ size_t heap_caps_get_allocated_size( void *ptr )
 
 static HEAP_IRAM_ATTR void *heap_caps_aligned_alloc_base(size_t alignment, size_t size, uint32_t caps)
 {
-    for (int prio = 0; prio < SOC_MEMORY_TYPE_NO_PRIOS; prio++) {
-        //Iterate over heaps and check capabilities at this priority
-        heap_t *heap;
-        SLIST_FOREACH(heap, &registered_heaps, next) {
-            if (heap->heap == NULL) {
-                continue;
-            }
-            if ((heap->caps[prio] & caps) != 0) {
-                //Heap has at least one of the caps requested. If caps has other bits set that this prio
-                //doesn't cover, see if they're available in other prios.
-                if ((get_all_caps(heap) & caps) == caps) {
-                    // Just try to alloc, nothing special. Provide the size of the block owner
-                    // as an offset to prevent a miscalculation of the alignment.
-                    void *ret = multi_heap_aligned_alloc_offs(heap->heap, MULTI_HEAP_ADD_BLOCK_OWNER_SIZE(size), alignment, MULTI_HEAP_BLOCK_OWNER_SIZE());
-                    if (ret != NULL) {
-                        MULTI_HEAP_SET_BLOCK_OWNER(ret);
-                        ret = MULTI_HEAP_ADD_BLOCK_OWNER_OFFSET(ret);
-                        CALL_HOOK(esp_heap_trace_alloc_hook, ret, size, caps);
-                        return ret;
-                    }
-                }
-            }
+    //Iterate over the heaps which can satisfy all the requested capabilities, by priority
+    heap_caps_candidate_iter_t iter;
+    candidate_iter_init(&iter, caps);
+    heap_t *heap;
+    while ((heap = candidate_iter_next(&iter)) != NULL) {
+        // Just try to alloc, nothing special. Provide the size of the block owner
+        // as an offset to prevent a miscalculation of the alignment.
+        void *ret = multi_heap_aligned_alloc_offs(heap->heap, MULTI_HEAP_ADD_BLOCK_OWNER_SIZE(size), alignment, MULTI_HEAP_BLOCK_OWNER_SIZE());
+        if (ret != NULL) {
+            MULTI_HEAP_SET_BLOCK_OWNER(ret);
+            ret = MULTI_HEAP_ADD_BLOCK_OWNER_OFFSET(ret);
+            CALL_HOOK(esp_heap_trace_alloc_hook, ret, size, caps);
+            candidate_iter_end(&iter);
+            return ret;
         }
     }
+    candidate_iter_end(&iter);
 
     //Nothing usable found.
     return NULL;
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -19,6 +19,17 @@ static const char *TAG = "heap_init";
 /* Linked-list of registered heaps */
 struct registered_heap_ll registered_heaps;
 
+/* Lookup table of registered heaps */
+heap_caps_lookup_t *registered_heaps_lookup;
+
+uint32_t registered_heaps_lookup_readers;
+
+heap_caps_lookup_t *registered_heaps_lookup_retired;
+
+/* Buffer of the current lookup table if it was allocated by heap_caps_add_region_with_caps(), NULL if it is
+   the table allocated with the heaps by heap_caps_init(), which is never freed */
+static void *s_lookup_buffer;
+
 static void register_heap(heap_t *region)
 {
     size_t heap_size = region->end - region->start;
@@ -124,8 +135,8 @@ void heap_caps_init(void)
     heap_t *heaps_array = NULL;
     for (size_t i = 0; i < num_heaps; i++) {
         if (heap_caps_match(&temp_heaps[i], MALLOC_CAP_8BIT|MALLOC_CAP_INTERNAL)) {
-            /* use the first DRAM heap which can fit the data */
-            heaps_array = multi_heap_malloc(temp_heaps[i].heap, sizeof(heap_t) * num_heaps);
+            /* use the first DRAM heap which can fit the data, followed by its lookup table */
+            heaps_array = multi_heap_malloc(temp_heaps[i].heap, sizeof(heap_t) * num_heaps + heap_caps_lookup_size(num_heaps));
             if (heaps_array != NULL) {
                 break;
             }
@@ -146,6 +157,9 @@ void heap_caps_init(void)
             SLIST_INSERT_AFTER(&heaps_array[i-1], &heaps_array[i], next);
         }
     }
+
+    heap_caps_lookup_t *lookup = heap_caps_lookup_build(&heaps_array[num_heaps], &registered_heaps, num_heaps);
+    __atomic_store_n(&registered_heaps_lookup, lookup, __ATOMIC_RELEASE);
 }
 
 esp_err_t heap_caps_add_region(intptr_t start, intptr_t end)
@@ -240,12 +254,54 @@ esp_err_t heap_caps_add_region_with_caps(const uint32_t caps[], intptr_t start,
 
     /* (This insertion is atomic to registered_heaps, so
        we don't need to worry about thread safety for readers,
-       only for writers. */
+       only for writers. The same goes for publishing the new
+       lookup table. The previous table is retired, and freed
+       once no reader holds it.
+
+       The new table is allocated before taking the lock, for the
+       number of heaps counted then. If another heap was added
+       meanwhile, it is allocated again. */
     static multi_heap_lock_t registered_heaps_write_lock = MULTI_HEAP_LOCK_STATIC_INITIALIZER;
-    MULTI_HEAP_LOCK(&registered_heaps_write_lock);
+    void *lookup_buffer = NULL;
+    size_t heap_count = 0;
+    while (true) {
+        size_t count = 1;
+        SLIST_FOREACH(heap, &registered_heaps, next) {
+            count++;
+        }
+        if (count != heap_count) {
+            heap_caps_free(lookup_buffer);
+            heap_count = count;
+            lookup_buffer = heap_caps_malloc(heap_caps_lookup_size(heap_count), MALLOC_CAP_INTERNAL|MALLOC_CAP_8BIT);
+            if (lookup_buffer == NULL) {
+                err = ESP_ERR_NO_MEM;
+                goto done;
+            }
+        }
+        MULTI_HEAP_LOCK(&registered_heaps_write_lock);
+        count = 1;
+        SLIST_FOREACH(heap, &registered_heaps, next) {
+            count++;
+        }
+        if (count == heap_count) {
+            break;
+        }
+        MULTI_HEAP_UNLOCK(&registered_heaps_write_lock);
+    }
     SLIST_INSERT_HEAD(&registered_heaps, p_new, next);
+    heap_caps_lookup_t *lookup = heap_caps_lookup_build(lookup_buffer, &registered_heaps, heap_count);
+    __atomic_store_n(&registered_heaps_lookup, lookup, __ATOMIC_SEQ_CST);
+    heap_caps_lookup_t *retired = s_lookup_buffer;
+    s_lookup_buffer = lookup_buffer;
     MULTI_HEAP_UNLOCK(&registered_heaps_write_lock);
 
+    if (retired != NULL) {
+        retired->retired_next = __atomic_load_n(&registered_heaps_lookup_retired, __ATOMIC_SEQ_CST);
+        while (!__atomic_compare_exchange_n(&registered_heaps_lookup_retired, &retired->retired_next, retired,
+                                            false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+        }
+        heap_caps_lookup_free_retired();
+    }
     err = ESP_OK;
 
  done:
@@ -166,6 +166,11 @@ void heap_caps_get_info( multi_heap_info_t *info, uint32_t caps )
     memset(info, 0, sizeof(multi_heap_info_t));
 }
 
+void heap_caps_get_fragmentation_info( multi_heap_frag_info_t *info, uint32_t caps )
+{
+    memset(info, 0, sizeof(multi_heap_frag_info_t));
+}
+
 void heap_caps_print_heap_info( uint32_t caps )
 {
     printf("No heap summary available when building for the linux target");
@@ -0,0 +1,163 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include "heap_private.h"
+
+/*
+This file builds the lookup tables used by heap_caps.c to find the heaps to allocate from, and the heap
+containing a pointer to free, without walking registered_heaps. The functions called on allocation and
+free are placed in IRAM by linker.lf, like the other functions they are called from.
+*/
+
+size_t heap_caps_lookup_size(size_t heap_count)
+{
+    return sizeof(heap_caps_lookup_t)
+           + heap_count * sizeof(heap_t *)
+           + heap_count * sizeof(int)
+           + heap_count * SOC_MEMORY_TYPE_NO_PRIOS * sizeof(heap_caps_prio_entry_t)
+           + HEAP_CAPS_LOOKUP_CANDIDATE_SETS * heap_count * sizeof(heap_t *);
+}
+
+static bool heap_address_before(const heap_t *a, const heap_t *b)
+{
+    // Nested regions come after the region containing them
+    return a->start < b->start || (a->start == b->start && a->end > b->end);
+}
+
+heap_caps_lookup_t *heap_caps_lookup_build(void *buffer, const struct registered_heap_ll *heaps, size_t heap_count)
+{
+    heap_caps_lookup_t *lookup = buffer;
+    memset(lookup, 0, sizeof(heap_caps_lookup_t));
+    lookup->by_address = (heap_t **)(lookup + 1);
+    lookup->prio_entries = (heap_caps_prio_entry_t *)(lookup->by_address + heap_count);
+    lookup->enclosing = (int *)(lookup->prio_entries + heap_count * SOC_MEMORY_TYPE_NO_PRIOS);
+    heap_t **candidate_heaps = (heap_t **)(lookup->enclosing + heap_count);
+    for (int i = 0; i < HEAP_CAPS_LOOKUP_CANDIDATE_SETS; i++) {
+        lookup->candidates[i].heaps = candidate_heaps + i * heap_count;
+    }
+    MULTI_HEAP_LOCK_INIT(&lookup->candidates_lock);
+
+    // Insertion sort, there are few heaps
+    heap_t *heap;
+    SLIST_FOREACH(heap, heaps, next) {
+        size_t i = lookup->heap_count++;
+        assert(i < heap_count);
+        while (i > 0 && heap_address_before(heap, lookup->by_address[i - 1])) {
+            lookup->by_address[i] = lookup->by_address[i - 1];
+            i--;
+        }
+        lookup->by_address[i] = heap;
+    }
+
+    // Regions are either disjoint or nested (see heap_caps_check_add_region_allowed), the enclosing
+    // heap of each heap is the closest heap before it in address order which is not over yet
+    for (int i = 0; i < (int)lookup->heap_count; i++) {
+        int outer = i - 1;
+        while (outer >= 0 && lookup->by_address[outer]->end <= lookup->by_address[i]->start) {
+            outer = lookup->enclosing[outer];
+        }
+        lookup->enclosing[i] = outer;
+    }
+
+    // Heaps are tried by priority first, then in list order. Heaps which are not registered
+    // yet (heap->heap == NULL) are kept, as they are registered later without rebuilding the table.
+    for (int prio = 0; prio < SOC_MEMORY_TYPE_NO_PRIOS; prio++) {
+        SLIST_FOREACH(heap, heaps, next) {
+            if (heap->caps[prio] == 0) {
+                continue;
+            }
+            heap_caps_prio_entry_t *entry = &lookup->prio_entries[lookup->prio_entry_count++];
+            entry->heap = heap;
+            entry->caps = heap->caps[prio];
+            entry->all_caps = 0;
+            for (int i = 0; i < SOC_MEMORY_TYPE_NO_PRIOS; i++) {
+                entry->all_caps |= heap->caps[i];
+            }
+        }
+    }
+    return lookup;
+}
+
+heap_t *heap_caps_lookup_find_containing(const heap_caps_lookup_t *lookup, intptr_t p)
+{
+    if (lookup == NULL) {
+        return NULL;
+    }
+    // Find the last heap starting at or before p
+    size_t low = 0;
+    size_t high = lookup->heap_count;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (lookup->by_address[mid]->start <= p) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    // If it doesn't contain p, the heaps enclosing it may
+    for (int i = (int)low - 1; i >= 0; i = lookup->enclosing[i]) {
+        heap_t *heap = lookup->by_address[i];
+        if (heap->heap != NULL && p < heap->end) {
+            return heap;
+        }
+    }
+    return NULL;
+}
+
+static void fill_candidates(const heap_caps_lookup_t *lookup, heap_caps_candidates_t *set, uint32_t caps)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < lookup->prio_entry_count; i++) {
+        const heap_caps_prio_entry_t *entry = &lookup->prio_entries[i];
+        if ((entry->caps & caps) == 0 || (entry->all_caps & caps) != caps) {
+            continue;
+        }
+        // A heap is tried at its first matching priority only, trying it again can't succeed
+        bool found = false;
+        for (size_t j = 0; j < count && !found; j++) {
+            found = set->heaps[j] == entry->heap;
+        }
+        if (!found) {
+            set->heaps[count++] = entry->heap;
+        }
+    }
+    set->caps = caps;
+    set->count = count;
+}
+
+heap_t *const *heap_caps_lookup_get_candidates(heap_caps_lookup_t *lookup, uint32_t caps, size_t *count)
+{
+    // Sets are filled in order, and never change once filled
+    for (int i = 0; i < HEAP_CAPS_LOOKUP_CANDIDATE_SETS; i++) {
+        heap_caps_candidates_t *set = &lookup->candidates[i];
+        if (!__atomic_load_n(&set->filled, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+        if (set->caps == caps) {
+            *count = set->count;
+            return set->heaps;
+        }
+    }
+
+    heap_t *const *heaps = NULL;
+    MULTI_HEAP_LOCK(&lookup->candidates_lock);
+    for (int i = 0; i < HEAP_CAPS_LOOKUP_CANDIDATE_SETS; i++) {
+        heap_caps_candidates_t *set = &lookup->candidates[i];
+        if (!set->filled) {
+            fill_candidates(lookup, set, caps);
+            __atomic_store_n(&set->filled, true, __ATOMIC_RELEASE);
+        }
+        if (set->caps == caps) {
+            *count = set->count;
+            heaps = set->heaps;
+            break;
+        }
+    }
+    MULTI_HEAP_UNLOCK(&lookup->candidates_lock);
+    return heaps;
+}
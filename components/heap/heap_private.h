@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -7,6 +7,7 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <soc/soc_memory_layout.h>
 #include "multi_heap.h"
 #include "multi_heap_platform.h"
@@ -40,6 +41,86 @@ typedef struct heap_t_ {
 */
 extern SLIST_HEAD(registered_heap_ll, heap_t_) registered_heaps;
 
+/* Number of capability sets remembered by a heap lookup table, see heap_caps_lookup_get_candidates() */
+#define HEAP_CAPS_LOOKUP_CANDIDATE_SETS 8
+
+/* A registered heap at one of its priorities, see heap_caps_lookup_t */
+typedef struct {
+    heap_t *heap;
+    uint32_t caps;          ///< Capabilities of the heap at this priority
+    uint32_t all_caps;      ///< Capabilities of the heap at all priorities
+} heap_caps_prio_entry_t;
+
+/* Heaps able to satisfy a set of capabilities, in the order they are tried */
+typedef struct {
+    bool filled;            ///< Set once the other fields are written
+    uint32_t caps;          ///< Requested capabilities
+    size_t count;           ///< Number of heaps in the set
+    heap_t **heaps;         ///< Heaps of the set
+} heap_caps_candidates_t;
+
+/* Lookup tables built from registered_heaps, so that allocating and freeing don't walk the list.
+
+   A table is never modified after it is published, except for filling unused candidate sets.
+   Readers don't take any lock, they hold the table between heap_caps_lookup_acquire() and
+   heap_caps_lookup_release(). Registering a heap publishes a new table and retires the previous
+   one, which is freed once no reader holds a table.
+*/
+typedef struct heap_caps_lookup_ {
+    size_t heap_count;
+    heap_t **by_address;                    ///< Heaps sorted by start address, then by decreasing end address
+    int *enclosing;                         ///< Index in by_address of the heap containing each heap, -1 if none
+    size_t prio_entry_count;
+    heap_caps_prio_entry_t *prio_entries;   ///< Heaps at each priority, in the order heap_caps_malloc tries them
+    heap_caps_candidates_t candidates[HEAP_CAPS_LOOKUP_CANDIDATE_SETS];
+    multi_heap_lock_t candidates_lock;      ///< Taken to fill an unused candidate set
+    struct heap_caps_lookup_ *retired_next; ///< Next retired table waiting to be freed
+} heap_caps_lookup_t;
+
+/* Current lookup table, NULL until heap_caps_init() is done */
+extern heap_caps_lookup_t *registered_heaps_lookup;
+
+/* Number of readers holding a lookup table */
+extern uint32_t registered_heaps_lookup_readers;
+
+/* Tables replaced by a newer one and allocated from the heaps, waiting to be freed */
+extern heap_caps_lookup_t *registered_heaps_lookup_retired;
+
+/* Free the retired lookup tables, if no reader holds a table */
+void heap_caps_lookup_free_retired(void);
+
+/* Return the current lookup table, which stays valid until heap_caps_lookup_release() */
+inline static heap_caps_lookup_t *heap_caps_lookup_acquire(void)
+{
+    // The reader is counted before loading the table, so a table retired after the load isn't freed
+    __atomic_add_fetch(&registered_heaps_lookup_readers, 1, __ATOMIC_SEQ_CST);
+    return __atomic_load_n(&registered_heaps_lookup, __ATOMIC_SEQ_CST);
+}
+
+inline static void heap_caps_lookup_release(void)
+{
+    if (__atomic_sub_fetch(&registered_heaps_lookup_readers, 1, __ATOMIC_SEQ_CST) == 0
+            && __atomic_load_n(&registered_heaps_lookup_retired, __ATOMIC_SEQ_CST) != NULL) {
+        heap_caps_lookup_free_retired();
+    }
+}
+
+/* Size of the buffer holding the lookup table of heap_count heaps */
+size_t heap_caps_lookup_size(size_t heap_count);
+
+/* Build the lookup table of the heaps of the list in buffer, which must be heap_caps_lookup_size() bytes */
+heap_caps_lookup_t *heap_caps_lookup_build(void *buffer, const struct registered_heap_ll *heaps, size_t heap_count);
+
+/* Return the heap whose region contains p, or NULL. If regions are nested, return the innermost one. */
+heap_t *heap_caps_lookup_find_containing(const heap_caps_lookup_t *lookup, intptr_t p);
+
+/* Return the heaps able to satisfy caps, in the order they are tried, deduplicated.
+
+   Returns NULL if all candidate sets are used by other capabilities, the caller must then walk
+   lookup->prio_entries.
+*/
+heap_t *const *heap_caps_lookup_get_candidates(heap_caps_lookup_t *lookup, uint32_t caps, size_t *count);
+
 bool heap_caps_match(const heap_t *heap, uint32_t caps);
 
 /* return all possible capabilities (across all priorities) for a given heap */
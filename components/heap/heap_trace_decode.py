@@ -0,0 +1,180 @@
+#!/usr/bin/env python
+#
+# SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+#
+# Aggregates by allocation call stack the heap trace records written on the target by
+# heap_trace_dump_binary(). With sampling enabled (heap_trace_set_sampling()), the numbers of
+# allocations and bytes are estimated by scaling the sampled allocations by the sampling period.
+#
+# Usage: heap_trace_decode.py [--elf build/app.elf] trace.bin
+
+import argparse
+import struct
+import subprocess
+import sys
+from typing import BinaryIO, Dict, Iterator, List, Tuple
+
+# Same values as in esp_heap_trace.h
+HEAP_TRACE_BINARY_MAGIC = 0x43525448
+HEAP_TRACE_BINARY_VERSION = 1
+HEAP_TRACE_ALL = 0
+
+HEADER = struct.Struct('<6I')
+RECORD = struct.Struct('<4I')
+
+
+class Header:
+    def __init__(self, data: bytes) -> None:
+        if len(data) < HEADER.size:
+            raise ValueError('dump too short')
+        magic, flags, self.total_allocations, self.total_frees, self.sample_period, self.sample_size_threshold = \
+            HEADER.unpack_from(data)
+        if magic != HEAP_TRACE_BINARY_MAGIC:
+            raise ValueError('not a heap trace dump')
+        if flags & 0xff != HEAP_TRACE_BINARY_VERSION:
+            raise ValueError('unsupported dump version {}'.format(flags & 0xff))
+        self.stack_depth = (flags >> 8) & 0xff
+        self.mode = (flags >> 16) & 0xff
+        self.has_overflowed = bool(flags >> 24)
+
+
+class Record:
+    def __init__(self, address: int, size: int, ccount: int, alloced_by: Tuple[int, ...], freed_by: Tuple[int, ...]) -> None:
+        self.address = address
+        self.size = size
+        self.ccount = ccount
+        self.alloced_by = alloced_by
+        self.freed_by = freed_by
+
+
+def read_dump(stream: BinaryIO) -> Tuple[Header, List[Record]]:
+    data = stream.read()
+    header = Header(data)
+    return header, list(read_records(data, HEADER.size))
+
+
+def read_records(data: bytes, pos: int) -> Iterator[Record]:
+    while pos + RECORD.size <= len(data):
+        address, size, ccount, depths = RECORD.unpack_from(data, pos)
+        alloc_depth = depths & 0xff
+        free_depth = (depths >> 8) & 0xff
+        pos += RECORD.size
+        callers_size = 4 * (alloc_depth + free_depth)
+        if pos + callers_size > len(data):
+            raise ValueError('truncated record at offset {}'.format(pos - RECORD.size))
+        callers = struct.unpack_from('<{}I'.format(alloc_depth + free_depth), data, pos)
+        pos += callers_size
+        yield Record(address, size, ccount, callers[:alloc_depth], callers[alloc_depth:])
+    if pos != len(data):
+        raise ValueError('truncated record at offset {}'.format(pos))
+
+
+class Stack:
+    def __init__(self) -> None:
+        self.records = 0
+        self.bytes = 0
+        self.estimated_allocations = 0
+        self.estimated_bytes = 0
+        self.live_records = 0
+        self.live_bytes = 0
+
+
+def aggregate(header: Header, records: List[Record]) -> Dict[Tuple[int, ...], Stack]:
+    stacks = {}  # type: Dict[Tuple[int, ...], Stack]
+    for record in records:
+        stack = stacks.setdefault(record.alloced_by, Stack())
+        # Allocations above the size threshold are always traced, the other ones 1 in sample_period
+        weight = 1
+        if header.sample_period > 1 and not (header.sample_size_threshold and record.size >= header.sample_size_threshold):
+            weight = header.sample_period
+        stack.records += 1
+        stack.bytes += record.size
+        stack.estimated_allocations += weight
+        stack.estimated_bytes += weight * record.size
+        # In HEAP_TRACE_LEAKS mode, the records of freed memory are removed
+        if header.mode != HEAP_TRACE_ALL or not record.freed_by:
+            stack.live_records += 1
+            stack.live_bytes += record.size
+    return stacks
+
+
+def symbolize(elf: str, toolchain_prefix: str, addresses: List[int]) -> Dict[int, str]:
+    if not addresses:
+        return {}
+    # A single addr2line run for all the addresses, which prints one line per address
+    cmd = [toolchain_prefix + 'addr2line', '-pfiaC', '-e', elf]
+    try:
+        output = subprocess.run(cmd, input='\n'.join('0x{:08x}'.format(a) for a in addresses), stdout=subprocess.PIPE,
+                                universal_newlines=True, check=True).stdout
+    except (OSError, subprocess.CalledProcessError) as e:
+        sys.stderr.write('Failed to run {}: {}\n'.format(cmd[0], e))
+        return {}
+    symbols = {}  # type: Dict[int, str]
+    address = None
+    for line in output.splitlines():
+        # Inlined functions are reported on additional lines starting with ' (inlined by)'
+        if line.startswith('0x'):
+            address_str, _, location = line.partition(': ')
+            address = int(address_str, 16)
+            symbols[address] = location
+        elif address is not None:
+            symbols[address] += '\n' + ' ' * 16 + line.strip()
+    return symbols
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description='Aggregate by call stack the heap trace dumped by heap_trace_dump_binary()')
+    parser.add_argument('dump', type=argparse.FileType('rb'), nargs='?', default=sys.stdin.buffer,
+                        help='file holding the dump, standard input by default')
+    parser.add_argument('--elf', help='ELF file of the application, to print the function names of the callers')
+    parser.add_argument('--toolchain-prefix', default='xtensa-esp32-elf-',
+                        help='prefix of the toolchain addr2line, riscv32-esp-elf- for RISC-V targets')
+    parser.add_argument('--sort', choices=('bytes', 'count', 'live'), default='bytes',
+                        help='sort the call stacks by estimated bytes, estimated allocations or live bytes')
+    parser.add_argument('--top', type=int, default=0, help='print only this number of call stacks')
+    args = parser.parse_args()
+
+    header, records = read_dump(args.dump)
+    stacks = aggregate(header, records)
+
+    if header.sample_period == 1:
+        sampling = 'all allocations'
+    elif header.sample_period == 0:
+        sampling = 'allocations of at least {} bytes'.format(header.sample_size_threshold)
+    else:
+        sampling = '1 in {} allocations'.format(header.sample_period)
+        if header.sample_size_threshold:
+            sampling += ' and allocations of at least {} bytes'.format(header.sample_size_threshold)
+    print('{} records, {} allocations and {} frees traced ({}), mode {}'.format(
+        len(records), header.total_allocations, header.total_frees, sampling,
+        'all' if header.mode == HEAP_TRACE_ALL else 'leaks'))
+    if header.has_overflowed:
+        print('NB: the trace buffer has overflowed, the oldest records were lost')
+
+    sort_keys = {
+        'bytes': lambda s: s.estimated_bytes,
+        'count': lambda s: s.estimated_allocations,
+        'live': lambda s: s.live_bytes,
+    }
+    ordered = sorted(stacks.items(), key=lambda item: sort_keys[args.sort](item[1]), reverse=True)
+    if args.top > 0:
+        ordered = ordered[:args.top]
+
+    symbols = {}  # type: Dict[int, str]
+    if args.elf:
+        symbols = symbolize(args.elf, args.toolchain_prefix, sorted({a for callers, _ in ordered for a in callers}))
+
+    for callers, stack in ordered:
+        print()
+        print('{} bytes in {} allocations (estimated), {} records of {} bytes, {} live records of {} bytes'.format(
+            stack.estimated_bytes, stack.estimated_allocations, stack.records, stack.bytes,
+            stack.live_records, stack.live_bytes))
+        if not callers:
+            print('    <no call stack>')
+        for address in callers:
+            print('    0x{:08x}  {}'.format(address, symbols.get(address, '')).rstrip())
+
+
+if __name__ == '__main__':
+    main()
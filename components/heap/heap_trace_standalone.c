@@ -1,11 +1,12 @@
 /*
- * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
 #include <string.h>
 #include <sdkconfig.h>
 #include <inttypes.h>
+#include <sys/param.h>
 #include "esp_log.h"
 
 #define HEAP_TRACE_SRCFILE /* don't warn on inclusion here */
@@ -24,7 +25,8 @@ static __attribute__((unused)) const char* TAG = "heaptrace";
 
 #if CONFIG_HEAP_TRACING_STANDALONE
 
-static portMUX_TYPE trace_mux = portMUX_INITIALIZER_UNLOCKED;
+#define NUM_SHARDS CONFIG_HEAP_TRACE_RECORD_SHARDS
+
 static bool tracing;
 static heap_trace_mode_t mode;
 
@@ -32,9 +34,21 @@ static heap_trace_mode_t mode;
 TAILQ_HEAD(heap_trace_record_list_struct_t, heap_trace_record_t);
 typedef struct heap_trace_record_list_struct_t heap_trace_record_list_t;
 
-/* Linked List of Records */
+#if CONFIG_HEAP_TRACE_HASH_MAP
+SLIST_HEAD(heap_trace_hash_list_struct_t, heap_trace_record_t);
+typedef struct heap_trace_hash_list_struct_t heap_trace_hash_list_t;
+#endif
+
+/* Linked List of Records
+
+   The records are split in NUM_SHARDS shards, by hash of the allocated address. Each shard
+   has its own lock, part of the record buffer, and part of the hash map, so that tracing
+   allocations of different addresses doesn't contend on a single lock. */
 typedef struct {
 
+    /* Protects the shard */
+    portMUX_TYPE mux;
+
     /* Buffer used for records. */
     heap_trace_record_t *buffer;
 
@@ -57,97 +71,133 @@ typedef struct {
 
     /* Has the buffer overflowed and lost trace entries? */
     bool has_overflowed;
+
+    /* Actual number of allocations logged */
+    size_t total_allocations;
+
+    /* Actual number of frees logged */
+    size_t total_frees;
+
+    /* Number of times 'list' was searched for a freed address */
+    size_t total_list_searches;
+
+    /* Used to speed up heap_trace_get */
+    heap_trace_record_t* r_get;
+    size_t r_get_idx;
+
+#if CONFIG_HEAP_TRACE_HASH_MAP
+    /* Hash map buckets of the shard */
+    heap_trace_hash_list_t* hash_map;
+    size_t total_hashmap_hits;
+    size_t total_hashmap_miss;
+#endif
 } records_t;
 
 // Forward Defines
 static void heap_trace_dump_base(bool internal_ram, bool psram);
 static void record_deep_copy(heap_trace_record_t *r_dest, const heap_trace_record_t *r_src);
-static void list_setup(void);
-static void list_remove(heap_trace_record_t *r_remove);
-static heap_trace_record_t* list_add(const heap_trace_record_t *r_append);
-static heap_trace_record_t* list_pop_unused(void);
-static heap_trace_record_t* list_find(void *p);
-static void list_find_and_remove(void* p);
+static void list_setup(records_t *records);
+static void list_remove(records_t *records, heap_trace_record_t *r_remove);
+static heap_trace_record_t* list_add(records_t *records, const heap_trace_record_t *r_append);
+static heap_trace_record_t* list_pop_unused(records_t *records);
+static heap_trace_record_t* list_find(records_t *records, void *p);
+static void list_find_and_remove(records_t *records, void* p);
+static void get_sampling(uint32_t *period, size_t *size_threshold);
 
 /* The actual records. */
-static records_t records;
+static records_t shards[NUM_SHARDS] = {
+    [0 ... NUM_SHARDS - 1] = { .mux = portMUX_INITIALIZER_UNLOCKED }
+};
 
-/* Actual number of allocations logged */
-static size_t total_allocations;
+static HEAP_IRAM_ATTR uint32_t hash_address(void* p)
+{
+    static const uint32_t fnv_prime = 16777619UL; // expression 2^24 + 2^8 + 0x93 (32 bits size)
+    // since all the addresses are 4 bytes aligned, computing address * fnv_prime always gives
+    // a modulo 4 number. The bit shift goal is to distribute more evenly the hashes between
+    // the shards and the hash map entries.
+    return (((uint32_t)p >> 3) +
+            ((uint32_t)p >> 5) +
+            ((uint32_t)p >> 7)) * fnv_prime;
+}
 
-/* Actual number of frees logged */
-static size_t total_frees;
+/* Shard holding the record of an address */
+static HEAP_IRAM_ATTR records_t* shard_of(void* p)
+{
+    return &shards[hash_address(p) % NUM_SHARDS];
+}
 
-/* Used to speed up heap_trace_get */
-static heap_trace_record_t* r_get;
-static size_t r_get_idx;
+static void lock_all_shards(void)
+{
+    for (int i = 0; i < NUM_SHARDS; i++) {
+        portENTER_CRITICAL(&shards[i].mux);
+    }
+}
+
+static void unlock_all_shards(void)
+{
+    for (int i = NUM_SHARDS - 1; i >= 0; i--) {
+        portEXIT_CRITICAL(&shards[i].mux);
+    }
+}
 
 #if CONFIG_HEAP_TRACE_HASH_MAP
 
 // We use a hash_map to make locating a record by memory address very fast.
 //   Key: addr                  // the memory address returned by malloc, calloc, realloc
 //   Value: hash_map[hash(key)] // a list of records ptrs, which contains the relevant record.
-SLIST_HEAD(heap_trace_hash_list_struct_t, heap_trace_record_t);
-typedef struct heap_trace_hash_list_struct_t heap_trace_hash_list_t;
+// The buckets are split between the shards, each shard only uses its own buckets.
+#define SHARD_HASH_MAP_SIZE MAX(1, CONFIG_HEAP_TRACE_HASH_MAP_SIZE / NUM_SHARDS)
 static heap_trace_hash_list_t* hash_map; // array of lists
-static size_t total_hashmap_hits;
-static size_t total_hashmap_miss;
 
 static HEAP_IRAM_ATTR size_t hash_idx(void* p)
 {
-    static const uint32_t fnv_prime = 16777619UL; // expression 2^24 + 2^8 + 0x93 (32 bits size)
-    // since all the addresses are 4 bytes aligned, computing address * fnv_prime always gives
-    // a modulo 4 number. The bit shift goal is to distribute more evenly the hashes in the
-    // given range [0 , CONFIG_HEAP_TRACE_HASH_MAP_SIZE - 1].
-    return ((((uint32_t)p >> 3) +
-             ((uint32_t)p >> 5) +
-             ((uint32_t)p >> 7)) * fnv_prime) % (uint32_t)CONFIG_HEAP_TRACE_HASH_MAP_SIZE;
+    return (hash_address(p) / NUM_SHARDS) % (uint32_t)SHARD_HASH_MAP_SIZE;
 }
 
-static HEAP_IRAM_ATTR void map_add(heap_trace_record_t *r_add)
+static HEAP_IRAM_ATTR void map_add(records_t *records, heap_trace_record_t *r_add)
 {
     size_t idx = hash_idx(r_add->address);
-    SLIST_INSERT_HEAD(&hash_map[idx], r_add, slist_hashmap);
+    SLIST_INSERT_HEAD(&records->hash_map[idx], r_add, slist_hashmap);
 }
 
-static HEAP_IRAM_ATTR void map_remove(heap_trace_record_t *r_remove)
+static HEAP_IRAM_ATTR void map_remove(records_t *records, heap_trace_record_t *r_remove)
 {
     size_t idx = hash_idx(r_remove->address);
-    SLIST_REMOVE(&hash_map[idx], r_remove, heap_trace_record_t, slist_hashmap);
+    SLIST_REMOVE(&records->hash_map[idx], r_remove, heap_trace_record_t, slist_hashmap);
 }
 
-static HEAP_IRAM_ATTR heap_trace_record_t* map_find(void *p)
+static HEAP_IRAM_ATTR heap_trace_record_t* map_find(records_t *records, void *p)
 {
     size_t idx = hash_idx(p);
     heap_trace_record_t *r_cur = NULL;
-    SLIST_FOREACH(r_cur, &hash_map[idx], slist_hashmap) {
+    SLIST_FOREACH(r_cur, &records->hash_map[idx], slist_hashmap) {
         if (r_cur->address == p) {
-            total_hashmap_hits++;
+            records->total_hashmap_hits++;
             return r_cur;
         }
     }
-    total_hashmap_miss++;
+    records->total_hashmap_miss++;
     return NULL;
 }
 
-static HEAP_IRAM_ATTR heap_trace_record_t* map_find_and_remove(void *p)
+static HEAP_IRAM_ATTR heap_trace_record_t* map_find_and_remove(records_t *records, void *p)
 {
     size_t idx = hash_idx(p);
     heap_trace_record_t *r_cur = NULL;
     heap_trace_record_t *r_prev = NULL;
-    SLIST_FOREACH(r_cur, &hash_map[idx], slist_hashmap) {
+    SLIST_FOREACH(r_cur, &records->hash_map[idx], slist_hashmap) {
         if (r_cur->address == p) {
-            total_hashmap_hits++;
+            records->total_hashmap_hits++;
             if (r_prev) {
                 SLIST_REMOVE_AFTER(r_prev, slist_hashmap);
             } else {
-                SLIST_REMOVE_HEAD(&hash_map[idx], slist_hashmap);
+                SLIST_REMOVE_HEAD(&records->hash_map[idx], slist_hashmap);
             }
             return r_cur;
         }
         r_prev = r_cur;
     }
-    total_hashmap_miss++;
+    records->total_hashmap_miss++;
     return NULL;
 }
 #endif // CONFIG_HEAP_TRACE_HASH_MAP
@@ -164,7 +214,7 @@ esp_err_t heap_trace_init_standalone(heap_trace_record_t *record_buffer, size_t
 
 #if CONFIG_HEAP_TRACE_HASH_MAP
     if (hash_map == NULL) {
-        uint32_t map_size = sizeof(heap_trace_record_list_t) * CONFIG_HEAP_TRACE_HASH_MAP_SIZE;
+        uint32_t map_size = sizeof(heap_trace_hash_list_t) * SHARD_HASH_MAP_SIZE * NUM_SHARDS;
 #if CONFIG_HEAP_TRACE_HASH_MAP_IN_EXT_RAM
         ESP_LOGI(TAG, "hashmap: allocating %" PRIu32 " bytes (PSRAM)\n", map_size);
         hash_map = heap_caps_calloc(1, map_size, MALLOC_CAP_SPIRAM);
@@ -175,8 +225,16 @@ esp_err_t heap_trace_init_standalone(heap_trace_record_t *record_buffer, size_t
     }
 #endif // CONFIG_HEAP_TRACE_HASH_MAP
 
-    records.buffer = record_buffer;
-    records.capacity = num_records;
+    // Split the buffer between the shards
+    for (int i = 0; i < NUM_SHARDS; i++) {
+        records_t *records = &shards[i];
+        records->buffer = record_buffer;
+        records->capacity = num_records / NUM_SHARDS + ((size_t)i < num_records % NUM_SHARDS ? 1 : 0);
+        record_buffer += records->capacity;
+#if CONFIG_HEAP_TRACE_HASH_MAP
+        records->hash_map = &hash_map[i * SHARD_HASH_MAP_SIZE];
+#endif
+    }
 
     return ESP_OK;
 }
@@ -192,59 +250,69 @@ static esp_err_t set_tracing(bool enable)
 
 esp_err_t heap_trace_start(heap_trace_mode_t mode_param)
 {
-    if (records.buffer == NULL || records.capacity == 0) {
+    if (shards[0].buffer == NULL || shards[0].capacity == 0) {
         return ESP_ERR_INVALID_STATE;
     }
 
-    portENTER_CRITICAL(&trace_mux);
+    lock_all_shards();
 
     set_tracing(false);
     mode = mode_param;
 
-    // clear buffers
-    memset(records.buffer, 0, sizeof(heap_trace_record_t) * records.capacity);
+    for (int s = 0; s < NUM_SHARDS; s++) {
+        records_t *records = &shards[s];
+
+        // clear buffers
+        memset(records->buffer, 0, sizeof(heap_trace_record_t) * records->capacity);
 
 #if CONFIG_HEAP_TRACE_HASH_MAP
-    for (size_t i = 0; i < (size_t)CONFIG_HEAP_TRACE_HASH_MAP_SIZE; i++) {
-        SLIST_INIT(&hash_map[i]);
-    }
+        for (size_t i = 0; i < (size_t)SHARD_HASH_MAP_SIZE; i++) {
+            SLIST_INIT(&records->hash_map[i]);
+        }
 
-    total_hashmap_hits = 0;
-    total_hashmap_miss = 0;
+        records->total_hashmap_hits = 0;
+        records->total_hashmap_miss = 0;
 #endif // CONFIG_HEAP_TRACE_HASH_MAP
 
-    records.count = 0;
-    records.has_overflowed = false;
-    list_setup();
+        records->count = 0;
+        records->has_overflowed = false;
+        records->r_get = NULL;
+        list_setup(records);
 
-    total_allocations = 0;
-    total_frees = 0;
+        records->total_allocations = 0;
+        records->total_frees = 0;
+        records->total_list_searches = 0;
+    }
 
     const esp_err_t ret_val = set_tracing(true);
 
-    portEXIT_CRITICAL(&trace_mux);
+    unlock_all_shards();
     return ret_val;
 }
 
 esp_err_t heap_trace_stop(void)
 {
-    portENTER_CRITICAL(&trace_mux);
+    lock_all_shards();
     const esp_err_t ret_val = set_tracing(false);
-    portEXIT_CRITICAL(&trace_mux);
+    unlock_all_shards();
     return ret_val;
 }
 
 esp_err_t heap_trace_resume(void)
 {
-    portENTER_CRITICAL(&trace_mux);
+    lock_all_shards();
     const esp_err_t ret_val = set_tracing(true);
-    portEXIT_CRITICAL(&trace_mux);
+    unlock_all_shards();
     return ret_val;
 }
 
 size_t heap_trace_get_count(void)
 {
-    return records.count;
+    size_t count = 0;
+    for (int s = 0; s < NUM_SHARDS; s++) {
+        count += shards[s].count;
+    }
+    return count;
 }
 
 esp_err_t heap_trace_get(size_t index, heap_trace_record_t *r_out)
@@ -253,46 +321,53 @@ esp_err_t heap_trace_get(size_t index, heap_trace_record_t *r_out)
         return ESP_ERR_INVALID_STATE;
     }
 
-    esp_err_t result = ESP_OK;
+    esp_err_t result = ESP_ERR_INVALID_ARG; /* out of range for 'count' */
 
-    portENTER_CRITICAL(&trace_mux);
+    // Records are indexed shard after shard
+    for (int s = 0; s < NUM_SHARDS && result != ESP_OK; s++) {
+        records_t *records = &shards[s];
 
-    if (index >= records.count) {
+        portENTER_CRITICAL(&records->mux);
 
-        result = ESP_ERR_INVALID_ARG; /* out of range for 'count' */
+        if (index >= records->count) {
 
-    } else {
+            index -= records->count;
 
-        // Perf: speed up sequential access
-        if (r_get && r_get_idx == index - 1) {
+        } else {
 
-            r_get = TAILQ_NEXT(r_get, tailq_list);
-            r_get_idx = index;
+            // Perf: speed up sequential access
+            if (records->r_get && records->r_get_idx == index - 1) {
 
-        } else {
+                records->r_get = TAILQ_NEXT(records->r_get, tailq_list);
+                records->r_get_idx = index;
 
-            // Iterate through through the linked list
+            } else {
 
-            r_get = TAILQ_FIRST(&records.list);
+                // Iterate through through the linked list
 
-            for (int i = 0; i < index; i++) {
+                records->r_get = TAILQ_FIRST(&records->list);
 
-                if (r_get == NULL) {
-                    break;
-                }
+                for (int i = 0; i < index; i++) {
+
+                    if (records->r_get == NULL) {
+                        break;
+                    }
 
-                r_get = TAILQ_NEXT(r_get, tailq_list);
-                r_get_idx = i + 1;
+                    records->r_get = TAILQ_NEXT(records->r_get, tailq_list);
+                    records->r_get_idx = i + 1;
+                }
             }
+
+            // We already checked that index < records->count,
+            // This could be indicative of memory corruption.
+            assert(records->r_get != NULL);
+            memcpy(r_out, records->r_get, sizeof(heap_trace_record_t));
+            result = ESP_OK;
         }
 
-        // We already checked that index < records.count,
-        // This could be indicative of memory corruption.
-        assert(r_get != NULL);
-        memcpy(r_out, r_get, sizeof(heap_trace_record_t));
+        portEXIT_CRITICAL(&records->mux);
     }
 
-    portEXIT_CRITICAL(&trace_mux);
     return result;
 }
 
@@ -302,19 +377,26 @@ esp_err_t heap_trace_summary(heap_trace_summary_t *summary)
         return ESP_ERR_INVALID_ARG;
     }
 
-    portENTER_CRITICAL(&trace_mux);
+    memset(summary, 0, sizeof(heap_trace_summary_t));
+
+    lock_all_shards();
     summary->mode = mode;
-    summary->total_allocations = total_allocations;
-    summary->total_frees = total_frees;
-    summary->count = records.count;
-    summary->capacity = records.capacity;
-    summary->high_water_mark = records.high_water_mark;
-    summary->has_overflowed = records.has_overflowed;
+    for (int s = 0; s < NUM_SHARDS; s++) {
+        const records_t *records = &shards[s];
+        summary->total_allocations += records->total_allocations;
+        summary->total_frees += records->total_frees;
+        summary->total_list_searches += records->total_list_searches;
+        summary->count += records->count;
+        summary->capacity += records->capacity;
+        // With several shards, the shards may have reached their high water mark at different times
+        summary->high_water_mark += records->high_water_mark;
+        summary->has_overflowed = summary->has_overflowed || records->has_overflowed;
 #if CONFIG_HEAP_TRACE_HASH_MAP
-    summary->total_hashmap_hits = total_hashmap_hits;
-    summary->total_hashmap_miss = total_hashmap_miss;
+        summary->total_hashmap_hits += records->total_hashmap_hits;
+        summary->total_hashmap_miss += records->total_hashmap_miss;
 #endif // CONFIG_HEAP_TRACE_HASH_MAP
-    portEXIT_CRITICAL(&trace_mux);
+    }
+    unlock_all_shards();
 
     return ESP_OK;
 }
@@ -327,66 +409,127 @@ void heap_trace_dump_caps(const uint32_t caps) {
     heap_trace_dump_base(caps & MALLOC_CAP_INTERNAL, caps & MALLOC_CAP_SPIRAM);
 }
 
+esp_err_t heap_trace_dump_binary(heap_trace_write_cb_t write_cb, void *arg)
+{
+    if (write_cb == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (shards[0].buffer == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    heap_trace_summary_t summary;
+    uint32_t sample_period;
+    size_t sample_size_threshold;
+    heap_trace_summary(&summary);
+    get_sampling(&sample_period, &sample_size_threshold);
+
+    const uint32_t header[] = {
+        HEAP_TRACE_BINARY_MAGIC,
+        HEAP_TRACE_BINARY_VERSION | (STACK_DEPTH << 8) | (summary.mode << 16) | ((summary.has_overflowed ? 1 : 0) << 24),
+        summary.total_allocations,
+        summary.total_frees,
+        sample_period,
+        sample_size_threshold,
+    };
+    esp_err_t err = write_cb(header, sizeof(header), arg);
+
+    // Records are copied one by one, so that no lock is held while calling write_cb
+    heap_trace_record_t record;
+    for (size_t i = 0; err == ESP_OK && heap_trace_get(i, &record) == ESP_OK; i++) {
+        uint32_t entry[4 + 2 * STACK_DEPTH];
+        uint32_t alloc_depth = 0;
+        uint32_t free_depth = 0;
+
+        while (alloc_depth < STACK_DEPTH && record.alloced_by[alloc_depth] != NULL) {
+            entry[4 + alloc_depth] = (uint32_t)record.alloced_by[alloc_depth];
+            alloc_depth++;
+        }
+        while (free_depth < STACK_DEPTH && record.freed_by[free_depth] != NULL) {
+            entry[4 + alloc_depth + free_depth] = (uint32_t)record.freed_by[free_depth];
+            free_depth++;
+        }
+        entry[0] = (uint32_t)record.address;
+        entry[1] = record.size;
+        entry[2] = record.ccount;
+        entry[3] = alloc_depth | (free_depth << 8);
+
+        err = write_cb(entry, sizeof(uint32_t) * (4 + alloc_depth + free_depth), arg);
+    }
+
+    return err;
+}
+
 static void heap_trace_dump_base(bool internal_ram, bool psram)
 {
-    portENTER_CRITICAL(&trace_mux);
+    heap_trace_summary_t summary;
+    uint32_t sample_period;
+    size_t sample_size_threshold;
+    get_sampling(&sample_period, &sample_size_threshold);
+
+    heap_trace_summary(&summary);
+    lock_all_shards();
 
     size_t delta_size = 0;
     size_t delta_allocs = 0;
-    size_t start_count = records.count;
+    size_t start_count = heap_trace_get_count();
 
     esp_rom_printf("====== Heap Trace: %"PRIu32" records (%"PRIu32" capacity) ======\n",
-        records.count, records.capacity);
+        summary.count, summary.capacity);
 
-    // Iterate through through the linked list
+    // Iterate through through the linked list of each shard
 
-    heap_trace_record_t *r_cur = TAILQ_FIRST(&records.list);
+    for (int s = 0; s < NUM_SHARDS; s++) {
 
-    for (int i = 0; i < records.count; i++) {
+        const records_t *records = &shards[s];
+        heap_trace_record_t *r_cur = TAILQ_FIRST(&records->list);
 
-        // check corruption
-        if (r_cur == NULL) {
-            esp_rom_printf("\nError: heap trace linked list is corrupt. expected more records.\n");
-            break;
-        }
+        for (int i = 0; i < records->count; i++) {
 
-        bool should_print = r_cur->address != NULL &&
-            ((psram && internal_ram) ||
-             (internal_ram && esp_ptr_internal(r_cur->address)) ||
-             (psram && esp_ptr_external_ram(r_cur->address)));
+            // check corruption
+            if (r_cur == NULL) {
+                esp_rom_printf("\nError: heap trace linked list is corrupt. expected more records.\n");
+                break;
+            }
 
-        if (should_print) {
+            bool should_print = r_cur->address != NULL &&
+                ((psram && internal_ram) ||
+                 (internal_ram && esp_ptr_internal(r_cur->address)) ||
+                 (psram && esp_ptr_external_ram(r_cur->address)));
 
-            const char* label = "";
-            if (esp_ptr_internal(r_cur->address)) {
-                label = ", Internal";
-            }
-            if (esp_ptr_external_ram(r_cur->address)) {
-                label = ",    PSRAM";
-            }
+            if (should_print) {
 
-            esp_rom_printf("%6d bytes (@ %p%s) allocated CPU %d ccount 0x%08x caller ",
-                   r_cur->size, r_cur->address, label, r_cur->ccount & 1, r_cur->ccount & ~3);
+                const char* label = "";
+                if (esp_ptr_internal(r_cur->address)) {
+                    label = ", Internal";
+                }
+                if (esp_ptr_external_ram(r_cur->address)) {
+                    label = ",    PSRAM";
+                }
 
-            for (int j = 0; j < STACK_DEPTH && r_cur->alloced_by[j] != 0; j++) {
-                esp_rom_printf("%p%s", r_cur->alloced_by[j],
-                       (j < STACK_DEPTH - 1) ? ":" : "");
-            }
+                esp_rom_printf("%6d bytes (@ %p%s) allocated CPU %d ccount 0x%08x caller ",
+                       r_cur->size, r_cur->address, label, r_cur->ccount & 1, r_cur->ccount & ~3);
 
-            if (mode != HEAP_TRACE_ALL || STACK_DEPTH == 0 || r_cur->freed_by[0] == NULL) {
-                delta_size += r_cur->size;
-                delta_allocs++;
-                esp_rom_printf("\n");
-            } else {
-                esp_rom_printf("\nfreed by ");
-                for (int j = 0; j < STACK_DEPTH; j++) {
-                    esp_rom_printf("%p%s", r_cur->freed_by[j],
-                           (j < STACK_DEPTH - 1) ? ":" : "\n");
+                for (int j = 0; j < STACK_DEPTH && r_cur->alloced_by[j] != 0; j++) {
+                    esp_rom_printf("%p%s", r_cur->alloced_by[j],
+                           (j < STACK_DEPTH - 1) ? ":" : "");
+                }
+
+                if (mode != HEAP_TRACE_ALL || STACK_DEPTH == 0 || r_cur->freed_by[0] == NULL) {
+                    delta_size += r_cur->size;
+                    delta_allocs++;
+                    esp_rom_printf("\n");
+                } else {
+                    esp_rom_printf("\nfreed by ");
+                    for (int j = 0; j < STACK_DEPTH; j++) {
+                        esp_rom_printf("%p%s", r_cur->freed_by[j],
+                               (j < STACK_DEPTH - 1) ? ":" : "\n");
+                    }
                 }
             }
-        }
 
-        r_cur = TAILQ_NEXT(r_cur, tailq_list);
+            r_cur = TAILQ_NEXT(r_cur, tailq_list);
+        }
     }
 
     esp_rom_printf("====== Heap Trace Summary ======\n");
@@ -401,25 +544,36 @@ static void heap_trace_dump_base(bool internal_ram, bool psram)
     }
 
     esp_rom_printf("records: %"PRIu32" (%"PRIu32" capacity, %"PRIu32" high water mark)\n",
-        records.count, records.capacity, records.high_water_mark);
+        summary.count, summary.capacity, summary.high_water_mark);
+#if NUM_SHARDS > 1
+    esp_rom_printf("shards: %d\n", NUM_SHARDS);
+#endif
 
 #if CONFIG_HEAP_TRACE_HASH_MAP
     esp_rom_printf("hashmap: %"PRIu32" capacity (%"PRIu32" hits, %"PRIu32" misses)\n",
-        (size_t)CONFIG_HEAP_TRACE_HASH_MAP_SIZE, total_hashmap_hits, total_hashmap_miss);
+        (size_t)(SHARD_HASH_MAP_SIZE * NUM_SHARDS), summary.total_hashmap_hits, summary.total_hashmap_miss);
 #endif // CONFIG_HEAP_TRACE_HASH_MAP
 
-    esp_rom_printf("total allocations: %"PRIu32"\n", total_allocations);
-    esp_rom_printf("total frees: %"PRIu32"\n", total_frees);
+    esp_rom_printf("total allocations: %"PRIu32"\n", summary.total_allocations);
+    esp_rom_printf("total frees: %"PRIu32"\n", summary.total_frees);
+    if (sample_period > 1) {
+        esp_rom_printf("sampling: 1 in %"PRIu32" allocations", sample_period);
+    } else if (sample_period == 0) {
+        esp_rom_printf("sampling: no allocations");
+    }
+    if (sample_period != 1) {
+        esp_rom_printf(", and allocations of at least %"PRIu32" bytes\n", sample_size_threshold);
+    }
 
-    if (start_count != records.count) { // only a problem if trace isn't stopped before dumping
+    if (start_count != heap_trace_get_count()) { // only a problem if trace isn't stopped before dumping
         esp_rom_printf("(NB: New entries were traced while dumping, so trace dump may have duplicate entries.)\n");
     }
-    if (records.has_overflowed) {
+    if (summary.has_overflowed) {
         esp_rom_printf("(NB: Internal Buffer has overflowed, so trace data is incomplete.)\n");
     }
     esp_rom_printf("================================\n");
 
-    portEXIT_CRITICAL(&trace_mux);
+    unlock_all_shards();
 }
 
 /* Add a new allocation to the heap trace records */
@@ -429,30 +583,34 @@ static HEAP_IRAM_ATTR void record_allocation(const heap_trace_record_t *r_alloca
         return;
     }
 
-    portENTER_CRITICAL(&trace_mux);
+    records_t *records = shard_of(r_allocation->address);
+    portENTER_CRITICAL(&records->mux);
 
     if (tracing) {
         // If buffer is full, pop off the oldest
         // record to make more space
-        if (records.count == records.capacity) {
+        if (records->count == records->capacity) {
 
-            records.has_overflowed = true;
+            records->has_overflowed = true;
 
-            heap_trace_record_t *r_first = TAILQ_FIRST(&records.list);
+            // with fewer records than shards, some shards have no record at all
+            if (records->count > 0) {
+                heap_trace_record_t *r_first = TAILQ_FIRST(&records->list);
 
-            // always remove from hashmap first since list_remove is setting address field
-            // of the record to 0x00
+                // always remove from hashmap first since list_remove is setting address field
+                // of the record to 0x00
 #if CONFIG_HEAP_TRACE_HASH_MAP
-            map_remove(r_first);
+                map_remove(records, r_first);
 #endif
-            list_remove(r_first);
+                list_remove(records, r_first);
+            }
         }
         // push onto end of list
-        list_add(r_allocation);
-        total_allocations++;
+        list_add(records, r_allocation);
+        records->total_allocations++;
     }
 
-    portEXIT_CRITICAL(&trace_mux);
+    portEXIT_CRITICAL(&records->mux);
 }
 
 /* record a free event in the heap trace log
@@ -469,21 +627,25 @@ static HEAP_IRAM_ATTR void record_free(void *p, void **callers)
         return;
     }
 
-    portENTER_CRITICAL(&trace_mux);
-    // return directly if records.count == 0. In case of hashmap being used
+    records_t *records = shard_of(p);
+    portENTER_CRITICAL(&records->mux);
+    if (tracing) {
+        // counted even if this shard has no record, the other shards may have some
+        records->total_frees++;
+    }
+
+    // return directly if records->count == 0. In case of hashmap being used
     // this prevents the hashmap to return an item that is no longer in the
     // records list.
-    if (records.count == 0) {
-        portEXIT_CRITICAL(&trace_mux);
+    if (records->count == 0) {
+        portEXIT_CRITICAL(&records->mux);
         return;
     }
 
     if (tracing) {
 
-        total_frees++;
-
         if (mode == HEAP_TRACE_ALL) {
-            heap_trace_record_t *r_found = list_find(p);
+            heap_trace_record_t *r_found = list_find(records, p);
             if (r_found != NULL) {
                 // add 'freed_by' info to the record
                 memcpy(r_found->freed_by, callers, sizeof(void *) * STACK_DEPTH);
@@ -491,63 +653,63 @@ static HEAP_IRAM_ATTR void record_free(void *p, void **callers)
         } else { // HEAP_TRACE_LEAKS
             // Leak trace mode, once an allocation is freed
             // we remove it from the list & hashmap
-            list_find_and_remove(p);
+            list_find_and_remove(records, p);
         }
     }
 
-    portEXIT_CRITICAL(&trace_mux);
+    portEXIT_CRITICAL(&records->mux);
 }
 
 // connect all records into a linked list of 'unused' records
-static void list_setup(void)
+static void list_setup(records_t *records)
 {
-    TAILQ_INIT(&records.list);
-    TAILQ_INIT(&records.unused);
+    TAILQ_INIT(&records->list);
+    TAILQ_INIT(&records->unused);
 
-    for (int i = 0; i < records.capacity; i++) {
+    for (int i = 0; i < records->capacity; i++) {
 
-        heap_trace_record_t *r_cur = &records.buffer[i];
+        heap_trace_record_t *r_cur = &records->buffer[i];
 
-        TAILQ_INSERT_TAIL(&records.unused, r_cur, tailq_list);
+        TAILQ_INSERT_TAIL(&records->unused, r_cur, tailq_list);
     }
 }
 
-/* 1. removes record r_remove from records.list,
-   2. places it into records.unused */
-static HEAP_IRAM_ATTR void list_remove(heap_trace_record_t* r_remove)
+/* 1. removes record r_remove from records->list,
+   2. places it into records->unused */
+static HEAP_IRAM_ATTR void list_remove(records_t *records, heap_trace_record_t* r_remove)
 {
-    assert(records.count > 0);
+    assert(records->count > 0);
 
-    // remove from records.list
-    TAILQ_REMOVE(&records.list, r_remove, tailq_list);
+    // remove from records->list
+    TAILQ_REMOVE(&records->list, r_remove, tailq_list);
 
     // set as unused
     r_remove->address = 0;
     r_remove->size = 0;
 
-    // add to records.unused
-    TAILQ_INSERT_HEAD(&records.unused, r_remove, tailq_list);
+    // add to records->unused
+    TAILQ_INSERT_HEAD(&records->unused, r_remove, tailq_list);
 
     // decrement
-    records.count--;
+    records->count--;
 }
 
 
 // pop record from unused list
-static HEAP_IRAM_ATTR heap_trace_record_t* list_pop_unused(void)
+static HEAP_IRAM_ATTR heap_trace_record_t* list_pop_unused(records_t *records)
 {
     // no records left?
-    if (records.count >= records.capacity) {
+    if (records->count >= records->capacity) {
         return NULL;
     }
 
-    // get from records.unused
-    heap_trace_record_t *r_unused = TAILQ_FIRST(&records.unused);
+    // get from records->unused
+    heap_trace_record_t *r_unused = TAILQ_FIRST(&records->unused);
     assert(r_unused->address == NULL);
     assert(r_unused->size == 0);
 
-    // remove from records.unused
-    TAILQ_REMOVE(&records.unused, r_unused, tailq_list);
+    // remove from records->unused
+    TAILQ_REMOVE(&records->unused, r_unused, tailq_list);
 
     return r_unused;
 }
@@ -563,14 +725,14 @@ static HEAP_IRAM_ATTR void record_deep_copy(heap_trace_record_t *r_dest, const h
     memcpy(r_dest->alloced_by, r_src->alloced_by, sizeof(void *) * STACK_DEPTH);
 }
 
-// Append a record to records.list
+// Append a record to records->list
 // Note: This deep copies r_append
-static HEAP_IRAM_ATTR heap_trace_record_t* list_add(const heap_trace_record_t *r_append)
+static HEAP_IRAM_ATTR heap_trace_record_t* list_add(records_t *records, const heap_trace_record_t *r_append)
 {
-    if (records.count < records.capacity) {
+    if (records->count < records->capacity) {
 
         // get unused record
-        heap_trace_record_t *r_dest = list_pop_unused();
+        heap_trace_record_t *r_dest = list_pop_unused(records);
 
         // we checked that there is capacity, so this
         // should never be null.
@@ -579,46 +741,42 @@ static HEAP_IRAM_ATTR heap_trace_record_t* list_add(const heap_trace_record_t *r
         // copy allocation data
         record_deep_copy(r_dest, r_append);
 
-        // append to records.list
-        TAILQ_INSERT_TAIL(&records.list, r_dest, tailq_list);
+        // append to records->list
+        TAILQ_INSERT_TAIL(&records->list, r_dest, tailq_list);
 
         // increment
-        records.count++;
+        records->count++;
 
         // high water mark
-        if (records.count > records.high_water_mark) {
-            records.high_water_mark = records.count;
+        if (records->count > records->high_water_mark) {
+            records->high_water_mark = records->count;
         }
 
 #if CONFIG_HEAP_TRACE_HASH_MAP
-        map_add(r_dest);
+        map_add(records, r_dest);
 #endif
 
         return r_dest;
 
     } else {
-        records.has_overflowed = true;
+        records->has_overflowed = true;
         return NULL;
     }
 }
 
-// search records.list for the allocation record matching this address
-static HEAP_IRAM_ATTR heap_trace_record_t* list_find(void* p)
+// search records->list for the allocation record matching this address
+static HEAP_IRAM_ATTR heap_trace_record_t* list_find(records_t *records, void* p)
 {
-    heap_trace_record_t *r_found = NULL;
-
 #if CONFIG_HEAP_TRACE_HASH_MAP
-        // check the hashmap
-        r_found = map_find(p);
-
-        if (r_found != NULL) {
-            return r_found;
-        }
-#endif
-
-    // to the end of the list and most allocations are short lived.
+    // every record of the list is in the hashmap, so a miss means that
+    // the address is not traced and the list doesn't have to be searched.
+    // Most frees are misses when sampling allocations.
+    return map_find(records, p);
+#else
+    heap_trace_record_t *r_found = NULL;
     heap_trace_record_t *r_cur = NULL;
-    TAILQ_FOREACH(r_cur, &records.list, tailq_list) {
+    records->total_list_searches++;
+    TAILQ_FOREACH(r_cur, &records->list, tailq_list) {
         if (r_cur->address == p) {
             r_found = r_cur;
             break;
@@ -626,24 +784,26 @@ static HEAP_IRAM_ATTR heap_trace_record_t* list_find(void* p)
     }
 
     return r_found;
+#endif
 }
 
-static HEAP_IRAM_ATTR void list_find_and_remove(void* p)
+static HEAP_IRAM_ATTR void list_find_and_remove(records_t *records, void* p)
 {
 #if CONFIG_HEAP_TRACE_HASH_MAP
-    heap_trace_record_t *r_found = map_find_and_remove(p);
+    heap_trace_record_t *r_found = map_find_and_remove(records, p);
     if (r_found != NULL) {
-        list_remove(r_found);
-        return;
+        list_remove(records, r_found);
     }
-#endif
+#else
     heap_trace_record_t *r_cur = NULL;
-    TAILQ_FOREACH(r_cur, &records.list, tailq_list) {
+    records->total_list_searches++;
+    TAILQ_FOREACH(r_cur, &records->list, tailq_list) {
         if (r_cur->address == p) {
-            list_remove(r_cur);
+            list_remove(records, r_cur);
             break;
         }
     }
+#endif
 }
 
 #include "heap_trace.inc"
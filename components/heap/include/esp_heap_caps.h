@@ -278,6 +278,24 @@ esp_err_t heap_caps_monitor_local_minimum_free_size_stop(void);
  */
 void heap_caps_get_info( multi_heap_info_t *info, uint32_t caps );
 
+/**
+ * @brief Get fragmentation info for all regions with the given capabilities.
+ *
+ * Calls multi_heap_get_fragmentation_info() on all heaps which share the given capabilities, and adds up
+ * their free block and allocation size histograms. This tells why an allocation fails although enough memory
+ * is free: the free block histogram shows how many free blocks could hold an allocation of a given size.
+ *
+ * The fragmentation index is computed from the largest free block of all the matching heaps, so it is also
+ * above 0 when the free memory is spread in several heaps. Blocks held by the small object caches (see
+ * CONFIG_HEAP_SMALL_OBJECT_CACHE) are counted in ``total_free_bytes``, but not in the free block histograms.
+ *
+ * @param info        Pointer to a structure which will be filled with relevant
+ *                    heap fragmentation information.
+ * @param caps        Bitwise OR of MALLOC_CAP_* flags indicating the type
+ *                    of memory
+ */
+void heap_caps_get_fragmentation_info( multi_heap_frag_info_t *info, uint32_t caps );
+
 
 /**
  * @brief Print a summary of all memory with the given capabilities.
@@ -431,6 +449,18 @@ void heap_caps_dump(uint32_t caps);
  */
 void heap_caps_dump_all(void);
 
+/**
+ * @brief Free the blocks held by the small object caches of all cores to their heaps.
+ *
+ * When CONFIG_HEAP_SMALL_OBJECT_CACHE is enabled, the blocks of small allocations which are freed
+ * are kept in a cache of the current core, to be reused by the next allocations. They are
+ * reported as free memory, but heap_caps_dump() and heap walkers see them as allocated blocks.
+ * This function returns them to their heaps.
+ *
+ * Does nothing if CONFIG_HEAP_SMALL_OBJECT_CACHE is disabled.
+ */
+void heap_caps_flush_cache(void);
+
 /**
  * @brief Return the size that a particular pointer was allocated with.
  *
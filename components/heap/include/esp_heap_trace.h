@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -55,6 +55,7 @@ typedef struct {
     size_t capacity;                 ///< The capacity of the internal buffer
     size_t high_water_mark;          ///< The maximum value that 'count' got to
     size_t has_overflowed;           ///< True if the internal buffer overflowed at some point
+    size_t total_list_searches;      ///< The total number of times the records were searched one by one for a freed address
 #if CONFIG_HEAP_TRACE_HASH_MAP
     size_t total_hashmap_hits;       ///< If hashmap is used, the total number of hits
     size_t total_hashmap_miss;       ///< If hashmap is used, the total number of misses (possibly due to overflow)
@@ -182,6 +183,74 @@ void heap_trace_dump_caps(const uint32_t caps);
  */
 esp_err_t heap_trace_summary(heap_trace_summary_t *summary);
 
+/**
+ * @brief Trace only a sample of the heap allocations
+ *
+ * Recording every allocation, with its call stack, slows down the heap functions and
+ * fills the trace buffer quickly. With sampling, 1 in 'period' allocations is traced, as well
+ * as all the allocations of at least 'size_threshold' bytes. Frees are still traced, so that
+ * the records of the sampled allocations are updated.
+ *
+ * Sampling applies until this function is called again, heap_trace_set_sampling(1, 0) traces all
+ * the allocations again.
+ *
+ * @param period Trace 1 in 'period' allocations. 1 traces all the allocations, 0 only the allocations
+ * of at least 'size_threshold' bytes.
+ * @param size_threshold Always trace the allocations of at least this size. 0 to trace the allocations
+ * based on 'period' only.
+ * @return
+ * - ESP_ERR_NOT_SUPPORTED Project was compiled without heap tracing enabled in menuconfig.
+ * - ESP_ERR_INVALID_ARG Both 'period' and 'size_threshold' are 0.
+ * - ESP_OK Sampling configured.
+ */
+esp_err_t heap_trace_set_sampling(uint32_t period, size_t size_threshold);
+
+/** Magic value at the start of a binary heap trace dump, "HTRC" in little endian */
+#define HEAP_TRACE_BINARY_MAGIC   0x43525448
+/** Version of the binary heap trace dump format */
+#define HEAP_TRACE_BINARY_VERSION 1
+
+/**
+ * @brief Callback writing a part of a binary heap trace dump
+ *
+ * @param data Data to write
+ * @param size Size of the data, in bytes
+ * @param arg User argument passed to heap_trace_dump_binary()
+ * @return ESP_OK if the data was written, any other value to abort the dump.
+ */
+typedef esp_err_t (*heap_trace_write_cb_t)(const void *data, size_t size, void *arg);
+
+/**
+ * @brief Dump the heap trace records in a compact binary format
+ *
+ * The dump can be written to a file, or sent to a host, and decoded by
+ * components/heap/heap_trace_decode.py, which aggregates the records by call stack.
+ *
+ * All values are little endian 32-bit words. The dump starts with a header:
+ * - HEAP_TRACE_BINARY_MAGIC
+ * - HEAP_TRACE_BINARY_VERSION (bits 0-7), CONFIG_HEAP_TRACING_STACK_DEPTH (bits 8-15),
+ *   heap_trace_mode_t (bits 16-23), 1 if the buffer has overflowed (bits 24-31)
+ * - total number of allocations, total number of frees
+ * - sampling period and size threshold, see heap_trace_set_sampling()
+ *
+ * followed by one entry per record, until the end of the dump:
+ * - address, size, ccount
+ * - number of callers in the allocation call stack (bits 0-7) and in the free call stack (bits 8-15)
+ * - allocation callers, then free callers
+ *
+ * @note The callback is called with no lock held and may allocate memory, but tracing should be
+ * stopped first so that the dumped records are consistent.
+ *
+ * @param write_cb Callback called for each part of the dump
+ * @param arg User argument passed to the callback
+ * @return
+ * - ESP_ERR_NOT_SUPPORTED Project was compiled without standalone heap tracing enabled in menuconfig.
+ * - ESP_ERR_INVALID_ARG write_cb is NULL.
+ * - ESP_ERR_INVALID_STATE Heap tracing was not initialised.
+ * - ESP_OK The whole dump was written, otherwise the error returned by the callback.
+ */
+esp_err_t heap_trace_dump_binary(heap_trace_write_cb_t write_cb, void *arg);
+
 #ifdef __cplusplus
 }
 #endif
@@ -179,6 +179,67 @@ typedef struct {
  */
 void multi_heap_get_info(multi_heap_handle_t heap, multi_heap_info_t *info);
 
+/** @brief Number of size classes of the histograms of multi_heap_frag_info_t
+ *
+ * Size class 0 holds the sizes up to 31 bytes, size class i (1 to 14) the sizes from 2^(i+4) to 2^(i+5) - 1 bytes,
+ * and size class 15 the sizes of 512 KB and more.
+ */
+#define MULTI_HEAP_HISTOGRAM_SIZE 16
+
+/**
+ * @brief Return the histogram size class of a block or allocation size
+ *
+ * @param size Size in bytes
+ * @return Size class, from 0 to MULTI_HEAP_HISTOGRAM_SIZE - 1.
+ */
+static inline size_t multi_heap_histogram_class(size_t size)
+{
+    /* Index of the most significant bit, the size classes start at 2^5 bytes */
+    int msb = 31 - __builtin_clz((uint32_t)size | 1);
+    if (msb < 5) {
+        return 0;
+    }
+    return (msb - 4 < MULTI_HEAP_HISTOGRAM_SIZE) ? msb - 4 : MULTI_HEAP_HISTOGRAM_SIZE - 1;
+}
+
+/** @brief Structure to access heap fragmentation information via multi_heap_get_fragmentation_info */
+typedef struct {
+    size_t total_free_bytes;      ///<  Total free bytes in the heap. Equivalent to multi_free_heap_size().
+    size_t largest_free_block;    ///<  Size of the largest free block in the heap. This is the largest malloc-able size.
+    size_t free_blocks;           ///<  Number of free blocks in the heap.
+    size_t free_block_count[MULTI_HEAP_HISTOGRAM_SIZE]; ///< Number of free blocks, per size class (see multi_heap_histogram_class()).
+    size_t free_block_bytes[MULTI_HEAP_HISTOGRAM_SIZE]; ///< Total size of the free blocks, per size class.
+    size_t alloc_count[MULTI_HEAP_HISTOGRAM_SIZE];      ///< Number of successful allocations, per requested size class. Only counted if CONFIG_HEAP_ALLOC_SIZE_HISTOGRAM is enabled.
+    size_t alloc_failures[MULTI_HEAP_HISTOGRAM_SIZE];   ///< Number of failed allocations, per requested size class. Only counted if CONFIG_HEAP_ALLOC_SIZE_HISTOGRAM is enabled.
+    uint32_t fragmentation_index; ///<  0 to 100, how much the free memory is split in small blocks: 100 * (1 - largest_free_block / total_free_bytes).
+} multi_heap_frag_info_t;
+
+/** @brief Return fragmentation information about a given heap
+ *
+ * Walks the free blocks of the heap to build the histogram of their sizes, which
+ * tells which allocation sizes can still succeed. The heap is locked during the walk.
+ *
+ * @param heap Handle to a registered heap.
+ * @param info Pointer to a structure to fill with heap fragmentation information.
+ */
+void multi_heap_get_fragmentation_info(multi_heap_handle_t heap, multi_heap_frag_info_t *info);
+
+/**
+ * @brief Compute the fragmentation index of a heap, or of several heaps
+ *
+ * @param largest_free_block Size of the largest free block
+ * @param total_free_bytes Total free bytes
+ * @return 0 if the free memory is a single block (or if there is no free memory), up to 100 as
+ * the free memory gets split in many small blocks.
+ */
+static inline uint32_t multi_heap_fragmentation_index(size_t largest_free_block, size_t total_free_bytes)
+{
+    if (total_free_bytes == 0 || largest_free_block >= total_free_bytes) {
+        return 0;
+    }
+    return 100 - (uint32_t)((uint64_t)largest_free_block * 100 / total_free_bytes);
+}
+
 /**
  * @brief Perform an aligned allocation from the provided offset
  *
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -34,6 +34,10 @@ void *multi_heap_aligned_alloc_offs(multi_heap_handle_t heap, size_t size, size_
     return multi_heap_aligned_alloc_impl_offs(heap, size, alignment, offset);
 }
 
+/* Not provided by the ROM, implemented in this file for both the ROM and the IDF TLSF */
+void multi_heap_get_fragmentation_info(multi_heap_handle_t heap, multi_heap_frag_info_t *info)
+    __attribute__((alias("multi_heap_get_fragmentation_info_impl")));
+
 #if (!defined CONFIG_HEAP_TLSF_USE_ROM_IMPL)
 /* if no heap poisoning, public API aliases directly to these implementations */
 void *multi_heap_malloc(multi_heap_handle_t heap, size_t size)
@@ -83,10 +87,48 @@ typedef struct multi_heap_info {
     size_t minimum_free_bytes;
     size_t pool_size;
     void* heap_data;
+#if CONFIG_HEAP_ALLOC_SIZE_HISTOGRAM
+    size_t alloc_count[MULTI_HEAP_HISTOGRAM_SIZE];
+    size_t alloc_failures[MULTI_HEAP_HISTOGRAM_SIZE];
+#endif
 } heap_t;
 
+/* Count an allocation in the allocation size histogram. Called with the heap locked. */
+static inline __attribute__((always_inline)) void count_allocation(heap_t *heap, size_t size, const void *result)
+{
+#if CONFIG_HEAP_ALLOC_SIZE_HISTOGRAM
+    if (result != NULL) {
+        heap->alloc_count[multi_heap_histogram_class(size)]++;
+    } else {
+        heap->alloc_failures[multi_heap_histogram_class(size)]++;
+    }
+#endif
+}
+
+__attribute__((noinline)) static void multi_heap_get_fragmentation_info_tlsf(void* ptr, size_t size, int used, void* user)
+{
+    multi_heap_frag_info_t *info = user;
+
+    if(!used) {
+        size_t size_class = multi_heap_histogram_class(size);
+        info->free_block_count[size_class]++;
+        info->free_block_bytes[size_class] += size;
+        info->free_blocks++;
+
+        if(size > info->largest_free_block) {
+            info->largest_free_block = size;
+        }
+    }
+}
+
 #if CONFIG_HEAP_TLSF_USE_ROM_IMPL
 
+/* Provided by the TLSF implementation in ROM */
+typedef void* pool_t;
+typedef void (*tlsf_walker)(void* ptr, size_t size, int used, void* user);
+void tlsf_walk_pool(pool_t pool, tlsf_walker walker, void* user);
+pool_t tlsf_get_pool(void* tlsf);
+
 void _multi_heap_lock(void *lock)
 {
     MULTI_HEAP_LOCK(lock);
@@ -107,6 +149,23 @@ void multi_heap_in_rom_init(void)
     multi_heap_os_funcs_init(&multi_heap_os_funcs);
 }
 
+/* The ROM doesn't provide tlsf_fit_size(), the largest free block is the size of the block */
+void multi_heap_get_fragmentation_info_impl(multi_heap_handle_t heap, multi_heap_frag_info_t *info)
+{
+    memset(info, 0, sizeof(multi_heap_frag_info_t));
+
+    if (heap == NULL) {
+        return;
+    }
+
+    multi_heap_internal_lock(heap);
+    tlsf_walk_pool(tlsf_get_pool(heap->heap_data), multi_heap_get_fragmentation_info_tlsf, info);
+    info->total_free_bytes = heap->free_bytes;
+    multi_heap_internal_unlock(heap);
+
+    info->fragmentation_index = multi_heap_fragmentation_index(info->largest_free_block, info->total_free_bytes);
+}
+
 #else // CONFIG_HEAP_TLSF_USE_ROM_IMPL
 
 /* Check a block is valid for this heap. Used to verify parameters. */
@@ -153,6 +212,10 @@ multi_heap_handle_t multi_heap_register_impl(void *start_ptr, size_t size)
     result->free_bytes = size - tlsf_size(result->heap_data);
     result->pool_size = size;
     result->minimum_free_bytes = result->free_bytes;
+#if CONFIG_HEAP_ALLOC_SIZE_HISTOGRAM
+    memset(result->alloc_count, 0, sizeof(result->alloc_count));
+    memset(result->alloc_failures, 0, sizeof(result->alloc_failures));
+#endif
     return result;
 }
 
@@ -216,6 +279,7 @@ void *multi_heap_malloc_impl(multi_heap_handle_t heap, size_t size)
             heap->minimum_free_bytes = heap->free_bytes;
         }
     }
+    count_allocation(heap, size, result);
     multi_heap_internal_unlock(heap);
 
     return result;
@@ -262,6 +326,9 @@ void *multi_heap_realloc_impl(multi_heap_handle_t heap, void *p, size_t size)
             heap->minimum_free_bytes = heap->free_bytes;
         }
     }
+    if (size != 0) {
+        count_allocation(heap, size, result);
+    }
 
     multi_heap_internal_unlock(heap);
 
@@ -292,6 +359,7 @@ void *multi_heap_aligned_alloc_impl_offs(multi_heap_handle_t heap, size_t size,
             heap->minimum_free_bytes = heap->free_bytes;
         }
     }
+    count_allocation(heap, size, result);
     multi_heap_internal_unlock(heap);
 
     return result;
@@ -431,6 +499,27 @@ void multi_heap_get_info_impl(multi_heap_handle_t heap, multi_heap_info_t *info)
     multi_heap_internal_unlock(heap);
 }
 
+void multi_heap_get_fragmentation_info_impl(multi_heap_handle_t heap, multi_heap_frag_info_t *info)
+{
+    memset(info, 0, sizeof(multi_heap_frag_info_t));
+
+    if (heap == NULL) {
+        return;
+    }
+
+    multi_heap_internal_lock(heap);
+    tlsf_walk_pool(tlsf_get_pool(heap->heap_data), multi_heap_get_fragmentation_info_tlsf, info);
+    info->total_free_bytes = heap->free_bytes;
+    info->largest_free_block = tlsf_fit_size(heap->heap_data, info->largest_free_block);
+#if CONFIG_HEAP_ALLOC_SIZE_HISTOGRAM
+    memcpy(info->alloc_count, heap->alloc_count, sizeof(info->alloc_count));
+    memcpy(info->alloc_failures, heap->alloc_failures, sizeof(info->alloc_failures));
+#endif
+    multi_heap_internal_unlock(heap);
+
+    info->fragmentation_index = multi_heap_fragmentation_index(info->largest_free_block, info->total_free_bytes);
+}
+
 #endif // CONFIG_HEAP_TLSF_USE_ROM_IMPL
 
 size_t multi_heap_reset_minimum_free_bytes(multi_heap_handle_t heap)
@@ -398,6 +398,15 @@ void multi_heap_get_info(multi_heap_handle_t heap, multi_heap_info_t *info)
     subtract_poison_overhead(&info->minimum_free_bytes);
 }
 
+void multi_heap_get_fragmentation_info(multi_heap_handle_t heap, multi_heap_frag_info_t *info)
+{
+    multi_heap_get_fragmentation_info_impl(heap, info);
+    /* same as multi_heap_get_info(), the free block histograms are left as is */
+    subtract_poison_overhead(&info->largest_free_block);
+    subtract_poison_overhead(&info->total_free_bytes);
+    info->fragmentation_index = multi_heap_fragmentation_index(info->largest_free_block, info->total_free_bytes);
+}
+
 size_t multi_heap_free_size(multi_heap_handle_t heap)
 {
     size_t r = multi_heap_free_size_impl(heap);
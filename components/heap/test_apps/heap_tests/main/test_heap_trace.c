@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2022-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Unlicense OR CC0-1.0
  */
@@ -26,6 +26,14 @@
 
 #include "esp_heap_trace.h"
 
+#ifdef CONFIG_HEAP_TRACE_RECORD_SHARDS
+#define RECORD_SHARDS CONFIG_HEAP_TRACE_RECORD_SHARDS
+#else
+#define RECORD_SHARDS 1
+#endif
+
+#if RECORD_SHARDS == 1
+// with several shards, the records are not returned in allocation order
 TEST_CASE("heap trace leak check", "[heap-trace]")
 {
     heap_trace_record_t recs[8];
@@ -74,6 +82,7 @@ TEST_CASE("heap trace leak check", "[heap-trace]")
 
     heap_trace_stop();
 }
+#endif // RECORD_SHARDS == 1
 
 TEST_CASE("heap trace wrapped buffer check", "[heap-trace]")
 {
@@ -189,7 +198,12 @@ TEST_CASE("check for summary value validity", "[heap-trace]") {
     // check that the summary shows the right number of internal memory allocation count
     heap_trace_summary_t summary;
     heap_trace_summary(&summary);
+#if RECORD_SHARDS == 1
     TEST_ASSERT(summary.count == counter_size);
+#else
+    // the allocations may not be spread evenly between the shards
+    TEST_ASSERT(summary.count <= counter_size);
+#endif
     TEST_ASSERT(summary.capacity == counter_size);
     TEST_ASSERT(summary.total_allocations == ptr_array_size);
     TEST_ASSERT(summary.has_overflowed == true);
@@ -205,6 +219,200 @@ TEST_CASE("check for summary value validity", "[heap-trace]") {
     heap_trace_stop();
 }
 
+typedef struct {
+    uint8_t data[2048];
+    size_t len;
+} dump_buffer_t;
+
+static esp_err_t write_to_buffer(const void *data, size_t size, void *arg)
+{
+    dump_buffer_t *dump = (dump_buffer_t *)arg;
+    if (dump->len + size > sizeof(dump->data)) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(dump->data + dump->len, data, size);
+    dump->len += size;
+    return ESP_OK;
+}
+
+TEST_CASE("heap trace sampling and binary dump", "[heap-trace]")
+{
+    const size_t N = 32;
+    const size_t large_size = 2000;
+    static heap_trace_record_t recs[64];
+    static dump_buffer_t dump;
+    void *ptrs[N];
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, heap_trace_set_sampling(0, 0));
+    heap_trace_init_standalone(recs, 64);
+    TEST_ESP_OK(heap_trace_set_sampling(8, large_size));
+    heap_trace_start(HEAP_TRACE_LEAKS);
+
+    for (int i = 0; i < N; i++) {
+        ptrs[i] = heap_caps_malloc(i == 5 ? large_size : 16, MALLOC_CAP_INTERNAL);
+        TEST_ASSERT_NOT_NULL(ptrs[i]);
+    }
+
+    heap_trace_stop();
+
+    // 1 in 8 of the small allocations, and the large one, are traced
+    bool saw_large = false;
+    size_t traced = 0;
+    for (int i = 0; i < heap_trace_get_count(); i++) {
+        heap_trace_record_t rec;
+        TEST_ESP_OK(heap_trace_get(i, &rec));
+        for (int j = 0; j < N; j++) {
+            if (rec.address == ptrs[j]) {
+                traced++;
+                saw_large = saw_large || j == 5;
+            }
+        }
+    }
+    TEST_ASSERT(saw_large);
+    TEST_ASSERT_GREATER_OR_EQUAL(2, traced);
+    TEST_ASSERT_LESS_OR_EQUAL(1 + N / 8, traced);
+
+    dump.len = 0;
+    TEST_ESP_OK(heap_trace_dump_binary(write_to_buffer, &dump));
+    uint32_t header[6];
+    TEST_ASSERT_GREATER_OR_EQUAL(sizeof(header), dump.len);
+    memcpy(header, dump.data, sizeof(header));
+    TEST_ASSERT_EQUAL_HEX32(HEAP_TRACE_BINARY_MAGIC, header[0]);
+    TEST_ASSERT_EQUAL(HEAP_TRACE_BINARY_VERSION, header[1] & 0xff);
+    TEST_ASSERT_EQUAL(CONFIG_HEAP_TRACING_STACK_DEPTH, (header[1] >> 8) & 0xff);
+    TEST_ASSERT_EQUAL(HEAP_TRACE_LEAKS, (header[1] >> 16) & 0xff);
+    TEST_ASSERT_EQUAL(8, header[4]);
+    TEST_ASSERT_EQUAL(large_size, header[5]);
+
+    // Walk the records of the dump
+    size_t pos = sizeof(header);
+    size_t records = 0;
+    saw_large = false;
+    while (pos < dump.len) {
+        uint32_t entry[4];
+        memcpy(entry, dump.data + pos, sizeof(entry));
+        saw_large = saw_large || ((void *)entry[0] == ptrs[5] && entry[1] == large_size);
+        pos += sizeof(entry) + sizeof(uint32_t) * ((entry[3] & 0xff) + ((entry[3] >> 8) & 0xff));
+        records++;
+    }
+    TEST_ASSERT_EQUAL(dump.len, pos);
+    TEST_ASSERT_EQUAL(heap_trace_get_count(), records);
+    TEST_ASSERT(saw_large);
+
+    for (int i = 0; i < N; i++) {
+        heap_caps_free(ptrs[i]);
+    }
+    TEST_ESP_OK(heap_trace_set_sampling(1, 0));
+}
+
+#if RECORD_SHARDS > 1
+TEST_CASE("heap trace records are split between the shards", "[heap-trace]")
+{
+    const size_t N = 16 * RECORD_SHARDS;
+    static heap_trace_record_t recs[16 * RECORD_SHARDS];
+    void *ptrs[N / 2];
+
+    heap_trace_init_standalone(recs, N);
+    heap_trace_start(HEAP_TRACE_LEAKS);
+    for (int i = 0; i < N / 2; i++) {
+        ptrs[i] = heap_caps_malloc(16 + i, MALLOC_CAP_INTERNAL);
+        TEST_ASSERT_NOT_NULL(ptrs[i]);
+    }
+
+    // every allocation is found once, whatever its shard
+    heap_trace_summary_t summary;
+    heap_trace_summary(&summary);
+    TEST_ASSERT_EQUAL(N, summary.capacity);
+    TEST_ASSERT_FALSE(summary.has_overflowed);
+    for (int i = 0; i < N / 2; i++) {
+        size_t found = 0;
+        for (int j = 0; j < heap_trace_get_count(); j++) {
+            heap_trace_record_t rec;
+            TEST_ESP_OK(heap_trace_get(j, &rec));
+            if (rec.address == ptrs[i]) {
+                TEST_ASSERT_EQUAL(16 + i, rec.size);
+                found++;
+            }
+        }
+        TEST_ASSERT_EQUAL(1, found);
+    }
+
+    // the records of the freed allocations are removed from their shards
+    for (int i = 0; i < N / 2; i += 2) {
+        heap_caps_free(ptrs[i]);
+    }
+    for (int j = 0; j < heap_trace_get_count(); j++) {
+        heap_trace_record_t rec;
+        TEST_ESP_OK(heap_trace_get(j, &rec));
+        for (int i = 0; i < N / 2; i += 2) {
+            TEST_ASSERT_NOT_EQUAL(ptrs[i], rec.address);
+        }
+    }
+    heap_trace_stop();
+
+    for (int i = 1; i < N / 2; i += 2) {
+        heap_caps_free(ptrs[i]);
+    }
+}
+#endif // RECORD_SHARDS > 1
+
+#if CONFIG_HEAP_TRACE_HASH_MAP
+TEST_CASE("heap trace frees of untraced allocations only look up the hash map", "[heap-trace]")
+{
+    const size_t N = 2 * RECORD_SHARDS;
+    const size_t M = 16;
+    static heap_trace_record_t recs[2 * RECORD_SHARDS];
+    static void *traced[64 * RECORD_SHARDS];
+    void *untraced[M];
+    size_t traced_count = 0;
+
+    heap_trace_init_standalone(recs, N);
+    heap_trace_start(HEAP_TRACE_LEAKS);
+
+    // fill every shard of the record store
+    while (heap_trace_get_count() < N) {
+        TEST_ASSERT_LESS_THAN(sizeof(traced) / sizeof(traced[0]), traced_count);
+        traced[traced_count] = heap_caps_malloc(16, MALLOC_CAP_INTERNAL);
+        TEST_ASSERT_NOT_NULL(traced[traced_count]);
+        traced_count++;
+    }
+
+    // then stop sampling the allocations
+    TEST_ESP_OK(heap_trace_set_sampling(0, SIZE_MAX));
+    for (int i = 0; i < M; i++) {
+        untraced[i] = heap_caps_malloc(16, MALLOC_CAP_INTERNAL);
+        TEST_ASSERT_NOT_NULL(untraced[i]);
+    }
+
+    heap_trace_summary_t before, after;
+    heap_trace_summary(&before);
+    TEST_ASSERT_EQUAL(N, before.count);
+
+    // each free is a single hash map lookup, which misses, and the records are neither searched nor changed
+    for (int i = 0; i < M; i++) {
+        heap_caps_free(untraced[i]);
+    }
+    heap_trace_summary(&after);
+    TEST_ASSERT_EQUAL(N, after.count);
+    TEST_ASSERT_EQUAL(0, after.total_list_searches);
+    TEST_ASSERT_EQUAL(before.total_hashmap_hits, after.total_hashmap_hits);
+    TEST_ASSERT_EQUAL(before.total_hashmap_miss + M, after.total_hashmap_miss);
+
+    // the allocations still recorded are hits, the ones dropped when the store was full are misses
+    for (int i = 0; i < traced_count; i++) {
+        heap_caps_free(traced[i]);
+    }
+    heap_trace_summary(&before);
+    TEST_ASSERT_EQUAL(0, before.count);
+    TEST_ASSERT_EQUAL(0, before.total_list_searches);
+    TEST_ASSERT_EQUAL(after.total_hashmap_hits + N, before.total_hashmap_hits);
+    TEST_ASSERT_EQUAL(after.total_hashmap_miss + traced_count - N, before.total_hashmap_miss);
+
+    heap_trace_stop();
+    TEST_ESP_OK(heap_trace_set_sampling(1, 0));
+}
+#endif // CONFIG_HEAP_TRACE_HASH_MAP
+
 #ifdef CONFIG_SPIRAM
 void* allocate_pointer(uint32_t caps)
 {
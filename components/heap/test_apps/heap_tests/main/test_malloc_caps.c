@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2022-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Unlicense OR CC0-1.0
  */
@@ -171,6 +171,44 @@ TEST_CASE("heap_caps metadata test", "[heap]")
     TEST_ASSERT(after.minimum_free_bytes < original.total_free_bytes);
 }
 
+TEST_CASE("heap caps fragmentation info", "[heap]")
+{
+    /* need to print something as first printf allocates some heap */
+    printf("heap caps fragmentation info\n");
+
+    const uint32_t caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+    const size_t block_size = 1000;
+    void *blocks[8];
+    for (int i = 0; i < sizeof(blocks) / sizeof(blocks[0]); i++) {
+        blocks[i] = heap_caps_malloc(block_size, caps);
+        TEST_ASSERT_NOT_NULL(blocks[i]);
+    }
+    /* every other block is freed, the ones in between keep them apart */
+    for (int i = 0; i < sizeof(blocks) / sizeof(blocks[0]); i += 2) {
+        heap_caps_free(blocks[i]);
+    }
+
+    multi_heap_frag_info_t info;
+    heap_caps_get_fragmentation_info(&info, caps);
+
+    size_t free_blocks = 0;
+    size_t free_block_bytes = 0;
+    for (int i = 0; i < MULTI_HEAP_HISTOGRAM_SIZE; i++) {
+        free_blocks += info.free_block_count[i];
+        free_block_bytes += info.free_block_bytes[i];
+    }
+    TEST_ASSERT_EQUAL(info.free_blocks, free_blocks);
+    TEST_ASSERT(free_block_bytes <= info.total_free_bytes);
+    TEST_ASSERT(info.largest_free_block <= info.total_free_bytes);
+    TEST_ASSERT(info.fragmentation_index <= 100);
+    TEST_ASSERT(info.free_blocks >= 3);
+    TEST_ASSERT(info.free_block_count[multi_heap_histogram_class(block_size)] >= 3);
+
+    for (int i = 1; i < sizeof(blocks) / sizeof(blocks[0]); i += 2) {
+        heap_caps_free(blocks[i]);
+    }
+}
+
 TEST_CASE("heap caps minimum free bytes monitoring", "[heap]")
 {
     printf("heap caps minimum free bytes monitoring local minimum\n");
@@ -0,0 +1,163 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "unity.h"
+#include "esp_heap_caps.h"
+#include "esp_cpu.h"
+#include "esp_memory_utils.h"
+#include "sdkconfig.h"
+
+#if CONFIG_HEAP_SMALL_OBJECT_CACHE
+
+#define NUM_POINTERS 64
+
+TEST_CASE("small object cache blocks are reported as free memory", "[heap][small_object_cache]")
+{
+    heap_caps_flush_cache();
+    size_t free_before = heap_caps_get_free_size(MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
+    multi_heap_info_t info_before;
+    heap_caps_get_info(&info_before, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
+
+    void *p[NUM_POINTERS];
+    for (int i = 0; i < NUM_POINTERS; i++) {
+        p[i] = malloc(8 + i % 56);
+        TEST_ASSERT_NOT_NULL(p[i]);
+        memset(p[i], 0xA5, 8 + i % 56);
+    }
+    TEST_ASSERT_LESS_THAN(free_before, heap_caps_get_free_size(MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL));
+    for (int i = 0; i < NUM_POINTERS; i++) {
+        free(p[i]);
+    }
+
+    // The freed blocks are cached, but count as free
+    size_t free_after = heap_caps_get_free_size(MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
+    multi_heap_info_t info_after;
+    heap_caps_get_info(&info_after, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
+    TEST_ASSERT_INT_WITHIN(64, free_before, free_after);
+    TEST_ASSERT_EQUAL(info_before.allocated_blocks, info_after.allocated_blocks);
+
+    heap_caps_flush_cache();
+    TEST_ASSERT_EQUAL(free_before, heap_caps_get_free_size(MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL));
+    TEST_ASSERT_TRUE(heap_caps_check_integrity_all(true));
+}
+
+TEST_CASE("small object cache serves blocks with the requested capabilities", "[heap][small_object_cache]")
+{
+    void *p = heap_caps_malloc(24, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    TEST_ASSERT_NOT_NULL(p);
+    TEST_ASSERT_TRUE(esp_ptr_internal(p));
+    TEST_ASSERT_GREATER_OR_EQUAL(24, heap_caps_get_allocated_size(p));
+    free(p);
+
+    // Reusing the block just freed
+    void *q = heap_caps_malloc(20, MALLOC_CAP_DEFAULT);
+    TEST_ASSERT_EQUAL_PTR(p, q);
+    free(q);
+
+    // Not served by the caches
+    p = heap_caps_malloc(16, MALLOC_CAP_DMA);
+    TEST_ASSERT_NOT_NULL(p);
+    TEST_ASSERT_TRUE(esp_ptr_dma_capable(p));
+    free(p);
+    p = heap_caps_malloc(128, MALLOC_CAP_DEFAULT);
+    TEST_ASSERT_NOT_NULL(p);
+    free(p);
+    heap_caps_flush_cache();
+}
+
+TEST_CASE("small object caches are flushed when memory runs out", "[heap][small_object_cache]")
+{
+    heap_caps_flush_cache();
+    size_t free_before = heap_caps_get_free_size(MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL);
+
+    // Fill the cache of each size class
+    void *p[NUM_POINTERS];
+    for (int i = 0; i < NUM_POINTERS; i++) {
+        p[i] = malloc(16 << (i % 3));
+        TEST_ASSERT_NOT_NULL(p[i]);
+    }
+    for (int i = 0; i < NUM_POINTERS; i++) {
+        free(p[i]);
+    }
+
+    // Allocate all the internal memory in blocks too big for the caches, the last ones
+    // can only be allocated once the cached blocks are freed to their heaps
+    void **blocks = NULL;
+    void **block;
+    while ((block = heap_caps_malloc(96, MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL)) != NULL) {
+        *block = blocks;
+        blocks = block;
+    }
+    TEST_ASSERT_LESS_THAN(96, heap_caps_get_largest_free_block(MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL));
+
+    while (blocks != NULL) {
+        void **next = *blocks;
+        free(blocks);
+        blocks = next;
+    }
+    heap_caps_flush_cache();
+    TEST_ASSERT_EQUAL(free_before, heap_caps_get_free_size(MALLOC_CAP_8BIT | MALLOC_CAP_INTERNAL));
+}
+
+#if !CONFIG_FREERTOS_UNICORE
+
+#define ITERATIONS 20000
+
+typedef struct {
+    SemaphoreHandle_t done;
+    uint32_t cycles;
+    bool ok;
+} alloc_task_arg_t;
+
+static void alloc_task(void *arg)
+{
+    alloc_task_arg_t *task_arg = arg;
+    void *p[8] = { 0 };
+    uint32_t start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < ITERATIONS; i++) {
+        int n = i % 8;
+        free(p[n]);
+        p[n] = malloc(4 + (i * 7) % 60);
+        if (p[n] == NULL) {
+            break;
+        }
+        memset(p[n], n, 4);
+    }
+    task_arg->cycles = esp_cpu_get_cycle_count() - start;
+    task_arg->ok = true;
+    for (int n = 0; n < 8; n++) {
+        task_arg->ok = task_arg->ok && p[n] != NULL && *(uint8_t *)p[n] == n;
+        free(p[n]);
+    }
+    xSemaphoreGive(task_arg->done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("small object cache allocations from both cores", "[heap][small_object_cache]")
+{
+    alloc_task_arg_t args[portNUM_PROCESSORS];
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        args[core].done = xSemaphoreCreateBinary();
+        TEST_ASSERT_NOT_NULL(args[core].done);
+        xTaskCreatePinnedToCore(alloc_task, "alloc", 4096, &args[core], uxTaskPriorityGet(NULL) + 1, NULL, core);
+    }
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        TEST_ASSERT_TRUE(xSemaphoreTake(args[core].done, pdMS_TO_TICKS(10000)));
+        vSemaphoreDelete(args[core].done);
+        TEST_ASSERT_TRUE(args[core].ok);
+        printf("core %d: %"PRIu32" cycles per malloc/free\n", core, args[core].cycles / ITERATIONS);
+    }
+    heap_caps_flush_cache();
+    TEST_ASSERT_TRUE(heap_caps_check_integrity_all(true));
+}
+
+#endif // !CONFIG_FREERTOS_UNICORE
+
+#endif // CONFIG_HEAP_SMALL_OBJECT_CACHE
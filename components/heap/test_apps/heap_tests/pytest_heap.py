@@ -1,4 +1,4 @@
-# SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+# SPDX-FileCopyrightText: 2022-2024 Espressif Systems (Shanghai) CO LTD
 # SPDX-License-Identifier: CC0-1.0
 
 import pytest
@@ -50,6 +50,20 @@ def test_heap_in_flash(dut: Dut) -> None:
     dut.run_all_single_board_cases()
 
 
+@pytest.mark.generic
+@pytest.mark.esp32c2
+@pytest.mark.esp32c6
+@pytest.mark.esp32h2
+@pytest.mark.parametrize(
+    'config',
+    [
+        'rom_tlsf'
+    ]
+)
+def test_heap_rom_tlsf(dut: Dut) -> None:
+    dut.run_all_single_board_cases()
+
+
 @pytest.mark.generic
 @pytest.mark.esp32
 @pytest.mark.esp32s2
@@ -58,7 +72,8 @@ def test_heap_in_flash(dut: Dut) -> None:
     'config',
     [
         'psram',
-        'psram_all_ext'
+        'psram_all_ext',
+        'small_object_cache'
     ]
 )
 def test_heap(dut: Dut) -> None:
@@ -93,7 +108,8 @@ def test_heap_misc_options(dut: Dut) -> None:
     'config',
     [
         'heap_trace',
-        'heap_trace_hashmap'
+        'heap_trace_hashmap',
+        'heap_trace_sharded'
     ]
 )
 def test_heap_trace_dump(dut: Dut) -> None:
@@ -0,0 +1,131 @@
+#!/usr/bin/env python
+# SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+import io
+import struct
+import subprocess
+import sys
+import unittest
+from typing import Sequence
+
+try:
+    import heap_trace_decode
+except ImportError:
+    sys.path.append('..')
+    import heap_trace_decode
+
+
+'''
+To run the test on local PC:
+cd ~/esp/esp-idf/components/heap/test_heap_trace_decode_host/
+ ./heap_trace_decode_tests.py
+'''
+
+HEAP_TRACE_LEAKS = 1
+
+
+def make_header(mode: int = HEAP_TRACE_LEAKS, stack_depth: int = 2, overflowed: bool = False, total_allocations: int = 0,
+                total_frees: int = 0, sample_period: int = 1, sample_size_threshold: int = 0) -> bytes:
+    flags = heap_trace_decode.HEAP_TRACE_BINARY_VERSION | (stack_depth << 8) | (mode << 16) | (int(overflowed) << 24)
+    return heap_trace_decode.HEADER.pack(heap_trace_decode.HEAP_TRACE_BINARY_MAGIC, flags, total_allocations, total_frees,
+                                         sample_period, sample_size_threshold)
+
+
+def make_record(address: int, size: int, alloced_by: Sequence[int], freed_by: Sequence[int] = (), ccount: int = 0) -> bytes:
+    depths = len(alloced_by) | (len(freed_by) << 8)
+    callers = list(alloced_by) + list(freed_by)
+    return heap_trace_decode.RECORD.pack(address, size, ccount, depths) + struct.pack('<{}I'.format(len(callers)), *callers)
+
+
+class ReadDumpTests(unittest.TestCase):
+
+    def test_header(self) -> None:
+        header, records = heap_trace_decode.read_dump(io.BytesIO(make_header(mode=0, stack_depth=4, overflowed=True, total_allocations=10,
+                                                                             total_frees=3, sample_period=8, sample_size_threshold=1000)))
+        self.assertEqual(header.mode, 0)
+        self.assertEqual(header.stack_depth, 4)
+        self.assertTrue(header.has_overflowed)
+        self.assertEqual(header.total_allocations, 10)
+        self.assertEqual(header.total_frees, 3)
+        self.assertEqual(header.sample_period, 8)
+        self.assertEqual(header.sample_size_threshold, 1000)
+        self.assertEqual(records, [])
+
+    def test_records(self) -> None:
+        data = make_header() + make_record(0x3ffb0000, 16, (0x400d1000, 0x400d2000)) + \
+            make_record(0x3ffb0100, 32, (0x400d3000,), freed_by=(0x400d4000, 0x400d5000), ccount=1234)
+        _, records = heap_trace_decode.read_dump(io.BytesIO(data))
+        self.assertEqual(len(records), 2)
+        self.assertEqual(records[0].address, 0x3ffb0000)
+        self.assertEqual(records[0].size, 16)
+        self.assertEqual(records[0].alloced_by, (0x400d1000, 0x400d2000))
+        self.assertEqual(records[0].freed_by, ())
+        self.assertEqual(records[1].ccount, 1234)
+        self.assertEqual(records[1].alloced_by, (0x400d3000,))
+        self.assertEqual(records[1].freed_by, (0x400d4000, 0x400d5000))
+
+    def test_invalid_dumps(self) -> None:
+        with self.assertRaisesRegex(ValueError, 'too short'):
+            heap_trace_decode.read_dump(io.BytesIO(make_header()[:10]))
+        with self.assertRaisesRegex(ValueError, 'not a heap trace dump'):
+            heap_trace_decode.read_dump(io.BytesIO(b'\0' + make_header()[1:]))
+        bad_version = bytearray(make_header())
+        bad_version[4] = 99
+        with self.assertRaisesRegex(ValueError, 'unsupported dump version'):
+            heap_trace_decode.read_dump(io.BytesIO(bytes(bad_version)))
+        record = make_record(0x3ffb0000, 16, (0x400d1000, 0x400d2000))
+        # record cut in its callers, and in its fixed part
+        for length in (len(record) - 4, 8):
+            with self.assertRaisesRegex(ValueError, 'truncated record'):
+                heap_trace_decode.read_dump(io.BytesIO(make_header() + record[:length]))
+
+
+class AggregateTests(unittest.TestCase):
+
+    def aggregate(self, header: bytes, *records: bytes) -> dict:
+        return heap_trace_decode.aggregate(*heap_trace_decode.read_dump(io.BytesIO(header + b''.join(records))))
+
+    def test_group_by_call_stack(self) -> None:
+        stacks = self.aggregate(make_header(), make_record(0x1000, 16, (1, 2)), make_record(0x2000, 48, (1, 2)),
+                                make_record(0x3000, 8, (1, 3)))
+        self.assertEqual(len(stacks), 2)
+        self.assertEqual(stacks[(1, 2)].records, 2)
+        self.assertEqual(stacks[(1, 2)].bytes, 64)
+        self.assertEqual(stacks[(1, 2)].estimated_allocations, 2)
+        self.assertEqual(stacks[(1, 2)].estimated_bytes, 64)
+        self.assertEqual(stacks[(1, 3)].live_bytes, 8)
+
+    def test_sampling_weights(self) -> None:
+        # 1 in 8 small allocations are traced, allocations of at least 1000 bytes are always traced
+        stacks = self.aggregate(make_header(sample_period=8, sample_size_threshold=1000), make_record(0x1000, 16, (1,)),
+                                make_record(0x2000, 2000, (2,)))
+        self.assertEqual(stacks[(1,)].estimated_allocations, 8)
+        self.assertEqual(stacks[(1,)].estimated_bytes, 128)
+        self.assertEqual(stacks[(2,)].estimated_allocations, 1)
+        self.assertEqual(stacks[(2,)].estimated_bytes, 2000)
+
+    def test_live_records(self) -> None:
+        # in HEAP_TRACE_ALL mode, the freed allocations are kept with their freed_by call stack
+        stacks = self.aggregate(make_header(mode=heap_trace_decode.HEAP_TRACE_ALL), make_record(0x1000, 16, (1,)),
+                                make_record(0x2000, 32, (1,), freed_by=(5,)))
+        self.assertEqual(stacks[(1,)].records, 2)
+        self.assertEqual(stacks[(1,)].live_records, 1)
+        self.assertEqual(stacks[(1,)].live_bytes, 16)
+
+
+class CommandLineTests(unittest.TestCase):
+
+    def test_output(self) -> None:
+        data = make_header(total_allocations=3, total_frees=1, sample_period=4) + make_record(0x1000, 16, (0x400d1000,)) + \
+            make_record(0x2000, 100, (0x400d2000,)) + make_record(0x3000, 100, (0x400d2000,))
+        output = subprocess.run([sys.executable, heap_trace_decode.__file__, '--top', '1'], input=data, stdout=subprocess.PIPE,
+                                check=True).stdout.decode()
+        self.assertIn('3 records, 3 allocations and 1 frees traced (1 in 4 allocations), mode leaks', output)
+        # the largest call stack only
+        self.assertIn('800 bytes in 8 allocations (estimated), 2 records of 200 bytes', output)
+        self.assertIn('0x400d2000', output)
+        self.assertNotIn('0x400d1000', output)
+
+
+if __name__ == '__main__':
+    unittest.main()
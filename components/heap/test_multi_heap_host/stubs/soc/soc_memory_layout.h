@@ -0,0 +1,13 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * Host replacement of the memory layout header, for building heap_caps_lookup.c.
+ */
+#pragma once
+
+#define SOC_MEMORY_TYPE_NO_PRIOS 3
+#define SOC_MAX_CONTIGUOUS_RAM_SIZE 0x400000
@@ -0,0 +1,214 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "catch.hpp"
+#include "../heap_private.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+/* Same values as in esp_heap_caps.h, which can't be included on the host */
+#define MALLOC_CAP_EXEC             (1<<0)
+#define MALLOC_CAP_32BIT            (1<<1)
+#define MALLOC_CAP_8BIT             (1<<2)
+#define MALLOC_CAP_DMA              (1<<3)
+#define MALLOC_CAP_SPIRAM           (1<<10)
+#define MALLOC_CAP_INTERNAL         (1<<11)
+#define MALLOC_CAP_DEFAULT          (1<<12)
+#define MALLOC_CAP_RTCRAM           (1<<15)
+
+/* Registered heaps with the layout given to heap_caps_init(), and their lookup table */
+class TestHeaps {
+public:
+    explicit TestHeaps(size_t count) : heaps(count)
+    {
+        SLIST_INIT(&list);
+    }
+
+    heap_t *add(intptr_t start, intptr_t end, uint32_t caps0, uint32_t caps1, uint32_t caps2)
+    {
+        heap_t *heap = &heaps.at(added++);
+        heap->caps[0] = caps0;
+        heap->caps[1] = caps1;
+        heap->caps[2] = caps2;
+        heap->start = start;
+        heap->end = end;
+        heap->heap = (multi_heap_handle_t)heap;
+        SLIST_INSERT_HEAD(&list, heap, next);
+        return heap;
+    }
+
+    heap_caps_lookup_t *build()
+    {
+        buffer.assign(heap_caps_lookup_size(added), 0);
+        return heap_caps_lookup_build(buffer.data(), &list, added);
+    }
+
+    /* Reference implementations walking the list */
+    heap_t *find_linear(intptr_t p)
+    {
+        heap_t *heap;
+        SLIST_FOREACH(heap, &list, next) {
+            if (heap->heap != NULL && p >= heap->start && p < heap->end) {
+                return heap;
+            }
+        }
+        return NULL;
+    }
+
+    std::vector<heap_t *> candidates_linear(uint32_t caps)
+    {
+        std::vector<heap_t *> result;
+        for (int prio = 0; prio < SOC_MEMORY_TYPE_NO_PRIOS; prio++) {
+            heap_t *heap;
+            SLIST_FOREACH(heap, &list, next) {
+                if ((heap->caps[prio] & caps) != 0 && (get_all_caps(heap) & caps) == caps
+                        && std::find(result.begin(), result.end(), heap) == result.end()) {
+                    result.push_back(heap);
+                }
+            }
+        }
+        return result;
+    }
+
+    struct registered_heap_ll list;
+
+private:
+    std::vector<heap_t> heaps;
+    std::vector<uint8_t> buffer;
+    size_t added = 0;
+};
+
+static const uint32_t DRAM_CAPS[] = { MALLOC_CAP_8BIT | MALLOC_CAP_DEFAULT, MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA, MALLOC_CAP_32BIT };
+static const uint32_t IRAM_CAPS[] = { MALLOC_CAP_EXEC | MALLOC_CAP_32BIT | MALLOC_CAP_INTERNAL, 0, 0 };
+static const uint32_t PSRAM_CAPS[] = { MALLOC_CAP_SPIRAM, 0, MALLOC_CAP_8BIT | MALLOC_CAP_32BIT | MALLOC_CAP_DEFAULT };
+
+/* Heaps of a chip with several internal RAM regions and PSRAM, registered in a different order than their addresses */
+static void add_chip_heaps(TestHeaps &heaps, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        intptr_t start = 0x3f800000 + ((i * 7) % count) * 0x10000;
+        const uint32_t *caps = (i % 3 == 0) ? DRAM_CAPS : (i % 3 == 1) ? IRAM_CAPS : PSRAM_CAPS;
+        heaps.add(start, start + 0x8000, caps[0], caps[1], caps[2]);
+    }
+}
+
+TEST_CASE("heap_caps lookup finds the containing heap", "[heap_caps_lookup]")
+{
+    TestHeaps heaps(16);
+    add_chip_heaps(heaps, 12);
+    heap_t *outer = heaps.add(0x40000000, 0x40010000, MALLOC_CAP_8BIT, 0, 0);
+    heap_t *nested = heaps.add(0x40004000, 0x40008000, MALLOC_CAP_DMA, 0, 0);
+    heap_t *nested_twice = heaps.add(0x40005000, 0x40006000, MALLOC_CAP_DMA, 0, 0);
+    heap_t *unregistered = heaps.add(0x40100000, 0x40110000, MALLOC_CAP_8BIT, 0, 0);
+    unregistered->heap = NULL;
+    heap_caps_lookup_t *lookup = heaps.build();
+
+    REQUIRE(heap_caps_lookup_find_containing(lookup, 0x40000000) == outer);
+    REQUIRE(heap_caps_lookup_find_containing(lookup, 0x40004000) == nested);
+    REQUIRE(heap_caps_lookup_find_containing(lookup, 0x40005000) == nested_twice);
+    REQUIRE(heap_caps_lookup_find_containing(lookup, 0x40006000) == nested);
+    REQUIRE(heap_caps_lookup_find_containing(lookup, 0x40007ffc) == nested);
+    REQUIRE(heap_caps_lookup_find_containing(lookup, 0x40008000) == outer);
+    REQUIRE(heap_caps_lookup_find_containing(lookup, 0x40010000) == NULL);
+    REQUIRE(heap_caps_lookup_find_containing(lookup, 0x40100010) == NULL);
+    REQUIRE(heap_caps_lookup_find_containing(lookup, 0) == NULL);
+    REQUIRE(heap_caps_lookup_find_containing(NULL, 0x40000000) == NULL);
+
+    for (intptr_t p = 0x3f7f0000; p < 0x40200000; p += 0x1000 - 4) {
+        REQUIRE(heap_caps_lookup_find_containing(lookup, p) == heaps.find_linear(p));
+    }
+}
+
+TEST_CASE("heap_caps lookup returns candidate heaps in priority order", "[heap_caps_lookup]")
+{
+    TestHeaps heaps(12);
+    add_chip_heaps(heaps, 12);
+    heap_caps_lookup_t *lookup = heaps.build();
+
+    const uint32_t caps_list[] = {
+        MALLOC_CAP_DEFAULT, MALLOC_CAP_DEFAULT | MALLOC_CAP_INTERNAL, MALLOC_CAP_8BIT, MALLOC_CAP_DMA,
+        MALLOC_CAP_SPIRAM, MALLOC_CAP_EXEC | MALLOC_CAP_32BIT, MALLOC_CAP_32BIT, MALLOC_CAP_SPIRAM | MALLOC_CAP_DMA,
+    };
+    for (int round = 0; round < 2; round++) {
+        for (uint32_t caps : caps_list) {
+            size_t count = 0;
+            heap_t *const *candidates = heap_caps_lookup_get_candidates(lookup, caps, &count);
+            REQUIRE(candidates != NULL);
+            std::vector<heap_t *> expected = heaps.candidates_linear(caps);
+            REQUIRE(std::vector<heap_t *>(candidates, candidates + count) == expected);
+        }
+    }
+
+    // All sets are used, other capabilities must be looked up in the priority entries
+    size_t count = 0;
+    REQUIRE(heap_caps_lookup_get_candidates(lookup, MALLOC_CAP_RTCRAM, &count) == NULL);
+}
+
+TEST_CASE("heap_caps lookup benchmark", "[heap_caps_lookup][benchmark]")
+{
+    const size_t HEAP_COUNT = 12;
+    const int ITERATIONS = 200000;
+    TestHeaps heaps(HEAP_COUNT);
+    add_chip_heaps(heaps, HEAP_COUNT);
+    heap_caps_lookup_t *lookup = heaps.build();
+
+    std::vector<intptr_t> addresses;
+    for (int i = 0; i < 256; i++) {
+        addresses.push_back(0x3f800000 + (i * 0x9c40) % (HEAP_COUNT * 0x10000));
+    }
+
+    uintptr_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        sink += (uintptr_t)heaps.find_linear(addresses[i % addresses.size()]);
+    }
+    auto linear_find = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        sink += (uintptr_t)heap_caps_lookup_find_containing(lookup, addresses[i % addresses.size()]);
+    }
+    auto lookup_find = std::chrono::steady_clock::now() - start;
+
+    // First heap able to satisfy the capabilities, as in a successful allocation
+    const uint32_t caps = MALLOC_CAP_32BIT | MALLOC_CAP_8BIT;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        for (int prio = 0; prio < SOC_MEMORY_TYPE_NO_PRIOS; prio++) {
+            heap_t *heap;
+            bool found = false;
+            SLIST_FOREACH(heap, &heaps.list, next) {
+                if ((heap->caps[prio] & caps) != 0 && (get_all_caps(heap) & caps) == caps) {
+                    sink += (uintptr_t)heap;
+                    found = true;
+                    break;
+                }
+            }
+            if (found) {
+                break;
+            }
+        }
+    }
+    auto linear_candidates = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        size_t count;
+        heap_t *const *candidates = heap_caps_lookup_get_candidates(lookup, caps, &count);
+        sink += (uintptr_t)candidates[0];
+    }
+    auto lookup_candidates = std::chrono::steady_clock::now() - start;
+
+    auto ns_per_call = [](std::chrono::steady_clock::duration d) {
+        return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(d).count() / ITERATIONS;
+    };
+    printf("%zu heaps: containing heap %.1f ns linear, %.1f ns lookup; first candidate %.1f ns linear, %.1f ns lookup (%u)\n",
+           HEAP_COUNT, ns_per_call(linear_find), ns_per_call(lookup_find),
+           ns_per_call(linear_candidates), ns_per_call(lookup_candidates), (unsigned)(sink & 1));
+}
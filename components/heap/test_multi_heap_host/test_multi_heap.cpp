@@ -383,6 +383,75 @@ TEST_CASE("multi_heap_get_info() function", "[multi_heap]")
     REQUIRE( after.minimum_free_bytes == freed.minimum_free_bytes );
 }
 
+TEST_CASE("multi_heap_get_fragmentation_info() function", "[multi_heap]")
+{
+    uint8_t heapdata[16 * 1024];
+    multi_heap_handle_t heap = multi_heap_register(heapdata, sizeof(heapdata));
+    multi_heap_frag_info_t frag;
+    multi_heap_info_t info;
+    void *p[16];
+
+    REQUIRE( 0 == multi_heap_histogram_class(0) );
+    REQUIRE( 0 == multi_heap_histogram_class(31) );
+    REQUIRE( 1 == multi_heap_histogram_class(32) );
+    REQUIRE( 1 == multi_heap_histogram_class(63) );
+    REQUIRE( 2 == multi_heap_histogram_class(64) );
+    REQUIRE( 14 == multi_heap_histogram_class(512 * 1024 - 1) );
+    REQUIRE( MULTI_HEAP_HISTOGRAM_SIZE - 1 == multi_heap_histogram_class(512 * 1024) );
+    REQUIRE( MULTI_HEAP_HISTOGRAM_SIZE - 1 == multi_heap_histogram_class(SIZE_MAX) );
+
+    multi_heap_get_fragmentation_info(heap, &frag);
+    REQUIRE( 1 == frag.free_blocks );
+    REQUIRE( 0 == frag.fragmentation_index );
+
+    for (int i = 0; i < 16; i++) {
+        p[i] = multi_heap_malloc(heap, 512);
+        REQUIRE( p[i] != NULL );
+    }
+    for (int i = 0; i < 16; i += 2) {
+        multi_heap_free(heap, p[i]);
+    }
+
+    multi_heap_get_fragmentation_info(heap, &frag);
+    multi_heap_get_info(heap, &info);
+    printf("fragmentation index %u, free blocks per size class:", (unsigned)frag.fragmentation_index);
+    for (int i = 0; i < MULTI_HEAP_HISTOGRAM_SIZE; i++) {
+        printf(" %zu", frag.free_block_count[i]);
+    }
+    printf("\n");
+
+    REQUIRE( info.free_blocks == frag.free_blocks );
+    REQUIRE( info.total_free_bytes == frag.total_free_bytes );
+    REQUIRE( info.largest_free_block == frag.largest_free_block );
+    REQUIRE( 8 <= frag.free_block_count[multi_heap_histogram_class(512)] );
+    REQUIRE( frag.fragmentation_index == multi_heap_fragmentation_index(info.largest_free_block, info.total_free_bytes) );
+    REQUIRE( frag.fragmentation_index > 0 );
+
+    size_t count = 0;
+    for (int i = 0; i < MULTI_HEAP_HISTOGRAM_SIZE; i++) {
+        count += frag.free_block_count[i];
+    }
+    REQUIRE( frag.free_blocks == count );
+
+    REQUIRE( multi_heap_malloc(heap, 64 * 1024) == NULL );
+
+#if CONFIG_HEAP_ALLOC_SIZE_HISTOGRAM
+    multi_heap_get_fragmentation_info(heap, &frag);
+    REQUIRE( 16 == frag.alloc_count[multi_heap_histogram_class(512)] );
+    REQUIRE( 1 == frag.alloc_failures[multi_heap_histogram_class(64 * 1024)] );
+#endif
+
+    for (int i = 1; i < 16; i += 2) {
+        multi_heap_free(heap, p[i]);
+    }
+    multi_heap_get_fragmentation_info(heap, &frag);
+    REQUIRE( 1 == frag.free_blocks );
+    REQUIRE( 0 == frag.fragmentation_index );
+
+    REQUIRE( 0 == multi_heap_fragmentation_index(0, 0) );
+    REQUIRE( 50 == multi_heap_fragmentation_index(50, 100) );
+}
+
 TEST_CASE("multi_heap minimum-size allocations", "[multi_heap]")
 {
     uint8_t heapdata[4096];
@@ -7,6 +7,9 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdarg.h>
+#include "sdkconfig.h"
+#include "esp_log.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -16,6 +19,24 @@ void esp_log_impl_lock(void);
 bool esp_log_impl_lock_timeout(void);
 void esp_log_impl_unlock(void);
 
+#if CONFIG_LOG_DEFERRED
+unsigned esp_log_impl_get_core_id(void);
+void esp_log_impl_deferred_start(void);
+// Returns true if the format string is read-only data of the application, which outlives the log call
+bool esp_log_impl_format_is_static(const char *format);
+
+void esp_log_deferred_write(const char *format, va_list args);
+#endif
+
+#if CONFIG_LOG_DEFERRED || CONFIG_LOG_ASYNC
+int esp_log_output(const char *format, ...);
+#endif
+
+#if CONFIG_LOG_ASYNC
+// Returns false if the message must be printed synchronously, without consuming args
+bool esp_log_async_write(esp_log_level_t level, const char *format, va_list args);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
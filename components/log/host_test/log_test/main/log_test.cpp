@@ -7,8 +7,13 @@
    CONDITIONS OF ANY KIND, either express or implied.
 */
 #include <cstdio>
+#include <cstring>
 #include <regex>
 #include <iostream>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <atomic>
 #include "esp_log.h"
 
 #include <catch2/catch_test_macros.hpp>
@@ -278,3 +283,123 @@ TEST_CASE("changing early log level")
     ESP_EARLY_LOGI(TEST_TAG, "must indeed be printed");
     CHECK(regex_search(fix.get_print_buffer_string(), test_print) == true);
 }
+
+TEST_CASE("log level is found for copies of a tag")
+{
+    PrintFixture fix(ESP_LOG_INFO);
+    char tag_copy[] = "test";
+
+    esp_log_level_set(tag_copy, ESP_LOG_ERROR);
+    CHECK(esp_log_level_get(TEST_TAG) == ESP_LOG_ERROR);
+
+    ESP_LOGW(TEST_TAG, "must not be printed");
+    CHECK(fix.get_print_buffer_string().size() == 0);
+
+    esp_log_level_set(TEST_TAG, ESP_LOG_WARN);
+    CHECK(esp_log_level_get(tag_copy) == ESP_LOG_WARN);
+}
+
+TEST_CASE("log level lookup scales with concurrent loggers")
+{
+    PrintFixture fix(ESP_LOG_INFO);
+    const int ITERATIONS = 200000;
+    static const char *const tags[] = { "tag0", "tag1", "tag2", "tag3" };
+
+    for (const char *tag : tags) {
+        esp_log_level_set(tag, ESP_LOG_INFO);
+    }
+
+    for (int thread_count = 1; thread_count <= 8; thread_count *= 2) {
+        std::atomic<int> errors(0);
+        std::vector<std::thread> threads;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int t = 0; t < thread_count; t++) {
+            threads.emplace_back([&errors, t]() {
+                const char *tag = tags[t % 4];
+                for (int i = 0; i < ITERATIONS; i++) {
+                    // Filtered out by the level of the tag, so only the level is looked up
+                    ESP_LOGD(tag, "not printed %d", i);
+                    if (esp_log_level_get(tag) != ESP_LOG_INFO) {
+                        errors++;
+                    }
+                }
+            });
+        }
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        printf("%d logging threads: %.1f million lookups per second\n",
+               thread_count, 2.0 * thread_count * ITERATIONS / elapsed.count() / 1e6);
+        CHECK(errors == 0);
+    }
+    CHECK(fix.get_print_buffer_string().size() == 0);
+}
+
+#if CONFIG_LOG_DEFERRED
+TEST_CASE("deferred log is printed when processed")
+{
+    PrintFixture fix(ESP_LOG_INFO);
+    const std::regex test_print("I \\([0-9]*\\) test: deferred 42 copied", std::regex::ECMAScript);
+    char str[] = "copied";
+
+    esp_log_set_deferred(true);
+    ESP_LOGI(TEST_TAG, "deferred %d %s", 42, str);
+    strcpy(str, "change");
+    esp_log_set_deferred(false);
+    CHECK(fix.get_print_buffer_string().size() == 0);
+
+    CHECK(esp_log_deferred_process() == 1);
+    CHECK(regex_search(fix.get_print_buffer_string(), test_print) == true);
+    CHECK(esp_log_deferred_process() == 0);
+}
+
+TEST_CASE("deferred log copies formats which are not read-only data")
+{
+    PrintFixture fix(ESP_LOG_INFO);
+    char format[] = "runtime format %d\n";
+
+    esp_log_set_deferred(true);
+    esp_log_write(ESP_LOG_INFO, TEST_TAG, format, 7);
+    strcpy(format, "changed");
+    esp_log_set_deferred(false);
+
+    CHECK(esp_log_deferred_process() == 1);
+    CHECK(fix.get_print_buffer_string() == "runtime format 7\n");
+}
+
+TEST_CASE("deferred log call cost compared to text log")
+{
+    PrintFixture fix(ESP_LOG_INFO);
+    const int BATCH = 32;
+    const int ITERATIONS = 1000;
+    uint32_t dropped = esp_log_deferred_get_dropped();
+    std::chrono::nanoseconds text_time(0);
+    std::chrono::nanoseconds deferred_time(0);
+
+    for (int i = 0; i < ITERATIONS; i++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int j = 0; j < BATCH; j++) {
+            ESP_LOGI(TEST_TAG, "some test data, %d, %d, %d", i, j, 12);
+        }
+        text_time += std::chrono::steady_clock::now() - start;
+
+        esp_log_set_deferred(true);
+        start = std::chrono::steady_clock::now();
+        for (int j = 0; j < BATCH; j++) {
+            ESP_LOGI(TEST_TAG, "some test data, %d, %d, %d", i, j, 12);
+        }
+        deferred_time += std::chrono::steady_clock::now() - start;
+        esp_log_set_deferred(false);
+
+        // Formatting the deferred messages is not part of the cost of the calls
+        CHECK(esp_log_deferred_process() == BATCH);
+    }
+
+    printf("text log: %.1f ns per call, deferred log: %.1f ns per call\n",
+           (double) text_time.count() / (ITERATIONS * BATCH), (double) deferred_time.count() / (ITERATIONS * BATCH));
+    CHECK(esp_log_deferred_get_dropped() == dropped);
+}
+#endif // CONFIG_LOG_DEFERRED
@@ -9,9 +9,14 @@
 
 #include <stdint.h>
 #include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <inttypes.h>
 #include "sdkconfig.h"
 #include "esp_rom_sys.h"
+#if CONFIG_LOG_ASYNC
+#include "esp_err.h"
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -112,6 +117,164 @@ esp_log_level_t esp_log_level_get(const char* tag);
  */
 vprintf_like_t esp_log_set_vprintf(vprintf_like_t func);
 
+#if CONFIG_LOG_DEFERRED || __DOXYGEN__
+
+/**
+ * @brief Enable or disable deferred logging
+ *
+ * In deferred mode, log messages which pass the level checks are not formatted by
+ * the logging task. Only the address of the format string and the raw arguments are
+ * stored, in a ring buffer of the current CPU core, and the messages are formatted
+ * later by esp_log_deferred_process(). Format strings which are not in the read-only
+ * data of the application, e.g. built at run time, are copied whole instead, and
+ * string arguments are copied, truncated to 64 characters. Messages are dropped if
+ * the ring buffer is full.
+ *
+ * If CONFIG_LOG_DEFERRED_TASK is enabled, enabling deferred mode starts a task which
+ * calls esp_log_deferred_process() periodically.
+ *
+ * @note Messages logged from different cores may be printed out of order.
+ *
+ * @param enable true to defer the formatting of log messages, false to format them
+ *               when they are logged. Pending messages are kept when disabling.
+ */
+void esp_log_set_deferred(bool enable);
+
+/**
+ * @brief Format and print the pending deferred log messages
+ *
+ * Messages are printed by the function set with esp_log_set_vprintf().
+ * Returns immediately if another task is processing or reading the messages.
+ *
+ * @return Number of messages printed
+ */
+size_t esp_log_deferred_process(void);
+
+/**
+ * @brief Read the pending deferred log messages in binary form
+ *
+ * Moves whole records of pending messages into the buffer. Each record starts with
+ * its length in bytes as uint32_t, followed by the address of the format string and
+ * the raw arguments. The address is 0 if a copy of the format string follows it.
+ * The records can be decoded by log_deferred_decode.py, which reads the format
+ * strings from the ELF file of the application.
+ *
+ * @param buffer Buffer receiving the records
+ * @param size   Size of the buffer in bytes
+ *
+ * @return Number of bytes written to the buffer
+ */
+size_t esp_log_deferred_read(void *buffer, size_t size);
+
+/**
+ * @brief Get the number of deferred log messages dropped
+ *
+ * @return Number of messages dropped because the ring buffer was full, since startup
+ */
+uint32_t esp_log_deferred_get_dropped(void);
+
+#endif // CONFIG_LOG_DEFERRED
+
+#if CONFIG_LOG_ASYNC || __DOXYGEN__
+
+/**
+ * @brief Behaviour of the asynchronous log sink when its buffer is full
+ */
+typedef enum {
+    ESP_LOG_ASYNC_BLOCK,        /*!< Wait up to block_timeout_ms for space, then drop the new message */
+    ESP_LOG_ASYNC_DROP_NEWEST,  /*!< Drop the new message */
+    ESP_LOG_ASYNC_DROP_OLDEST,  /*!< Drop the oldest pending messages to make space for the new one */
+} esp_log_async_policy_t;
+
+/**
+ * @brief Configuration of the asynchronous log sink
+ */
+typedef struct {
+    size_t buffer_size;             /*!< Size in bytes of the ring buffer holding the pending messages */
+    esp_log_async_policy_t policy;  /*!< Behaviour when the ring buffer is full */
+    uint32_t block_timeout_ms;      /*!< Longest time to wait for space with ESP_LOG_ASYNC_BLOCK */
+    uint32_t task_priority;         /*!< Priority of the task printing the messages */
+    uint32_t task_stack_size;       /*!< Stack size of the task printing the messages */
+    int task_core_id;               /*!< Core the task runs on, -1 for no affinity */
+} esp_log_async_config_t;
+
+#define ESP_LOG_ASYNC_CONFIG_DEFAULT() { \
+    .buffer_size = 4096, \
+    .policy = ESP_LOG_ASYNC_DROP_NEWEST, \
+    .block_timeout_ms = 10, \
+    .task_priority = 1, \
+    .task_stack_size = 3072, \
+    .task_core_id = -1, \
+}
+
+/**
+ * @brief Start printing log messages asynchronously
+ *
+ * Log messages which pass the level checks are formatted by the logging task
+ * into a ring buffer, and printed by a dedicated task with the function set with
+ * esp_log_set_vprintf(). Messages longer than CONFIG_LOG_ASYNC_MAX_MESSAGE_LENGTH
+ * are truncated. Messages logged from an ISR, before the scheduler is started, or
+ * by the printing task itself are still printed synchronously.
+ *
+ * @param config Configuration of the sink
+ *
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if config is NULL or invalid
+ *     - ESP_ERR_INVALID_STATE if the sink is already started, or still being stopped
+ *     - ESP_ERR_NO_MEM if the ring buffer or the task could not be created
+ */
+esp_err_t esp_log_async_start(const esp_log_async_config_t *config);
+
+/**
+ * @brief Stop printing log messages asynchronously
+ *
+ * Messages are printed synchronously once this function is called. It waits until the
+ * pending messages are printed, then deletes the printing task and the ring buffer.
+ * The dropped message counters are kept until the sink is started again.
+ *
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_STATE if the sink is not started, or if called by the printing task
+ */
+esp_err_t esp_log_async_stop(void);
+
+/**
+ * @brief Wait until all the pending asynchronous log messages are printed
+ *
+ * @param timeout_ms Longest time to wait
+ *
+ * @return
+ *     - ESP_OK if no message is pending
+ *     - ESP_ERR_INVALID_STATE if the sink is not started
+ *     - ESP_ERR_TIMEOUT if messages are still pending after timeout_ms
+ */
+esp_err_t esp_log_async_flush(uint32_t timeout_ms);
+
+/**
+ * @brief Get the number of asynchronous log messages dropped
+ *
+ * @param level Level of the messages to count, or ESP_LOG_NONE to count the messages of all levels
+ *
+ * @return Number of messages of the level dropped because the ring buffer was full
+ */
+uint32_t esp_log_async_get_dropped(esp_log_level_t level);
+
+/**
+ * @brief Print the pending asynchronous log messages from the panic handler
+ *
+ * Called by the panic handler, with the scheduler stopped, so that messages logged
+ * just before a crash are not lost. The message being printed by the printing task
+ * at the time of the crash may be printed partly or not at all.
+ *
+ * @param print_str Function printing a null-terminated string
+ *
+ * @return Number of messages printed
+ */
+size_t esp_log_async_panic_flush(void (*print_str)(const char *str));
+
+#endif // CONFIG_LOG_ASYNC
+
 /**
  * @brief Function which returns timestamp to be used in log output
  *
@@ -13,18 +13,24 @@
  * To avoid looking up log level for given tag each time message is
  * printed, this library caches pointers to tags. Because the suggested
  * way of creating tags uses one 'TAG' constant per file, this caching
- * should be effective. Cache is a binary min-heap of cached_tag_entry_t
- * items, ordering is done on 'generation' member. In this context,
- * generation is an integer which is incremented each time an operation
- * with cache is performed. When cache is full, new item is inserted in
- * place of an oldest item (that is, with smallest 'generation' value).
- * After that, bubble-down operation is performed to fix ordering in the
- * min-heap.
+ * should be effective. Cache is a hash table of cached_tag_entry_t items,
+ * indexed by the tag pointer, with linear probing over a few slots.
  *
- * The potential problem with wrap-around of cache generation counter is
- * ignored for now. This will happen if someone happens to output more
- * than 4 billion log entries, at which point wrap-around will not be
- * the biggest problem.
+ * Cache lookups do not take the lock, so that checking the level of a log
+ * is wait-free from any task or core. Each entry is protected by a sequence
+ * number which is odd while the entry is being written: a reader which sees
+ * an odd or changed sequence number treats the lookup as a miss. Entries are
+ * only written with the lock held, on a miss, after the tag has been looked
+ * up in the linked list by string comparison.
+ *
+ * Level changes are rare, so esp_log_level_set does not update the cache.
+ * It increments the cache version instead, which invalidates all entries
+ * at once since each entry holds the version it was filled at.
+ *
+ * The potential problem with wrap-around of cache version counter is
+ * ignored for now. This will happen if someone happens to change log levels
+ * more than 500 million times, at which point wrap-around will not be the
+ * biggest problem.
  *
  */
 
@@ -35,6 +41,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
+#include <stdatomic.h>
 #include "esp_log.h"
 #include "esp_log_private.h"
 
@@ -47,13 +54,18 @@
 
 #include "sys/queue.h"
 
-// Number of tags to be cached. Must be 2**n - 1, n >= 2.
-#define TAG_CACHE_SIZE 31
+// Number of tags to be cached. Must be 2**n.
+#define TAG_CACHE_SIZE 64
+// Number of slots searched for a tag, starting at its hash
+#define TAG_CACHE_PROBES 4
+
+#define TAG_CACHE_LEVEL_BITS 3
+#define TAG_CACHE_LEVEL_MASK ((1 << TAG_CACHE_LEVEL_BITS) - 1)
 
 typedef struct {
-    const char *tag;
-    uint32_t level : 3;
-    uint32_t generation : 29;
+    atomic_uint_least32_t seq;              // odd while the entry is being written
+    atomic_uintptr_t tag;                   // pointer to the tag, 0 if the entry is unused
+    atomic_uint_least32_t version_level;    // cache version the entry was filled at, and esp_log_level_t
 } cached_tag_entry_t;
 
 typedef struct uncached_tag_entry_ {
@@ -68,9 +80,12 @@ esp_log_level_t g_master_log_level = CONFIG_LOG_DEFAULT_LEVEL;
 esp_log_level_t esp_log_default_level = CONFIG_LOG_DEFAULT_LEVEL;
 static SLIST_HEAD(log_tags_head, uncached_tag_entry_) s_log_tags = SLIST_HEAD_INITIALIZER(s_log_tags);
 static cached_tag_entry_t s_log_cache[TAG_CACHE_SIZE];
-static uint32_t s_log_cache_max_generation = 0;
-static uint32_t s_log_cache_entry_count = 0;
+static atomic_uint_least32_t s_log_cache_version = 0;
+static uint32_t s_log_cache_victim = 0;
 static vprintf_like_t s_log_print_func = &vprintf;
+#if CONFIG_LOG_DEFERRED
+static bool s_log_deferred = false;
+#endif
 
 #ifdef LOG_BUILTIN_CHECKS
 static uint32_t s_log_cache_misses = 0;
@@ -79,8 +94,6 @@ static uint32_t s_log_cache_misses = 0;
 static inline bool get_cached_log_level(const char *tag, esp_log_level_t *level);
 static inline bool get_uncached_log_level(const char *tag, esp_log_level_t *level);
 static inline void add_to_cache(const char *tag, esp_log_level_t level);
-static void heap_bubble_down(int index);
-static inline void heap_swap(int i, int j);
 static inline bool should_output(esp_log_level_t level_for_message, esp_log_level_t level_for_tag);
 static inline void clear_log_level_list(void);
 
@@ -93,6 +106,29 @@ vprintf_like_t esp_log_set_vprintf(vprintf_like_t func)
     return orig_func;
 }
 
+#if CONFIG_LOG_DEFERRED
+void esp_log_set_deferred(bool enable)
+{
+    esp_log_impl_lock();
+    if (enable) {
+        esp_log_impl_deferred_start();
+    }
+    s_log_deferred = enable;
+    esp_log_impl_unlock();
+}
+#endif // CONFIG_LOG_DEFERRED
+
+#if CONFIG_LOG_DEFERRED || CONFIG_LOG_ASYNC
+int esp_log_output(const char *format, ...)
+{
+    va_list list;
+    va_start(list, format);
+    int ret = (*s_log_print_func)(format, list);
+    va_end(list);
+    return ret;
+}
+#endif
+
 #ifdef CONFIG_LOG_MASTER_LEVEL
 esp_log_level_t esp_log_get_level_master(void)
 {
@@ -142,45 +178,43 @@ void esp_log_level_set(const char *tag, esp_log_level_t level)
         SLIST_INSERT_HEAD(&s_log_tags, new_entry, entries);
     }
 
-    // search in the cache and update the entry it if exists
-    for (uint32_t i = 0; i < s_log_cache_entry_count; ++i) {
-#ifdef LOG_BUILTIN_CHECKS
-        assert(i == 0 || s_log_cache[(i - 1) / 2].generation < s_log_cache[i].generation);
-#endif
-        if (strcmp(s_log_cache[i].tag, tag) == 0) {
-            s_log_cache[i].level = level;
-            break;
-        }
-    }
+    // invalidate the cache
+    atomic_fetch_add_explicit(&s_log_cache_version, 1, memory_order_release);
     esp_log_impl_unlock();
 }
 
-/* Common code for getting the log level from cache, esp_log_impl_lock()
-   should be called before calling this function. The function unlocks,
-   as indicated in the name.
+/* Common code for getting the log level. Returns false if the tag is not
+   cached and the lock could not be taken to look it up.
 */
-static esp_log_level_t s_log_level_get_and_unlock(const char *tag)
+static bool s_log_level_get(const char *tag, esp_log_level_t *level, bool wait)
 {
-    esp_log_level_t level_for_tag;
     // Look for the tag in cache first, then in the linked list of all tags
-    if (!get_cached_log_level(tag, &level_for_tag)) {
-        if (!get_uncached_log_level(tag, &level_for_tag)) {
-            level_for_tag = esp_log_default_level;
-        }
-        add_to_cache(tag, level_for_tag);
+    if (get_cached_log_level(tag, level)) {
+        return true;
+    }
+
+    if (wait) {
+        esp_log_impl_lock();
+    } else if (!esp_log_impl_lock_timeout()) {
+        return false;
+    }
+    if (!get_uncached_log_level(tag, level)) {
+        *level = esp_log_default_level;
+    }
+    add_to_cache(tag, *level);
 #ifdef LOG_BUILTIN_CHECKS
-        ++s_log_cache_misses;
+    ++s_log_cache_misses;
 #endif
-    }
     esp_log_impl_unlock();
 
-    return level_for_tag;
+    return true;
 }
 
 esp_log_level_t esp_log_level_get(const char *tag)
 {
-    esp_log_impl_lock();
-    return s_log_level_get_and_unlock(tag);
+    esp_log_level_t level_for_tag;
+    s_log_level_get(tag, &level_for_tag, true);
+    return level_for_tag;
 }
 
 void clear_log_level_list(void)
@@ -190,8 +224,7 @@ void clear_log_level_list(void)
         SLIST_REMOVE_HEAD(&s_log_tags, entries);
         free(it);
     }
-    s_log_cache_entry_count = 0;
-    s_log_cache_max_generation = 0;
+    atomic_fetch_add_explicit(&s_log_cache_version, 1, memory_order_release);
 #ifdef LOG_BUILTIN_CHECKS
     s_log_cache_misses = 0;
 #endif
@@ -202,14 +235,27 @@ void esp_log_writev(esp_log_level_t level,
                     const char *format,
                     va_list args)
 {
-    if (!esp_log_impl_lock_timeout()) {
+    esp_log_level_t level_for_tag;
+    if (!s_log_level_get(tag, &level_for_tag, false)) {
         return;
     }
-    esp_log_level_t level_for_tag = s_log_level_get_and_unlock(tag);
     if (!should_output(level, level_for_tag)) {
         return;
     }
 
+#if CONFIG_LOG_DEFERRED
+    if (s_log_deferred) {
+        esp_log_deferred_write(format, args);
+        return;
+    }
+#endif
+
+#if CONFIG_LOG_ASYNC
+    if (esp_log_async_write(level, format, args)) {
+        return;
+    }
+#endif
+
     (*s_log_print_func)(format, args);
 
 }
@@ -224,62 +270,71 @@ void esp_log_write(esp_log_level_t level,
     va_end(list);
 }
 
+static inline uint32_t tag_hash(const char *tag)
+{
+    uint32_t hash = (uint32_t)(uintptr_t) tag * 2654435761u;
+    return hash >> 16;
+}
+
 static inline bool get_cached_log_level(const char *tag, esp_log_level_t *level)
 {
+    uint32_t version = atomic_load_explicit(&s_log_cache_version, memory_order_acquire);
+    uint32_t hash = tag_hash(tag);
+
     // Look for `tag` in cache
-    uint32_t i;
-    for (i = 0; i < s_log_cache_entry_count; ++i) {
-#ifdef LOG_BUILTIN_CHECKS
-        assert(i == 0 || s_log_cache[(i - 1) / 2].generation < s_log_cache[i].generation);
-#endif
-        if (s_log_cache[i].tag == tag) {
-            break;
+    for (uint32_t i = 0; i < TAG_CACHE_PROBES; ++i) {
+        cached_tag_entry_t *entry = &s_log_cache[(hash + i) & (TAG_CACHE_SIZE - 1)];
+
+        uint32_t seq = atomic_load_explicit(&entry->seq, memory_order_acquire);
+        uintptr_t entry_tag = atomic_load_explicit(&entry->tag, memory_order_relaxed);
+        uint32_t version_level = atomic_load_explicit(&entry->version_level, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+
+        if ((seq & 1) || atomic_load_explicit(&entry->seq, memory_order_relaxed) != seq) {
+            // Entry being written, take the slow path
+            return false;
+        }
+        if (entry_tag == (uintptr_t) tag) {
+            if ((version_level >> TAG_CACHE_LEVEL_BITS) != (version & (UINT32_MAX >> TAG_CACHE_LEVEL_BITS))) {
+                // Filled before the last level change
+                return false;
+            }
+            *level = (esp_log_level_t)(version_level & TAG_CACHE_LEVEL_MASK);
+            return true;
+        }
+        if (entry_tag == 0) {
+            return false;
         }
     }
-    if (i == s_log_cache_entry_count) { // Not found in cache
-        return false;
-    }
-    // Return level from cache
-    *level = (esp_log_level_t) s_log_cache[i].level;
-    // If cache has been filled, start taking ordering into account
-    // (other options are: dynamically resize cache, add "dummy" entries
-    //  to the cache; this option was chosen because code is much simpler,
-    //  and the unfair behavior of cache will show it self at most once, when
-    //  it has just been filled)
-    if (s_log_cache_entry_count == TAG_CACHE_SIZE) {
-        // Update item generation
-        s_log_cache[i].generation = s_log_cache_max_generation++;
-        // Restore heap ordering
-        heap_bubble_down(i);
-    }
-    return true;
+    return false;
 }
 
+// Fills the cache entry of a tag, esp_log_impl_lock() should be called before calling this function
 static inline void add_to_cache(const char *tag, esp_log_level_t level)
 {
-    uint32_t generation = s_log_cache_max_generation++;
-    // First consider the case when cache is not filled yet.
-    // In this case, just add new entry at the end.
-    // This happens to satisfy binary min-heap ordering.
-    if (s_log_cache_entry_count < TAG_CACHE_SIZE) {
-        s_log_cache[s_log_cache_entry_count] = (cached_tag_entry_t) {
-            .generation = generation,
-            .level = level,
-            .tag = tag
-        };
-        ++s_log_cache_entry_count;
-        return;
+    uint32_t version = atomic_load_explicit(&s_log_cache_version, memory_order_relaxed);
+    uint32_t hash = tag_hash(tag);
+    cached_tag_entry_t *entry = NULL;
+
+    // Use the entry of the tag or a free one, else replace one of the probed entries in turn
+    for (uint32_t i = 0; i < TAG_CACHE_PROBES; ++i) {
+        cached_tag_entry_t *it = &s_log_cache[(hash + i) & (TAG_CACHE_SIZE - 1)];
+        uintptr_t entry_tag = atomic_load_explicit(&it->tag, memory_order_relaxed);
+        if (entry_tag == (uintptr_t) tag || entry_tag == 0) {
+            entry = it;
+            break;
+        }
+    }
+    if (entry == NULL) {
+        entry = &s_log_cache[(hash + s_log_cache_victim++ % TAG_CACHE_PROBES) & (TAG_CACHE_SIZE - 1)];
     }
 
-    // Cache is full, so we replace the oldest entry (which is at index 0
-    // because this is a min-heap) with the new one, and do bubble-down
-    // operation to restore min-heap ordering.
-    s_log_cache[0] = (cached_tag_entry_t) {
-        .tag = tag,
-        .level = level,
-        .generation = generation
-    };
-    heap_bubble_down(0);
+    uint32_t seq = atomic_load_explicit(&entry->seq, memory_order_relaxed);
+    atomic_store_explicit(&entry->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&entry->tag, (uintptr_t) tag, memory_order_relaxed);
+    atomic_store_explicit(&entry->version_level, (version << TAG_CACHE_LEVEL_BITS) | level, memory_order_relaxed);
+    atomic_store_explicit(&entry->seq, seq + 2, memory_order_release);
 }
 
 static inline bool get_uncached_log_level(const char *tag, esp_log_level_t *level)
@@ -300,21 +355,3 @@ static inline bool should_output(esp_log_level_t level_for_message, esp_log_leve
 {
     return level_for_message <= level_for_tag;
 }
-
-static void heap_bubble_down(int index)
-{
-    while (index < TAG_CACHE_SIZE / 2) {
-        int left_index = index * 2 + 1;
-        int right_index = left_index + 1;
-        int next = (s_log_cache[left_index].generation < s_log_cache[right_index].generation) ? left_index : right_index;
-        heap_swap(index, next);
-        index = next;
-    }
-}
-
-static inline void heap_swap(int i, int j)
-{
-    cached_tag_entry_t tmp = s_log_cache[i];
-    s_log_cache[i] = s_log_cache[j];
-    s_log_cache[j] = tmp;
-}
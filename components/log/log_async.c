@@ -0,0 +1,267 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/ringbuf.h"
+#include "esp_log.h"
+#include "esp_log_private.h"
+
+// Each item of the ring buffer holds the level of a message, followed by the
+// null-terminated message. An item of a single byte stops the printing task.
+#define LOG_ASYNC_ITEM_SIZE (CONFIG_LOG_ASYNC_MAX_MESSAGE_LENGTH + 2)
+
+static RingbufHandle_t _Atomic s_log_async_buffer = NULL;
+static TaskHandle_t _Atomic s_log_async_task = NULL;
+static esp_log_async_policy_t s_log_async_policy;
+static TickType_t s_log_async_block_ticks;
+static size_t s_log_async_max_item_size;
+// Messages sent to the ring buffer and not yet printed or dropped
+static atomic_uint_least32_t s_log_async_pending = 0;
+static atomic_uint_least32_t s_log_async_dropped[ESP_LOG_VERBOSE + 1];
+// Tasks which may be sending a message, esp_log_async_stop() waits for them before deleting the ring buffer
+static atomic_uint s_log_async_writers = 0;
+
+static void log_async_task(void *arg)
+{
+    RingbufHandle_t buffer = (RingbufHandle_t)arg;
+    char message[LOG_ASYNC_ITEM_SIZE];
+    while (1) {
+        size_t size;
+        char *item = xRingbufferReceive(buffer, &size, portMAX_DELAY);
+        if (item == NULL) {
+            continue;
+        }
+        if (size < 2) {
+            // Stop item, sent by esp_log_async_stop() once no other message can follow it
+            vRingbufferReturnItem(buffer, item);
+            break;
+        }
+        // Printing may be slow. Return the item first, so that it does not hold space
+        // which ESP_LOG_ASYNC_DROP_OLDEST could not reclaim.
+        memcpy(message, item, size);
+        vRingbufferReturnItem(buffer, item);
+        esp_log_output("%s", message + 1);
+        atomic_fetch_sub_explicit(&s_log_async_pending, 1, memory_order_release);
+    }
+    s_log_async_task = NULL;
+    vTaskDelete(NULL);
+}
+
+static inline void count_dropped(esp_log_level_t level)
+{
+    atomic_fetch_add_explicit(&s_log_async_dropped[level], 1, memory_order_relaxed);
+}
+
+// Drops pending messages until a slot of the given size is acquired. Gives up if the messages left
+// are being printed or written.
+static bool acquire_dropping_oldest(RingbufHandle_t buffer, char **slot, size_t size)
+{
+    while (xRingbufferSendAcquire(buffer, (void **)slot, size, 0) != pdTRUE) {
+        size_t old_size;
+        char *old = xRingbufferReceive(buffer, &old_size, 0);
+        if (old == NULL) {
+            return false;
+        }
+        count_dropped((esp_log_level_t)old[0]);
+        vRingbufferReturnItem(buffer, old);
+        atomic_fetch_sub_explicit(&s_log_async_pending, 1, memory_order_release);
+    }
+    return true;
+}
+
+static void log_async_send(RingbufHandle_t buffer, esp_log_level_t level, const char *format, va_list args)
+{
+    // The message is formatted twice: first for its length, then straight into the acquired slot
+    va_list args_copy;
+    va_copy(args_copy, args);
+    int len = vsnprintf(NULL, 0, format, args_copy);
+    va_end(args_copy);
+    if (len < 0) {
+        return;
+    }
+    bool truncated = len > CONFIG_LOG_ASYNC_MAX_MESSAGE_LENGTH;
+    if (truncated) {
+        len = CONFIG_LOG_ASYNC_MAX_MESSAGE_LENGTH;
+    }
+    size_t size = len + 2;
+    if (size > s_log_async_max_item_size) {
+        count_dropped(level);
+        return;
+    }
+
+    atomic_fetch_add_explicit(&s_log_async_pending, 1, memory_order_relaxed);
+    char *slot;
+    bool acquired;
+    switch (s_log_async_policy) {
+    case ESP_LOG_ASYNC_BLOCK:
+        acquired = xRingbufferSendAcquire(buffer, (void **)&slot, size, s_log_async_block_ticks) == pdTRUE;
+        break;
+    case ESP_LOG_ASYNC_DROP_OLDEST:
+        acquired = acquire_dropping_oldest(buffer, &slot, size);
+        break;
+    default:
+        acquired = xRingbufferSendAcquire(buffer, (void **)&slot, size, 0) == pdTRUE;
+        break;
+    }
+    if (!acquired) {
+        atomic_fetch_sub_explicit(&s_log_async_pending, 1, memory_order_relaxed);
+        count_dropped(level);
+        return;
+    }
+
+    slot[0] = (char)level;
+    vsnprintf(slot + 1, size - 1, format, args);
+    if (truncated) {
+        // Keep the line break so that the next message starts on a new line
+        slot[size - 2] = '\n';
+    }
+    xRingbufferSendComplete(buffer, slot);
+}
+
+esp_err_t esp_log_async_start(const esp_log_async_config_t *config)
+{
+    if (config == NULL || config->buffer_size < LOG_ASYNC_ITEM_SIZE || config->policy > ESP_LOG_ASYNC_DROP_OLDEST) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (config->task_core_id >= portNUM_PROCESSORS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_log_impl_lock();
+    esp_err_t err = ESP_OK;
+    // The task of a sink being stopped is still running
+    if (s_log_async_task != NULL) {
+        err = ESP_ERR_INVALID_STATE;
+        goto exit;
+    }
+    RingbufHandle_t buffer = xRingbufferCreate(config->buffer_size, RINGBUF_TYPE_NOSPLIT);
+    if (buffer == NULL) {
+        err = ESP_ERR_NO_MEM;
+        goto exit;
+    }
+    s_log_async_policy = config->policy;
+    s_log_async_block_ticks = pdMS_TO_TICKS(config->block_timeout_ms);
+    s_log_async_max_item_size = xRingbufferGetMaxItemSize(buffer);
+    atomic_store(&s_log_async_pending, 0);
+    for (int i = 0; i <= ESP_LOG_VERBOSE; i++) {
+        atomic_store(&s_log_async_dropped[i], 0);
+    }
+
+    BaseType_t core_id = config->task_core_id < 0 ? tskNO_AFFINITY : config->task_core_id;
+    TaskHandle_t task;
+    if (xTaskCreatePinnedToCore(log_async_task, "log_async", config->task_stack_size, buffer,
+                                config->task_priority, &task, core_id) != pdPASS) {
+        vRingbufferDelete(buffer);
+        err = ESP_ERR_NO_MEM;
+        goto exit;
+    }
+    s_log_async_task = task;
+    // Written last, messages go through the ring buffer from now on
+    s_log_async_buffer = buffer;
+exit:
+    esp_log_impl_unlock();
+    return err;
+}
+
+esp_err_t esp_log_async_stop(void)
+{
+    // The log lock is not held while waiting below, so as not to stall the level checks of other tasks
+    esp_log_impl_lock();
+    RingbufHandle_t buffer = s_log_async_buffer;
+    bool stoppable = buffer != NULL && xTaskGetCurrentTaskHandle() != s_log_async_task;
+    if (stoppable) {
+        // Messages are printed synchronously from now on
+        s_log_async_buffer = NULL;
+    }
+    esp_log_impl_unlock();
+    if (!stoppable) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Wait for the tasks which loaded the ring buffer before it was cleared
+    while (atomic_load(&s_log_async_writers) != 0) {
+        vTaskDelay(1);
+    }
+    // The task prints the pending messages, then exits on the stop item
+    const char stop = 0;
+    xRingbufferSend(buffer, &stop, sizeof(stop), portMAX_DELAY);
+    while (s_log_async_task != NULL) {
+        vTaskDelay(1);
+    }
+    vRingbufferDelete(buffer);
+    return ESP_OK;
+}
+
+bool esp_log_async_write(esp_log_level_t level, const char *format, va_list args)
+{
+    if (atomic_load_explicit(&s_log_async_buffer, memory_order_relaxed) == NULL
+            || xPortInIsrContext() || xTaskGetSchedulerState() != taskSCHEDULER_RUNNING) {
+        return false;
+    }
+    atomic_fetch_add(&s_log_async_writers, 1);
+    RingbufHandle_t buffer = s_log_async_buffer;
+    bool async = buffer != NULL && xTaskGetCurrentTaskHandle() != s_log_async_task;
+    if (async) {
+        log_async_send(buffer, level, format, args);
+    }
+    atomic_fetch_sub(&s_log_async_writers, 1);
+    return async;
+}
+
+esp_err_t esp_log_async_flush(uint32_t timeout_ms)
+{
+    if (s_log_async_buffer == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+    while (atomic_load_explicit(&s_log_async_pending, memory_order_acquire) != 0) {
+        if (xTaskGetTickCount() - start >= timeout) {
+            return ESP_ERR_TIMEOUT;
+        }
+        vTaskDelay(1);
+    }
+    return ESP_OK;
+}
+
+uint32_t esp_log_async_get_dropped(esp_log_level_t level)
+{
+    if (level > ESP_LOG_VERBOSE) {
+        return 0;
+    }
+    if (level != ESP_LOG_NONE) {
+        return atomic_load_explicit(&s_log_async_dropped[level], memory_order_relaxed);
+    }
+    uint32_t dropped = 0;
+    for (int i = ESP_LOG_ERROR; i <= ESP_LOG_VERBOSE; i++) {
+        dropped += atomic_load_explicit(&s_log_async_dropped[i], memory_order_relaxed);
+    }
+    return dropped;
+}
+
+size_t esp_log_async_panic_flush(void (*print_str)(const char *str))
+{
+    RingbufHandle_t buffer = s_log_async_buffer;
+    if (buffer == NULL) {
+        return 0;
+    }
+    // The other core is stalled by the panic handler, possibly while holding the ring buffer
+    // spinlock. The messages left are not printed in that case, rather than waiting for the lock.
+    size_t count = 0;
+    size_t size;
+    char *item;
+    while ((item = xRingbufferTryReceiveFromISR(buffer, &size)) != NULL) {
+        print_str(item + 1);
+        vRingbufferReturnItemFromISR(buffer, item, NULL);
+        atomic_fetch_sub_explicit(&s_log_async_pending, 1, memory_order_release);
+        count++;
+    }
+    return count;
+}
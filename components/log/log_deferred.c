@@ -0,0 +1,483 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Deferred logging implementation notes.
+ *
+ * In deferred mode, esp_log_writev does not format the message. It stores a
+ * record holding the address of the format string and the raw arguments in
+ * the ring buffer of the current core. Only the format strings which are
+ * read-only data of the application are referred to by their address, the
+ * others may not outlive the call and are copied into the record. The records are formatted later by
+ * esp_log_deferred_process, or read as binary by esp_log_deferred_read and
+ * decoded on the host by log_deferred_decode.py with the ELF file.
+ *
+ * Record layout, each field starting at a 4 byte aligned offset:
+ *
+ *     uint32_t header        record length in bytes | LOG_RECORD_COMMITTED
+ *     const char *format     address of the format string, or NULL if the
+ *                            format string follows, with its terminating zero
+ *     arguments              in the order of the conversions of the format,
+ *                            each with the size of its type after default
+ *                            argument promotions. Strings are copied with
+ *                            their terminating zero, truncated to
+ *                            LOG_RECORD_STRING_MAX characters.
+ *
+ * Tasks of any core may write to a ring at the same time. A writer reserves
+ * space by advancing the head with compare-and-swap, copies the record after
+ * the header, and commits the record by storing the header last. The reader
+ * stops at the first record which is not committed yet, and clears the
+ * records it consumes so that stale headers are never taken as committed.
+ */
+
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "esp_log_private.h"
+
+#if CONFIG_FREERTOS_NUMBER_OF_CORES
+#define LOG_RING_COUNT              CONFIG_FREERTOS_NUMBER_OF_CORES
+#else
+#define LOG_RING_COUNT              1
+#endif
+#define LOG_RING_SIZE               CONFIG_LOG_DEFERRED_BUFFER_SIZE
+
+#define LOG_RECORD_COMMITTED        0x80000000
+#define LOG_RECORD_LENGTH_MASK      0x0000ffff
+#define LOG_RECORD_MAX              256
+#define LOG_RECORD_STRING_MAX       64
+#define LOG_LINE_MAX                256
+
+_Static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0, "CONFIG_LOG_DEFERRED_BUFFER_SIZE must be a power of two");
+
+typedef struct {
+    atomic_uint_least32_t head;     // bytes reserved by writers since startup
+    atomic_uint_least32_t tail;     // bytes consumed by the reader since startup
+    uint32_t buf[LOG_RING_SIZE / sizeof(uint32_t)];
+} log_ring_t;
+
+// Type of the argument of a conversion
+typedef enum {
+    LOG_ARG_NONE,
+    LOG_ARG_INT,
+    LOG_ARG_LONG,
+    LOG_ARG_LLONG,
+    LOG_ARG_INTMAX,
+    LOG_ARG_SIZE,
+    LOG_ARG_PTRDIFF,
+    LOG_ARG_PTR,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_LDOUBLE,
+    LOG_ARG_STRING,
+} log_arg_t;
+
+typedef struct {
+    uint8_t *pos;
+    uint8_t *end;
+} log_cursor_t;
+
+static log_ring_t s_log_rings[LOG_RING_COUNT];
+static atomic_uint_least32_t s_log_dropped;
+static atomic_flag s_log_reading = ATOMIC_FLAG_INIT;
+
+/* Parses the conversion starting after a '%' of fmt. Returns the type of its
+   argument, sets *end after the conversion and *stars to the number of int
+   arguments which give the width and precision and come before the argument.
+*/
+static log_arg_t conversion_parse(const char *fmt, const char **end, int *stars)
+{
+    const char *p = fmt;
+    int length = 0; // 'h', 'l', 'L', 'j', 'z', 't', or 'l' + 'l' for "ll"
+
+    *stars = 0;
+    while (*p && strchr("-+ #0", *p)) {
+        p++;
+    }
+    if (*p == '*') {
+        (*stars)++;
+        p++;
+    }
+    while (*p >= '0' && *p <= '9') {
+        p++;
+    }
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            (*stars)++;
+            p++;
+        }
+        while (*p >= '0' && *p <= '9') {
+            p++;
+        }
+    }
+    while (*p && strchr("hlLjzt", *p)) {
+        length += *p++;
+    }
+
+    char conversion = *p;
+    if (conversion) {
+        p++;
+    }
+    *end = p;
+
+    switch (conversion) {
+    case 'd': case 'i': case 'o': case 'u': case 'x': case 'X': case 'c':
+        switch (length) {
+        case 'l':       return LOG_ARG_LONG;
+        case 'l' + 'l': return LOG_ARG_LLONG;
+        case 'j':       return LOG_ARG_INTMAX;
+        case 'z':       return LOG_ARG_SIZE;
+        case 't':       return LOG_ARG_PTRDIFF;
+        default:        return LOG_ARG_INT;
+        }
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        return length == 'L' ? LOG_ARG_LDOUBLE : LOG_ARG_DOUBLE;
+    case 's':
+        return LOG_ARG_STRING;
+    case 'p':
+        return LOG_ARG_PTR;
+    default:
+        // "%%", or a conversion which is not supported, such as "%n"
+        return LOG_ARG_NONE;
+    }
+}
+
+static inline bool cursor_put(log_cursor_t *c, const void *data, size_t size)
+{
+    size_t aligned = (size + 3) & ~3;
+    if ((size_t)(c->end - c->pos) < aligned) {
+        return false;
+    }
+    memcpy(c->pos, data, size);
+    c->pos += aligned;
+    return true;
+}
+
+static inline bool cursor_get(log_cursor_t *c, void *data, size_t size)
+{
+    size_t aligned = (size + 3) & ~3;
+    if ((size_t)(c->end - c->pos) < aligned) {
+        return false;
+    }
+    memcpy(data, c->pos, size);
+    c->pos += aligned;
+    return true;
+}
+
+static bool cursor_put_string(log_cursor_t *c, const char *str, size_t max_len)
+{
+    if (str == NULL) {
+        str = "(null)";
+    }
+    size_t len = strnlen(str, max_len);
+    size_t aligned = (len + 1 + 3) & ~3;
+    if ((size_t)(c->end - c->pos) < aligned) {
+        return false;
+    }
+    memcpy(c->pos, str, len);
+    memset(c->pos + len, 0, aligned - len);
+    c->pos += aligned;
+    return true;
+}
+
+// Returns the string at the cursor in the record, or NULL if it is not terminated
+static const char *cursor_get_string(log_cursor_t *c)
+{
+    const char *str = (const char *) c->pos;
+    size_t len = strnlen(str, c->end - c->pos);
+    if (len == (size_t)(c->end - c->pos)) {
+        return NULL;
+    }
+    c->pos += (len + 1 + 3) & ~3;
+    return str;
+}
+
+#define RECORD_PUT(cursor, type, value) do { \
+        type value_ = (value); \
+        if (!cursor_put(cursor, &value_, sizeof(value_))) { \
+            return 0; \
+        } \
+    } while (0)
+
+// Builds the record of a message in buf. Returns its length, or 0 if it does not fit.
+static size_t record_build(uint32_t *buf, const char *format, va_list args)
+{
+    log_cursor_t c = { .pos = (uint8_t *) buf, .end = (uint8_t *) buf + LOG_RECORD_MAX };
+    const char *p = format;
+
+    c.pos += sizeof(uint32_t); // header
+    if (esp_log_impl_format_is_static(format)) {
+        RECORD_PUT(&c, const char *, format);
+    } else {
+        // The format is copied whole, the record is dropped if it does not fit
+        RECORD_PUT(&c, const char *, NULL);
+        if (!cursor_put_string(&c, format, LOG_RECORD_MAX)) {
+            return 0;
+        }
+    }
+
+    while ((p = strchr(p, '%')) != NULL) {
+        int stars;
+        log_arg_t arg = conversion_parse(p + 1, &p, &stars);
+
+        for (int i = 0; i < stars; i++) {
+            RECORD_PUT(&c, int, va_arg(args, int));
+        }
+        switch (arg) {
+        case LOG_ARG_NONE:    break;
+        case LOG_ARG_INT:     RECORD_PUT(&c, int, va_arg(args, int)); break;
+        case LOG_ARG_LONG:    RECORD_PUT(&c, long, va_arg(args, long)); break;
+        case LOG_ARG_LLONG:   RECORD_PUT(&c, long long, va_arg(args, long long)); break;
+        case LOG_ARG_INTMAX:  RECORD_PUT(&c, intmax_t, va_arg(args, intmax_t)); break;
+        case LOG_ARG_SIZE:    RECORD_PUT(&c, size_t, va_arg(args, size_t)); break;
+        case LOG_ARG_PTRDIFF: RECORD_PUT(&c, ptrdiff_t, va_arg(args, ptrdiff_t)); break;
+        case LOG_ARG_PTR:     RECORD_PUT(&c, void *, va_arg(args, void *)); break;
+        case LOG_ARG_DOUBLE:  RECORD_PUT(&c, double, va_arg(args, double)); break;
+        case LOG_ARG_LDOUBLE: RECORD_PUT(&c, long double, va_arg(args, long double)); break;
+        case LOG_ARG_STRING:
+            if (!cursor_put_string(&c, va_arg(args, const char *), LOG_RECORD_STRING_MAX)) {
+                return 0;
+            }
+            break;
+        }
+    }
+
+    return c.pos - (uint8_t *) buf;
+}
+
+// Copies size bytes from data into the ring at pos, which wraps around at the end of the ring
+static void ring_write(log_ring_t *ring, uint32_t pos, const void *data, size_t size)
+{
+    uint8_t *buf = (uint8_t *) ring->buf;
+    size_t offset = pos & (LOG_RING_SIZE - 1);
+    size_t first = LOG_RING_SIZE - offset < size ? LOG_RING_SIZE - offset : size;
+
+    memcpy(buf + offset, data, first);
+    memcpy(buf, (const uint8_t *) data + first, size - first);
+}
+
+// Moves size bytes at pos out of the ring into data, and clears them
+static void ring_take(log_ring_t *ring, uint32_t pos, void *data, size_t size)
+{
+    uint8_t *buf = (uint8_t *) ring->buf;
+    size_t offset = pos & (LOG_RING_SIZE - 1);
+    size_t first = LOG_RING_SIZE - offset < size ? LOG_RING_SIZE - offset : size;
+
+    memcpy(data, buf + offset, first);
+    memcpy((uint8_t *) data + first, buf, size - first);
+    memset(buf + offset, 0, first);
+    memset(buf, 0, size - first);
+}
+
+static inline atomic_uint_least32_t *ring_header(log_ring_t *ring, uint32_t pos)
+{
+    return (atomic_uint_least32_t *) &ring->buf[(pos & (LOG_RING_SIZE - 1)) / sizeof(uint32_t)];
+}
+
+void esp_log_deferred_write(const char *format, va_list args)
+{
+    uint32_t record[LOG_RECORD_MAX / sizeof(uint32_t)];
+    size_t len = record_build(record, format, args);
+    log_ring_t *ring = &s_log_rings[esp_log_impl_get_core_id() % LOG_RING_COUNT];
+
+    if (len == 0) {
+        atomic_fetch_add(&s_log_dropped, 1);
+        return;
+    }
+
+    // Reserve space for the record
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    do {
+        uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        if (head - tail + len > LOG_RING_SIZE) {
+            atomic_fetch_add(&s_log_dropped, 1);
+            return;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&ring->head, &head, head + len,
+                                                    memory_order_relaxed, memory_order_relaxed));
+
+    // Copy the record, then commit it by storing its header
+    ring_write(ring, head + sizeof(uint32_t), record + 1, len - sizeof(uint32_t));
+    atomic_store_explicit(ring_header(ring, head), len | LOG_RECORD_COMMITTED, memory_order_release);
+}
+
+// Takes the oldest committed record of a ring into buf. Returns its length, or 0 if there is none.
+static size_t ring_take_record(log_ring_t *ring, uint32_t *buf)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t header = atomic_load_explicit(ring_header(ring, tail), memory_order_acquire);
+
+    if (!(header & LOG_RECORD_COMMITTED)) {
+        return 0;
+    }
+
+    size_t len = header & LOG_RECORD_LENGTH_MASK;
+    ring_take(ring, tail, buf, len);
+    buf[0] = len;
+    atomic_store_explicit(&ring->tail, tail + len, memory_order_release);
+    return len;
+}
+
+// Moves the output position after n characters written by snprintf, or to the end of the line if truncated
+static inline void line_advance(char **out, size_t *left, int n)
+{
+    size_t written = (size_t) n < *left ? (size_t) n : *left - 1;
+    *out += written;
+    *left -= written;
+}
+
+#define RECORD_FORMAT(cursor, type) do { \
+        type value_; \
+        if (!cursor_get(cursor, &value_, sizeof(value_))) { \
+            return; \
+        } \
+        n = stars == 0 ? snprintf(out, left, spec, value_) : \
+            stars == 1 ? snprintf(out, left, spec, star[0], value_) : \
+                         snprintf(out, left, spec, star[0], star[1], value_); \
+    } while (0)
+
+// Formats a record into line
+static void record_format(uint32_t *record, size_t len, char *line, size_t size)
+{
+    log_cursor_t c = { .pos = (uint8_t *) record + sizeof(uint32_t), .end = (uint8_t *) record + len };
+    const char *format;
+    char *out = line;
+    size_t left = size;
+
+    line[0] = '\0';
+    if (!cursor_get(&c, &format, sizeof(format))) {
+        return;
+    }
+    if (format == NULL) {
+        format = cursor_get_string(&c);
+        if (format == NULL) {
+            return;
+        }
+    }
+
+    const char *p = format;
+    while (*p && left > 1) {
+        const char *percent = strchr(p, '%');
+        size_t literal = percent ? (size_t)(percent - p) : strlen(p);
+        int n;
+
+        // Text up to the next conversion
+        n = snprintf(out, left, "%.*s", (int) literal, p);
+        line_advance(&out, &left, n);
+        if (percent == NULL) {
+            break;
+        }
+
+        int stars;
+        int star[2] = { 0 };
+        char spec[32];
+        log_arg_t arg = conversion_parse(percent + 1, &p, &stars);
+
+        if ((size_t)(p - percent) >= sizeof(spec)) {
+            return;
+        }
+        memcpy(spec, percent, p - percent);
+        spec[p - percent] = '\0';
+        for (int i = 0; i < stars; i++) {
+            if (!cursor_get(&c, &star[i], sizeof(int))) {
+                return;
+            }
+        }
+
+        switch (arg) {
+        case LOG_ARG_NONE:    n = snprintf(out, left, "%s", strcmp(spec, "%%") == 0 ? "%" : spec); break;
+        case LOG_ARG_INT:     RECORD_FORMAT(&c, int); break;
+        case LOG_ARG_LONG:    RECORD_FORMAT(&c, long); break;
+        case LOG_ARG_LLONG:   RECORD_FORMAT(&c, long long); break;
+        case LOG_ARG_INTMAX:  RECORD_FORMAT(&c, intmax_t); break;
+        case LOG_ARG_SIZE:    RECORD_FORMAT(&c, size_t); break;
+        case LOG_ARG_PTRDIFF: RECORD_FORMAT(&c, ptrdiff_t); break;
+        case LOG_ARG_PTR:     RECORD_FORMAT(&c, void *); break;
+        case LOG_ARG_DOUBLE:  RECORD_FORMAT(&c, double); break;
+        case LOG_ARG_LDOUBLE: RECORD_FORMAT(&c, long double); break;
+        case LOG_ARG_STRING: {
+            const char *str = cursor_get_string(&c);
+            if (str == NULL) {
+                return;
+            }
+            n = stars == 0 ? snprintf(out, left, spec, str) :
+                stars == 1 ? snprintf(out, left, spec, star[0], str) :
+                             snprintf(out, left, spec, star[0], star[1], str);
+            break;
+        }
+        }
+        if (n < 0) {
+            return;
+        }
+        line_advance(&out, &left, n);
+    }
+}
+
+size_t esp_log_deferred_process(void)
+{
+    uint32_t record[LOG_RECORD_MAX / sizeof(uint32_t)];
+    char line[LOG_LINE_MAX];
+    size_t count = 0;
+
+    // Records are taken by a single reader at a time
+    if (atomic_flag_test_and_set(&s_log_reading)) {
+        return 0;
+    }
+
+    for (int i = 0; i < LOG_RING_COUNT; i++) {
+        size_t len;
+        while ((len = ring_take_record(&s_log_rings[i], record)) != 0) {
+            record_format(record, len, line, sizeof(line));
+            esp_log_output("%s", line);
+            count++;
+        }
+    }
+
+    atomic_flag_clear(&s_log_reading);
+    return count;
+}
+
+size_t esp_log_deferred_read(void *buffer, size_t size)
+{
+    uint8_t *dst = (uint8_t *) buffer;
+    size_t total = 0;
+
+    if (atomic_flag_test_and_set(&s_log_reading)) {
+        return 0;
+    }
+
+    for (int i = 0; i < LOG_RING_COUNT; i++) {
+        log_ring_t *ring = &s_log_rings[i];
+
+        while (true) {
+            uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+            uint32_t header = atomic_load_explicit(ring_header(ring, tail), memory_order_acquire);
+            size_t len = header & LOG_RECORD_LENGTH_MASK;
+
+            if (!(header & LOG_RECORD_COMMITTED) || size - total < len) {
+                break;
+            }
+            uint32_t length = len;
+            ring_take(ring, tail, dst + total, len);
+            memcpy(dst + total, &length, sizeof(length));
+            atomic_store_explicit(&ring->tail, tail + len, memory_order_release);
+            total += len;
+        }
+    }
+
+    atomic_flag_clear(&s_log_reading);
+    return total;
+}
+
+uint32_t esp_log_deferred_get_dropped(void)
+{
+    return atomic_load(&s_log_dropped);
+}
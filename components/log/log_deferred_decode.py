@@ -0,0 +1,175 @@
+#!/usr/bin/env python
+#
+# SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+#
+# Decodes deferred log records read on the target by esp_log_deferred_read() into text.
+# The records hold the addresses of the format strings, which are read from the ELF file of
+# the application, unless the format string was not read-only data and is copied in the record.
+#
+# Usage: log_deferred_decode.py build/app.elf records.bin
+
+import argparse
+import re
+import struct
+import sys
+from typing import BinaryIO, Callable, Dict, Iterator, List, Optional, Tuple, Union
+
+# Same grammar as conversion_parse() in log_deferred.c
+CONVERSION_RE = re.compile(r'%([-+ #0]*)(\*|\d*)(?:\.(\*|\d*))?([hlLjzt]*)(.?)', re.DOTALL)
+
+INTEGER_CONVERSIONS = 'diouxXc'
+FLOAT_CONVERSIONS = 'fFeEgGaA'
+
+
+class Record:
+    def __init__(self, data: bytes) -> None:
+        self.data = data
+        self.pos = 8
+
+    @property
+    def format_address(self) -> int:
+        return int(struct.unpack_from('<I', self.data, 4)[0])
+
+    def take(self, fmt: str) -> Union[int, float]:
+        size = struct.calcsize(fmt)
+        if self.pos + size > len(self.data):
+            raise ValueError('record too short')
+        value = struct.unpack_from(fmt, self.data, self.pos)[0]
+        self.pos += (size + 3) & ~3
+        return value  # type: ignore
+
+    def take_string(self) -> str:
+        end = self.data.find(b'\0', self.pos)
+        if end < 0:
+            raise ValueError('string not terminated')
+        value = self.data[self.pos:end].decode('utf-8', errors='replace')
+        self.pos += (end - self.pos + 1 + 3) & ~3
+        return value
+
+
+def read_records(stream: BinaryIO) -> Iterator[Record]:
+    data = stream.read()
+    pos = 0
+    while pos + 8 <= len(data):
+        length = struct.unpack_from('<I', data, pos)[0]
+        if length < 8 or pos + length > len(data):
+            raise ValueError('invalid record at offset {}'.format(pos))
+        yield Record(data[pos:pos + length])
+        pos += length
+
+
+def integer_format(length: str, conversion: str) -> str:
+    signed = conversion in 'di'
+    size = 'q' if length in ('ll', 'j') else 'i'
+    return '<' + (size if signed else size.upper())
+
+
+def format_record(record: Record, fmt: str, long_double_size: int) -> str:
+    out = []  # type: List[str]
+    pos = 0
+    for match in CONVERSION_RE.finditer(fmt):
+        out.append(fmt[pos:match.start()])
+        pos = match.end()
+        flags, width, precision, length, conversion = match.groups()
+
+        stars = []  # type: List[Union[int, float]]
+        for field in (width, precision):
+            if field == '*':
+                stars.append(record.take('<i'))
+
+        spec = '%' + flags + width + ('.' + precision if precision is not None else '')
+        if conversion in INTEGER_CONVERSIONS:
+            value = record.take(integer_format(length, conversion))  # type: Union[int, float, str]
+            if conversion == 'c':
+                value = chr(int(value) & 0xff)
+            elif conversion in 'iu':
+                conversion = 'd'
+        elif conversion in FLOAT_CONVERSIONS:
+            if length == 'L' and long_double_size != 8:
+                record.take('<{}s'.format(long_double_size))
+                out.append('?')
+                continue
+            value = record.take('<d')
+            if conversion in 'aA':
+                value = float(value).hex()
+                conversion = 's'
+            elif conversion == 'F':
+                conversion = 'f'
+        elif conversion == 's':
+            value = record.take_string()
+        elif conversion == 'p':
+            value = record.take('<I')
+            spec = '0x' + spec
+            conversion = 'x'
+        else:
+            out.append('%' if conversion == '%' else match.group(0))
+            continue
+        out.append((spec + conversion) % tuple(stars + [value]))
+
+    out.append(fmt[pos:])
+    return ''.join(out)
+
+
+def decode_records(stream: BinaryIO, read_string: Callable[[int], Optional[str]],
+                   long_double_size: int = 8) -> Iterator[str]:
+    for record in read_records(stream):
+        try:
+            if record.format_address == 0:
+                fmt = record.take_string()  # type: Optional[str]
+            else:
+                fmt = read_string(record.format_address)
+        except ValueError as e:
+            yield '<invalid record: {}>\n'.format(e)
+            continue
+        if fmt is None:
+            yield '<unknown format string at 0x{:08x}>\n'.format(record.format_address)
+            continue
+        try:
+            yield format_record(record, fmt, long_double_size)
+        except ValueError as e:
+            yield '<invalid record for format "{}": {}>\n'.format(fmt.rstrip(), e)
+
+
+def elf_string_reader(elf_path: str) -> Callable[[int], Optional[str]]:
+    from elftools.elf.constants import SH_FLAGS
+    from elftools.elf.elffile import ELFFile
+
+    sections = []  # type: List[Tuple[int, bytes]]
+    with open(elf_path, 'rb') as f:
+        elf = ELFFile(f)
+        for section in elf.iter_sections():
+            if section['sh_flags'] & SH_FLAGS.SHF_ALLOC and section['sh_type'] != 'SHT_NOBITS':
+                sections.append((section['sh_addr'], section.data()))
+
+    cache = {}  # type: Dict[int, Optional[str]]
+
+    def read(address: int) -> Optional[str]:
+        if address not in cache:
+            cache[address] = None
+            for start, data in sections:
+                if start <= address < start + len(data):
+                    end = data.find(b'\0', address - start)
+                    cache[address] = data[address - start:end].decode('utf-8', errors='replace')
+                    break
+        return cache[address]
+
+    return read
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description='Decode deferred log records read by esp_log_deferred_read()')
+    parser.add_argument('elf', help='ELF file of the application which wrote the records')
+    parser.add_argument('records', type=argparse.FileType('rb'), nargs='?', default=sys.stdin.buffer,
+                        help='file holding the records, standard input by default')
+    parser.add_argument('--long-double-size', type=int, default=8, choices=(8, 16),
+                        help='size of long double on the target, 16 for RISC-V targets')
+    args = parser.parse_args()
+
+    read_string = elf_string_reader(args.elf)
+    for line in decode_records(args.records, read_string, args.long_double_size):
+        sys.stdout.write(line)
+
+
+if __name__ == '__main__':
+    main()
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -12,6 +12,7 @@
 #include "freertos/semphr.h"
 #include "esp_cpu.h" // for esp_cpu_get_cycle_count()
 #include "esp_compiler.h"
+#include "esp_memory_utils.h"
 #include "esp_log.h"
 #include "esp_log_private.h"
 
@@ -55,6 +56,43 @@ void esp_log_impl_unlock(void)
     xSemaphoreGive(s_log_mutex);
 }
 
+#if CONFIG_LOG_DEFERRED
+unsigned esp_log_impl_get_core_id(void)
+{
+    return xPortGetCoreID();
+}
+
+#if CONFIG_LOG_DEFERRED_TASK
+#define LOG_DEFERRED_TASK_PERIOD_TICKS ((CONFIG_LOG_DEFERRED_TASK_PERIOD_MS + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS)
+
+static void log_deferred_task(void *arg)
+{
+    while (1) {
+        esp_log_deferred_process();
+        vTaskDelay(LOG_DEFERRED_TASK_PERIOD_TICKS);
+    }
+}
+#endif
+
+void esp_log_impl_deferred_start(void)
+{
+#if CONFIG_LOG_DEFERRED_TASK
+    static TaskHandle_t s_log_deferred_task = NULL;
+
+    if (s_log_deferred_task == NULL && xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED) {
+        xTaskCreate(log_deferred_task, "log_deferred", CONFIG_LOG_DEFERRED_TASK_STACK_SIZE, NULL,
+                    CONFIG_LOG_DEFERRED_TASK_PRIORITY, &s_log_deferred_task);
+    }
+#endif
+}
+
+bool esp_log_impl_format_is_static(const char *format)
+{
+    // Formats in IRAM, DRAM or PSRAM are copied into the records
+    return esp_ptr_in_drom(format);
+}
+#endif // CONFIG_LOG_DEFERRED
+
 char *esp_log_system_timestamp(void)
 {
     static char buffer[18] = {0};
@@ -28,6 +28,25 @@ void esp_log_impl_unlock(void)
     assert(pthread_mutex_unlock(&mutex1) == 0);
 }
 
+#if CONFIG_LOG_DEFERRED
+unsigned esp_log_impl_get_core_id(void)
+{
+    return 0;
+}
+
+void esp_log_impl_deferred_start(void)
+{
+    // There is no task printing the deferred logs, esp_log_deferred_process() has to be called
+}
+
+bool esp_log_impl_format_is_static(const char *format)
+{
+    // Read-only sections of the executable, between the code and the writable data
+    extern const char etext[], __data_start[];
+    return format >= etext && format < __data_start;
+}
+#endif
+
 uint32_t esp_log_timestamp(void)
 {
     struct timespec current_time;
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2019-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2019-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -8,6 +8,7 @@
 #include "esp_log_private.h"
 #include "esp_rom_sys.h"
 #include "esp_cpu.h"
+#include "esp_memory_utils.h"
 
 static int s_lock = 0;
 
@@ -29,6 +30,29 @@ void esp_log_impl_unlock(void)
     s_lock = 0;
 }
 
+#if CONFIG_LOG_DEFERRED
+unsigned esp_log_impl_get_core_id(void)
+{
+    return 0;
+}
+
+void esp_log_impl_deferred_start(void)
+{
+}
+
+bool esp_log_impl_format_is_static(const char *format)
+{
+    return esp_ptr_in_drom(format);
+}
+#endif
+
+#if CONFIG_LOG_ASYNC
+bool esp_log_async_write(esp_log_level_t level, const char *format, va_list args)
+{
+    return false;
+}
+#endif
+
 /* FIXME: define an API for getting the timestamp in soc/hal IDF-2351 */
 uint32_t esp_log_early_timestamp(void)
 {
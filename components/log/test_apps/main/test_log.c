@@ -1,10 +1,11 @@
 /*
- * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2023-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <inttypes.h>
 #include "unity.h"
 #include "freertos/FreeRTOS.h"
@@ -55,3 +56,129 @@ TEST_CASE("test master logging level performance", "[log]")
     esp_log_level_set("*", ESP_LOG_INFO);
     ESP_LOGI(TAG, "End");
 }
+
+#if CONFIG_LOG_ASYNC
+static volatile int s_async_printed;
+static volatile bool s_async_slow;
+static char s_async_last[CONFIG_LOG_ASYNC_MAX_MESSAGE_LENGTH + 2];
+
+static int async_vprintf(const char *format, va_list args)
+{
+    if (s_async_slow) {
+        vTaskDelay(1);
+    }
+    va_list args_copy;
+    va_copy(args_copy, args);
+    vsnprintf(s_async_last, sizeof(s_async_last), format, args_copy);
+    va_end(args_copy);
+    s_async_printed++;
+    return vprintf(format, args);
+}
+
+static void async_flood(void)
+{
+    s_async_slow = true;
+    for (int i = 0; i < 100; i++) {
+        ESP_LOGW(TAG, "async flood %d", i);
+    }
+    s_async_slow = false;
+    TEST_ESP_OK(esp_log_async_flush(5000));
+}
+
+TEST_CASE("async log sink prints messages from its task and counts drops", "[log]")
+{
+    vprintf_like_t orig_vprintf = esp_log_set_vprintf(async_vprintf);
+    s_async_printed = 0;
+    esp_log_async_config_t config = ESP_LOG_ASYNC_CONFIG_DEFAULT();
+    config.buffer_size = 512;
+    config.policy = ESP_LOG_ASYNC_DROP_OLDEST;
+    TEST_ESP_OK(esp_log_async_start(&config));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, esp_log_async_start(&config));
+
+    for (int i = 0; i < 3; i++) {
+        ESP_LOGI(TAG, "async message %d", i);
+    }
+    TEST_ESP_OK(esp_log_async_flush(1000));
+    TEST_ASSERT_EQUAL(3, s_async_printed);
+    TEST_ASSERT_EQUAL(0, esp_log_async_get_dropped(ESP_LOG_NONE));
+
+    async_flood();
+    uint32_t dropped = esp_log_async_get_dropped(ESP_LOG_WARN);
+    TEST_ASSERT_GREATER_THAN(0, dropped);
+    TEST_ASSERT_EQUAL(0, esp_log_async_get_dropped(ESP_LOG_INFO));
+    TEST_ASSERT_EQUAL(dropped, esp_log_async_get_dropped(ESP_LOG_NONE));
+    TEST_ASSERT_EQUAL(103, s_async_printed + dropped);
+    // The oldest messages were dropped, the last one is printed
+    TEST_ASSERT_NOT_NULL(strstr(s_async_last, "async flood 99"));
+
+    TEST_ESP_OK(esp_log_async_stop());
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, esp_log_async_stop());
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, esp_log_async_flush(0));
+    // Printed synchronously once stopped
+    int printed = s_async_printed;
+    ESP_LOGI(TAG, "sync message");
+    TEST_ASSERT_EQUAL(printed + 1, s_async_printed);
+
+    esp_log_set_vprintf(orig_vprintf);
+}
+
+TEST_CASE("async log sink drops the newest messages when full", "[log]")
+{
+    vprintf_like_t orig_vprintf = esp_log_set_vprintf(async_vprintf);
+    s_async_printed = 0;
+    esp_log_async_config_t config = ESP_LOG_ASYNC_CONFIG_DEFAULT();
+    config.buffer_size = 512;
+    config.policy = ESP_LOG_ASYNC_DROP_NEWEST;
+    TEST_ESP_OK(esp_log_async_start(&config));
+    // The counters of the previous sink are reset
+    TEST_ASSERT_EQUAL(0, esp_log_async_get_dropped(ESP_LOG_NONE));
+
+    async_flood();
+    uint32_t dropped = esp_log_async_get_dropped(ESP_LOG_WARN);
+    TEST_ASSERT_GREATER_THAN(0, dropped);
+    TEST_ASSERT_EQUAL(100, s_async_printed + dropped);
+    TEST_ASSERT_NULL(strstr(s_async_last, "async flood 99"));
+
+    TEST_ESP_OK(esp_log_async_stop());
+    esp_log_set_vprintf(orig_vprintf);
+}
+
+TEST_CASE("async log sink waits for space when full", "[log]")
+{
+    vprintf_like_t orig_vprintf = esp_log_set_vprintf(async_vprintf);
+    s_async_printed = 0;
+    esp_log_async_config_t config = ESP_LOG_ASYNC_CONFIG_DEFAULT();
+    config.buffer_size = 512;
+    config.policy = ESP_LOG_ASYNC_BLOCK;
+    config.block_timeout_ms = 1000;
+    TEST_ESP_OK(esp_log_async_start(&config));
+
+    async_flood();
+    TEST_ASSERT_EQUAL(0, esp_log_async_get_dropped(ESP_LOG_NONE));
+    TEST_ASSERT_EQUAL(100, s_async_printed);
+    TEST_ASSERT_NOT_NULL(strstr(s_async_last, "async flood 99"));
+
+    TEST_ESP_OK(esp_log_async_stop());
+    esp_log_set_vprintf(orig_vprintf);
+}
+
+TEST_CASE("async log sink truncates long messages", "[log]")
+{
+    vprintf_like_t orig_vprintf = esp_log_set_vprintf(async_vprintf);
+    esp_log_async_config_t config = ESP_LOG_ASYNC_CONFIG_DEFAULT();
+    TEST_ESP_OK(esp_log_async_start(&config));
+
+    char *long_str = malloc(CONFIG_LOG_ASYNC_MAX_MESSAGE_LENGTH + 1);
+    TEST_ASSERT_NOT_NULL(long_str);
+    memset(long_str, 'x', CONFIG_LOG_ASYNC_MAX_MESSAGE_LENGTH);
+    long_str[CONFIG_LOG_ASYNC_MAX_MESSAGE_LENGTH] = '\0';
+    ESP_LOGI(TAG, "%s", long_str);
+    TEST_ESP_OK(esp_log_async_flush(1000));
+    // The line break is kept at the end of a truncated message
+    TEST_ASSERT_EQUAL('\n', s_async_last[strlen(s_async_last) - 1]);
+    free(long_str);
+
+    TEST_ESP_OK(esp_log_async_stop());
+    esp_log_set_vprintf(orig_vprintf);
+}
+#endif // CONFIG_LOG_ASYNC
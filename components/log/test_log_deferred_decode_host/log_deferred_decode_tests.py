@@ -0,0 +1,89 @@
+#!/usr/bin/env python
+# SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+import io
+import struct
+import sys
+import unittest
+from typing import List, Optional
+
+try:
+    import log_deferred_decode
+except ImportError:
+    sys.path.append('..')
+    import log_deferred_decode
+
+
+'''
+To run the test on local PC:
+cd ~/esp/esp-idf/components/log/test_log_deferred_decode_host/
+ ./log_deferred_decode_tests.py
+'''
+
+FORMATS = {
+    0x3f400010: 'I (%lu) %s: value %d\n',
+    0x3f400040: '%5.*f|%-4s|%%|%c|%p\n',
+    0x3f400080: '%lld %llu %x %08X\n',
+}
+
+
+def read_string(address: int) -> Optional[str]:
+    return FORMATS.get(address)
+
+
+def pad(data: bytes) -> bytes:
+    return data + b'\0' * (-len(data) % 4)
+
+
+def string(value: str) -> bytes:
+    return pad(value.encode() + b'\0')
+
+
+def record(format_address: int, *args: bytes) -> bytes:
+    # Same layout as the records of log_deferred.c: length, format address, arguments aligned to 4 bytes
+    body = struct.pack('<I', format_address) + b''.join(pad(arg) for arg in args)
+    return struct.pack('<I', 4 + len(body)) + body
+
+
+def decode(data: bytes) -> List[str]:
+    return list(log_deferred_decode.decode_records(io.BytesIO(data), read_string))
+
+
+class DecodeTests(unittest.TestCase):
+
+    def test_format_from_elf(self) -> None:
+        data = record(0x3f400010, struct.pack('<I', 1234), string('tag'), struct.pack('<i', -5))
+        self.assertEqual(decode(data), ['I (1234) tag: value -5\n'])
+
+    def test_conversions(self) -> None:
+        data = record(0x3f400040, struct.pack('<i', 2), struct.pack('<d', 3.14159), string('ab'), struct.pack('<i', 0x41),
+                      struct.pack('<I', 0x3fc80000))
+        data += record(0x3f400080, struct.pack('<q', -1), struct.pack('<Q', 2 ** 40), struct.pack('<I', 255),
+                       struct.pack('<I', 0xbeef))
+        self.assertEqual(decode(data), [' 3.14|ab  |%|A|0x3fc80000\n', '-1 1099511627776 ff 0000BEEF\n'])
+
+    def test_copied_format(self) -> None:
+        # Format strings which are not read-only data are copied after a NULL address
+        data = record(0, string('runtime %s %d\n'), string('format'), struct.pack('<i', 7))
+        self.assertEqual(decode(data), ['runtime format 7\n'])
+
+    def test_unknown_format(self) -> None:
+        data = record(0x12345678, struct.pack('<i', 1)) + record(0x3f400010, struct.pack('<I', 1), string('t'),
+                                                                  struct.pack('<i', 2))
+        self.assertEqual(decode(data), ['<unknown format string at 0x12345678>\n', 'I (1) t: value 2\n'])
+
+    def test_invalid_records(self) -> None:
+        # Missing argument, then a copied format which is not terminated
+        data = record(0x3f400010, struct.pack('<I', 1), string('t'))
+        data += record(0, b'abcd')
+        self.assertEqual(decode(data), ['<invalid record for format "I (%lu) %s: value %d": record too short>\n',
+                                        '<invalid record: string not terminated>\n'])
+
+    def test_truncated_stream(self) -> None:
+        data = record(0x3f400010, struct.pack('<I', 1), string('t'), struct.pack('<i', 2))
+        with self.assertRaises(ValueError):
+            decode(data[:-4])
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -1,10 +1,11 @@
 /*
- * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2022-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
 #pragma once
 
+#include <sys/uio.h>    // struct iovec, which lwIP doesn't define again
 #include_next "lwip/sockets.h"
 #include "sdkconfig.h"
 
@@ -12,6 +13,15 @@
 extern "C" {
 #endif
 
+#if CONFIG_VFS_SUPPORT_EPOLL && !CONFIG_IDF_TARGET_LINUX
+/* Reports the readiness of a socket to the epoll sets watching it, called after each read
+ * since the data left by a partial read doesn't cause a socket event */
+void esp_vfs_lwip_epoll_update(int s);
+#define ESP_LWIP_EPOLL_UPDATE(s) esp_vfs_lwip_epoll_update(s)
+#else
+#define ESP_LWIP_EPOLL_UPDATE(s)
+#endif
+
 static inline int accept(int s,struct sockaddr *addr,socklen_t *addrlen)
 { return lwip_accept(s,addr,addrlen); }
 static inline int bind(int s,const struct sockaddr *name, socklen_t namelen)
@@ -33,11 +43,11 @@ static inline int connect(int s,const struct sockaddr *name,socklen_t namelen)
 static inline int listen(int s,int backlog)
 { return lwip_listen(s,backlog); }
 static inline ssize_t recvmsg(int sockfd, struct msghdr *msg, int flags)
-{ return lwip_recvmsg(sockfd, msg, flags); }
+{ ssize_t ret = lwip_recvmsg(sockfd, msg, flags); ESP_LWIP_EPOLL_UPDATE(sockfd); return ret; }
 static inline ssize_t recv(int s,void *mem,size_t len,int flags)
-{ return lwip_recv(s,mem,len,flags); }
+{ ssize_t ret = lwip_recv(s,mem,len,flags); ESP_LWIP_EPOLL_UPDATE(s); return ret; }
 static inline ssize_t recvfrom(int s,void *mem,size_t len,int flags,struct sockaddr *from,socklen_t *fromlen)
-{ return lwip_recvfrom(s,mem,len,flags,from,fromlen); }
+{ ssize_t ret = lwip_recvfrom(s,mem,len,flags,from,fromlen); ESP_LWIP_EPOLL_UPDATE(s); return ret; }
 static inline ssize_t send(int s,const void *dataptr,size_t size,int flags)
 { return lwip_send(s,dataptr,size,flags); }
 static inline ssize_t sendmsg(int s,const struct msghdr *message,int flags)
@@ -1,9 +1,10 @@
 /*
- * SPDX-FileCopyrightText: 2017-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2017-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 #include <stdarg.h>
@@ -15,6 +16,12 @@
 #include "sdkconfig.h"
 #include "lwip/sockets.h"
 #include "lwip/sys.h"
+#ifdef CONFIG_VFS_SUPPORT_EPOLL
+#include <sys/poll.h>
+#include "lwip/api.h"
+#include "lwip/priv/sockets_priv.h"
+#include "freertos/FreeRTOS.h"
+#endif
 
 #ifndef CONFIG_VFS_SUPPORT_IO
 #error This file should only be built when CONFIG_VFS_SUPPORT_IO=y
@@ -52,6 +59,144 @@ static void *lwip_get_socket_select_semaphore(void)
      */
     return (void *) sys_thread_sem_get();
 }
+
+#ifdef CONFIG_VFS_SUPPORT_EPOLL
+/*
+ * Each lwip_poll_args_t structure records an epoll set watching a socket, they form a linked list in
+ * s_poll_args[socket - LWIP_SOCKET_OFFSET].
+ *
+ * The netconn callback of a watched socket is replaced by lwip_poll_event_callback, which calls the
+ * callback of the socket layer (event_callback in sockets.c, which counts the events used by select)
+ * and then reports the readiness to the epoll sets. The data left in the socket by a partial read
+ * doesn't cause an event, so the socket is also reported after each read.
+ */
+typedef struct lwip_poll_args_t {
+    esp_vfs_epoll_watch_t       *watch;
+    struct lwip_poll_args_t     *next;
+} lwip_poll_args_t;
+
+static lwip_poll_args_t *s_poll_args[CONFIG_LWIP_MAX_SOCKETS];
+static portMUX_TYPE s_poll_lock = portMUX_INITIALIZER_UNLOCKED;
+static netconn_callback s_lwip_event_callback;
+
+static uint32_t lwip_poll_events(const struct lwip_sock *sock)
+{
+    // same conditions as lwip_selscan
+    uint32_t events = 0;
+    if (sock->lastdata.pbuf != NULL || sock->rcvevent > 0) {
+        events |= POLLIN;
+    }
+    if (sock->sendevent != 0) {
+        events |= POLLOUT;
+    }
+    if (sock->errevent != 0) {
+        events |= POLLERR;
+    }
+    return events;
+}
+
+void esp_vfs_lwip_epoll_update(int s)
+{
+    const int index = s - LWIP_SOCKET_OFFSET;
+    if (index < 0 || index >= CONFIG_LWIP_MAX_SOCKETS || s_poll_args[index] == NULL) {
+        // start_poll reports the socket itself after adding it to the list
+        return;
+    }
+    portENTER_CRITICAL(&s_poll_lock);
+    const struct lwip_sock *sock = lwip_socket_dbg_get_socket(s);
+    if (sock != NULL) {
+        const uint32_t events = lwip_poll_events(sock);
+        for (lwip_poll_args_t *poll_args = s_poll_args[index]; poll_args != NULL; poll_args = poll_args->next) {
+            esp_vfs_epoll_ready(poll_args->watch, events);
+        }
+    }
+    portEXIT_CRITICAL(&s_poll_lock);
+}
+
+static void lwip_poll_event_callback(struct netconn *conn, enum netconn_evt evt, u16_t len)
+{
+    s_lwip_event_callback(conn, evt, len);
+    // conn->socket is negative for the events received before the socket is allocated
+    esp_vfs_lwip_epoll_update(conn->socket);
+}
+
+static esp_err_t lwip_start_poll(int fd, esp_vfs_epoll_watch_t *watch)
+{
+    const int index = fd - LWIP_SOCKET_OFFSET;
+    if (index < 0 || index >= CONFIG_LWIP_MAX_SOCKETS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    lwip_poll_args_t *poll_args = (lwip_poll_args_t *)malloc(sizeof(lwip_poll_args_t));
+    if (poll_args == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    poll_args->watch = watch;
+
+    esp_err_t error = ESP_OK;
+    portENTER_CRITICAL(&s_poll_lock);
+    struct lwip_sock *sock = lwip_socket_dbg_get_socket(fd);
+    if (sock == NULL || sock->conn == NULL) {
+        error = ESP_ERR_INVALID_STATE;
+    } else {
+        // every socket uses the same callback, accepted sockets inherit the replaced one
+        if (s_lwip_event_callback == NULL) {
+            s_lwip_event_callback = sock->conn->callback;
+        }
+        if (sock->conn->callback == s_lwip_event_callback) {
+            sock->conn->callback = lwip_poll_event_callback;
+        }
+        if (sock->conn->callback == lwip_poll_event_callback) {
+            poll_args->next = s_poll_args[index];
+            s_poll_args[index] = poll_args;
+            esp_vfs_epoll_ready(watch, lwip_poll_events(sock));
+        } else {
+            // unknown callback, the epoll set checks the socket with select
+            error = ESP_ERR_NOT_SUPPORTED;
+        }
+    }
+    portEXIT_CRITICAL(&s_poll_lock);
+
+    if (error != ESP_OK) {
+        free(poll_args);
+    }
+    return error;
+}
+
+static void lwip_end_poll(int fd, esp_vfs_epoll_watch_t *watch)
+{
+    const int index = fd - LWIP_SOCKET_OFFSET;
+    if (index < 0 || index >= CONFIG_LWIP_MAX_SOCKETS) {
+        return;
+    }
+    lwip_poll_args_t *found = NULL;
+    portENTER_CRITICAL(&s_poll_lock);
+    lwip_poll_args_t **poll_args = &s_poll_args[index];
+    while (*poll_args != NULL) {
+        if ((*poll_args)->watch == watch) {
+            found = *poll_args;
+            *poll_args = found->next;
+            break;
+        }
+        poll_args = &(*poll_args)->next;
+    }
+    portEXIT_CRITICAL(&s_poll_lock);
+    free(found);
+}
+
+static ssize_t lwip_read_and_poll(int fd, void *mem, size_t len)
+{
+    const ssize_t ret = lwip_read(fd, mem, len);
+    esp_vfs_lwip_epoll_update(fd);
+    return ret;
+}
+
+static ssize_t lwip_readv_and_poll(int fd, const struct iovec *iov, int iovcnt)
+{
+    const ssize_t ret = lwip_readv(fd, iov, iovcnt);
+    esp_vfs_lwip_epoll_update(fd);
+    return ret;
+}
+#endif // CONFIG_VFS_SUPPORT_EPOLL
 #else // CONFIG_VFS_SUPPORT_SELECT
 
 int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *errorfds, struct timeval *timeout)
@@ -91,7 +236,14 @@ void esp_vfs_lwip_sockets_register(void)
         .open = NULL,
         .fstat = &lwip_fstat,
         .close = &lwip_close,
+#ifdef CONFIG_VFS_SUPPORT_EPOLL
+        .read = &lwip_read_and_poll,
+        .readv = &lwip_readv_and_poll,
+#else
         .read = &lwip_read,
+        .readv = &lwip_readv,
+#endif
+        .writev = &lwip_writev,
         .fcntl = &lwip_fcntl_r_wrapper,
         .ioctl = &lwip_ioctl_r_wrapper,
 #ifdef CONFIG_VFS_SUPPORT_SELECT
@@ -100,6 +252,10 @@ void esp_vfs_lwip_sockets_register(void)
         .stop_socket_select = &lwip_stop_socket_select,
         .stop_socket_select_isr = &lwip_stop_socket_select_isr,
 #endif // CONFIG_VFS_SUPPORT_SELECT
+#ifdef CONFIG_VFS_SUPPORT_EPOLL
+        .start_poll = &lwip_start_poll,
+        .end_poll = &lwip_end_poll,
+#endif // CONFIG_VFS_SUPPORT_EPOLL
     };
     /* Non-LWIP file descriptors are from 0 to (LWIP_SOCKET_OFFSET-1). LWIP
      * file descriptors are registered from LWIP_SOCKET_OFFSET to
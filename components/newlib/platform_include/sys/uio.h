@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2018-2021 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2018-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -13,7 +13,14 @@
 extern "C" {
 #endif
 
-struct iovec;
+/* Defining iovec tells lwIP (lwip/sockets.h) not to define the structure again */
+#ifndef iovec
+#define iovec iovec
+struct iovec {
+    void *iov_base;
+    size_t iov_len;
+};
+#endif
 
 int writev(int s, const struct iovec *iov, int iovcnt);
 
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -17,6 +17,7 @@
 #include <string.h>
 #include <string>
 #include <random>
+#include <chrono>
 #include "test_fixtures.hpp"
 
 #define TEST_ESP_ERR(rc, res) CHECK((rc) == (res))
@@ -288,6 +289,109 @@ TEST_CASE("HashList is cleaned up as soon as items are erased", "[nvs]")
     CHECK(hashlist.getBlockCount() == 0);
 }
 
+class HashTableTestHelper : public nvs::HashTable {
+public:
+    bool isAllocated()
+    {
+        return mTable != nullptr;
+    }
+};
+
+TEST_CASE("HashTable finds, erases and frees items like HashList", "[nvs]")
+{
+    HashTableTestHelper table;
+    const size_t count = nvs::HashTable::MAX_ENTRIES;
+    CHECK(table.isAllocated() == false);
+    for (size_t i = 0; i < count; ++i) {
+        char key[16];
+        snprintf(key, sizeof(key), "i%ld", (long int)(i / 2));
+        nvs::Item item(1, nvs::ItemType::U32, 1, key);
+        TEST_ESP_OK(table.insert(item, i));
+    }
+    CHECK(table.isAllocated() == true);
+    // every key was added twice, find has to return the first index at or after start
+    for (size_t i = 0; i < count; i += 2) {
+        char key[16];
+        snprintf(key, sizeof(key), "i%ld", (long int)(i / 2));
+        nvs::Item item(1, nvs::ItemType::U32, 1, key);
+        CHECK(table.find(0, item) == i);
+        CHECK(table.find(i + 1, item) == i + 1);
+        CHECK(table.find(i + 2, item) == SIZE_MAX);
+    }
+    nvs::Item missing(1, nvs::ItemType::U32, 1, "missing");
+    CHECK(table.find(0, missing) == SIZE_MAX);
+    // erase every other item, the remaining ones must still be found
+    for (size_t i = 0; i < count; i += 2) {
+        CHECK(table.erase(i) == true);
+        CHECK(table.erase(i) == false);
+    }
+    for (size_t i = 0; i < count; i += 2) {
+        char key[16];
+        snprintf(key, sizeof(key), "i%ld", (long int)(i / 2));
+        nvs::Item item(1, nvs::ItemType::U32, 1, key);
+        CHECK(table.find(0, item) == i + 1);
+    }
+    for (size_t i = 1; i < count; i += 2) {
+        CHECK(table.erase(i) == true);
+    }
+    CHECK(table.isAllocated() == false);
+    CHECK(table.erase(0) == false);
+}
+
+TEST_CASE("HashTable insert replaces the only item at an index", "[nvs]")
+{
+    HashTableTestHelper table;
+    nvs::Item first(1, nvs::ItemType::U32, 1, "first");
+    nvs::Item second(1, nvs::ItemType::U32, 1, "second");
+    TEST_ESP_OK(table.insert(first, 5));
+    // erasing the previous item at this index frees the table, which has to be allocated again
+    TEST_ESP_OK(table.insert(second, 5));
+    CHECK(table.isAllocated() == true);
+    CHECK(table.find(0, first) == SIZE_MAX);
+    CHECK(table.find(0, second) == 5);
+    CHECK(table.erase(5) == true);
+    CHECK(table.isAllocated() == false);
+}
+
+template<typename T>
+static double benchmark_hash_list(size_t rounds)
+{
+    const size_t count = nvs::Page::ENTRY_COUNT;
+    nvs::Item items[count];
+    for (size_t i = 0; i < count; ++i) {
+        char key[16];
+        snprintf(key, sizeof(key), "key%ld", (long int)i);
+        items[i] = nvs::Item(1, nvs::ItemType::U32, 1, key);
+    }
+
+    T list;
+    size_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < count; ++i) {
+            list.insert(items[i], i);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            found += (list.find(0, items[i]) == i);
+        }
+        // erase in the order garbage collection frees entries
+        for (size_t i = 0; i < count; ++i) {
+            list.erase(i);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    CHECK(found == rounds * count);
+    return std::chrono::duration<double, std::micro>(end - start).count() / (rounds * count);
+}
+
+TEST_CASE("HashList and HashTable performance", "[nvs][hashlist]")
+{
+    const size_t rounds = 200;
+    double listTime = benchmark_hash_list<nvs::HashList>(rounds);
+    double tableTime = benchmark_hash_list<nvs::HashTable>(rounds);
+    s_perf << "Insert, find and erase of a full page of items: HashList " << listTime << " us/item, HashTable " << tableTime << " us/item" << std::endl;
+}
+
 TEST_CASE("can init PageManager in empty flash", "[nvs]")
 {
     PartitionEmulationFixture f(0, 4);
@@ -3396,6 +3500,428 @@ TEST_CASE("nvs find key tests", "[nvs]")
     nvs_close(handle_2);
     TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
 }
+
+TEST_CASE("items stay accessible while pages are written, erased and freed", "[nvs]")
+{
+    PartitionEmulationFixture f(0, 8);
+    nvs::Storage storage(f.part());
+    TEST_ESP_OK(storage.init(0, 8));
+
+    char key[16];
+    char str[512];
+    memset(str, 'x', sizeof(str) - 1);
+    str[sizeof(str) - 1] = 0;
+
+    // rewrite the same keys many times so that pages get full and are freed
+    for (int round = 0; round < 20; ++round) {
+        for (int i = 0; i < 16; ++i) {
+            snprintf(key, sizeof(key), "key%d", i);
+            TEST_ESP_OK(storage.writeItem(1, key, round * 100 + i));
+        }
+        TEST_ESP_OK(storage.writeItem(1, nvs::ItemType::SZ, "str", str, sizeof(str)));
+        TEST_ESP_OK(storage.eraseItem(1, "key3"));
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        snprintf(key, sizeof(key), "key%d", i);
+        int value;
+        if (i == 3) {
+            CHECK(storage.readItem(1, key, value) == ESP_ERR_NVS_NOT_FOUND);
+        } else {
+            TEST_ESP_OK(storage.readItem(1, key, value));
+            CHECK(value == 1900 + i);
+        }
+        // same key in another namespace is not found
+        CHECK(storage.readItem(2, key, value) == ESP_ERR_NVS_NOT_FOUND);
+    }
+
+    // items are found after the partition is loaded again
+    nvs::Storage storage2(f.part());
+    TEST_ESP_OK(storage2.init(0, 8));
+    int value;
+    TEST_ESP_OK(storage2.readItem(1, "key15", value));
+    CHECK(value == 1915);
+    CHECK(storage2.readItem(1, "key3", value) == ESP_ERR_NVS_NOT_FOUND);
+}
+
+TEST_CASE("lookup cost does not depend on the number of pages", "[nvs]")
+{
+    const size_t PAGE_COUNTS[] = {8, 32, 64};
+    uint32_t foundReads[3];
+    uint32_t missingReads[3];
+
+    for (size_t run = 0; run < 3; ++run) {
+        const size_t pageCount = PAGE_COUNTS[run];
+        PartitionEmulationFixture f(0, pageCount);
+        nvs::Storage storage(f.part());
+        TEST_ESP_OK(storage.init(0, pageCount));
+
+        // each filler string takes most of a page, keys end up on the first and the last pages
+        static char filler[3000];
+        memset(filler, 'f', sizeof(filler) - 1);
+        char key[16];
+        TEST_ESP_OK(storage.writeItem(1, "first", 1));
+        for (size_t i = 0; i < pageCount - 2; ++i) {
+            snprintf(key, sizeof(key), "fill%d", (int) i);
+            TEST_ESP_OK(storage.writeItem(1, nvs::ItemType::SZ, key, filler, sizeof(filler)));
+        }
+        TEST_ESP_OK(storage.writeItem(1, "last", 2));
+
+        int value;
+        esp_partition_clear_stats();
+        TEST_ESP_OK(storage.readItem(1, "last", value));
+        CHECK(value == 2);
+        foundReads[run] = esp_partition_get_read_ops();
+
+        esp_partition_clear_stats();
+        CHECK(storage.readItem(1, "missing", value) == ESP_ERR_NVS_NOT_FOUND);
+        missingReads[run] = esp_partition_get_read_ops();
+
+        s_perf << "Lookup in " << pageCount << " pages: existing key " << foundReads[run]
+               << " reads, missing key " << missingReads[run] << " reads" << std::endl;
+    }
+
+#ifdef CONFIG_NVS_ITEM_INDEX
+    CHECK(foundReads[0] == foundReads[1]);
+    CHECK(foundReads[1] == foundReads[2]);
+    CHECK(missingReads[0] == 0);
+    CHECK(missingReads[1] == 0);
+    CHECK(missingReads[2] == 0);
+#endif
+}
+
+TEST_CASE("mount time depending on partition size and blob count", "[nvs]")
+{
+    const size_t PAGE_COUNTS[] = {16, 64};
+    static uint8_t blob[3000];
+    for (size_t i = 0; i < sizeof(blob); ++i) {
+        blob[i] = (uint8_t) i;
+    }
+
+    for (size_t pageCount : PAGE_COUNTS) {
+        for (size_t blobCount : {(size_t) 0, pageCount / 4, pageCount / 2}) {
+            PartitionEmulationFixture f(0, pageCount);
+            {
+                nvs::Storage storage(f.part());
+                TEST_ESP_OK(storage.init(0, pageCount));
+                char key[16];
+                for (size_t i = 0; i < blobCount; ++i) {
+                    snprintf(key, sizeof(key), "blob%d", (int) i);
+                    TEST_ESP_OK(storage.writeItem(1, nvs::ItemType::BLOB, key, blob, sizeof(blob)));
+                }
+            }
+
+            nvs::Storage storage(f.part());
+            esp_partition_clear_stats();
+            TEST_ESP_OK(storage.init(0, pageCount));
+            s_perf << "Mount " << pageCount << " pages with " << blobCount << " blobs: " << esp_partition_get_total_time()
+                   << " us (" << esp_partition_get_read_ops() << "R " << esp_partition_get_read_bytes() << "Rb)" << std::endl;
+
+            // all blobs have to survive mounting
+            static uint8_t readBlob[sizeof(blob)];
+            char key[16];
+            for (size_t i = 0; i < blobCount; ++i) {
+                snprintf(key, sizeof(key), "blob%d", (int) i);
+                TEST_ESP_OK(storage.readItem(1, nvs::ItemType::BLOB, key, readBlob, sizeof(readBlob)));
+                CHECK(memcmp(blob, readBlob, sizeof(blob)) == 0);
+            }
+        }
+    }
+}
+
+TEST_CASE("nvs transaction writes all values with fewer flash writes", "[nvs]")
+{
+    const size_t KEY_COUNT = 32;
+    PartitionEmulationFixture f(0, 8);
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, 8));
+
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+    char key[16];
+
+    for (size_t i = 0; i < KEY_COUNT; ++i) {
+        snprintf(key, sizeof(key), "key%d", (int) i);
+        TEST_ESP_OK(nvs_set_u32(handle, key, i));
+    }
+    esp_partition_clear_stats();
+    for (size_t i = 0; i < KEY_COUNT; ++i) {
+        snprintf(key, sizeof(key), "key%d", (int) i);
+        TEST_ESP_OK(nvs_set_u32(handle, key, i + 1));
+    }
+    size_t singleWrites = esp_partition_get_write_ops();
+
+    esp_partition_clear_stats();
+    TEST_ESP_OK(nvs_transaction_begin(handle));
+    TEST_ESP_ERR(nvs_transaction_begin(handle), ESP_ERR_INVALID_STATE);
+    for (size_t i = 0; i < KEY_COUNT; ++i) {
+        snprintf(key, sizeof(key), "key%d", (int) i);
+        TEST_ESP_OK(nvs_set_u32(handle, key, 0));
+        TEST_ESP_OK(nvs_set_u32(handle, key, i + 1000));
+    }
+    TEST_ESP_OK(nvs_set_str(handle, "str", "transaction"));
+    TEST_ESP_ERR(nvs_erase_key(handle, "key0"), ESP_ERR_INVALID_STATE);
+    uint32_t value;
+    TEST_ESP_OK(nvs_get_u32(handle, "key0", &value));
+    CHECK(value == 1);
+    CHECK(esp_partition_get_write_ops() == 0);
+    TEST_ESP_OK(nvs_commit(handle));
+    size_t batchWrites = esp_partition_get_write_ops();
+    s_perf << "Update " << KEY_COUNT << " keys: " << singleWrites << " flash writes one by one, "
+           << batchWrites << " in a transaction" << std::endl;
+    CHECK(batchWrites * 4 < singleWrites);
+
+    // values which didn't change aren't written again
+    esp_partition_clear_stats();
+    TEST_ESP_OK(nvs_transaction_begin(handle));
+    for (size_t i = 0; i < KEY_COUNT; ++i) {
+        snprintf(key, sizeof(key), "key%d", (int) i);
+        TEST_ESP_OK(nvs_set_u32(handle, key, i + 1000));
+    }
+    TEST_ESP_OK(nvs_commit(handle));
+    CHECK(esp_partition_get_write_ops() == 0);
+
+    TEST_ESP_OK(nvs_transaction_begin(handle));
+    TEST_ESP_OK(nvs_set_u32(handle, "key0", 1));
+    TEST_ESP_OK(nvs_transaction_abort(handle));
+    TEST_ESP_ERR(nvs_transaction_abort(handle), ESP_ERR_INVALID_STATE);
+
+    // strings which span several pages
+    static char str[100];
+    memset(str, 's', sizeof(str) - 1);
+    TEST_ESP_OK(nvs_transaction_begin(handle));
+    for (size_t i = 0; i < 40; ++i) {
+        snprintf(key, sizeof(key), "str%d", (int) i);
+        TEST_ESP_OK(nvs_set_str(handle, key, str));
+    }
+    TEST_ESP_OK(nvs_commit(handle));
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+
+    // everything has to be in place after mounting again
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, 8));
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READONLY, &handle));
+    TEST_ESP_ERR(nvs_transaction_begin(handle), ESP_ERR_NVS_READ_ONLY);
+    for (size_t i = 0; i < KEY_COUNT; ++i) {
+        snprintf(key, sizeof(key), "key%d", (int) i);
+        TEST_ESP_OK(nvs_get_u32(handle, key, &value));
+        CHECK(value == i + 1000);
+    }
+    char buf[sizeof(str)];
+    size_t len = sizeof(buf);
+    TEST_ESP_OK(nvs_get_str(handle, "str", buf, &len));
+    CHECK(strcmp(buf, "transaction") == 0);
+    for (size_t i = 0; i < 40; ++i) {
+        snprintf(key, sizeof(key), "str%d", (int) i);
+        len = sizeof(buf);
+        TEST_ESP_OK(nvs_get_str(handle, key, buf, &len));
+        CHECK(strcmp(buf, str) == 0);
+    }
+    nvs_stats_t stats;
+    TEST_ESP_OK(nvs_get_stats(NVS_DEFAULT_PART_NAME, &stats));
+    // one namespace entry, KEY_COUNT integers, one short string and 40 strings of 5 entries
+    CHECK(stats.used_entries == 1 + KEY_COUNT + 2 + 40 * 5);
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+}
+
+TEST_CASE("nvs transaction leaves no duplicates after a power loss at any point of the commit", "[nvs]")
+{
+    const size_t KEY_COUNT = 50;
+    const size_t OTHER_PAGE_KEY_COUNT = 40;
+    static char fill[2000];
+    memset(fill, 'f', sizeof(fill) - 1);
+    char key[16];
+    uint32_t value;
+
+    for (uint32_t errDelay = 0; ; ++errDelay) {
+        INFO(errDelay);
+        PartitionEmulationFixture f(0, 8);
+        TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, 8));
+
+        // the first keys are on the first page, the strings move the current page further,
+        // and the other keys are on the current page
+        nvs_handle_t handle;
+        TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+        for (size_t i = 0; i < KEY_COUNT; ++i) {
+            if (i == OTHER_PAGE_KEY_COUNT) {
+                for (size_t j = 0; j < 3; ++j) {
+                    snprintf(key, sizeof(key), "fill%d", (int) j);
+                    TEST_ESP_OK(nvs_set_str(handle, key, fill));
+                }
+            }
+            snprintf(key, sizeof(key), "key%d", (int) i);
+            TEST_ESP_OK(nvs_set_u32(handle, key, i));
+        }
+        nvs_stats_t stats;
+        TEST_ESP_OK(nvs_get_stats(NVS_DEFAULT_PART_NAME, &stats));
+        const size_t usedEntries = stats.used_entries;
+
+        TEST_ESP_OK(nvs_transaction_begin(handle));
+        for (size_t i = 0; i < KEY_COUNT; ++i) {
+            snprintf(key, sizeof(key), "key%d", (int) i);
+            TEST_ESP_OK(nvs_set_u32(handle, key, i + 1000));
+        }
+        TEST_ESP_OK(nvs_set_str(handle, "str", "new"));
+        esp_partition_fail_after(errDelay, ESP_PARTITION_FAIL_AFTER_MODE_BOTH);
+        esp_err_t commitErr = nvs_commit(handle);
+        esp_partition_fail_after(SIZE_MAX, 0);
+        nvs_close(handle);
+        TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+
+        // every key has either its old or its new value, and erasing it once removes it
+        TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, 8));
+        TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+        for (size_t i = 0; i < KEY_COUNT; ++i) {
+            snprintf(key, sizeof(key), "key%d", (int) i);
+            TEST_ESP_OK(nvs_get_u32(handle, key, &value));
+            CHECK((value == i + 1000 || (commitErr != ESP_OK && value == i)));
+            TEST_ESP_OK(nvs_erase_key(handle, key));
+            TEST_ESP_ERR(nvs_get_u32(handle, key, &value), ESP_ERR_NVS_NOT_FOUND);
+        }
+        esp_err_t strErr = nvs_erase_key(handle, "str");
+        CHECK((strErr == ESP_OK || (commitErr != ESP_OK && strErr == ESP_ERR_NVS_NOT_FOUND)));
+        // the strings and the namespace entry are left, without any batch marker
+        TEST_ESP_OK(nvs_get_stats(NVS_DEFAULT_PART_NAME, &stats));
+        CHECK(stats.used_entries == usedEntries - KEY_COUNT);
+        nvs_close(handle);
+        TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+
+        if (commitErr == ESP_OK) {
+            // the power loss came after the end of the commit
+            break;
+        }
+    }
+}
+
+TEST_CASE("nvs value cache serves repeated reads and drops changed values", "[nvs]")
+{
+    PartitionEmulationFixture f(0, 4);
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, 4));
+
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+    TEST_ESP_OK(nvs_set_i32(handle, "int", 42));
+    TEST_ESP_OK(nvs_set_str(handle, "str", "cached"));
+
+    int32_t value;
+    char buf[16];
+    size_t len;
+    esp_partition_clear_stats();
+    for (int i = 0; i < 10; ++i) {
+        TEST_ESP_OK(nvs_get_i32(handle, "int", &value));
+        CHECK(value == 42);
+        len = sizeof(buf);
+        TEST_ESP_OK(nvs_get_str(handle, "str", buf, &len));
+        CHECK(strcmp(buf, "cached") == 0);
+    }
+    size_t readOps = esp_partition_get_read_ops();
+
+    // the checks done on reads from flash apply to cached values as well
+    int16_t shortValue;
+    TEST_ESP_ERR(nvs_get_i16(handle, "int", &shortValue), ESP_ERR_NVS_NOT_FOUND);
+    len = 3;
+    TEST_ESP_ERR(nvs_get_str(handle, "str", buf, &len), ESP_ERR_NVS_INVALID_LENGTH);
+    CHECK(len == strlen("cached") + 1);
+
+    TEST_ESP_OK(nvs_set_i32(handle, "int", 43));
+    TEST_ESP_OK(nvs_get_i32(handle, "int", &value));
+    CHECK(value == 43);
+    TEST_ESP_OK(nvs_erase_key(handle, "str"));
+    len = sizeof(buf);
+    TEST_ESP_ERR(nvs_get_str(handle, "str", buf, &len), ESP_ERR_NVS_NOT_FOUND);
+#ifndef CONFIG_NVS_LEGACY_DUP_KEYS_COMPATIBILITY
+    TEST_ESP_OK(nvs_set_u8(handle, "int", 1));
+    TEST_ESP_ERR(nvs_get_i32(handle, "int", &value), ESP_ERR_NVS_NOT_FOUND);
+#endif
+    TEST_ESP_OK(nvs_set_i32(handle, "int", 44));
+    TEST_ESP_OK(nvs_get_i32(handle, "int", &value));
+    TEST_ESP_OK(nvs_erase_all(handle));
+    TEST_ESP_ERR(nvs_get_i32(handle, "int", &value), ESP_ERR_NVS_NOT_FOUND);
+
+    nvs_cache_stats_t stats;
+#ifdef CONFIG_NVS_VALUE_CACHE
+    TEST_ESP_OK(nvs_get_cache_stats(NULL, &stats));
+    // only the first read of each value accesses the flash, and reading a string counts once even though its
+    // size is looked up first. The other reads above are misses, apart from the string read into a short buffer,
+    // which fails on its size.
+    CHECK(stats.hits == 18);
+#ifndef CONFIG_NVS_LEGACY_DUP_KEYS_COMPATIBILITY
+    CHECK(stats.misses == 7);
+#else
+    CHECK(stats.misses == 6);
+#endif
+    CHECK(stats.total_entries == CONFIG_NVS_VALUE_CACHE_ENTRIES);
+    CHECK(stats.used_entries == 0);
+    s_perf << "Read an integer and a string ten times: " << readOps << " flash reads with value cache" << std::endl;
+#else
+    TEST_ESP_ERR(nvs_get_cache_stats(NULL, &stats), ESP_ERR_NOT_SUPPORTED);
+    s_perf << "Read an integer and a string ten times: " << readOps << " flash reads without value cache" << std::endl;
+#endif
+    TEST_ESP_ERR(nvs_get_cache_stats(NULL, NULL), ESP_ERR_INVALID_ARG);
+
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+}
+
+static size_t update_keys_worst_latency(nvs_handle_t handle, size_t keyCount, size_t updates, bool collectGarbage)
+{
+    char key[16];
+    size_t worst = 0;
+    for (size_t i = 0; i < updates; ++i) {
+        snprintf(key, sizeof(key), "key%d", (int) (i * 7 % keyCount));
+        esp_partition_clear_stats();
+        TEST_ESP_OK(nvs_set_u32(handle, key, i));
+        worst = std::max(worst, esp_partition_get_total_time());
+        if (collectGarbage) {
+            esp_err_t err = nvs_gc_step(NULL);
+            CHECK((err == ESP_OK || err == ESP_ERR_NOT_FOUND));
+        }
+    }
+    return worst;
+}
+
+TEST_CASE("nvs_gc_step moves garbage collection out of writes", "[nvs][gc]")
+{
+    const size_t KEY_COUNT = 400;
+    const size_t UPDATES = 2000;
+    PartitionEmulationFixture f(0, 6);
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, 6));
+
+    nvs_handle_t handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+    char key[16];
+    for (size_t i = 0; i < KEY_COUNT; ++i) {
+        snprintf(key, sizeof(key), "key%d", (int) i);
+        TEST_ESP_OK(nvs_set_u32(handle, key, i));
+    }
+
+    size_t worstWithoutGc = update_keys_worst_latency(handle, KEY_COUNT, UPDATES, false);
+#ifdef CONFIG_NVS_INCREMENTAL_GC
+    size_t worstWithGc = update_keys_worst_latency(handle, KEY_COUNT, UPDATES, true);
+    s_perf << "Worst case time to update one of " << KEY_COUNT << " keys in 6 pages: " << worstWithoutGc
+           << " us, " << worstWithGc << " us with nvs_gc_step() after each write" << std::endl;
+    CHECK(worstWithGc * 4 < worstWithoutGc);
+#else
+    TEST_ESP_ERR(nvs_gc_step(NULL), ESP_ERR_NOT_SUPPORTED);
+    s_perf << "Worst case time to update one of " << KEY_COUNT << " keys in 6 pages: " << worstWithoutGc
+           << " us" << std::endl;
+#endif
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+
+    // all values have to be in place after mounting again
+    TEST_ESP_OK(nvs::NVSPartitionManager::get_instance()->init_custom(f.part(), 0, 6));
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READONLY, &handle));
+    for (size_t i = UPDATES - KEY_COUNT; i < UPDATES; ++i) {
+        snprintf(key, sizeof(key), "key%d", (int) (i * 7 % KEY_COUNT));
+        uint32_t value;
+        TEST_ESP_OK(nvs_get_u32(handle, key, &value));
+        CHECK(value == i);
+    }
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+}
+
 /* Add new tests above */
 /* This test has to be the final one */
 
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -544,7 +544,8 @@ esp_err_t nvs_erase_all(nvs_handle_t handle);
  *
  * After setting any values, nvs_commit() must be called to ensure changes are written
  * to non-volatile storage. Individual implementations may write to storage at other times,
- * but this is not guaranteed.
+ * but this is not guaranteed. If a transaction has been started with \c nvs_transaction_begin,
+ * the values recorded since then are written by this call and the transaction ends.
  *
  * @param[in]  handle  Storage handle obtained with nvs_open.
  *                     Handles that were opened read only cannot be used.
@@ -556,6 +557,44 @@ esp_err_t nvs_erase_all(nvs_handle_t handle);
  */
 esp_err_t nvs_commit(nvs_handle_t handle);
 
+/**
+ * @brief      Start collecting values to be written together
+ *
+ * After this call, the nvs_set_* functions called with this handle only record the new
+ * values in RAM. The next call to \c nvs_commit writes all of them at once, which needs
+ * fewer flash operations than setting each value separately: values equal to the stored ones
+ * are skipped, the new entries are written in contiguous runs and the replaced entries are
+ * erased page by page. Setting the same key again within a transaction replaces the recorded value.
+ *
+ * Values recorded by an open transaction are not visible to the nvs_get_* functions until
+ * they are committed. Erasing keys is not possible while a transaction is open.
+ * Since the values are copied, the nvs_set_* functions may return ESP_ERR_NO_MEM during a transaction.
+ * The commit is not atomic: if it fails, or if power is lost during it, values written before
+ * are kept. Each key has either its previous or its new value, never both.
+ *
+ * @param[in]  handle  Storage handle obtained with nvs_open.
+ *                     Handles that were opened read only cannot be used.
+ *
+ * @return
+ *             - ESP_OK if the transaction has been started
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_READ_ONLY if handle was opened as read only
+ *             - ESP_ERR_INVALID_STATE if a transaction is already open for this handle
+ */
+esp_err_t nvs_transaction_begin(nvs_handle_t handle);
+
+/**
+ * @brief      Discard the values recorded since \c nvs_transaction_begin
+ *
+ * @param[in]  handle  Storage handle obtained with nvs_open.
+ *
+ * @return
+ *             - ESP_OK if the transaction has been discarded
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_INVALID_STATE if no transaction is open for this handle
+ */
+esp_err_t nvs_transaction_abort(nvs_handle_t handle);
+
 /**
  * @brief      Close the storage handle and free any allocated resources
  *
@@ -615,6 +654,63 @@ typedef struct {
  */
 esp_err_t nvs_get_stats(const char *part_name, nvs_stats_t *nvs_stats);
 
+/**
+ * @note Info about the value cache of a NVS partition, see CONFIG_NVS_VALUE_CACHE.
+ */
+typedef struct {
+    size_t hits;              /**< Number of reads served from the cache. */
+    size_t misses;            /**< Number of reads of cacheable values which had to access the flash. */
+    size_t used_entries;      /**< Number of values currently cached. */
+    size_t total_entries;     /**< Number of values the cache can hold. */
+} nvs_cache_stats_t;
+
+/**
+ * @brief      Fill structure nvs_cache_stats_t. It provides hit and miss counts of the value cache.
+ *
+ * The counters are reset when the partition is initialized. Reads of blobs are not counted,
+ * since blobs are never cached.
+ *
+ * @param[in]   part_name    Partition name NVS in the partition table.
+ *                           If pass a NULL than will use NVS_DEFAULT_PART_NAME ("nvs").
+ *
+ * @param[out]  cache_stats  Returns filled structure nvs_cache_stats_t.
+ *
+ * @return
+ *             - ESP_OK if the statistics have been read successfully.
+ *             - ESP_ERR_NOT_SUPPORTED if the value cache is disabled or couldn't be allocated.
+ *             - ESP_ERR_NVS_NOT_INITIALIZED if the storage driver is not initialized.
+ *             - ESP_ERR_INVALID_ARG if cache_stats is equal to NULL.
+ *             - ESP_ERR_NVS_INVALID_STATE if the storage is not in a valid state.
+ */
+esp_err_t nvs_get_cache_stats(const char *part_name, nvs_cache_stats_t *cache_stats);
+
+/**
+ * @brief      Perform one step of garbage collection on a NVS partition.
+ *
+ * When NVS runs out of free pages while writing, it moves the remaining items of a used page to a new page
+ * and erases the old one before the write can complete. Calling this function from a low priority task
+ * while the application is idle does this work ahead of time, so that writes don't have to.
+ * Each call erases at most one flash sector and moves the items of at most one page.
+ *
+ * \code{c}
+ * // Example of collecting garbage while there is nothing else to do:
+ * while (nvs_gc_step(NULL) == ESP_OK) {
+ *     vTaskDelay(1);
+ * }
+ * \endcode
+ *
+ * @param[in]   part_name   Partition name NVS in the partition table.
+ *                          If pass a NULL than will use NVS_DEFAULT_PART_NAME ("nvs").
+ *
+ * @return
+ *             - ESP_OK if a page has been compacted or freed.
+ *             - ESP_ERR_NOT_FOUND if there is nothing worth collecting at the moment.
+ *             - ESP_ERR_NOT_SUPPORTED if CONFIG_NVS_INCREMENTAL_GC is disabled.
+ *             - ESP_ERR_NVS_NOT_INITIALIZED if the storage driver is not initialized.
+ *             - one of the error codes from the underlying flash storage driver
+ */
+esp_err_t nvs_gc_step(const char *part_name);
+
 /**
  * @brief      Calculate all entries in a namespace.
  *
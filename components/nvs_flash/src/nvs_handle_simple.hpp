@@ -59,6 +59,17 @@ public:
 
     esp_err_t commit() override;
 
+    /**
+     * Starts collecting the values set through this handle instead of writing them immediately.
+     * They are written to the storage together by the next commit().
+     */
+    esp_err_t begin_transaction();
+
+    /**
+     * Discards the values collected since begin_transaction() without writing them.
+     */
+    esp_err_t abort_transaction();
+
     esp_err_t get_used_entry_count(size_t &usedEntries) override;
 
     esp_err_t getItemDataSize(ItemType datatype, const char *key, size_t &dataSize);
@@ -101,6 +112,13 @@ private:
      * Upon opening, a handle is valid. It becomes invalid if the underlying storage is de-initialized.
      */
     uint8_t valid;
+
+    /**
+     * Whether a transaction is open, i.e. values are collected in mTransaction until commit() is called.
+     */
+    bool mInTransaction = false;
+
+    WriteBatch mTransaction;
 };
 
 } // nvs
@@ -0,0 +1,108 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "nvs_item_hash_table.hpp"
+#include <cstring>
+
+namespace nvs
+{
+
+HashTable::HashTable()
+{
+}
+
+HashTable::~HashTable()
+{
+    clear();
+}
+
+void HashTable::clear()
+{
+    delete mTable;
+    mTable = nullptr;
+    mCount = 0;
+}
+
+esp_err_t HashTable::insert(const Item& item, size_t index)
+{
+    if (index >= MAX_ENTRIES) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // erasing the only entry releases the table, so this is done first
+    if (mTable && isUsed(index)) {
+        erase(index);
+    }
+
+    if (!mTable) {
+        mTable = new (std::nothrow) Table;
+        if (!mTable) {
+            return ESP_ERR_NO_MEM;
+        }
+        memset(mTable->mSlots, SLOT_EMPTY, sizeof(mTable->mSlots));
+        memset(mTable->mUsed, 0, sizeof(mTable->mUsed));
+    }
+
+    const uint32_t hash_24 = item.calculateCrc32WithoutValue() & 0xffffff;
+    size_t pos = home(hash_24);
+    while (mTable->mSlots[pos] != SLOT_EMPTY) {
+        pos = nextSlot(pos);
+    }
+    mTable->mSlots[pos] = (uint8_t) index;
+    mTable->mHashes[index][0] = hash_24 & 0xff;
+    mTable->mHashes[index][1] = (hash_24 >> 8) & 0xff;
+    mTable->mHashes[index][2] = (hash_24 >> 16) & 0xff;
+    mTable->mUsed[index / 32] |= 1U << (index % 32);
+    ++mCount;
+    return ESP_OK;
+}
+
+bool HashTable::erase(size_t index)
+{
+    if (!mTable || index >= MAX_ENTRIES || !isUsed(index)) {
+        return false;
+    }
+
+    size_t hole = home(hashAt(index));
+    while (mTable->mSlots[hole] != index) {
+        hole = nextSlot(hole);
+    }
+
+    // move entries of the same cluster back into the hole unless this would place them in front of their home slot
+    for (size_t pos = nextSlot(hole); mTable->mSlots[pos] != SLOT_EMPTY; pos = nextSlot(pos)) {
+        size_t entryHome = home(hashAt(mTable->mSlots[pos]));
+        if (((pos - entryHome) & (SLOT_COUNT - 1)) >= ((pos - hole) & (SLOT_COUNT - 1))) {
+            mTable->mSlots[hole] = mTable->mSlots[pos];
+            hole = pos;
+        }
+    }
+    mTable->mSlots[hole] = SLOT_EMPTY;
+    mTable->mUsed[index / 32] &= ~(1U << (index % 32));
+
+    if (--mCount == 0) {
+        clear();
+    }
+    return true;
+}
+
+size_t HashTable::find(size_t start, const Item& item)
+{
+    if (!mTable) {
+        return SIZE_MAX;
+    }
+
+    const uint32_t hash_24 = item.calculateCrc32WithoutValue() & 0xffffff;
+    size_t result = SIZE_MAX;
+    for (size_t pos = home(hash_24); mTable->mSlots[pos] != SLOT_EMPTY; pos = nextSlot(pos)) {
+        size_t index = mTable->mSlots[pos];
+        if (index >= start && index < result && hashAt(index) == hash_24) {
+            result = index;
+        }
+    }
+    return result;
+}
+
+} // namespace nvs
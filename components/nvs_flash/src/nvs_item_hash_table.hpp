@@ -0,0 +1,80 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef nvs_item_hash_table_h
+#define nvs_item_hash_table_h
+
+#include "nvs.h"
+#include "nvs_types.hpp"
+#include "nvs_memory_management.hpp"
+
+namespace nvs
+{
+
+/**
+ * Drop-in replacement for HashList with constant time insert, erase and find.
+ *
+ * Since a page has at most MAX_ENTRIES entries, all state fits into one fixed-size table which is allocated
+ * when the first item is inserted and released when the last one is erased. Item hashes are stored per entry
+ * index, and a 256-slot open-addressing table with linear probing maps hashes to entry indices. The table is
+ * never more than half full, so probe sequences stay short, and backward-shift deletion avoids tombstones.
+ */
+class HashTable
+{
+public:
+    static const size_t MAX_ENTRIES = 126;
+
+    HashTable();
+    ~HashTable();
+
+    esp_err_t insert(const Item& item, size_t index);
+    bool erase(const size_t index);
+    size_t find(size_t start, const Item& item);
+    void clear();
+
+private:
+    HashTable(const HashTable& other);
+    const HashTable& operator= (const HashTable& rhs);
+
+protected:
+    static const size_t SLOT_COUNT = 256;
+    static const uint8_t SLOT_EMPTY = 0xff;
+
+    struct Table : public ExceptionlessAllocatable {
+        uint8_t mSlots[SLOT_COUNT];
+        uint8_t mHashes[MAX_ENTRIES][3];
+        uint32_t mUsed[(MAX_ENTRIES + 31) / 32];
+    };
+
+    bool isUsed(size_t index) const
+    {
+        return (mTable->mUsed[index / 32] >> (index % 32)) & 1;
+    }
+
+    uint32_t hashAt(size_t index) const
+    {
+        const uint8_t* h = mTable->mHashes[index];
+        return h[0] | (h[1] << 8) | (h[2] << 16);
+    }
+
+    static size_t home(uint32_t hash)
+    {
+        return hash & (SLOT_COUNT - 1);
+    }
+
+    static size_t nextSlot(size_t pos)
+    {
+        return (pos + 1) & (SLOT_COUNT - 1);
+    }
+
+    Table* mTable = nullptr;
+    size_t mCount = 0;
+}; // class HashTable
+
+} // namespace nvs
+
+
+#endif /* nvs_item_hash_table_h */
@@ -0,0 +1,158 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "nvs_item_index.hpp"
+
+namespace nvs
+{
+
+ItemIndex::ItemIndex()
+{
+}
+
+ItemIndex::~ItemIndex()
+{
+    clear();
+}
+
+esp_err_t ItemIndex::init(size_t maxItems, size_t maxBytes)
+{
+    clear();
+
+    // keep the load factor at or below 3/4 so that probe sequences stay short
+    size_t capacity = 8;
+    while (capacity * 3 / 4 < maxItems && capacity * 2 * sizeof(Slot) <= maxBytes) {
+        capacity *= 2;
+    }
+
+    mSlots = new (std::nothrow) Slot[capacity];
+    if (!mSlots) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (size_t i = 0; i < capacity; ++i) {
+        mSlots[i].mPage = nullptr;
+    }
+    mCapacity = capacity;
+    mCount = 0;
+    return ESP_OK;
+}
+
+void ItemIndex::clear()
+{
+    delete[] mSlots;
+    mSlots = nullptr;
+    mCapacity = 0;
+    mCount = 0;
+}
+
+void ItemIndex::insert(const Item& item, Page* page, size_t index)
+{
+    if (!isValid()) {
+        return;
+    }
+
+    if ((mCount + 1) * 4 > mCapacity * 3) {
+        // RAM budget exhausted, the owner has to fall back to searching the pages
+        clear();
+        return;
+    }
+
+    const uint32_t hash_24 = hashOf(item);
+    size_t pos = home(hash_24);
+    while (mSlots[pos].mPage != nullptr) {
+        pos = (pos + 1) & (mCapacity - 1);
+    }
+    mSlots[pos].mPage = page;
+    mSlots[pos].mHash = hash_24;
+    mSlots[pos].mIndex = static_cast<uint32_t>(index);
+    ++mCount;
+}
+
+void ItemIndex::eraseSlot(size_t pos)
+{
+    const size_t mask = mCapacity - 1;
+    size_t hole = pos;
+    for (size_t next = (pos + 1) & mask; mSlots[next].mPage != nullptr; next = (next + 1) & mask) {
+        // an entry may fill the hole only if this doesn't move it in front of its home slot
+        size_t entryHome = home(mSlots[next].mHash);
+        if (((next - entryHome) & mask) >= ((next - hole) & mask)) {
+            mSlots[hole] = mSlots[next];
+            hole = next;
+        }
+    }
+    mSlots[hole].mPage = nullptr;
+    --mCount;
+}
+
+void ItemIndex::erase(const Item& item, Page* page, size_t index)
+{
+    if (!isValid()) {
+        return;
+    }
+
+    const uint32_t hash_24 = hashOf(item);
+    for (size_t pos = home(hash_24); mSlots[pos].mPage != nullptr; pos = (pos + 1) & (mCapacity - 1)) {
+        if (mSlots[pos].mPage == page && mSlots[pos].mIndex == index) {
+            eraseSlot(pos);
+            return;
+        }
+    }
+}
+
+void ItemIndex::erase(Page* page, size_t index)
+{
+    if (!isValid()) {
+        return;
+    }
+
+    for (size_t pos = 0; pos < mCapacity; ++pos) {
+        if (mSlots[pos].mPage == page && mSlots[pos].mIndex == index) {
+            eraseSlot(pos);
+            return;
+        }
+    }
+}
+
+void ItemIndex::erasePage(Page* page)
+{
+    if (!isValid()) {
+        return;
+    }
+
+    for (size_t pos = 0; pos < mCapacity;) {
+        if (mSlots[pos].mPage == page) {
+            // backward shift may move another entry into this slot, check it again
+            eraseSlot(pos);
+        } else {
+            ++pos;
+        }
+    }
+}
+
+size_t ItemIndex::find(const Item& item, Page** pages, uint8_t* indices, size_t maxCount) const
+{
+    if (!isValid()) {
+        return 0;
+    }
+
+    const uint32_t hash_24 = hashOf(item);
+    size_t count = 0;
+    for (size_t pos = home(hash_24); mSlots[pos].mPage != nullptr; pos = (pos + 1) & (mCapacity - 1)) {
+        if (mSlots[pos].mHash != hash_24) {
+            continue;
+        }
+        if (count == maxCount) {
+            return SIZE_MAX;
+        }
+        pages[count] = mSlots[pos].mPage;
+        indices[count] = mSlots[pos].mIndex;
+        ++count;
+    }
+    return count;
+}
+
+} // namespace nvs
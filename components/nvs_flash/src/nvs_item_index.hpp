@@ -0,0 +1,110 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef nvs_item_index_hpp
+#define nvs_item_index_hpp
+
+#include "nvs.h"
+#include "nvs_types.hpp"
+#include "nvs_memory_management.hpp"
+
+namespace nvs
+{
+
+class Page;
+
+/**
+ * Partition-wide index of the items stored in all pages of one Storage.
+ *
+ * Maps the hash of <namespace index, key, chunk index> (the same hash which is used by the per-page HashList)
+ * to the page and the entry index the item starts at. Lookups can then go directly to the candidate pages
+ * instead of searching every page of the partition.
+ *
+ * The index is an open-addressing hash table with linear probing and backward-shift deletion, so it never
+ * accumulates tombstones. Its size is fixed when it is created. If more items are inserted than the table can
+ * hold, the index drops its table and reports itself as invalid; the owner is then expected to fall back to
+ * searching all pages. Since hashes may collide, every candidate returned by find() has to be verified by
+ * reading the item from its page.
+ */
+class ItemIndex
+{
+public:
+    ItemIndex();
+    ~ItemIndex();
+
+    /**
+     * Allocates a table big enough for maxItems items, limited by maxBytes of RAM.
+     */
+    esp_err_t init(size_t maxItems, size_t maxBytes);
+
+    void clear();
+
+    bool isValid() const
+    {
+        return mSlots != nullptr;
+    }
+
+    void insert(const Item& item, Page* page, size_t index);
+
+    void erase(const Item& item, Page* page, size_t index);
+
+    /**
+     * Slow variant of erase for entries whose header can't be read anymore. Scans the whole table.
+     */
+    void erase(Page* page, size_t index);
+
+    /**
+     * Removes all entries of the given page. Scans the whole table.
+     */
+    void erasePage(Page* page);
+
+    /**
+     * Collects up to maxCount locations of items having the same hash as item.
+     * Returns the number of candidates found, or SIZE_MAX if there were more than maxCount of them.
+     */
+    size_t find(const Item& item, Page** pages, uint8_t* indices, size_t maxCount) const;
+
+    size_t size() const
+    {
+        return mCount;
+    }
+
+    size_t capacity() const
+    {
+        return mCapacity;
+    }
+
+    static uint32_t hashOf(const Item& item)
+    {
+        return item.calculateCrc32WithoutValue() & 0xffffff;
+    }
+
+private:
+    ItemIndex(const ItemIndex& other);
+    const ItemIndex& operator= (const ItemIndex& rhs);
+
+protected:
+    struct Slot {
+        Page* mPage;
+        uint32_t mHash  : 24;
+        uint32_t mIndex : 8;
+    };
+
+    size_t home(uint32_t hash) const
+    {
+        return hash & (mCapacity - 1);
+    }
+
+    void eraseSlot(size_t pos);
+
+    Slot* mSlots = nullptr;
+    size_t mCapacity = 0;
+    size_t mCount = 0;
+}; // class ItemIndex
+
+} // namespace nvs
+
+#endif /* nvs_item_index_hpp */
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -206,6 +206,10 @@ esp_err_t Page::writeItem(uint8_t nsIndex, ItemType datatype, const char* key, c
         return err;
     }
 
+    if (mItemIndex) {
+        mItemIndex->insert(item, this, mNextFreeEntry);
+    }
+
     if (!isVariableLengthType(datatype)) {
         memcpy(item.data, data, dataSize);
         item.crc32 = item.calculateCrc32();
@@ -247,6 +251,289 @@ esp_err_t Page::writeItem(uint8_t nsIndex, ItemType datatype, const char* key, c
     return ESP_OK;
 }
 
+esp_err_t Page::writeItems(uint8_t nsIndex, WriteBatch::iterator begin, WriteBatch::iterator end, bool withMarker)
+{
+    esp_err_t err;
+
+    if (mState == PageState::INVALID) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    if (mState == PageState::UNINITIALIZED) {
+        err = initialize();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    if (mState == PageState::FULL) {
+        return ESP_ERR_NVS_PAGE_FULL;
+    }
+
+    size_t entriesCount = 0;
+    for (auto it = begin; it != end; ++it) {
+        if (it->unchanged) {
+            continue;
+        }
+        if (it->dataSize > Page::CHUNK_MAX_SIZE) {
+            return ESP_ERR_NVS_VALUE_TOO_LONG;
+        }
+        if ((!isVariableLengthType(it->datatype)) && it->dataSize > 8) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        entriesCount += getItemEntryCount(it->datatype, it->dataSize);
+    }
+
+    if (entriesCount == 0) {
+        return ESP_OK;
+    }
+    if (withMarker) {
+        ++entriesCount;
+    }
+
+    if (mNextFreeEntry == INVALID_ENTRY || mNextFreeEntry + entriesCount > ENTRY_COUNT) {
+        // page will not fit this amount of data
+        return ESP_ERR_NVS_PAGE_FULL;
+    }
+
+    // add all items to the hash list before touching the flash, so that running out of memory leaves the page intact
+    Item marker(NS_INDEX, BATCH_MARKER_TYPE, 1, BATCH_MARKER_KEY, BATCH_MARKER_CHUNK);
+    size_t index = mNextFreeEntry;
+    if (withMarker) {
+        err = mHashList.insert(marker, index);
+        if (err != ESP_OK) {
+            return err;
+        }
+        ++index;
+    }
+    for (auto it = begin; it != end; ++it) {
+        if (it->unchanged) {
+            continue;
+        }
+        size_t span = getItemEntryCount(it->datatype, it->dataSize);
+        err = mHashList.insert(Item(nsIndex, it->datatype, span, it->key), index);
+        if (err != ESP_OK) {
+            for (size_t i = mNextFreeEntry; i < index; ++i) {
+                mHashList.erase(i);
+            }
+            return err;
+        }
+        index += span;
+    }
+
+    // Entries are collected in a small buffer and written in as few flash operations as possible.
+    // Their state is changed to WRITTEN only after all of them have been written; if power is lost
+    // before that, the entries are found half-written and erased when the page is loaded.
+    uint8_t buf[ENTRY_SIZE * 8];
+    size_t buffered = 0;
+    size_t writeIndex = mNextFreeEntry;
+    if (withMarker) {
+        if (mItemIndex) {
+            mItemIndex->insert(marker, this, writeIndex);
+        }
+        memset(marker.data, 0, sizeof(marker.data));
+        marker.crc32 = marker.calculateCrc32();
+        memcpy(buf, &marker, ENTRY_SIZE);
+        buffered = 1;
+    }
+    auto flush = [&]() -> esp_err_t {
+        if (buffered == 0) {
+            return ESP_OK;
+        }
+        uint32_t phyAddr;
+        esp_err_t rc = getEntryAddress(writeIndex, &phyAddr);
+        if (rc == ESP_OK) {
+            rc = mPartition->write(phyAddr, buf, buffered * ENTRY_SIZE);
+        }
+        if (rc != ESP_OK) {
+            mState = PageState::INVALID;
+            return rc;
+        }
+        writeIndex += buffered;
+        buffered = 0;
+        return ESP_OK;
+    };
+
+    for (auto it = begin; it != end; ++it) {
+        if (it->unchanged) {
+            continue;
+        }
+        size_t span = getItemEntryCount(it->datatype, it->dataSize);
+        Item item(nsIndex, it->datatype, span, it->key);
+        if (mItemIndex) {
+            mItemIndex->insert(item, this, writeIndex + buffered);
+        }
+
+        const uint8_t* src = it->data();
+        if (!isVariableLengthType(it->datatype)) {
+            memcpy(item.data, src, it->dataSize);
+        } else {
+            item.varLength.dataCrc32 = Item::calculateCrc32(src, it->dataSize);
+            item.varLength.dataSize = it->dataSize;
+            item.varLength.reserved = 0xffff;
+        }
+        item.crc32 = item.calculateCrc32();
+
+        if (buffered == sizeof(buf) / ENTRY_SIZE) {
+            err = flush();
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        memcpy(buf + buffered * ENTRY_SIZE, &item, ENTRY_SIZE);
+        ++buffered;
+
+        if (!isVariableLengthType(it->datatype)) {
+            continue;
+        }
+
+        size_t dataEntries = span - 1;
+        if (buffered + dataEntries > sizeof(buf) / ENTRY_SIZE) {
+            // too big for the buffer, write the data directly after the buffered entries
+            err = flush();
+            if (err != ESP_OK) {
+                return err;
+            }
+            size_t left = it->dataSize - it->dataSize % ENTRY_SIZE;
+            if (left > 0) {
+                uint32_t phyAddr;
+                err = getEntryAddress(writeIndex, &phyAddr);
+                if (err == ESP_OK) {
+                    err = mPartition->write(phyAddr, src, left);
+                }
+                if (err != ESP_OK) {
+                    mState = PageState::INVALID;
+                    return err;
+                }
+                writeIndex += left / ENTRY_SIZE;
+            }
+            if (left < it->dataSize) {
+                std::fill_n(buf, ENTRY_SIZE, 0xff);
+                memcpy(buf, src + left, it->dataSize - left);
+                buffered = 1;
+            }
+        } else {
+            uint8_t* dst = buf + buffered * ENTRY_SIZE;
+            std::fill_n(dst, dataEntries * ENTRY_SIZE, 0xff);
+            memcpy(dst, src, it->dataSize);
+            buffered += dataEntries;
+        }
+    }
+
+    err = flush();
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = alterEntryRangeState(mNextFreeEntry, mNextFreeEntry + entriesCount, EntryState::WRITTEN);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    if (mFirstUsedEntry == INVALID_ENTRY) {
+        mFirstUsedEntry = mNextFreeEntry;
+    }
+    mUsedEntryCount += entriesCount;
+    mNextFreeEntry += entriesCount;
+    return ESP_OK;
+}
+
+esp_err_t Page::findBatchMarker(size_t& itemIndex)
+{
+    // the hash list tells where to start reading entries, pages without a marker are not read at all
+    itemIndex = mHashList.find(0, Item(NS_INDEX, BATCH_MARKER_TYPE, 1, BATCH_MARKER_KEY, BATCH_MARKER_CHUNK));
+    if (itemIndex >= ENTRY_COUNT) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    Item item;
+    return findItem(NS_INDEX, BATCH_MARKER_TYPE, BATCH_MARKER_KEY, itemIndex, item);
+}
+
+esp_err_t Page::eraseItems(WriteBatch::iterator begin, WriteBatch::iterator end)
+{
+    size_t firstWord = SIZE_MAX;
+    size_t lastWord = 0;
+    bool firstUsedErased = false;
+    esp_err_t err;
+
+    for (auto it = begin; it != end; ++it) {
+        if (it->oldPage != this) {
+            continue;
+        }
+        it->oldPage = nullptr;
+        size_t index = it->oldIndex;
+
+        EntryState state;
+        err = mEntryTable.get(index, &state);
+        if (err != ESP_OK) {
+            return err;
+        }
+
+        size_t span = 1;
+        if (state == EntryState::WRITTEN) {
+            Item item;
+            err = readEntry(index, item);
+            if (err != ESP_OK) {
+                return err;
+            }
+            mHashList.erase(index);
+            if (item.calculateCrc32() != item.crc32) {
+                if (mItemIndex) {
+                    mItemIndex->erase(this, index);
+                }
+            } else {
+                if (mItemIndex) {
+                    mItemIndex->erase(item, this, index);
+                }
+                span = item.span;
+            }
+            for (size_t i = index; i < index + span; ++i) {
+                err = mEntryTable.get(i, &state);
+                if (err != ESP_OK) {
+                    return err;
+                }
+                if (state == EntryState::WRITTEN) {
+                    --mUsedEntryCount;
+                }
+                ++mErasedEntryCount;
+            }
+        }
+
+        NVS_ASSERT_OR_RETURN(index + span <= ENTRY_COUNT, ESP_FAIL);
+        for (size_t i = index; i < index + span; ++i) {
+            err = mEntryTable.set(i, EntryState::ERASED);
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        firstWord = std::min(firstWord, mEntryTable.getWordIndex(index));
+        lastWord = std::max(lastWord, mEntryTable.getWordIndex(index + span - 1));
+
+        if (index == mFirstUsedEntry) {
+            firstUsedErased = true;
+        }
+        if (index + span > mNextFreeEntry) {
+            mNextFreeEntry = index + span;
+        }
+    }
+
+    if (firstWord == SIZE_MAX) {
+        return ESP_OK;
+    }
+
+    err = mPartition->write_raw(mBaseAddress + ENTRY_TABLE_OFFSET + static_cast<uint32_t>(firstWord) * 4,
+            mEntryTable.data() + firstWord, (lastWord - firstWord + 1) * 4);
+    if (err != ESP_OK) {
+        mState = PageState::INVALID;
+        return err;
+    }
+
+    if (firstUsedErased) {
+        return updateFirstUsedEntry(mFirstUsedEntry, 1);
+    }
+    return ESP_OK;
+}
+
 esp_err_t Page::readItem(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize, uint8_t chunkIdx, VerOffset chunkStart)
 {
     size_t index = 0;
@@ -388,6 +675,9 @@ esp_err_t Page::eraseEntryAndSpan(size_t index)
         }
         if (item.calculateCrc32() != item.crc32) {
             mHashList.erase(index);
+            if (mItemIndex) {
+                mItemIndex->erase(this, index);
+            }
             rc = alterEntryState(index, EntryState::ERASED);
             --mUsedEntryCount;
             ++mErasedEntryCount;
@@ -396,6 +686,9 @@ esp_err_t Page::eraseEntryAndSpan(size_t index)
             }
         } else {
             mHashList.erase(index);
+            if (mItemIndex) {
+                mItemIndex->erase(item, this, index);
+            }
             span = item.span;
             for (ptrdiff_t i = index + span - 1; i >= static_cast<ptrdiff_t>(index); --i) {
                 rc = mEntryTable.get(i, &state);
@@ -498,6 +791,10 @@ esp_err_t Page::copyItems(Page& other)
             return err;
         }
 
+        if (other.mItemIndex) {
+            other.mItemIndex->insert(entry, &other, other.mNextFreeEntry);
+        }
+
         err = other.writeEntry(entry);
         if (err != ESP_OK) {
             return err;
@@ -1033,6 +1330,9 @@ esp_err_t Page::erase()
     mNextFreeEntry = INVALID_ENTRY;
     mState = PageState::UNINITIALIZED;
     mHashList.clear();
+    if (mItemIndex) {
+        mItemIndex->erasePage(this);
+    }
     return ESP_OK;
 }
 
@@ -1063,6 +1363,16 @@ size_t Page::getVarDataTailroom() const
     return ((mNextFreeEntry < (ENTRY_COUNT-1)) ? ((ENTRY_COUNT - mNextFreeEntry - 1) * ENTRY_SIZE): 0);
 }
 
+size_t Page::getFreeEntryCount() const
+{
+    if (mState == PageState::UNINITIALIZED) {
+        return ENTRY_COUNT;
+    } else if (mState != PageState::ACTIVE || mNextFreeEntry == INVALID_ENTRY) {
+        return 0;
+    }
+    return (mNextFreeEntry < ENTRY_COUNT) ? (ENTRY_COUNT - mNextFreeEntry) : 0;
+}
+
 const char* Page::pageStateToName(PageState ps)
 {
     switch (ps) {
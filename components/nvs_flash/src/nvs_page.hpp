@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -16,6 +16,9 @@
 #include "compressed_enum_table.hpp"
 #include "intrusive_list.h"
 #include "nvs_item_hash_list.hpp"
+#include "nvs_item_hash_table.hpp"
+#include "nvs_item_index.hpp"
+#include "nvs_write_batch.hpp"
 #include "nvs_memory_management.hpp"
 #include "partition.hpp"
 
@@ -47,6 +50,11 @@ public:
 
     static const uint8_t CHUNK_ANY = Item::CHUNK_ANY;
 
+    /* Item marking a run of batch items which replace items on other pages, see writeItems */
+    static constexpr const char* BATCH_MARKER_KEY = "batch";
+    static constexpr ItemType BATCH_MARKER_TYPE = ItemType::U32;
+    static constexpr uint8_t BATCH_MARKER_CHUNK = 0; // namespace entries use CHUNK_ANY, so the hashes differ
+
     static const uint8_t NVS_VERSION = 0xfe; // Decrement to upgrade
 
     enum class PageState : uint32_t {
@@ -100,6 +108,37 @@ public:
 
     esp_err_t eraseEntryAndSpan(size_t index);
 
+    /**
+     * Writes all entries of the batch in [begin, end) which aren't marked as unchanged, or none of them if they
+     * don't fit into the free entries of this page. The entry state table is updated after the data of all items
+     * has been written, one word after the other, so after a power loss the first items may be found on the page
+     * and the others are erased when it is loaded.
+     *
+     * With withMarker, a marker item (namespace index, BATCH_MARKER_TYPE, BATCH_MARKER_KEY) is written before the
+     * items. Until the caller has erased the items they replace and then the marker, the marker tells
+     * PageManager::load that items following it may still have duplicates on earlier pages.
+     */
+    esp_err_t writeItems(uint8_t nsIndex, WriteBatch::iterator begin, WriteBatch::iterator end, bool withMarker);
+
+    /**
+     * Finds the batch marker written by writeItems, if any.
+     */
+    esp_err_t findBatchMarker(size_t& itemIndex);
+
+    /**
+     * Erases the items superseded by the batch entries in [begin, end) which are located in this page,
+     * writing each modified word of the entry state table only once. Resets oldPage of these entries.
+     */
+    esp_err_t eraseItems(WriteBatch::iterator begin, WriteBatch::iterator end);
+
+    static size_t getItemEntryCount(ItemType datatype, size_t dataSize)
+    {
+        if (!isVariableLengthType(datatype)) {
+            return 1;
+        }
+        return 1 + (dataSize + ENTRY_SIZE - 1) / ENTRY_SIZE;
+    }
+
     template<typename T>
     esp_err_t writeItem(uint8_t nsIndex, const char* key, const T& value)
     {
@@ -135,6 +174,8 @@ public:
     }
     size_t getVarDataTailroom() const ;
 
+    size_t getFreeEntryCount() const;
+
     esp_err_t markFull();
 
     esp_err_t markFreeing();
@@ -147,6 +188,11 @@ public:
 
     esp_err_t calcEntries(nvs_stats_t &nvsStats);
 
+    void setItemIndex(ItemIndex* index)
+    {
+        mItemIndex = index;
+    }
+
 protected:
 
     class Header
@@ -219,10 +265,22 @@ protected:
     uint16_t mUsedEntryCount = 0;
     uint16_t mErasedEntryCount = 0;
 
+#ifdef CONFIG_NVS_PAGE_HASH_TABLE
+    typedef HashTable THashList;
+    static_assert(HashTable::MAX_ENTRIES == ENTRY_COUNT, "hash table must cover all page entries");
+#else
+    typedef HashList THashList;
+#endif
+
     /**
      * This hash list stores hashes of namespace index, key, and ChunkIndex for quick lookup when searching items.
      */
-    HashList mHashList;
+    THashList mHashList;
+
+    /**
+     * Partition-wide index owned by the Storage, kept in sync with mHashList if set.
+     */
+    ItemIndex* mItemIndex = nullptr;
 
     Partition *mPartition;
 
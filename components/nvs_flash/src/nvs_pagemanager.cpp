@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -54,6 +54,31 @@ esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t
         mSeqNumber = lastSeqNo + 1;
     }
 
+    // if power went out after a run of batch items was written (see Storage::writeBatch), but before
+    // all the items they replace were erased, the items following the batch marker may have duplicates
+    // on earlier pages
+    for (auto markerPage = begin(); markerPage != end(); ++markerPage) {
+        size_t markerIndex;
+        if (markerPage->findBatchMarker(markerIndex) != ESP_OK) {
+            continue;
+        }
+        Item item;
+        size_t itemIndex = markerIndex + 1;
+        while (markerPage->findItem(Page::NS_ANY, ItemType::ANY, nullptr, itemIndex, item) == ESP_OK) {
+            for (auto it = begin(); it != markerPage; ++it) {
+                if ((it->state() != Page::PageState::FREEING) &&
+                        (it->eraseItem(item.nsIndex, item.datatype, item.key, item.chunkIndex) == ESP_OK)) {
+                    break;
+                }
+            }
+            itemIndex += item.span;
+        }
+        auto err = markerPage->eraseEntryAndSpan(markerIndex);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
     // if power went out after a new item for the given key was written,
     // but before the old one was erased, we end up with a duplicate item
     Page& lastPage = back();
@@ -164,14 +189,15 @@ esp_err_t PageManager::requestNewPage()
         return err;
     }
 
-    Page* newPage = &mPageList.back();
-
-    Page* erasedPage = maxUnusedItemsPageIt;
+    return movePage(maxUnusedItemsPageIt, &mPageList.back());
+}
 
+esp_err_t PageManager::movePage(Page* erasedPage, Page* newPage)
+{
 #ifndef NDEBUG
-    size_t usedEntries = erasedPage->getUsedEntryCount();
+    size_t usedEntries = erasedPage->getUsedEntryCount() + newPage->getUsedEntryCount();
 #endif
-    err = erasedPage->markFreeing();
+    esp_err_t err = erasedPage->markFreeing();
     if (err != ESP_OK) {
         return err;
     }
@@ -189,12 +215,76 @@ esp_err_t PageManager::requestNewPage()
     NVS_ASSERT_OR_RETURN(usedEntries == newPage->getUsedEntryCount(), ESP_FAIL);
 #endif
 
-    mPageList.erase(maxUnusedItemsPageIt);
+    mPageList.erase(erasedPage);
     mFreePageList.push_back(erasedPage);
 
     return ESP_OK;
 }
 
+esp_err_t PageManager::collectGarbageStep(size_t reservePages)
+{
+    Page& activePage = mPageList.back();
+
+    // Pages without any live items are simply erased, this frees a page at the cost of one sector erase
+    for (auto it = begin(); it != end(); ++it) {
+        if (&*it != &activePage && it->state() == Page::PageState::FULL && it->getUsedEntryCount() == 0) {
+            Page* p = it;
+            auto err = p->erase();
+            if (err != ESP_OK) {
+                return err;
+            }
+            mPageList.erase(p);
+            mFreePageList.push_back(p);
+            return ESP_OK;
+        }
+    }
+
+    if (mFreePageList.size() > reservePages) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // The items of the page with the most erased and unwritten entries are moved either into the active page,
+    // if nothing has been written there yet, or into a new page which replaces it. Moving items into an active
+    // page already holding items would be unsafe, since the recovery of an interrupted move erases the target.
+    bool activePageEmpty = activePage.getUsedEntryCount() == 0;
+    size_t activeFreeEntries = activePage.getFreeEntryCount();
+    Page* erasedPage = nullptr;
+    size_t maxUnusedItems = 0;
+    for (auto it = begin(); it != end(); ++it) {
+        if (&*it == &activePage) {
+            continue;
+        }
+        auto unused = Page::ENTRY_COUNT - it->getUsedEntryCount();
+        if (unused > maxUnusedItems && (!activePageEmpty || it->getUsedEntryCount() <= activeFreeEntries)) {
+            erasedPage = it;
+            maxUnusedItems = unused;
+        }
+    }
+
+    // Replacing the active page makes its free entries unusable until the page is moved itself, so this is only
+    // done once the active page is almost full compared to the entries gained
+    if (erasedPage == nullptr || (!activePageEmpty && activeFreeEntries * 4 >= maxUnusedItems)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (activePageEmpty) {
+        return movePage(erasedPage, &activePage);
+    }
+
+    esp_err_t err;
+    if (activePage.state() == Page::PageState::ACTIVE) {
+        err = activePage.markFull();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    err = activatePage();
+    if (err != ESP_OK) {
+        return err;
+    }
+    return movePage(erasedPage, &mPageList.back());
+}
+
 esp_err_t PageManager::activatePage()
 {
     if (mFreePageList.empty()) {
@@ -214,6 +304,13 @@ esp_err_t PageManager::activatePage()
     return ESP_OK;
 }
 
+void PageManager::setItemIndex(ItemIndex* index)
+{
+    for (uint32_t i = 0; i < mPageCount; ++i) {
+        mPages[i].setItemIndex(index);
+    }
+}
+
 esp_err_t PageManager::fillStats(nvs_stats_t& nvsStats)
 {
     nvsStats.used_entries      = 0;
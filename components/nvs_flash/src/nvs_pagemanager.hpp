@@ -54,6 +54,15 @@ public:
 
     esp_err_t requestNewPage();
 
+    /**
+     * Performs one bounded step of garbage collection ahead of time, so that requestNewPage doesn't have to.
+     * Erases one page without live items, or, if no more than reservePages free pages are left, moves the items
+     * of the page with the most unused entries to a fresh page. Each step writes at most one page worth of
+     * entries and erases one sector.
+     * Returns ESP_ERR_NOT_FOUND if there is nothing worth collecting.
+     */
+    esp_err_t collectGarbageStep(size_t reservePages);
+
     esp_err_t fillStats(nvs_stats_t& nvsStats);
 
     uint32_t getBaseSector()
@@ -61,11 +70,15 @@ public:
         return mBaseSector;
     }
 
+    void setItemIndex(ItemIndex* index);
+
 protected:
     friend class Iterator;
 
     esp_err_t activatePage();
 
+    esp_err_t movePage(Page* erasedPage, Page* newPage);
+
     TPageList mPageList;
     TPageList mFreePageList;
     std::unique_ptr<Page[]> mPages;
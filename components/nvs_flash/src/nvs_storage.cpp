@@ -36,174 +36,251 @@ void Storage::clearNamespaces()
     mNamespaces.clearAndFreeNodes();
 }
 
-esp_err_t Storage::populateBlobIndices(TBlobIndexList& blobIdxList)
+Storage::BlobIndexTable::~BlobIndexTable()
 {
-    for (auto it = mPageManager.begin(); it != mPageManager.end(); ++it) {
-        Page& p = *it;
-        size_t itemIndex = 0;
-        Item item;
+    delete[] mBuckets;
+}
 
-        /* If the power went off just after writing a blob index, the duplicate detection
-         * logic in pagemanager will remove the earlier index. So we should never find a
-         * duplicate index at this point */
+esp_err_t Storage::BlobIndexTable::init(TBlobIndexList& blobIdxList)
+{
+    mBucketCount = 1;
+    while (mBucketCount < blobIdxList.size()) {
+        mBucketCount *= 2;
+    }
 
-        while (p.findItem(Page::NS_ANY, ItemType::BLOB_IDX, nullptr, itemIndex, item) == ESP_OK) {
-            BlobIndexNode* entry = new (std::nothrow) BlobIndexNode;
+    mBuckets = new (std::nothrow) BlobIndexNode*[mBucketCount];
+    if (!mBuckets) {
+        return ESP_ERR_NO_MEM;
+    }
+    std::fill_n(mBuckets, mBucketCount, nullptr);
 
-            if (!entry) return ESP_ERR_NO_MEM;
+    for (auto it = blobIdxList.begin(); it != blobIdxList.end(); ++it) {
+        // append, so that find() returns the first matching index in page order
+        BlobIndexNode** pos = bucketFor(it->nsIndex, it->key, it->chunkStart);
+        while (*pos) {
+            pos = &(*pos)->hashNext;
+        }
+        it->hashNext = nullptr;
+        *pos = it;
+    }
+    return ESP_OK;
+}
 
-            item.getKey(entry->key, sizeof(entry->key));
-            entry->nsIndex = item.nsIndex;
-            entry->chunkStart = item.blobIndex.chunkStart;
-            entry->chunkCount = item.blobIndex.chunkCount;
-            entry->dataSize = item.blobIndex.dataSize;
-            entry->observedDataSize = 0;
-            entry->observedChunkCount = 0;
+Storage::BlobIndexNode** Storage::BlobIndexTable::bucketFor(uint8_t nsIndex, const char* key, VerOffset chunkStart)
+{
+    uint32_t hash = Item(nsIndex, ItemType::BLOB_IDX, 0, key, static_cast<uint8_t>(chunkStart)).calculateCrc32WithoutValue();
+    return &mBuckets[hash & (mBucketCount - 1)];
+}
 
-            blobIdxList.push_back(entry);
-            itemIndex += item.span;
+Storage::BlobIndexNode* Storage::BlobIndexTable::find(uint8_t nsIndex, const char* key, VerOffset chunkStart)
+{
+    for (BlobIndexNode* node = *bucketFor(nsIndex, key, chunkStart); node; node = node->hashNext) {
+        if (node->nsIndex == nsIndex && node->chunkStart == chunkStart
+                && strncmp(key, node->key, sizeof(node->key) - 1) == 0) {
+            return node;
         }
     }
+    return nullptr;
+}
 
-    return ESP_OK;
+void Storage::BlobIndexTable::remove(BlobIndexNode* node)
+{
+    for (BlobIndexNode** pos = bucketFor(node->nsIndex, node->key, node->chunkStart); *pos; pos = &(*pos)->hashNext) {
+        if (*pos == node) {
+            *pos = node->hashNext;
+            return;
+        }
+    }
 }
 
-// Check BLOB_DATA entries belonging to BLOB_INDEX entries for mismatched records.
-// BLOB_INDEX record is compared with information collected from BLOB_DATA records
-// matched using namespace index, key and chunk version. Mismatched summary length
-// or wrong number of chunks are checked. Mismatched BLOB_INDEX data are deleted
-// and removed from the blobIdxList. The BLOB_DATA are left as orphans and removed
-// later by the call to eraseOrphanDataBlobs().
-void Storage::eraseMismatchedBlobIndexes(TBlobIndexList& blobIdxList)
+// Collect namespaces, blob indexes and blob data chunks of all pages in a single pass.
+// If power went off just after writing a blob index, the duplicate detection logic in
+// pagemanager removes the earlier index, so duplicate indexes are never found here.
+esp_err_t Storage::loadItems(TBlobIndexList& blobIdxList, TBlobDataList& blobDataList)
 {
     for (auto it = mPageManager.begin(); it != mPageManager.end(); ++it) {
         Page& p = *it;
         size_t itemIndex = 0;
         Item item;
-        /* Chunks with same <ns,key> and with chunkIndex in the following ranges
-         * belong to same family.
-         * 1) VER_0_OFFSET <= chunkIndex < VER_1_OFFSET-1 => Version0 chunks
-         * 2) VER_1_OFFSET <= chunkIndex < VER_ANY => Version1 chunks
-         */
-        while (p.findItem(Page::NS_ANY, ItemType::BLOB_DATA, nullptr, itemIndex, item) == ESP_OK) {
-
-            auto iter = std::find_if(blobIdxList.begin(),
-                    blobIdxList.end(),
-                    [=] (const BlobIndexNode& e) -> bool
-                    {return (strncmp(item.key, e.key, sizeof(e.key) - 1) == 0)
-                            && (item.nsIndex == e.nsIndex)
-                            && (item.chunkIndex >=  static_cast<uint8_t> (e.chunkStart))
-                            && (item.chunkIndex < static_cast<uint8_t> ((e.chunkStart == nvs::VerOffset::VER_0_OFFSET) ? nvs::VerOffset::VER_1_OFFSET : nvs::VerOffset::VER_ANY));});
-            if (iter != std::end(blobIdxList)) {
-                // accumulate the size
-                iter->observedDataSize += item.varLength.dataSize;
-                iter->observedChunkCount++;
+        while (p.findItem(Page::NS_ANY, ItemType::ANY, nullptr, itemIndex, item) == ESP_OK) {
+            mItemIndex.insert(item, &p, itemIndex);
+
+            if (item.nsIndex == Page::NS_INDEX && item.datatype == ItemType::U8) {
+                NamespaceEntry* entry = new (std::nothrow) NamespaceEntry;
+                if (!entry) {
+                    return ESP_ERR_NO_MEM;
+                }
+
+                item.getKey(entry->mName, sizeof(entry->mName));
+                auto err = item.getValue(entry->mIndex);
+                if (err != ESP_OK) {
+                    delete entry;
+                    return err;
+                }
+                if (mNamespaceUsage.set(entry->mIndex, true) != ESP_OK) {
+                    delete entry;
+                    return ESP_FAIL;
+                }
+                mNamespaces.push_back(entry);
+            } else if (item.datatype == ItemType::BLOB_IDX && item.chunkIndex == Page::CHUNK_ANY) {
+                BlobIndexNode* entry = new (std::nothrow) BlobIndexNode;
+                if (!entry) {
+                    return ESP_ERR_NO_MEM;
+                }
+
+                item.getKey(entry->key, sizeof(entry->key));
+                entry->nsIndex = item.nsIndex;
+                entry->chunkStart = item.blobIndex.chunkStart;
+                entry->chunkCount = item.blobIndex.chunkCount;
+                entry->dataSize = item.blobIndex.dataSize;
+                entry->observedDataSize = 0;
+                entry->observedChunkCount = 0;
+                blobIdxList.push_back(entry);
+            } else if (item.datatype == ItemType::BLOB_DATA) {
+                BlobDataNode* entry = new (std::nothrow) BlobDataNode;
+                if (!entry) {
+                    return ESP_ERR_NO_MEM;
+                }
+
+                entry->page = &p;
+                item.getKey(entry->key, sizeof(entry->key));
+                entry->nsIndex = item.nsIndex;
+                entry->chunkIndex = item.chunkIndex;
+                entry->dataSize = item.varLength.dataSize;
+                blobDataList.push_back(entry);
             }
             itemIndex += item.span;
         }
     }
 
+    return ESP_OK;
+}
+
+// Compare each BLOB_INDEX record with the information collected from the BLOB_DATA records
+// matched using namespace index, key and chunk version. BLOB_INDEX records with mismatched
+// summary length or wrong number of chunks are deleted. Afterwards, BLOB_DATA records
+// without a parent BLOB_INDEX are deleted.
+esp_err_t Storage::eraseInconsistentBlobs(TBlobIndexList& blobIdxList, TBlobDataList& blobDataList)
+{
+    BlobIndexTable table;
+    auto err = table.init(blobIdxList);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    /* Chunks with same <ns,key> and with chunkIndex in the following ranges
+     * belong to same family.
+     * 1) VER_0_OFFSET <= chunkIndex < VER_1_OFFSET-1 => Version0 chunks
+     * 2) VER_1_OFFSET <= chunkIndex < VER_ANY => Version1 chunks
+     */
+    auto chunkVersion = [](uint8_t chunkIndex) -> VerOffset {
+        return (chunkIndex >= static_cast<uint8_t>(VerOffset::VER_1_OFFSET)) ? VerOffset::VER_1_OFFSET : VerOffset::VER_0_OFFSET;
+    };
+
+    for (auto it = blobDataList.begin(); it != blobDataList.end(); ++it) {
+        if (it->chunkIndex == Page::CHUNK_ANY) {
+            continue;
+        }
+        BlobIndexNode* index = table.find(it->nsIndex, it->key, chunkVersion(it->chunkIndex));
+        if (index) {
+            // accumulate the size
+            index->observedDataSize += it->dataSize;
+            index->observedChunkCount++;
+        }
+    }
+
     auto iter = blobIdxList.begin();
-    while (iter != blobIdxList.end())
-    {
-        if ( (iter->observedDataSize != iter->dataSize) || (iter->observedChunkCount != iter->chunkCount) )
-        {
+    while (iter != blobIdxList.end()) {
+        if ((iter->observedDataSize != iter->dataSize) || (iter->observedChunkCount != iter->chunkCount)) {
             // Delete blob_index from flash
             // This is very rare case, so we can loop over all pages
             for (auto it = mPageManager.begin(); it != mPageManager.end(); ++it) {
                 // skip pages in non eligible states
                 if (it->state() == nvs::Page::PageState::CORRUPT
                     || it->state() == nvs::Page::PageState::INVALID
-                    || it->state() == nvs::Page::PageState::UNINITIALIZED){
+                    || it->state() == nvs::Page::PageState::UNINITIALIZED) {
                     continue;
                 }
 
                 Page& p = *it;
-                if(p.eraseItem(iter->nsIndex, nvs::ItemType::BLOB_IDX, iter->key, 255, iter->chunkStart) == ESP_OK){
+                if (p.eraseItem(iter->nsIndex, nvs::ItemType::BLOB_IDX, iter->key, 255, iter->chunkStart) == ESP_OK) {
                     break;
                 }
             }
 
-            // Delete blob index from the blobIdxList
+            // Delete blob index from the blobIdxList, its data chunks become orphans
             auto tmp = iter;
             ++iter;
+            table.remove(tmp);
             blobIdxList.erase(tmp);
             delete (nvs::Storage::BlobIndexNode*)tmp;
-        }
-        else
-        {
+        } else {
             // Blob index OK
             ++iter;
         }
     }
+
+    for (auto it = blobDataList.begin(); it != blobDataList.end(); ++it) {
+        BlobIndexNode* index = nullptr;
+        if (it->chunkIndex != Page::CHUNK_ANY) {
+            index = table.find(it->nsIndex, it->key, chunkVersion(it->chunkIndex));
+        }
+        if (!index || it->chunkIndex >= static_cast<uint8_t>(index->chunkStart) + index->chunkCount) {
+            it->page->eraseItem(it->nsIndex, ItemType::BLOB_DATA, it->key, it->chunkIndex);
+        }
+    }
+
+    return ESP_OK;
 }
 
-void Storage::eraseOrphanDataBlobs(TBlobIndexList& blobIdxList)
+#ifdef CONFIG_NVS_ITEM_INDEX
+void Storage::initItemIndex()
 {
-    for (auto it = mPageManager.begin(); it != mPageManager.end(); ++it) {
-        Page& p = *it;
-        size_t itemIndex = 0;
-        Item item;
-        /* Chunks with same <ns,key> and with chunkIndex in the following ranges
-         * belong to same family.
-         * 1) VER_0_OFFSET <= chunkIndex < VER_1_OFFSET-1 => Version0 chunks
-         * 2) VER_1_OFFSET <= chunkIndex < VER_ANY => Version1 chunks
-         */
-        while (p.findItem(Page::NS_ANY, ItemType::BLOB_DATA, nullptr, itemIndex, item) == ESP_OK) {
-
-            auto iter = std::find_if(blobIdxList.begin(),
-                    blobIdxList.end(),
-                    [=] (const BlobIndexNode& e) -> bool
-                    {return (strncmp(item.key, e.key, sizeof(e.key) - 1) == 0)
-                            && (item.nsIndex == e.nsIndex)
-                            && (item.chunkIndex >=  static_cast<uint8_t> (e.chunkStart))
-                            && (item.chunkIndex < static_cast<uint8_t> (e.chunkStart) + e.chunkCount);});
-            if (iter == std::end(blobIdxList)) {
-                p.eraseItem(item.nsIndex, item.datatype, item.key, item.chunkIndex);
-            }
-
-            itemIndex += item.span;
-        }
+    if (mItemIndex.init(mPageManager.getPageCount() * Page::ENTRY_COUNT, CONFIG_NVS_ITEM_INDEX_RAM_SIZE) != ESP_OK) {
+        // Not enough memory for the index, lookups will search all pages
+        return;
     }
+
+    // Items are inserted while loading them, later changes are tracked by the pages
+    mPageManager.setItemIndex(&mItemIndex);
 }
+#endif // CONFIG_NVS_ITEM_INDEX
 
 esp_err_t Storage::init(uint32_t baseSector, uint32_t sectorCount)
 {
+    mItemIndex.clear();
+    mValueCache.clear();
+
     auto err = mPageManager.load(mPartition, baseSector, sectorCount);
     if (err != ESP_OK) {
         mState = StorageState::INVALID;
         return err;
     }
 
-    // load namespaces list
+#ifdef CONFIG_NVS_ITEM_INDEX
+    initItemIndex();
+#endif
+
+    // load namespaces list along with the multi-page blob entries
     clearNamespaces();
     std::fill_n(mNamespaceUsage.data(), mNamespaceUsage.byteSize() / 4, 0);
-    for (auto it = mPageManager.begin(); it != mPageManager.end(); ++it) {
-        Page& p = *it;
-        size_t itemIndex = 0;
-        Item item;
-        while (p.findItem(Page::NS_INDEX, ItemType::U8, nullptr, itemIndex, item) == ESP_OK) {
-            NamespaceEntry* entry = new (std::nothrow) NamespaceEntry;
+    TBlobIndexList blobIdxList;
+    TBlobDataList blobDataList;
+    err = loadItems(blobIdxList, blobDataList);
+    if (err == ESP_OK) {
+        // Remove blob indexes with mismatched blob data and data chunks without parent index
+        err = eraseInconsistentBlobs(blobIdxList, blobDataList);
+    }
 
-            if (!entry) {
-                mState = StorageState::INVALID;
-                return ESP_ERR_NO_MEM;
-            }
+    // Purge the blob lists
+    blobIdxList.clearAndFreeNodes();
+    blobDataList.clearAndFreeNodes();
 
-            item.getKey(entry->mName, sizeof(entry->mName));
-            err = item.getValue(entry->mIndex);
-            if (err != ESP_OK) {
-                delete entry;
-                return err;
-            }
-            if (mNamespaceUsage.set(entry->mIndex, true) != ESP_OK) {
-                delete entry;
-                return ESP_FAIL;
-            }
-            mNamespaces.push_back(entry);
-            itemIndex += item.span;
-        }
+    if (err != ESP_OK) {
+        mState = StorageState::INVALID;
+        return err;
     }
+
     if (mNamespaceUsage.set(0, true) != ESP_OK) {
         return ESP_FAIL;
     }
@@ -211,22 +288,10 @@ esp_err_t Storage::init(uint32_t baseSector, uint32_t sectorCount)
         return ESP_FAIL;
     }
 
-    // Populate list of multi-page index entries.
-    TBlobIndexList blobIdxList;
-    err = populateBlobIndices(blobIdxList);
-    if (err != ESP_OK) {
-        mState = StorageState::INVALID;
-        return ESP_ERR_NO_MEM;
-    }
-
-    // remove blob indexes with mismatched blob data length or chunk count
-    eraseMismatchedBlobIndexes(blobIdxList);
-
-    // Remove the entries for which there is no parent multi-page index.
-    eraseOrphanDataBlobs(blobIdxList);
-
-    // Purge the blob index list
-    blobIdxList.clearAndFreeNodes();
+#ifdef CONFIG_NVS_VALUE_CACHE
+    // Without the cache values are just read from flash every time
+    mValueCache.init(CONFIG_NVS_VALUE_CACHE_ENTRIES, CONFIG_NVS_VALUE_CACHE_MAX_VALUE_SIZE);
+#endif
 
     mState = StorageState::ACTIVE;
 
@@ -241,10 +306,80 @@ bool Storage::isValid() const
     return mState == StorageState::ACTIVE;
 }
 
+esp_err_t Storage::findIndexedItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, size_t &itemIndex, Item& item, uint8_t chunkIdx, VerOffset chunkStart)
+{
+    Page* pages[INDEX_CANDIDATES_MAX];
+    uint8_t indices[INDEX_CANDIDATES_MAX];
+
+    // Candidates are copied out first since verifying them may erase corrupted entries and thereby alter the index
+    size_t count = mItemIndex.find(Item(nsIndex, datatype, 0, key, chunkIdx), pages, indices, INDEX_CANDIDATES_MAX);
+    if (count == SIZE_MAX) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    Page* foundPage = nullptr;
+    uint32_t foundSeqNumber = 0;
+    size_t foundIndex = 0;
+    for (size_t i = 0; i < count; ++i) {
+        // Search each candidate page once, starting at its first candidate. The hash doesn't cover the datatype,
+        // so this finds the same entry as searching the whole page would, including type mismatches.
+        bool seen = false;
+        size_t candidateIndex = indices[i];
+        for (size_t j = 0; j < count; ++j) {
+            if (pages[j] == pages[i]) {
+                seen = seen || j < i;
+                candidateIndex = std::min(candidateIndex, static_cast<size_t>(indices[j]));
+            }
+        }
+        if (seen) {
+            continue;
+        }
+        Item candidate;
+        if (pages[i]->findItem(nsIndex, datatype, key, candidateIndex, candidate, chunkIdx, chunkStart) != ESP_OK) {
+            continue;
+        }
+        uint32_t seqNumber;
+        if (pages[i]->getSeqNumber(seqNumber) != ESP_OK) {
+            continue;
+        }
+        // Prefer the item a search in page order would have found first
+        if (foundPage == nullptr || seqNumber < foundSeqNumber
+                || (seqNumber == foundSeqNumber && candidateIndex < foundIndex)) {
+            foundPage = pages[i];
+            foundSeqNumber = seqNumber;
+            foundIndex = candidateIndex;
+            item = candidate;
+        }
+    }
+
+    if (foundPage == nullptr) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    page = foundPage;
+    itemIndex = foundIndex;
+    return ESP_OK;
+}
+
 esp_err_t Storage::findItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, Item& item, uint8_t chunkIdx, VerOffset chunkStart)
 {
+    size_t itemIndex;
+    return findItem(nsIndex, datatype, key, page, itemIndex, item, chunkIdx, chunkStart);
+}
+
+esp_err_t Storage::findItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, size_t &itemIndex, Item& item, uint8_t chunkIdx, VerOffset chunkStart)
+{
+    // The index is keyed by chunk index as well, so it can't be used to search for any chunk of a blob
+    if (mItemIndex.isValid() && key != nullptr && nsIndex != Page::NS_ANY
+            && !(datatype == ItemType::BLOB_DATA && chunkIdx == Page::CHUNK_ANY)) {
+        auto err = findIndexedItem(nsIndex, datatype, key, page, itemIndex, item, chunkIdx, chunkStart);
+        if (err != ESP_ERR_NVS_INVALID_STATE) {
+            return err;
+        }
+        // Too many colliding hashes, search all pages
+    }
+
     for (auto it = std::begin(mPageManager); it != std::end(mPageManager); ++it) {
-        size_t itemIndex = 0;
+        itemIndex = 0;
         auto err = it->findItem(nsIndex, datatype, key, itemIndex, item, chunkIdx, chunkStart);
         if (err == ESP_OK) {
             page = it;
@@ -369,6 +504,8 @@ esp_err_t Storage::writeItem(uint8_t nsIndex, ItemType datatype, const char* key
     bool matchedTypePageFound = false;
     Item item;
 
+    mValueCache.erase(nsIndex, key);
+
     esp_err_t err;
     if (datatype == ItemType::BLOB) {
         err = findItem(nsIndex, ItemType::BLOB_IDX, key, findPage, item);
@@ -514,6 +651,156 @@ esp_err_t Storage::writeItem(uint8_t nsIndex, ItemType datatype, const char* key
     return ESP_OK;
 }
 
+esp_err_t Storage::findSupersededItem(uint8_t nsIndex, WriteBatch::Entry& entry)
+{
+    Page* findPage = nullptr;
+    size_t itemIndex = 0;
+    Item item;
+    bool matchedTypePageFound = false;
+
+#ifdef CONFIG_NVS_LEGACY_DUP_KEYS_COMPATIBILITY
+    esp_err_t err = findItem(nsIndex, entry.datatype, entry.key, findPage, itemIndex, item);
+    if (err == ESP_OK) {
+        matchedTypePageFound = true;
+    }
+#else
+    esp_err_t err = findItem(nsIndex, ItemType::ANY, entry.key, findPage, itemIndex, item);
+    if (err == ESP_OK && entry.datatype == item.datatype) {
+        matchedTypePageFound = true;
+    }
+#endif
+
+    entry.oldPage = nullptr;
+    entry.unchanged = false;
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        return ESP_OK;
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    if (matchedTypePageFound &&
+            findPage->cmpItem(nsIndex, entry.datatype, entry.key, entry.data(), entry.dataSize) == ESP_OK) {
+        entry.unchanged = true;
+        return ESP_OK;
+    }
+
+    entry.oldPage = findPage;
+    entry.oldIndex = itemIndex;
+    return ESP_OK;
+}
+
+esp_err_t Storage::writeBatch(uint8_t nsIndex, WriteBatch& batch)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    esp_err_t err;
+    auto it = batch.begin();
+    while (it != batch.end()) {
+        if (it->datatype == ItemType::BLOB) {
+            // blobs may span multiple pages, these are written one by one
+            err = writeItem(nsIndex, it->datatype, it->key, it->data(), it->dataSize);
+            if (err != ESP_OK) {
+                return err;
+            }
+            ++it;
+            continue;
+        }
+
+        // Collect the following items which fit into the current page. The items they replace are looked up
+        // only now since requesting a new page may have moved them.
+        Page& page = getCurrentPage();
+        size_t freeEntries = page.getFreeEntryCount();
+        size_t usedEntries = 0;
+        size_t itemCount = 0;
+        bool replacesOtherPages = false;
+        bool withMarker = false;
+        auto runEnd = it;
+        while (runEnd != batch.end() && runEnd->datatype != ItemType::BLOB) {
+            mValueCache.erase(nsIndex, runEnd->key);
+            err = findSupersededItem(nsIndex, *runEnd);
+            if (err != ESP_OK) {
+                return err;
+            }
+            if (!runEnd->unchanged) {
+                // If power is lost before the replaced items are erased, PageManager::load erases the duplicates of
+                // the last item of the last page, and those of the items following a batch marker. A single item
+                // needs no marker, and neither do items replacing ones on this page, which Page::load takes care of.
+                size_t entries = Page::getItemEntryCount(runEnd->datatype, runEnd->dataSize);
+                bool replaces = replacesOtherPages || (runEnd->oldPage != nullptr && runEnd->oldPage != &page);
+                bool marker = replaces && itemCount > 0;
+                if (usedEntries + entries + (marker ? 1 : 0) > freeEntries) {
+                    runEnd->oldPage = nullptr;
+                    break;
+                }
+                usedEntries += entries;
+                ++itemCount;
+                replacesOtherPages = replaces;
+                withMarker = marker;
+            }
+            ++runEnd;
+        }
+
+        if (runEnd == it) {
+            if (freeEntries == Page::ENTRY_COUNT) {
+                return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+            }
+            if (page.state() != Page::PageState::FULL) {
+                err = page.markFull();
+                if (err != ESP_OK) {
+                    return err;
+                }
+            }
+            err = mPageManager.requestNewPage();
+            if (err != ESP_OK) {
+                return err;
+            }
+            continue;
+        }
+
+        err = page.writeItems(nsIndex, it, runEnd, withMarker);
+        if (err == ESP_ERR_NVS_PAGE_FULL) {
+            return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+
+        for (auto entry = it; entry != runEnd; ++entry) {
+            if (entry->oldPage) {
+                err = entry->oldPage->eraseItems(it, runEnd);
+                if (err == ESP_ERR_FLASH_OP_FAIL) {
+                    return ESP_ERR_NVS_REMOVE_FAILED;
+                }
+                if (err != ESP_OK) {
+                    return err;
+                }
+            }
+        }
+        if (withMarker) {
+            size_t markerIndex;
+            err = page.findBatchMarker(markerIndex);
+            if (err == ESP_OK) {
+                err = page.eraseEntryAndSpan(markerIndex);
+            }
+            if (err == ESP_ERR_FLASH_OP_FAIL) {
+                return ESP_ERR_NVS_REMOVE_FAILED;
+            }
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        it = runEnd;
+    }
+
+#ifdef DEBUG_STORAGE
+    debugCheck();
+#endif
+    return ESP_OK;
+}
+
 esp_err_t Storage::createOrOpenNamespace(const char* nsName, bool canCreate, uint8_t& nsIndex)
 {
     if (mState != StorageState::ACTIVE) {
@@ -674,12 +961,30 @@ esp_err_t Storage::readItem(uint8_t nsIndex, ItemType datatype, const char* key,
         } // else check if the blob is stored with earlier version format without index
     }
 
+    const uint8_t* cachedData;
+    size_t cachedSize;
+    if (isCacheableType(datatype) && mValueCache.find(nsIndex, datatype, key, cachedData, cachedSize)) {
+        // same checks as in Page::readItem
+        if (isVariableLengthType(datatype)) {
+            if (dataSize < cachedSize) {
+                return ESP_ERR_NVS_INVALID_LENGTH;
+            }
+        } else if (dataSize != cachedSize) {
+            return ESP_ERR_NVS_TYPE_MISMATCH;
+        }
+        memcpy(data, cachedData, cachedSize);
+        return ESP_OK;
+    }
+
     auto err = findItem(nsIndex, datatype, key, findPage, item);
     if (err != ESP_OK) {
         return err;
     }
-    return findPage->readItem(nsIndex, datatype, key, data, dataSize);
-
+    err = findPage->readItem(nsIndex, datatype, key, data, dataSize);
+    if (err == ESP_OK && isCacheableType(datatype)) {
+        mValueCache.insert(nsIndex, datatype, key, data, isVariableLengthType(datatype) ? item.varLength.dataSize : dataSize);
+    }
+    return err;
 }
 
 esp_err_t Storage::eraseMultiPageBlob(uint8_t nsIndex, const char* key, VerOffset chunkStart)
@@ -756,6 +1061,8 @@ esp_err_t Storage::eraseItem(uint8_t nsIndex, ItemType datatype, const char* key
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    mValueCache.erase(nsIndex, key);
+
     if (datatype == ItemType::BLOB) {
         return eraseMultiPageBlob(nsIndex, key);
     }
@@ -780,6 +1087,8 @@ esp_err_t Storage::eraseNamespace(uint8_t nsIndex)
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    mValueCache.eraseNamespace(nsIndex);
+
     for (auto it = std::begin(mPageManager); it != std::end(mPageManager); ++it) {
         while (true) {
             auto err = it->eraseItem(nsIndex, ItemType::ANY, nullptr);
@@ -821,6 +1130,11 @@ esp_err_t Storage::getItemDataSize(uint8_t nsIndex, ItemType datatype, const cha
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    // the size of a string is read before the string itself, only the read is counted by the cache
+    if (datatype == ItemType::SZ && mValueCache.findSize(nsIndex, datatype, key, dataSize)) {
+        return ESP_OK;
+    }
+
     Item item;
     Page* findPage = nullptr;
     auto err = findItem(nsIndex, datatype, key, findPage, item);
@@ -866,6 +1180,19 @@ void Storage::debugCheck()
                 assert(0);
             }
             keys.insert(std::make_pair(keystr, static_cast<Page*>(p)));
+            if (mItemIndex.isValid()) {
+                Page* pages[INDEX_CANDIDATES_MAX];
+                uint8_t indices[INDEX_CANDIDATES_MAX];
+                size_t count = mItemIndex.find(item, pages, indices, INDEX_CANDIDATES_MAX);
+                bool indexed = (count == SIZE_MAX);
+                for (size_t i = 0; i < count && !indexed; ++i) {
+                    indexed = (pages[i] == static_cast<Page*>(p) && indices[i] == itemIndex);
+                }
+                if (!indexed) {
+                    printf("Item missing in item index: %s\n", keystr.c_str());
+                    assert(0);
+                }
+            }
             itemIndex += item.span;
             usedCount += item.span;
         }
@@ -880,6 +1207,28 @@ esp_err_t Storage::fillStats(nvs_stats_t& nvsStats)
     return mPageManager.fillStats(nvsStats);
 }
 
+esp_err_t Storage::collectGarbageStep()
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+#ifdef CONFIG_NVS_INCREMENTAL_GC
+    return mPageManager.collectGarbageStep(CONFIG_NVS_GC_RESERVE_PAGES);
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t Storage::fillCacheStats(nvs_cache_stats_t& cacheStats)
+{
+    if (!mValueCache.isValid()) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    mValueCache.fillStats(cacheStats);
+    return ESP_OK;
+}
+
 esp_err_t Storage::calcEntriesInNamespace(uint8_t nsIndex, size_t& usedEntries)
 {
     usedEntries = 0;
@@ -13,6 +13,8 @@
 #include "nvs_types.hpp"
 #include "nvs_page.hpp"
 #include "nvs_pagemanager.hpp"
+#include "nvs_item_index.hpp"
+#include "nvs_value_cache.hpp"
 #include "nvs_memory_management.hpp"
 #include "partition.hpp"
 
@@ -51,10 +53,43 @@ class Storage : public intrusive_list_node<Storage>, public ExceptionlessAllocat
             size_t dataSize;
             size_t observedDataSize;
             size_t observedChunkCount;
+            BlobIndexNode* hashNext;
     };
 
     typedef intrusive_list<BlobIndexNode> TBlobIndexList;
 
+    struct BlobDataNode: public intrusive_list_node<BlobDataNode>, public ExceptionlessAllocatable {
+        public:
+            Page* page;
+            char key[Item::MAX_KEY_LENGTH + 1];
+            uint8_t nsIndex;
+            uint8_t chunkIndex;
+            size_t dataSize;
+    };
+
+    typedef intrusive_list<BlobDataNode> TBlobDataList;
+
+    /**
+     * Blob indexes hashed by namespace index, key and version, used to match data chunks to their index.
+     */
+    class BlobIndexTable
+    {
+    public:
+        ~BlobIndexTable();
+
+        esp_err_t init(TBlobIndexList& blobIdxList);
+
+        BlobIndexNode* find(uint8_t nsIndex, const char* key, VerOffset chunkStart);
+
+        void remove(BlobIndexNode* node);
+
+    protected:
+        BlobIndexNode** bucketFor(uint8_t nsIndex, const char* key, VerOffset chunkStart);
+
+        BlobIndexNode** mBuckets = nullptr;
+        size_t mBucketCount = 0;
+    };
+
 public:
     ~Storage();
 
@@ -72,6 +107,12 @@ public:
 
     esp_err_t writeItem(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize);
 
+    /**
+     * Writes all values of the batch. Values equal to the stored ones are skipped. The other ones are written
+     * to the current page in runs of consecutive entries, and the items they replace are erased per page.
+     */
+    esp_err_t writeBatch(uint8_t nsIndex, WriteBatch& batch);
+
     esp_err_t readItem(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize);
 
     esp_err_t findKey(const uint8_t nsIndex, const char* key, ItemType* datatype);
@@ -128,6 +169,10 @@ public:
 
     esp_err_t fillStats(nvs_stats_t& nvsStats);
 
+    esp_err_t fillCacheStats(nvs_cache_stats_t& cacheStats);
+
+    esp_err_t collectGarbageStep();
+
     esp_err_t calcEntriesInNamespace(uint8_t nsIndex, size_t& usedEntries);
 
     bool findEntry(nvs_opaque_iterator_t* it, const char* name);
@@ -145,20 +190,40 @@ protected:
 
     void clearNamespaces();
 
-    esp_err_t populateBlobIndices(TBlobIndexList&);
-
-    void eraseMismatchedBlobIndexes(TBlobIndexList&);
+    esp_err_t loadItems(TBlobIndexList&, TBlobDataList&);
 
-    void eraseOrphanDataBlobs(TBlobIndexList&);
+    esp_err_t eraseInconsistentBlobs(TBlobIndexList&, TBlobDataList&);
 
     void fillEntryInfo(Item &item, nvs_entry_info_t &info);
 
+    void initItemIndex();
+
     esp_err_t findItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, Item& item, uint8_t chunkIdx = Page::CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
+    esp_err_t findItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, size_t &itemIndex, Item& item, uint8_t chunkIdx = Page::CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
+
+    esp_err_t findIndexedItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, size_t &itemIndex, Item& item, uint8_t chunkIdx, VerOffset chunkStart);
+
+    esp_err_t findSupersededItem(uint8_t nsIndex, WriteBatch::Entry& entry);
+
+    /**
+     * Maximum number of items with colliding hashes which are checked through the item index.
+     * If there are more of them, findItem falls back to searching all pages.
+     */
+    static const size_t INDEX_CANDIDATES_MAX = 8;
+
+    static bool isCacheableType(ItemType datatype)
+    {
+        return datatype != ItemType::BLOB && datatype != ItemType::BLOB_DATA && datatype != ItemType::BLOB_IDX
+                && datatype != ItemType::ANY;
+    }
+
 protected:
     Partition *mPartition;
     size_t mPageCount;
     PageManager mPageManager;
+    ItemIndex mItemIndex;
+    ValueCache mValueCache;
     TNamespaces mNamespaces;
     CompressedEnumTable<bool, 1, 256> mNamespaceUsage;
     StorageState mState = StorageState::INVALID;
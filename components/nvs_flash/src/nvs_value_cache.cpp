@@ -0,0 +1,165 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "nvs_value_cache.hpp"
+#include <new>
+#include <cstring>
+#if __has_include(<bsd/string.h>)
+// for strlcpy
+#include <bsd/string.h>
+#endif
+
+namespace nvs
+{
+
+ValueCache::ValueCache()
+{
+}
+
+ValueCache::~ValueCache()
+{
+    clear();
+}
+
+esp_err_t ValueCache::init(size_t entryCount, size_t maxValueSize)
+{
+    clear();
+
+    mEntries = new (std::nothrow) Entry[entryCount];
+    mData = new (std::nothrow) uint8_t[entryCount * maxValueSize];
+    if (!mEntries || !mData) {
+        clear();
+        return ESP_ERR_NO_MEM;
+    }
+
+    mEntryCount = entryCount;
+    mMaxValueSize = maxValueSize;
+    for (size_t i = 0; i < entryCount; ++i) {
+        mEntries[i].data = mData + i * maxValueSize;
+        mFree.push_back(&mEntries[i]);
+    }
+    return ESP_OK;
+}
+
+void ValueCache::clear()
+{
+    mLru.clear();
+    mFree.clear();
+    delete[] mEntries;
+    delete[] mData;
+    mEntries = nullptr;
+    mData = nullptr;
+    mEntryCount = 0;
+    mMaxValueSize = 0;
+    mHits = 0;
+    mMisses = 0;
+}
+
+ValueCache::Entry* ValueCache::lookup(uint8_t nsIndex, ItemType datatype, const char* key)
+{
+    for (auto it = mLru.begin(); it != mLru.end(); ++it) {
+        if (it->nsIndex == nsIndex && it->datatype == datatype && strncmp(it->key, key, sizeof(it->key) - 1) == 0) {
+            return it;
+        }
+    }
+    return nullptr;
+}
+
+bool ValueCache::find(uint8_t nsIndex, ItemType datatype, const char* key, const uint8_t* &data, size_t &dataSize)
+{
+    if (!isValid()) {
+        return false;
+    }
+
+    Entry* entry = lookup(nsIndex, datatype, key);
+    if (entry == nullptr) {
+        ++mMisses;
+        return false;
+    }
+    if (entry != &mLru.front()) {
+        mLru.erase(entry);
+        mLru.push_front(entry);
+    }
+    data = entry->data;
+    dataSize = entry->dataSize;
+    ++mHits;
+    return true;
+}
+
+bool ValueCache::findSize(uint8_t nsIndex, ItemType datatype, const char* key, size_t &dataSize)
+{
+    if (!isValid()) {
+        return false;
+    }
+
+    Entry* entry = lookup(nsIndex, datatype, key);
+    if (entry == nullptr) {
+        return false;
+    }
+    dataSize = entry->dataSize;
+    return true;
+}
+
+void ValueCache::insert(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize)
+{
+    if (!isValid() || dataSize > mMaxValueSize) {
+        return;
+    }
+
+    Entry* entry;
+    if (!mFree.empty()) {
+        entry = &mFree.front();
+        mFree.erase(entry);
+    } else {
+        entry = &mLru.back();
+        mLru.erase(entry);
+    }
+
+    entry->nsIndex = nsIndex;
+    entry->datatype = datatype;
+    entry->dataSize = static_cast<uint16_t>(dataSize);
+    strlcpy(entry->key, key, sizeof(entry->key));
+    memcpy(entry->data, data, dataSize);
+    mLru.push_front(entry);
+}
+
+void ValueCache::release(Entry* entry)
+{
+    mLru.erase(entry);
+    mFree.push_back(entry);
+}
+
+void ValueCache::erase(uint8_t nsIndex, const char* key)
+{
+    for (auto it = mLru.begin(); it != mLru.end();) {
+        Entry* entry = it;
+        ++it;
+        if (entry->nsIndex == nsIndex && strncmp(entry->key, key, sizeof(entry->key) - 1) == 0) {
+            release(entry);
+        }
+    }
+}
+
+void ValueCache::eraseNamespace(uint8_t nsIndex)
+{
+    for (auto it = mLru.begin(); it != mLru.end();) {
+        Entry* entry = it;
+        ++it;
+        if (entry->nsIndex == nsIndex) {
+            release(entry);
+        }
+    }
+}
+
+void ValueCache::fillStats(nvs_cache_stats_t& stats) const
+{
+    stats.hits = mHits;
+    stats.misses = mMisses;
+    stats.used_entries = mLru.size();
+    stats.total_entries = mEntryCount;
+}
+
+} // namespace nvs
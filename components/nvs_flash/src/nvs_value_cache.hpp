@@ -0,0 +1,103 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef nvs_value_cache_hpp
+#define nvs_value_cache_hpp
+
+#include "nvs.h"
+#include "nvs_types.hpp"
+#include "intrusive_list.h"
+
+namespace nvs
+{
+
+/**
+ * Bounded cache of recently read values of one Storage, keyed by namespace index, type and key.
+ *
+ * Only values of primitive types and strings up to a configured size are cached, blobs never are. Entries are
+ * kept in least-recently-used order: a lookup moves the entry found to the front and inserting into a full cache
+ * replaces the entry at the back. All memory is allocated once by init().
+ *
+ * The cache doesn't know about the flash contents, so the owner has to erase the values of every key it writes
+ * or erases.
+ */
+class ValueCache
+{
+public:
+    ValueCache();
+    ~ValueCache();
+
+    /**
+     * Allocates entryCount entries holding values of up to maxValueSize bytes each.
+     */
+    esp_err_t init(size_t entryCount, size_t maxValueSize);
+
+    void clear();
+
+    bool isValid() const
+    {
+        return mEntries != nullptr;
+    }
+
+    /**
+     * Looks up a value and counts the lookup as a hit or a miss. The returned data stays valid until
+     * the next call modifying the cache.
+     */
+    bool find(uint8_t nsIndex, ItemType datatype, const char* key, const uint8_t* &data, size_t &dataSize);
+
+    /**
+     * Looks up the size of a value, without counting the lookup or changing the order of the entries.
+     */
+    bool findSize(uint8_t nsIndex, ItemType datatype, const char* key, size_t &dataSize);
+
+    void insert(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize);
+
+    /**
+     * Removes the values of all types stored under the given key.
+     */
+    void erase(uint8_t nsIndex, const char* key);
+
+    void eraseNamespace(uint8_t nsIndex);
+
+    void fillStats(nvs_cache_stats_t& stats) const;
+
+private:
+    ValueCache(const ValueCache& other);
+    const ValueCache& operator= (const ValueCache& rhs);
+
+protected:
+    struct Entry : public intrusive_list_node<Entry> {
+        uint8_t nsIndex;
+        ItemType datatype;
+        uint16_t dataSize;
+        char key[Item::MAX_KEY_LENGTH + 1];
+        uint8_t* data;
+    };
+
+    typedef intrusive_list<Entry> TEntryList;
+
+    Entry* lookup(uint8_t nsIndex, ItemType datatype, const char* key);
+
+    void release(Entry* entry);
+
+    Entry* mEntries = nullptr;
+    uint8_t* mData = nullptr;
+    size_t mEntryCount = 0;
+    size_t mMaxValueSize = 0;
+
+    /**
+     * Cached values, most recently used first, and entries not holding any value.
+     */
+    TEntryList mLru;
+    TEntryList mFree;
+
+    size_t mHits = 0;
+    size_t mMisses = 0;
+}; // class ValueCache
+
+} // namespace nvs
+
+#endif /* nvs_value_cache_hpp */
@@ -0,0 +1,88 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "sdkconfig.h"
+#include "nvs_write_batch.hpp"
+#include "nvs_page.hpp"
+#include <cstring>
+#if __has_include(<bsd/string.h>)
+// for strlcpy
+#include <bsd/string.h>
+#endif
+
+namespace nvs
+{
+
+WriteBatch::Entry::~Entry()
+{
+    delete[] mHeapData;
+}
+
+WriteBatch::WriteBatch()
+{
+}
+
+WriteBatch::~WriteBatch()
+{
+    clear();
+}
+
+void WriteBatch::clear()
+{
+    mEntries.clearAndFreeNodes();
+}
+
+esp_err_t WriteBatch::add(ItemType datatype, const char* key, const void* data, size_t dataSize)
+{
+    if (strlen(key) > Item::MAX_KEY_LENGTH) {
+        return ESP_ERR_NVS_KEY_TOO_LONG;
+    }
+
+    // reject values which would fail only once the batch is written; blobs are split into chunks
+    if (datatype != ItemType::BLOB && dataSize > Page::CHUNK_MAX_SIZE) {
+        return ESP_ERR_NVS_VALUE_TOO_LONG;
+    }
+
+    Entry* entry = new (std::nothrow) Entry;
+    if (!entry) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (dataSize > sizeof(entry->mInlineData)) {
+        entry->mHeapData = new (std::nothrow) uint8_t[dataSize];
+        if (!entry->mHeapData) {
+            delete entry;
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    memcpy(entry->mHeapData ? entry->mHeapData : entry->mInlineData, data, dataSize);
+    strlcpy(entry->key, key, sizeof(entry->key));
+    entry->datatype = datatype;
+    entry->dataSize = dataSize;
+    entry->oldPage = nullptr;
+    entry->oldIndex = 0;
+    entry->unchanged = false;
+
+    // drop the value set earlier for the same key, the storage would replace it anyway
+    for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+#ifdef CONFIG_NVS_LEGACY_DUP_KEYS_COMPATIBILITY
+        if (it->datatype != datatype) {
+            continue;
+        }
+#endif
+        if (strncmp(it->key, key, sizeof(it->key) - 1) == 0) {
+            Entry* old = it;
+            mEntries.erase(it);
+            delete old;
+            break;
+        }
+    }
+
+    mEntries.push_back(entry);
+    return ESP_OK;
+}
+
+} // namespace nvs
@@ -0,0 +1,91 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef nvs_write_batch_hpp
+#define nvs_write_batch_hpp
+
+#include "nvs.h"
+#include "nvs_types.hpp"
+#include "intrusive_list.h"
+#include "nvs_memory_management.hpp"
+
+namespace nvs
+{
+
+class Page;
+
+/**
+ * Values collected by an open transaction of a handle, written to the storage at once by Storage::writeBatch.
+ *
+ * The batch keeps its own copy of each value. Setting a key which is already part of the batch replaces the
+ * earlier value, so that every key is written at most once per batch.
+ */
+class WriteBatch
+{
+public:
+    struct Entry : public intrusive_list_node<Entry>, public ExceptionlessAllocatable {
+        ~Entry();
+
+        const uint8_t* data() const
+        {
+            return mHeapData ? mHeapData : mInlineData;
+        }
+
+        ItemType datatype;
+        char key[Item::MAX_KEY_LENGTH + 1];
+        size_t dataSize;
+
+        /**
+         * Filled in by Storage::writeBatch: location of the item superseded by this entry, if any,
+         * and whether the stored value is equal to this entry, in which case nothing is written.
+         */
+        Page* oldPage;
+        size_t oldIndex;
+        bool unchanged;
+
+    protected:
+        friend class WriteBatch;
+
+        uint8_t* mHeapData = nullptr;
+        uint8_t mInlineData[8];
+    };
+
+    typedef intrusive_list<Entry> TEntryList;
+    typedef TEntryList::iterator iterator;
+
+    WriteBatch();
+    ~WriteBatch();
+
+    esp_err_t add(ItemType datatype, const char* key, const void* data, size_t dataSize);
+
+    void clear();
+
+    size_t size() const
+    {
+        return mEntries.size();
+    }
+
+    iterator begin()
+    {
+        return mEntries.begin();
+    }
+
+    iterator end()
+    {
+        return mEntries.end();
+    }
+
+private:
+    WriteBatch(const WriteBatch& other);
+    const WriteBatch& operator= (const WriteBatch& rhs);
+
+protected:
+    TEntryList mEntries;
+}; // class WriteBatch
+
+} // namespace nvs
+
+#endif /* nvs_write_batch_hpp */
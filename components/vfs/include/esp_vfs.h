@@ -22,6 +22,7 @@
 #include <sys/termios.h>
 #include <sys/poll.h>
 #include <sys/dirent.h>
+#include <sys/uio.h>
 #include <string.h>
 #include "sdkconfig.h"
 
@@ -73,6 +74,13 @@ typedef struct
     void *sem;              /*!< semaphore instance */
 } esp_vfs_select_sem_t;
 
+/**
+ * @brief Registration of a file descriptor in an epoll set, see esp_vfs_epoll.h
+ *
+ * Opaque to the VFS drivers, which pass it to esp_vfs_epoll_ready to report the readiness of the file descriptor.
+ */
+typedef struct vfs_epoll_watch esp_vfs_epoll_watch_t;
+
 /**
  * @brief VFS definition structure
  *
@@ -252,7 +260,19 @@ typedef struct
     void* (*get_socket_select_semaphore)(void);
     /** get_socket_select_semaphore returns semaphore allocated in the socket driver; set only for the socket driver */
     esp_err_t (*end_select)(void *end_select_args);
+    /** start_poll is called when fd is added to an epoll set, the driver then reports the readiness of fd with esp_vfs_epoll_ready until end_poll is called; optional, start_select and end_select are used on each wait without it */
+    esp_err_t (*start_poll)(int fd, esp_vfs_epoll_watch_t *watch);
+    /** end_poll is called when fd is removed from the epoll set, no more calls of esp_vfs_epoll_ready with this watch are allowed after it returns */
+    void (*end_poll)(int fd, esp_vfs_epoll_watch_t *watch);
 #endif // CONFIG_VFS_SUPPORT_SELECT || defined __DOXYGEN__
+    union {
+        ssize_t (*readv_p)(void *ctx, int fd, const struct iovec *iov, int iovcnt);                  /*!< readv with context pointer, optional (read is called for each buffer if NULL) */
+        ssize_t (*readv)(int fd, const struct iovec *iov, int iovcnt);                               /*!< readv without context pointer, optional (read is called for each buffer if NULL) */
+    };
+    union {
+        ssize_t (*writev_p)(void *ctx, int fd, const struct iovec *iov, int iovcnt);                 /*!< writev with context pointer, optional (write is called for each buffer if NULL) */
+        ssize_t (*writev)(int fd, const struct iovec *iov, int iovcnt);                              /*!< writev without context pointer, optional (write is called for each buffer if NULL) */
+    };
 } esp_vfs_t;
 
 /**
@@ -441,6 +461,27 @@ void esp_vfs_select_triggered(esp_vfs_select_sem_t sem);
  */
 void esp_vfs_select_triggered_isr(esp_vfs_select_sem_t sem, BaseType_t *woken);
 
+/**
+ * @brief Notification from a VFS driver about the readiness of a file descriptor in an epoll set
+ *
+ * This function is called from start_poll with the current readiness of the file descriptor, then each time
+ * it changes. The readiness is level-triggered: the file descriptor is reported by esp_vfs_epoll_wait until
+ * the driver reports that it is not ready anymore. Only available with CONFIG_VFS_SUPPORT_EPOLL.
+ *
+ * @param watch  watch which was passed to the driver by the start_poll call
+ * @param events POLLIN, POLLOUT and POLLERR bits for the conditions which are currently true
+ */
+void esp_vfs_epoll_ready(esp_vfs_epoll_watch_t *watch, uint32_t events);
+
+/**
+ * @brief Notification from a VFS driver about the readiness of a file descriptor in an epoll set (ISR version)
+ *
+ * @param watch  watch which was passed to the driver by the start_poll call
+ * @param events POLLIN, POLLOUT and POLLERR bits for the conditions which are currently true
+ * @param woken  is set to pdTRUE if the function wakes up a task with higher priority
+ */
+void esp_vfs_epoll_ready_isr(esp_vfs_epoll_watch_t *watch, uint32_t events, BaseType_t *woken);
+
 /**
  *
  * @brief Implements the VFS layer of POSIX pread()
@@ -469,6 +510,38 @@ ssize_t esp_vfs_pread(int fd, void *dst, size_t size, off_t offset);
  */
 ssize_t esp_vfs_pwrite(int fd, const void *src, size_t size, off_t offset);
 
+/**
+ *
+ * @brief Implements the VFS layer of POSIX readv()
+ *
+ * The buffers are filled in order. If the VFS driver doesn't implement readv, read is called
+ * for each buffer until a read returns less data than requested.
+ *
+ * @param fd         File descriptor used for read
+ * @param iov        Array of buffers where the output will be written
+ * @param iovcnt     Number of buffers in iov
+ *
+ * @return           A positive return value indicates the number of bytes read. -1 is return on failure and errno is
+ *                   set accordingly.
+ */
+ssize_t esp_vfs_readv(int fd, const struct iovec *iov, int iovcnt);
+
+/**
+ *
+ * @brief Implements the VFS layer of POSIX writev()
+ *
+ * The buffers are written in order. If the VFS driver doesn't implement writev, write is called
+ * for each buffer until a write accepts less data than requested.
+ *
+ * @param fd         File descriptor used for write
+ * @param iov        Array of buffers from where the output will be read
+ * @param iovcnt     Number of buffers in iov
+ *
+ * @return           A positive return value indicates the number of bytes written. -1 is return on failure and errno is
+ *                   set accordingly.
+ */
+ssize_t esp_vfs_writev(int fd, const struct iovec *iov, int iovcnt);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -0,0 +1,121 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/poll.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ESP_VFS_EPOLL_CTL_ADD 1     /*!< Add a file descriptor to the epoll set */
+#define ESP_VFS_EPOLL_CTL_DEL 2     /*!< Remove a file descriptor from the epoll set */
+#define ESP_VFS_EPOLL_CTL_MOD 3     /*!< Change the events and user data of a file descriptor in the epoll set */
+
+/**
+ * @brief User data attached to a file descriptor in an epoll set, returned with its events
+ */
+typedef union {
+    void *ptr;
+    int fd;
+    uint32_t u32;
+} esp_vfs_epoll_data_t;
+
+/**
+ * @brief Events of a file descriptor in an epoll set
+ */
+typedef struct {
+    uint32_t events;                /*!< POLLIN, POLLOUT, POLLERR. POLLERR is always reported, even if not requested */
+    esp_vfs_epoll_data_t data;      /*!< User data */
+} esp_vfs_epoll_event_t;
+
+/**
+ * @brief Epoll vfs initialization settings
+ */
+typedef struct {
+    size_t max_fds;     /*!< The maximum number of epoll sets */
+} esp_vfs_epoll_config_t;
+
+#define ESP_VFS_EPOLL_CONFIG_DEFAULT() (esp_vfs_epoll_config_t) { \
+      .max_fds = 2, \
+}
+
+/**
+ * @brief  Registers the epoll vfs.
+ *
+ * @return  ESP_OK if successful, ESP_ERR_NO_MEM if too many VFSes are
+ *          registered, ESP_ERR_INVALID_STATE if already registered.
+ */
+esp_err_t esp_vfs_epoll_register(const esp_vfs_epoll_config_t *config);
+
+/**
+ * @brief  Unregisters the epoll vfs.
+ *
+ * All the epoll sets have to be closed first.
+ *
+ * @return ESP_OK if successful, ESP_ERR_INVALID_STATE if the epoll vfs
+ *         hasn't been registered or an epoll set is still open
+ */
+esp_err_t esp_vfs_epoll_unregister(void);
+
+/**
+ * @brief Creates an epoll set.
+ *
+ * An epoll set is a persistent set of file descriptors and the events they are
+ * waited for, similar to man(7) epoll. File descriptors of VFS drivers which
+ * implement start_poll (e.g. eventfd and lwip sockets) report their readiness to
+ * the set, so the cost of esp_vfs_epoll_wait only depends on the number of ready
+ * file descriptors. The other file descriptors (e.g. UART) are checked with select()
+ * on each wait.
+ *
+ * The epoll set is itself a file descriptor, which can be used in select()
+ * (readable when esp_vfs_epoll_wait would report events) and is destroyed by close().
+ *
+ * As on Linux, a file descriptor closed by close() is removed from the epoll sets.
+ * Sockets closed by closesocket() or lwip_close() have to be removed with
+ * ESP_VFS_EPOLL_CTL_DEL first.
+ *
+ * @return The file descriptor if successful, -1 if error happens.
+ */
+int esp_vfs_epoll_create(void);
+
+/**
+ * @brief Adds, modifies or removes a file descriptor in an epoll set.
+ *
+ * @param epfd  epoll set created by esp_vfs_epoll_create
+ * @param op    ESP_VFS_EPOLL_CTL_ADD, ESP_VFS_EPOLL_CTL_MOD or ESP_VFS_EPOLL_CTL_DEL
+ * @param fd    file descriptor
+ * @param event events to wait for and user data, not used by ESP_VFS_EPOLL_CTL_DEL
+ *
+ * @return 0 if successful, -1 if error happens (errno is set to EBADF, EINVAL,
+ *         EEXIST if fd is already in the set, ENOENT if fd is not in the set, EPERM if
+ *         the VFS driver of fd supports neither start_poll nor select, or ENOMEM).
+ */
+int esp_vfs_epoll_ctl(int epfd, int op, int fd, const esp_vfs_epoll_event_t *event);
+
+/**
+ * @brief Waits for events in an epoll set.
+ *
+ * Events are level-triggered: a file descriptor is reported by each call as long as it is ready.
+ * When more file descriptors are ready than maxevents, the following calls report the other ones first.
+ *
+ * @param epfd       epoll set created by esp_vfs_epoll_create
+ * @param events     array where the events of the ready file descriptors are written
+ * @param maxevents  size of the events array
+ * @param timeout_ms maximum time to wait in milliseconds, -1 to wait forever, 0 to return immediately
+ *
+ * @return The number of events written to the array, 0 on timeout, -1 if error happens.
+ */
+int esp_vfs_epoll_wait(int epfd, esp_vfs_epoll_event_t *events, int maxevents, int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
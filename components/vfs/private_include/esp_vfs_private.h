@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -92,6 +92,25 @@ const vfs_entry_t *get_vfs_for_path(const char *path);
  */
 const vfs_entry_t *get_vfs_for_index(int index);
 
+/**
+ * Get vfs entry and local fd for a global fd.
+ *
+ * @param fd global file descriptor.
+ * @param local_fd is set to the file descriptor of the VFS driver.
+ *
+ * @return Pointer to the `vfs_entry_t` handling fd, or NULL if fd is not valid.
+ */
+const vfs_entry_t *get_vfs_for_global_fd(int fd, int *local_fd);
+
+#ifdef CONFIG_VFS_SUPPORT_EPOLL
+/**
+ * Remove a file descriptor which is being closed from the epoll sets watching it.
+ *
+ * @param fd global file descriptor.
+ */
+void esp_vfs_epoll_fd_closed(int fd);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
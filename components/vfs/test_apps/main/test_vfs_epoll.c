@@ -0,0 +1,521 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "unity.h"
+#include "ccomp_timer.h"
+#include "esp_vfs.h"
+#include "esp_vfs_epoll.h"
+#include "esp_vfs_eventfd.h"
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+#include "test_utils.h"
+
+#if CONFIG_VFS_SUPPORT_EPOLL
+
+static void add_fd(int epfd, int fd, uint32_t events)
+{
+    esp_vfs_epoll_event_t event = { .events = events, .data.fd = fd };
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_ctl(epfd, ESP_VFS_EPOLL_CTL_ADD, fd, &event));
+}
+
+static void signal_fd(int fd)
+{
+    uint64_t val = 1;
+    TEST_ASSERT_EQUAL(sizeof(val), write(fd, &val, sizeof(val)));
+}
+
+static void clear_fd(int fd)
+{
+    uint64_t val;
+    TEST_ASSERT_EQUAL(sizeof(val), read(fd, &val, sizeof(val)));
+}
+
+TEST_CASE("epoll reports eventfd readiness", "[vfs][epoll]")
+{
+    esp_vfs_eventfd_config_t eventfd_config = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+    TEST_ESP_OK(esp_vfs_eventfd_register(&eventfd_config));
+    esp_vfs_epoll_config_t config = ESP_VFS_EPOLL_CONFIG_DEFAULT();
+    TEST_ESP_OK(esp_vfs_epoll_register(&config));
+
+    int epfd = esp_vfs_epoll_create();
+    TEST_ASSERT_GREATER_OR_EQUAL(0, epfd);
+    int fd0 = eventfd(0, 0);
+    int fd1 = eventfd(0, 0);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, fd0);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, fd1);
+    add_fd(epfd, fd0, POLLIN);
+    add_fd(epfd, fd1, POLLIN);
+
+    esp_vfs_epoll_event_t events[4];
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_wait(epfd, events, 4, 0));
+
+    // Level-triggered: the fd is reported until it is read
+    signal_fd(fd1);
+    for (int i = 0; i < 2; ++i) {
+        TEST_ASSERT_EQUAL(1, esp_vfs_epoll_wait(epfd, events, 4, 0));
+        TEST_ASSERT_EQUAL(POLLIN, events[0].events);
+        TEST_ASSERT_EQUAL(fd1, events[0].data.fd);
+    }
+    clear_fd(fd1);
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_wait(epfd, events, 4, 0));
+
+    // eventfd is always writable
+    esp_vfs_epoll_event_t event = { .events = POLLOUT, .data.u32 = 42 };
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_ctl(epfd, ESP_VFS_EPOLL_CTL_MOD, fd0, &event));
+    TEST_ASSERT_EQUAL(1, esp_vfs_epoll_wait(epfd, events, 4, 0));
+    TEST_ASSERT_EQUAL(POLLOUT, events[0].events);
+    TEST_ASSERT_EQUAL(42, events[0].data.u32);
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_ctl(epfd, ESP_VFS_EPOLL_CTL_DEL, fd0, NULL));
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_wait(epfd, events, 4, 0));
+
+    // The epoll set is readable in select() when it has ready fds
+    fd_set read_fds;
+    struct timeval zero_time = { 0 };
+    FD_ZERO(&read_fds);
+    FD_SET(epfd, &read_fds);
+    TEST_ASSERT_EQUAL(0, select(epfd + 1, &read_fds, NULL, NULL, &zero_time));
+    signal_fd(fd1);
+    FD_ZERO(&read_fds);
+    FD_SET(epfd, &read_fds);
+    TEST_ASSERT_EQUAL(1, select(epfd + 1, &read_fds, NULL, NULL, &zero_time));
+    TEST_ASSERT(FD_ISSET(epfd, &read_fds));
+
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_ctl(epfd, ESP_VFS_EPOLL_CTL_DEL, fd1, NULL));
+    TEST_ASSERT_EQUAL(0, close(fd0));
+    TEST_ASSERT_EQUAL(0, close(fd1));
+    TEST_ASSERT_EQUAL(0, close(epfd));
+    TEST_ESP_OK(esp_vfs_epoll_unregister());
+    TEST_ESP_OK(esp_vfs_eventfd_unregister());
+}
+
+/* UDP socket connected to itself, each send makes it readable */
+static int loopback_socket_init(int port)
+{
+    const struct addrinfo hints = {
+        .ai_family = AF_INET,
+        .ai_socktype = SOCK_DGRAM,
+    };
+    struct addrinfo *res;
+    char port_str[8];
+    snprintf(port_str, sizeof(port_str), "%d", port);
+    TEST_ASSERT_EQUAL(0, getaddrinfo("localhost", port_str, &hints, &res));
+    TEST_ASSERT_NOT_NULL(res);
+
+    const int fd = socket(res->ai_family, res->ai_socktype, 0);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, fd);
+    struct sockaddr_in saddr = {
+        .sin_family = PF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    TEST_ASSERT_EQUAL(0, bind(fd, (struct sockaddr *) &saddr, sizeof(saddr)));
+    TEST_ASSERT_EQUAL(0, connect(fd, res->ai_addr, res->ai_addrlen));
+    freeaddrinfo(res);
+    return fd;
+}
+
+static void send_task(void *arg)
+{
+    int fd = *((int *)arg);
+    vTaskDelay(pdMS_TO_TICKS(100));
+    TEST_ASSERT_EQUAL(4, send(fd, "ping", 4, 0));
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("epoll reports socket readiness", "[vfs][epoll][lwip]")
+{
+    test_case_uses_tcpip();
+    esp_vfs_epoll_config_t config = ESP_VFS_EPOLL_CONFIG_DEFAULT();
+    TEST_ESP_OK(esp_vfs_epoll_register(&config));
+
+    int epfd = esp_vfs_epoll_create();
+    TEST_ASSERT_GREATER_OR_EQUAL(0, epfd);
+    int fd = loopback_socket_init(8080);
+    add_fd(epfd, fd, POLLIN);
+
+    esp_vfs_epoll_event_t events[4];
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_wait(epfd, events, 4, 10));
+
+    // A datagram received while waiting ends the wait
+    xTaskCreate(send_task, "send_task", 2048, &fd, 5, NULL);
+    TEST_ASSERT_EQUAL(1, esp_vfs_epoll_wait(epfd, events, 4, 1000));
+    TEST_ASSERT_EQUAL(POLLIN, events[0].events);
+    TEST_ASSERT_EQUAL(fd, events[0].data.fd);
+
+    // Level-triggered: the socket is reported until each datagram is read
+    TEST_ASSERT_EQUAL(4, send(fd, "pong", 4, 0));
+    vTaskDelay(pdMS_TO_TICKS(10));
+    char buf[8];
+    TEST_ASSERT_EQUAL(4, recv(fd, buf, sizeof(buf), 0));
+    TEST_ASSERT_EQUAL(1, esp_vfs_epoll_wait(epfd, events, 4, 0));
+    TEST_ASSERT_EQUAL(4, read(fd, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_wait(epfd, events, 4, 0));
+
+    // A UDP socket is always writable
+    esp_vfs_epoll_event_t event = { .events = POLLIN | POLLOUT, .data.fd = fd };
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_ctl(epfd, ESP_VFS_EPOLL_CTL_MOD, fd, &event));
+    TEST_ASSERT_EQUAL(1, esp_vfs_epoll_wait(epfd, events, 4, 0));
+    TEST_ASSERT_EQUAL(POLLOUT, events[0].events);
+
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_ctl(epfd, ESP_VFS_EPOLL_CTL_DEL, fd, NULL));
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_wait(epfd, events, 4, 0));
+    TEST_ASSERT_EQUAL(0, close(fd));
+    TEST_ASSERT_EQUAL(0, close(epfd));
+    TEST_ESP_OK(esp_vfs_epoll_unregister());
+}
+
+TEST_CASE("epoll removes closed fds", "[vfs][epoll][lwip]")
+{
+    test_case_uses_tcpip();
+    esp_vfs_eventfd_config_t eventfd_config = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+    TEST_ESP_OK(esp_vfs_eventfd_register(&eventfd_config));
+    esp_vfs_epoll_config_t config = ESP_VFS_EPOLL_CONFIG_DEFAULT();
+    TEST_ESP_OK(esp_vfs_epoll_register(&config));
+
+    int epfd0 = esp_vfs_epoll_create();
+    int epfd1 = esp_vfs_epoll_create();
+    int fd = eventfd(0, 0);
+    int socket_fd = loopback_socket_init(8081);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, epfd0);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, epfd1);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, fd);
+    add_fd(epfd0, fd, POLLIN);
+    add_fd(epfd1, fd, POLLIN);
+    add_fd(epfd0, socket_fd, POLLOUT);
+    signal_fd(fd);
+    esp_vfs_epoll_event_t events[4];
+    TEST_ASSERT_EQUAL(2, esp_vfs_epoll_wait(epfd0, events, 4, 0));
+    TEST_ASSERT_EQUAL(1, esp_vfs_epoll_wait(epfd1, events, 4, 0));
+
+    // Closed fds leave every set, as on Linux
+    TEST_ASSERT_EQUAL(0, close(fd));
+    TEST_ASSERT_EQUAL(0, close(socket_fd));
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_wait(epfd0, events, 4, 0));
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_wait(epfd1, events, 4, 0));
+    TEST_ASSERT_EQUAL(-1, esp_vfs_epoll_ctl(epfd0, ESP_VFS_EPOLL_CTL_DEL, fd, NULL));
+    TEST_ASSERT_EQUAL(ENOENT, errno);
+    TEST_ASSERT_EQUAL(-1, esp_vfs_epoll_ctl(epfd0, ESP_VFS_EPOLL_CTL_DEL, socket_fd, NULL));
+    TEST_ASSERT_EQUAL(ENOENT, errno);
+
+    // A new fd reusing the number isn't in the sets
+    int new_fd = eventfd(0, 0);
+    TEST_ASSERT_EQUAL(fd, new_fd);
+    signal_fd(new_fd);
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_wait(epfd1, events, 4, 0));
+    add_fd(epfd1, new_fd, POLLIN);
+    TEST_ASSERT_EQUAL(1, esp_vfs_epoll_wait(epfd1, events, 4, 0));
+
+    TEST_ASSERT_EQUAL(0, close(new_fd));
+    TEST_ASSERT_EQUAL(0, close(epfd0));
+    TEST_ASSERT_EQUAL(0, close(epfd1));
+    TEST_ESP_OK(esp_vfs_epoll_unregister());
+    TEST_ESP_OK(esp_vfs_eventfd_unregister());
+}
+
+TEST_CASE("epoll ctl errors", "[vfs][epoll]")
+{
+    esp_vfs_eventfd_config_t eventfd_config = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+    TEST_ESP_OK(esp_vfs_eventfd_register(&eventfd_config));
+    esp_vfs_epoll_config_t config = ESP_VFS_EPOLL_CONFIG_DEFAULT();
+    TEST_ASSERT_EQUAL(-1, esp_vfs_epoll_create());
+    TEST_ASSERT_EQUAL(EACCES, errno);
+    TEST_ESP_OK(esp_vfs_epoll_register(&config));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, esp_vfs_epoll_register(&config));
+
+    int epfd = esp_vfs_epoll_create();
+    int fd = eventfd(0, 0);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, epfd);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, fd);
+    esp_vfs_epoll_event_t event = { .events = POLLIN };
+
+    TEST_ASSERT_EQUAL(-1, esp_vfs_epoll_ctl(epfd, ESP_VFS_EPOLL_CTL_MOD, fd, &event));
+    TEST_ASSERT_EQUAL(ENOENT, errno);
+    TEST_ASSERT_EQUAL(-1, esp_vfs_epoll_ctl(epfd, ESP_VFS_EPOLL_CTL_DEL, fd, NULL));
+    TEST_ASSERT_EQUAL(ENOENT, errno);
+    add_fd(epfd, fd, POLLIN);
+    TEST_ASSERT_EQUAL(-1, esp_vfs_epoll_ctl(epfd, ESP_VFS_EPOLL_CTL_ADD, fd, &event));
+    TEST_ASSERT_EQUAL(EEXIST, errno);
+    TEST_ASSERT_EQUAL(-1, esp_vfs_epoll_ctl(epfd, ESP_VFS_EPOLL_CTL_ADD, epfd, &event));
+    TEST_ASSERT_EQUAL(EINVAL, errno);
+    TEST_ASSERT_EQUAL(-1, esp_vfs_epoll_ctl(epfd, ESP_VFS_EPOLL_CTL_MOD, fd, NULL));
+    TEST_ASSERT_EQUAL(EINVAL, errno);
+    TEST_ASSERT_EQUAL(-1, esp_vfs_epoll_ctl(fd, ESP_VFS_EPOLL_CTL_ADD, epfd, &event));
+    TEST_ASSERT_EQUAL(EBADF, errno);
+    int closed_fd = eventfd(0, 0);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, closed_fd);
+    TEST_ASSERT_EQUAL(0, close(closed_fd));
+    TEST_ASSERT_EQUAL(-1, esp_vfs_epoll_ctl(epfd, ESP_VFS_EPOLL_CTL_ADD, closed_fd, &event));
+    TEST_ASSERT_EQUAL(EBADF, errno);
+    TEST_ASSERT_EQUAL(-1, esp_vfs_epoll_wait(fd, &event, 1, 0));
+    TEST_ASSERT_EQUAL(EBADF, errno);
+
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_ctl(epfd, ESP_VFS_EPOLL_CTL_DEL, fd, NULL));
+    TEST_ASSERT_EQUAL(0, close(fd));
+    TEST_ASSERT_EQUAL(0, close(epfd));
+    TEST_ESP_OK(esp_vfs_epoll_unregister());
+    TEST_ESP_OK(esp_vfs_eventfd_unregister());
+}
+
+TEST_CASE("epoll can't be unregistered while a set is open", "[vfs][epoll]")
+{
+    esp_vfs_eventfd_config_t eventfd_config = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+    TEST_ESP_OK(esp_vfs_eventfd_register(&eventfd_config));
+    esp_vfs_epoll_config_t config = ESP_VFS_EPOLL_CONFIG_DEFAULT();
+    TEST_ESP_OK(esp_vfs_epoll_register(&config));
+
+    int epfd = esp_vfs_epoll_create();
+    int fd = eventfd(0, 0);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, epfd);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, fd);
+    add_fd(epfd, fd, POLLIN);
+
+    // the set and its watch stay usable
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, esp_vfs_epoll_unregister());
+    signal_fd(fd);
+    esp_vfs_epoll_event_t events[1];
+    TEST_ASSERT_EQUAL(1, esp_vfs_epoll_wait(epfd, events, 1, 0));
+    TEST_ASSERT_EQUAL(fd, events[0].data.fd);
+
+    TEST_ASSERT_EQUAL(0, close(epfd));
+    TEST_ESP_OK(esp_vfs_epoll_unregister());
+    // the closed set doesn't watch fd any more
+    signal_fd(fd);
+    TEST_ASSERT_EQUAL(0, close(fd));
+    TEST_ESP_OK(esp_vfs_eventfd_unregister());
+}
+
+typedef struct {
+    int fd;
+    esp_vfs_select_sem_t sem;
+    fd_set *read_fds;
+    volatile bool readable;
+    volatile bool selecting;
+} select_only_vfs_t;
+
+static select_only_vfs_t s_select_only;
+
+static esp_err_t select_only_start_select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds,
+                                          esp_vfs_select_sem_t sem, void **end_select_args)
+{
+    s_select_only.read_fds = FD_ISSET(0, readfds) ? readfds : NULL;
+    FD_ZERO(readfds);
+    FD_ZERO(writefds);
+    FD_ZERO(exceptfds);
+    s_select_only.sem = sem;
+    s_select_only.selecting = true;
+    if (s_select_only.read_fds && s_select_only.readable) {
+        esp_vfs_select_triggered(sem);
+    }
+    *end_select_args = NULL;
+    return ESP_OK;
+}
+
+static esp_err_t select_only_end_select(void *end_select_args)
+{
+    s_select_only.selecting = false;
+    if (s_select_only.read_fds && s_select_only.readable) {
+        FD_SET(0, s_select_only.read_fds);
+    }
+    return ESP_OK;
+}
+
+static int select_only_close(int fd)
+{
+    return 0;
+}
+
+static void signal_task(void *arg)
+{
+    int fd = *((int *)arg);
+    vTaskDelay(pdMS_TO_TICKS(100));
+    signal_fd(fd);
+    vTaskDelete(NULL);
+}
+
+static void select_only_task(void *arg)
+{
+    vTaskDelay(pdMS_TO_TICKS(100));
+    s_select_only.readable = true;
+    while (!s_select_only.selecting) {
+        vTaskDelay(1);
+    }
+    esp_vfs_select_triggered(s_select_only.sem);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("epoll uses select for drivers without start_poll", "[vfs][epoll]")
+{
+    esp_vfs_eventfd_config_t eventfd_config = ESP_VFS_EVENTD_CONFIG_DEFAULT();
+    TEST_ESP_OK(esp_vfs_eventfd_register(&eventfd_config));
+    esp_vfs_epoll_config_t config = ESP_VFS_EPOLL_CONFIG_DEFAULT();
+    TEST_ESP_OK(esp_vfs_epoll_register(&config));
+
+    esp_vfs_t desc = {
+        .flags = ESP_VFS_FLAG_DEFAULT,
+        .close = &select_only_close,
+        .start_select = &select_only_start_select,
+        .end_select = &select_only_end_select,
+    };
+    esp_vfs_id_t vfs_id;
+    TEST_ESP_OK(esp_vfs_register_with_id(&desc, NULL, &vfs_id));
+    s_select_only = (select_only_vfs_t) { 0 };
+    TEST_ESP_OK(esp_vfs_register_fd_with_local_fd(vfs_id, 0, false, &s_select_only.fd));
+
+    int epfd = esp_vfs_epoll_create();
+    int fd = eventfd(0, 0);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, epfd);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, fd);
+    add_fd(epfd, fd, POLLIN);
+    add_fd(epfd, s_select_only.fd, POLLIN);
+
+    esp_vfs_epoll_event_t events[4];
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_wait(epfd, events, 4, 10));
+
+    // An eventfd signalled by another task ends the wait on the select-only fd
+    xTaskCreate(signal_task, "signal_task", 2048, &fd, 5, NULL);
+    TEST_ASSERT_EQUAL(1, esp_vfs_epoll_wait(epfd, events, 4, 1000));
+    TEST_ASSERT_EQUAL(fd, events[0].data.fd);
+    clear_fd(fd);
+
+    xTaskCreate(select_only_task, "select_only_task", 2048, NULL, 5, NULL);
+    TEST_ASSERT_EQUAL(1, esp_vfs_epoll_wait(epfd, events, 4, 1000));
+    TEST_ASSERT_EQUAL(s_select_only.fd, events[0].data.fd);
+    TEST_ASSERT_EQUAL(POLLIN, events[0].events);
+
+    // Both kinds of fds are reported by the same call
+    signal_fd(fd);
+    TEST_ASSERT_EQUAL(2, esp_vfs_epoll_wait(epfd, events, 4, 0));
+
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_ctl(epfd, ESP_VFS_EPOLL_CTL_DEL, fd, NULL));
+    TEST_ASSERT_EQUAL(0, esp_vfs_epoll_ctl(epfd, ESP_VFS_EPOLL_CTL_DEL, s_select_only.fd, NULL));
+    TEST_ASSERT_EQUAL(0, close(fd));
+    TEST_ASSERT_EQUAL(0, close(epfd));
+    TEST_ASSERT_EQUAL(0, close(s_select_only.fd));
+    TEST_ESP_OK(esp_vfs_unregister_with_id(vfs_id));
+    TEST_ESP_OK(esp_vfs_epoll_unregister());
+    TEST_ESP_OK(esp_vfs_eventfd_unregister());
+}
+
+TEST_CASE("epoll wait time compared to select", "[vfs][epoll]")
+{
+    const int iter_count = 1000;
+    const int fd_counts[] = { 8, 32, 64 };
+    esp_vfs_eventfd_config_t eventfd_config = { .max_fds = MAX_FDS - 1 };
+    TEST_ESP_OK(esp_vfs_eventfd_register(&eventfd_config));
+    esp_vfs_epoll_config_t config = ESP_VFS_EPOLL_CONFIG_DEFAULT();
+    TEST_ESP_OK(esp_vfs_epoll_register(&config));
+
+    for (int i = 0; i < sizeof(fd_counts) / sizeof(fd_counts[0]); ++i) {
+        int epfd = esp_vfs_epoll_create();
+        TEST_ASSERT_GREATER_OR_EQUAL(0, epfd);
+        int fds[MAX_FDS];
+        int count;
+        int max_fd = 0;
+        // The number of fds is limited by MAX_FDS, use all the remaining ones
+        for (count = 0; count < fd_counts[i]; ++count) {
+            fds[count] = eventfd(0, 0);
+            if (fds[count] < 0) {
+                break;
+            }
+            max_fd = fds[count] > max_fd ? fds[count] : max_fd;
+            add_fd(epfd, fds[count], POLLIN);
+        }
+        TEST_ASSERT_GREATER_THAN(0, count);
+        signal_fd(fds[count / 2]);
+
+        struct timeval zero_time = { 0 };
+        ccomp_timer_start();
+        for (int j = 0; j < iter_count; ++j) {
+            fd_set read_fds;
+            FD_ZERO(&read_fds);
+            for (int k = 0; k < count; ++k) {
+                FD_SET(fds[k], &read_fds);
+            }
+            TEST_ASSERT_EQUAL(1, select(max_fd + 1, &read_fds, NULL, NULL, &zero_time));
+        }
+        const int64_t select_time_us = ccomp_timer_stop();
+
+        esp_vfs_epoll_event_t events[4];
+        ccomp_timer_start();
+        for (int j = 0; j < iter_count; ++j) {
+            TEST_ASSERT_EQUAL(1, esp_vfs_epoll_wait(epfd, events, 4, 0));
+        }
+        const int64_t epoll_time_us = ccomp_timer_stop();
+        printf("%d fds, 1 ready: %d ns per select(), %d ns per esp_vfs_epoll_wait()\n", count,
+               (int) (select_time_us * 1000 / iter_count), (int) (epoll_time_us * 1000 / iter_count));
+
+        for (int k = 0; k < count; ++k) {
+            TEST_ASSERT_EQUAL(0, esp_vfs_epoll_ctl(epfd, ESP_VFS_EPOLL_CTL_DEL, fds[k], NULL));
+            TEST_ASSERT_EQUAL(0, close(fds[k]));
+        }
+        TEST_ASSERT_EQUAL(0, close(epfd));
+    }
+
+    TEST_ESP_OK(esp_vfs_epoll_unregister());
+    TEST_ESP_OK(esp_vfs_eventfd_unregister());
+}
+
+TEST_CASE("epoll wait time for sockets compared to select", "[vfs][epoll][lwip]")
+{
+    test_case_uses_tcpip();
+    const int iter_count = 1000;
+    esp_vfs_epoll_config_t config = ESP_VFS_EPOLL_CONFIG_DEFAULT();
+    TEST_ESP_OK(esp_vfs_epoll_register(&config));
+
+    int epfd = esp_vfs_epoll_create();
+    TEST_ASSERT_GREATER_OR_EQUAL(0, epfd);
+    int fds[CONFIG_LWIP_MAX_SOCKETS];
+    int count;
+    int max_fd = 0;
+    // Use all the sockets, one of them is readable
+    for (count = 0; count < CONFIG_LWIP_MAX_SOCKETS; ++count) {
+        fds[count] = (count == 0) ? loopback_socket_init(8082) : socket(AF_INET, SOCK_DGRAM, 0);
+        if (fds[count] < 0) {
+            break;
+        }
+        max_fd = fds[count] > max_fd ? fds[count] : max_fd;
+        add_fd(epfd, fds[count], POLLIN);
+    }
+    TEST_ASSERT_GREATER_THAN(0, count);
+    TEST_ASSERT_EQUAL(4, send(fds[0], "ping", 4, 0));
+    esp_vfs_epoll_event_t events[4];
+    TEST_ASSERT_EQUAL(1, esp_vfs_epoll_wait(epfd, events, 4, 1000));
+
+    struct timeval zero_time = { 0 };
+    ccomp_timer_start();
+    for (int j = 0; j < iter_count; ++j) {
+        fd_set read_fds;
+        FD_ZERO(&read_fds);
+        for (int k = 0; k < count; ++k) {
+            FD_SET(fds[k], &read_fds);
+        }
+        TEST_ASSERT_EQUAL(1, select(max_fd + 1, &read_fds, NULL, NULL, &zero_time));
+    }
+    const int64_t select_time_us = ccomp_timer_stop();
+
+    ccomp_timer_start();
+    for (int j = 0; j < iter_count; ++j) {
+        TEST_ASSERT_EQUAL(1, esp_vfs_epoll_wait(epfd, events, 4, 0));
+    }
+    const int64_t epoll_time_us = ccomp_timer_stop();
+    printf("%d sockets, 1 ready: %d ns per select(), %d ns per esp_vfs_epoll_wait()\n", count,
+           (int) (select_time_us * 1000 / iter_count), (int) (epoll_time_us * 1000 / iter_count));
+
+    for (int k = 0; k < count; ++k) {
+        TEST_ASSERT_EQUAL(0, close(fds[k]));
+    }
+    TEST_ASSERT_EQUAL(0, close(epfd));
+    TEST_ESP_OK(esp_vfs_epoll_unregister());
+}
+
+#endif // CONFIG_VFS_SUPPORT_EPOLL
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2022 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -10,6 +10,8 @@
 #include <unistd.h>
 #include <errno.h>
 #include <sys/fcntl.h>
+#include <sys/param.h>
+#include <sys/uio.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
@@ -289,3 +291,115 @@ TEST_CASE("esp_vfs_register_fd_range checks for overlap", "[vfs]")
     TEST_ESP_OK(esp_vfs_unregister("/test"));
     TEST_ESP_ERR(ESP_ERR_INVALID_ARG, err);
 }
+
+typedef struct {
+    char data[16];
+    size_t len;
+    size_t pos;
+    int rw_calls;       /*!< number of read/write calls */
+    int rwv_calls;      /*!< number of readv/writev calls */
+} iov_test_vfs_ctx_t;
+
+static int iov_test_vfs_open(void* ctx, const char * path, int flags, int mode)
+{
+    return 0;
+}
+
+static int iov_test_vfs_close(void* ctx, int fd)
+{
+    return 0;
+}
+
+static ssize_t iov_test_vfs_append(iov_test_vfs_ctx_t *test_ctx, const void * data, size_t size)
+{
+    size = MIN(size, sizeof(test_ctx->data) - test_ctx->len);
+    memcpy(test_ctx->data + test_ctx->len, data, size);
+    test_ctx->len += size;
+    return size;
+}
+
+static ssize_t iov_test_vfs_write(void* ctx, int fd, const void * data, size_t size)
+{
+    iov_test_vfs_ctx_t *test_ctx = (iov_test_vfs_ctx_t *) ctx;
+    test_ctx->rw_calls++;
+    return iov_test_vfs_append(test_ctx, data, size);
+}
+
+static ssize_t iov_test_vfs_writev(void* ctx, int fd, const struct iovec *iov, int iovcnt)
+{
+    iov_test_vfs_ctx_t *test_ctx = (iov_test_vfs_ctx_t *) ctx;
+    test_ctx->rwv_calls++;
+    ssize_t total = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        total += iov_test_vfs_append(test_ctx, iov[i].iov_base, iov[i].iov_len);
+    }
+    return total;
+}
+
+static ssize_t iov_test_vfs_read(void* ctx, int fd, void * dst, size_t size)
+{
+    iov_test_vfs_ctx_t *test_ctx = (iov_test_vfs_ctx_t *) ctx;
+    test_ctx->rw_calls++;
+    size = MIN(size, test_ctx->len - test_ctx->pos);
+    memcpy(dst, test_ctx->data + test_ctx->pos, size);
+    test_ctx->pos += size;
+    return size;
+}
+
+static void test_vfs_iov(const esp_vfs_t *desc, int expected_write_calls, int expected_writev_calls)
+{
+    iov_test_vfs_ctx_t ctx = { 0 };
+    TEST_ESP_OK( esp_vfs_register(VFS_PREF1, desc, &ctx) );
+    const int fd = open(VFS_PREF1 FILE1, 0, 0);
+    TEST_ASSERT_NOT_EQUAL(-1, fd);
+
+    char hello[] = "hello", empty[] = "", world[] = " world";
+    const struct iovec wr_iov[] = {
+        { .iov_base = hello, .iov_len = strlen(hello) },
+        { .iov_base = empty, .iov_len = 0 },
+        { .iov_base = world, .iov_len = strlen(world) },
+    };
+    TEST_ASSERT_EQUAL(11, writev(fd, wr_iov, 3));
+    TEST_ASSERT_EQUAL_STRING_LEN("hello world", ctx.data, 11);
+    TEST_ASSERT_EQUAL(expected_write_calls, ctx.rw_calls);
+    TEST_ASSERT_EQUAL(expected_writev_calls, ctx.rwv_calls);
+
+    // Only 5 bytes are left in the file, the write stops at the first short write
+    TEST_ASSERT_EQUAL(5, writev(fd, wr_iov, 3));
+    TEST_ASSERT_EQUAL(16, ctx.len);
+
+    char buf1[4], buf2[16];
+    const struct iovec rd_iov[] = {
+        { .iov_base = buf1, .iov_len = sizeof(buf1) },
+        { .iov_base = buf2, .iov_len = sizeof(buf2) },
+    };
+    TEST_ASSERT_EQUAL(16, readv(fd, rd_iov, 2));
+    TEST_ASSERT_EQUAL_STRING_LEN("hell", buf1, 4);
+    TEST_ASSERT_EQUAL_STRING_LEN("o worldhello", buf2, 12);
+    TEST_ASSERT_EQUAL(0, readv(fd, rd_iov, 2));
+
+    TEST_ASSERT_EQUAL(-1, writev(fd, wr_iov, -1));
+    TEST_ASSERT_EQUAL(EINVAL, errno);
+
+    TEST_ASSERT_NOT_EQUAL(-1, close(fd));
+    TEST_ASSERT_EQUAL(-1, writev(fd, wr_iov, 3));
+    TEST_ASSERT_EQUAL(EBADF, errno);
+    TEST_ESP_OK( esp_vfs_unregister(VFS_PREF1) );
+}
+
+TEST_CASE("readv/writev call the driver once per buffer or use its vectored callbacks", "[vfs]")
+{
+    esp_vfs_t desc = {
+        .flags = ESP_VFS_FLAG_CONTEXT_PTR,
+        .open_p = iov_test_vfs_open,
+        .close_p = iov_test_vfs_close,
+        .write_p = iov_test_vfs_write,
+        .read_p = iov_test_vfs_read,
+    };
+    // Fallback: one write per non-empty buffer
+    test_vfs_iov(&desc, 2, 0);
+
+    // Vectored callback: writev is a single driver call
+    desc.writev_p = iov_test_vfs_writev;
+    test_vfs_iov(&desc, 0, 1);
+}
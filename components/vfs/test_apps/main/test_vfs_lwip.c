@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2021-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -8,6 +8,8 @@
 #include <sys/fcntl.h>
 #include <sys/param.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <netdb.h>
 #include "unity.h"
 #include "test_utils.h"
 
@@ -27,3 +29,52 @@ TEST_CASE("fstat() sets st_mode to socket type", "[vfs][lwip]")
 
     close(socket_fd);
 }
+
+TEST_CASE("readv() and writev() on a socket transfer single datagrams", "[vfs][lwip]")
+{
+    test_case_uses_tcpip();
+    const struct addrinfo hints = {
+        .ai_family = AF_INET,
+        .ai_socktype = SOCK_DGRAM,
+    };
+    struct addrinfo *res;
+    TEST_ASSERT_EQUAL(0, getaddrinfo("localhost", "8083", &hints, &res));
+    TEST_ASSERT_NOT_NULL(res);
+
+    // UDP socket connected to itself
+    const int fd = socket(res->ai_family, res->ai_socktype, 0);
+    TEST_ASSERT_GREATER_OR_EQUAL(0, fd);
+    struct sockaddr_in saddr = {
+        .sin_family = PF_INET,
+        .sin_port = htons(8083),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    TEST_ASSERT_EQUAL(0, bind(fd, (struct sockaddr *) &saddr, sizeof(saddr)));
+    TEST_ASSERT_EQUAL(0, connect(fd, res->ai_addr, res->ai_addrlen));
+    freeaddrinfo(res);
+
+    // The buffers are sent in one datagram, which a single read receives
+    const struct iovec wr_iov[] = {
+        { .iov_base = (void *) "Hello", .iov_len = 5 },
+        { .iov_base = (void *) ", ", .iov_len = 2 },
+        { .iov_base = (void *) "world!", .iov_len = 6 },
+    };
+    TEST_ASSERT_EQUAL(13, writev(fd, wr_iov, 3));
+    char buf[32] = { 0 };
+    TEST_ASSERT_EQUAL(13, read(fd, buf, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("Hello, world!", buf);
+
+    // A datagram is scattered into the buffers
+    TEST_ASSERT_EQUAL(13, writev(fd, wr_iov, 3));
+    char buf1[8] = { 0 };
+    char buf2[16] = { 0 };
+    const struct iovec rd_iov[] = {
+        { .iov_base = buf1, .iov_len = 7 },
+        { .iov_base = buf2, .iov_len = 15 },
+    };
+    TEST_ASSERT_EQUAL(13, readv(fd, rd_iov, 2));
+    TEST_ASSERT_EQUAL_STRING("Hello, ", buf1);
+    TEST_ASSERT_EQUAL_STRING("world!", buf2);
+
+    TEST_ASSERT_EQUAL(0, close(fd));
+}
@@ -1,9 +1,10 @@
 /*
- * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include "sdkconfig.h"
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -11,9 +12,11 @@
 #include <errno.h>
 #include <sys/fcntl.h>
 #include <sys/dirent.h>
+#include <sys/stat.h>
 #include "esp_vfs.h"
 #include "unity.h"
 #include "esp_log.h"
+#include "ccomp_timer.h"
 
 /* Dummy VFS implementation to check if VFS is called or not with expected path
  */
@@ -273,3 +276,35 @@ TEST_CASE("vfs checks mount point path", "[vfs]")
     test_register_ok("/23456789012345");
     test_register_fail("/234567890123456");
 }
+
+TEST_CASE("vfs path lookup time with many mount points", "[vfs]")
+{
+    const int iter_count = 1000;
+    dummy_vfs_t inst[CONFIG_VFS_MAX_COUNT] = { 0 };
+    esp_vfs_t desc = DUMMY_VFS();
+    char prefix[CONFIG_VFS_MAX_COUNT][ESP_VFS_PATH_MAX];
+    char path[ESP_VFS_PATH_MAX + 16];
+    int count;
+    // Some VFSs may already be registered, use all the remaining ones
+    for (count = 0; count < CONFIG_VFS_MAX_COUNT; ++count) {
+        snprintf(prefix[count], sizeof(prefix[count]), "/mnt%d", count);
+        inst[count].match_path = "/file";
+        if (esp_vfs_register(prefix[count], &desc, &inst[count]) != ESP_OK) {
+            break;
+        }
+        // Look up the path of the last registered VFS, the worst case when all the prefixes are compared
+        snprintf(path, sizeof(path), "%s/file", prefix[count]);
+        test_opened(&inst[count], path);
+        struct stat st;
+        ccomp_timer_start();
+        for (int i = 0; i < iter_count; ++i) {
+            stat(path, &st);
+        }
+        const int64_t time_diff_us = ccomp_timer_stop();
+        printf("%d mount points: %d ns per stat()\n", count + 1, (int) (time_diff_us * 1000 / iter_count));
+    }
+    TEST_ASSERT_GREATER_THAN(0, count);
+    for (int i = 0; i < count; ++i) {
+        TEST_ESP_OK( esp_vfs_unregister(prefix[i]) );
+    }
+}
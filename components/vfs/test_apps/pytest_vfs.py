@@ -1,4 +1,4 @@
-# SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+# SPDX-FileCopyrightText: 2023-2024 Espressif Systems (Shanghai) CO LTD
 # SPDX-License-Identifier: CC0-1.0
 import pytest
 from pytest_embedded import Dut
@@ -9,7 +9,7 @@ from pytest_embedded import Dut
 @pytest.mark.esp32c6
 @pytest.mark.esp32h2
 @pytest.mark.parametrize('config', [
-    'default', 'iram',
+    'default', 'iram', 'trie', 'epoll',
 ], indirect=True)
 def test_vfs_default(dut: Dut) -> None:
     dut.run_all_single_board_cases()
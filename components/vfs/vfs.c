@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -14,6 +14,7 @@
 #include <sys/unistd.h>
 #include <sys/lock.h>
 #include <sys/param.h>
+#include <stdatomic.h>
 #include <dirent.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
@@ -75,6 +76,105 @@ static size_t s_vfs_count = 0;
 static fd_table_t s_fd_table[MAX_FDS] = { [0 ... MAX_FDS-1] = FD_TABLE_ENTRY_UNUSED };
 static _lock_t s_fd_table_lock;
 
+#ifdef CONFIG_VFS_PATH_PREFIX_TRIE
+/* Path prefixes start with '/' and don't end with '/', so a prefix has at most ESP_VFS_PATH_MAX - 1
+ * components. Node 0 is the root, which stands for the empty prefix and is never a child or a sibling.
+ */
+#define VFS_TRIE_MAX_NODES  (1 + VFS_MAX_COUNT * (ESP_VFS_PATH_MAX - 1))
+#define VFS_TRIE_NO_NODE    0
+
+typedef uint16_t trie_node_index_t;
+_Static_assert(VFS_TRIE_MAX_NODES <= UINT16_MAX, "trie node index type too small");
+
+typedef struct {
+    vfs_index_t vfs_index;      // VFS registered with the prefix ending at this node, or -1
+    vfs_index_t name_vfs;       // the component name is stored in prefixes[name_vfs]...
+    uint8_t name_offset;        // ...at this offset
+    uint8_t name_len;
+    trie_node_index_t child;    // first child, or VFS_TRIE_NO_NODE
+    trie_node_index_t sibling;  // next sibling, or VFS_TRIE_NO_NODE
+} vfs_trie_node_t;
+
+typedef struct {
+    vfs_trie_node_t nodes[VFS_TRIE_MAX_NODES];
+    char prefixes[VFS_MAX_COUNT][ESP_VFS_PATH_MAX];  // copies of the path prefixes, indexed like s_vfs
+} vfs_trie_t;
+
+/* get_vfs_for_path doesn't take any lock. The trie is rebuilt in the copy which is not in use, then this
+ * copy is made active. s_vfs_trie_seq is incremented before each rebuild, a lookup retries if it changed
+ * in the meantime, as the copy it was using may have been overwritten.
+ */
+static vfs_trie_t s_vfs_trie[2] = { [0 ... 1] = { .nodes[0].vfs_index = -1 } };
+static atomic_uint s_vfs_trie_active;
+static atomic_uint s_vfs_trie_seq;
+static _lock_t s_vfs_trie_lock;
+
+static trie_node_index_t vfs_trie_find_child(const vfs_trie_t *trie, trie_node_index_t node, const char *name, size_t name_len)
+{
+    trie_node_index_t child = trie->nodes[node].child;
+    // The bounds checks only matter for a copy being overwritten, which is then read again anyway
+    for (size_t i = 0; child != VFS_TRIE_NO_NODE && child < VFS_TRIE_MAX_NODES && i < VFS_TRIE_MAX_NODES; ++i) {
+        const vfs_trie_node_t *n = &trie->nodes[child];
+        if (n->name_len == name_len && n->name_vfs >= 0 && n->name_vfs < VFS_MAX_COUNT &&
+                n->name_offset + name_len <= ESP_VFS_PATH_MAX &&
+                memcmp(&trie->prefixes[n->name_vfs][n->name_offset], name, name_len) == 0) {
+            return child;
+        }
+        child = n->sibling;
+    }
+    return VFS_TRIE_NO_NODE;
+}
+
+static void vfs_trie_rebuild(void)
+{
+    _lock_acquire(&s_vfs_trie_lock);
+    atomic_fetch_add(&s_vfs_trie_seq, 1);
+    const unsigned new_active = 1 - atomic_load(&s_vfs_trie_active);
+    vfs_trie_t *trie = &s_vfs_trie[new_active];
+    trie->nodes[0] = (vfs_trie_node_t) { .vfs_index = -1, .child = VFS_TRIE_NO_NODE };
+    size_t node_count = 1;
+    for (size_t i = 0; i < s_vfs_count; ++i) {
+        const vfs_entry_t *vfs = s_vfs[i];
+        if (!vfs || vfs->path_prefix_len == LEN_PATH_PREFIX_IGNORED) {
+            continue;
+        }
+        const size_t len = vfs->path_prefix_len;
+        memcpy(trie->prefixes[i], vfs->path_prefix, len);
+        trie_node_index_t node = 0;
+        for (size_t pos = 0; pos < len; ) {
+            // pos is at the '/' in front of the component
+            const size_t start = pos + 1;
+            size_t end = start;
+            while (end < len && trie->prefixes[i][end] != '/') {
+                ++end;
+            }
+            trie_node_index_t child = vfs_trie_find_child(trie, node, &trie->prefixes[i][start], end - start);
+            if (child == VFS_TRIE_NO_NODE) {
+                assert(node_count < VFS_TRIE_MAX_NODES);
+                child = node_count++;
+                trie->nodes[child] = (vfs_trie_node_t) {
+                    .vfs_index = -1,
+                    .name_vfs = i,
+                    .name_offset = start,
+                    .name_len = end - start,
+                    .child = VFS_TRIE_NO_NODE,
+                    .sibling = trie->nodes[node].child,
+                };
+                trie->nodes[node].child = child;
+            }
+            node = child;
+            pos = end;
+        }
+        // If the same prefix is registered several times, the VFS with the lowest index is used
+        if (trie->nodes[node].vfs_index == -1) {
+            trie->nodes[node].vfs_index = i;
+        }
+    }
+    atomic_store(&s_vfs_trie_active, new_active);
+    _lock_release(&s_vfs_trie_lock);
+}
+#endif // CONFIG_VFS_PATH_PREFIX_TRIE
+
 esp_err_t esp_vfs_register_common(const char* base_path, size_t len, const esp_vfs_t* vfs, void* ctx, int *vfs_index)
 {
     if (len != LEN_PATH_PREFIX_IGNORED) {
@@ -119,6 +219,11 @@ esp_err_t esp_vfs_register_common(const char* base_path, size_t len, const esp_v
         *vfs_index = index;
     }
 
+#ifdef CONFIG_VFS_PATH_PREFIX_TRIE
+    if (len != LEN_PATH_PREFIX_IGNORED) {
+        vfs_trie_rebuild();
+    }
+#endif
     return ESP_OK;
 }
 
@@ -180,8 +285,16 @@ esp_err_t esp_vfs_unregister_with_id(esp_vfs_id_t vfs_id)
         return ESP_ERR_INVALID_ARG;
     }
     vfs_entry_t* vfs = s_vfs[vfs_id];
+#ifdef CONFIG_VFS_PATH_PREFIX_TRIE
+    const bool has_path_prefix = (vfs->path_prefix_len != LEN_PATH_PREFIX_IGNORED);
+#endif
     free(vfs);
     s_vfs[vfs_id] = NULL;
+#ifdef CONFIG_VFS_PATH_PREFIX_TRIE
+    if (has_path_prefix) {
+        vfs_trie_rebuild();
+    }
+#endif
 
     _lock_acquire(&s_fd_table_lock);
     // Delete all references from the FD lookup-table
@@ -328,6 +441,13 @@ static inline int get_local_fd(const vfs_entry_t *vfs, int fd)
     return local_fd;
 }
 
+const vfs_entry_t *get_vfs_for_global_fd(int fd, int *local_fd)
+{
+    const vfs_entry_t *vfs = get_vfs_for_fd(fd);
+    *local_fd = get_local_fd(vfs, fd);
+    return (*local_fd < 0) ? NULL : vfs;
+}
+
 static const char* translate_path(const vfs_entry_t* vfs, const char* src_path)
 {
     assert(strncmp(src_path, vfs->path_prefix, vfs->path_prefix_len) == 0);
@@ -338,6 +458,38 @@ static const char* translate_path(const vfs_entry_t* vfs, const char* src_path)
     return src_path + vfs->path_prefix_len;
 }
 
+#ifdef CONFIG_VFS_PATH_PREFIX_TRIE
+const vfs_entry_t* get_vfs_for_path(const char* path)
+{
+    const vfs_entry_t* best_match;
+    unsigned seq;
+    do {
+        seq = atomic_load(&s_vfs_trie_seq);
+        const vfs_trie_t *trie = &s_vfs_trie[atomic_load(&s_vfs_trie_active)];
+        // The root holds the default VFS, if one is registered with an empty prefix
+        vfs_index_t best_match_index = trie->nodes[0].vfs_index;
+        trie_node_index_t node = 0;
+        // Walk down the trie one path component at a time and select the deepest matching prefix;
+        // i.e. if "/dev" and "/dev/uart" both match, for "/dev/uart/1" path, choose "/dev/uart"
+        const char *p = path;
+        while (*p == '/') {
+            const char *name = p + 1;
+            const size_t name_len = strcspn(name, "/");
+            node = vfs_trie_find_child(trie, node, name, name_len);
+            if (node == VFS_TRIE_NO_NODE) {
+                break;
+            }
+            if (trie->nodes[node].vfs_index != -1) {
+                best_match_index = trie->nodes[node].vfs_index;
+            }
+            p = name + name_len;
+        }
+        best_match = (best_match_index >= 0 && best_match_index < VFS_MAX_COUNT) ? s_vfs[best_match_index] : NULL;
+        atomic_thread_fence(memory_order_acquire);
+    } while (atomic_load(&s_vfs_trie_seq) != seq);
+    return best_match;
+}
+#else
 const vfs_entry_t* get_vfs_for_path(const char* path)
 {
     const vfs_entry_t* best_match = NULL;
@@ -368,8 +520,7 @@ const vfs_entry_t* get_vfs_for_path(const char* path)
         // i.e. if "/dev" and "/dev/uart" both match, for "/dev/uart/1" path,
         // choose "/dev/uart",
         // This causes all s_vfs_count VFS entries to be scanned when opening
-        // a file by name. This can be optimized by introducing a table for
-        // FS search order, sorted so that longer prefixes are checked first.
+        // a file by name, see CONFIG_VFS_PATH_PREFIX_TRIE for the alternative.
         if (best_match_prefix_len < (ssize_t) vfs->path_prefix_len) {
             best_match_prefix_len = (ssize_t) vfs->path_prefix_len;
             best_match = vfs;
@@ -377,6 +528,7 @@ const vfs_entry_t* get_vfs_for_path(const char* path)
     }
     return best_match;
 }
+#endif // CONFIG_VFS_PATH_PREFIX_TRIE
 
 /*
  * Using huge multi-line macros is never nice, but in this case
@@ -537,6 +689,94 @@ ssize_t esp_vfs_pwrite(int fd, const void *src, size_t size, off_t offset)
     return ret;
 }
 
+/* Checks the iovec array and returns the total length of the buffers, or -1 with errno set */
+static ssize_t get_iov_len(struct _reent *r, const struct iovec *iov, int iovcnt)
+{
+    if (iovcnt < 0 || (iov == NULL && iovcnt > 0)) {
+        __errno_r(r) = EINVAL;
+        return -1;
+    }
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        total += iov[i].iov_len;
+        if (total < iov[i].iov_len || (ssize_t) total < 0) {
+            __errno_r(r) = EINVAL;
+            return -1;
+        }
+    }
+    return total;
+}
+
+ssize_t esp_vfs_readv(int fd, const struct iovec *iov, int iovcnt)
+{
+    struct _reent *r = __getreent();
+    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
+    const int local_fd = get_local_fd(vfs, fd);
+    if (vfs == NULL || local_fd < 0) {
+        __errno_r(r) = EBADF;
+        return -1;
+    }
+    if (get_iov_len(r, iov, iovcnt) < 0) {
+        return -1;
+    }
+    ssize_t ret;
+    if (vfs->vfs.readv != NULL) {
+        CHECK_AND_CALL(ret, r, vfs, readv, local_fd, iov, iovcnt);
+        return ret;
+    }
+    // Fall back to one read per buffer, stop at the first short read as the following data is not available yet
+    ssize_t total = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        if (iov[i].iov_len == 0) {
+            continue;
+        }
+        CHECK_AND_CALL(ret, r, vfs, read, local_fd, iov[i].iov_base, iov[i].iov_len);
+        if (ret < 0) {
+            return (total > 0) ? total : -1;
+        }
+        total += ret;
+        if ((size_t) ret < iov[i].iov_len) {
+            break;
+        }
+    }
+    return total;
+}
+
+ssize_t esp_vfs_writev(int fd, const struct iovec *iov, int iovcnt)
+{
+    struct _reent *r = __getreent();
+    const vfs_entry_t* vfs = get_vfs_for_fd(fd);
+    const int local_fd = get_local_fd(vfs, fd);
+    if (vfs == NULL || local_fd < 0) {
+        __errno_r(r) = EBADF;
+        return -1;
+    }
+    if (get_iov_len(r, iov, iovcnt) < 0) {
+        return -1;
+    }
+    ssize_t ret;
+    if (vfs->vfs.writev != NULL) {
+        CHECK_AND_CALL(ret, r, vfs, writev, local_fd, iov, iovcnt);
+        return ret;
+    }
+    // Fall back to one write per buffer, stop at the first short write as the following data would leave a gap
+    ssize_t total = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        if (iov[i].iov_len == 0) {
+            continue;
+        }
+        CHECK_AND_CALL(ret, r, vfs, write, local_fd, iov[i].iov_base, iov[i].iov_len);
+        if (ret < 0) {
+            return (total > 0) ? total : -1;
+        }
+        total += ret;
+        if ((size_t) ret < iov[i].iov_len) {
+            break;
+        }
+    }
+    return total;
+}
+
 int esp_vfs_close(struct _reent *r, int fd)
 {
     const vfs_entry_t* vfs = get_vfs_for_fd(fd);
@@ -545,6 +785,10 @@ int esp_vfs_close(struct _reent *r, int fd)
         __errno_r(r) = EBADF;
         return -1;
     }
+#ifdef CONFIG_VFS_SUPPORT_EPOLL
+    // as on Linux, a closed file descriptor leaves the epoll sets
+    esp_vfs_epoll_fd_closed(fd);
+#endif
     int ret;
     CHECK_AND_CALL(ret, r, vfs, close, local_fd);
 
@@ -1325,6 +1569,10 @@ ssize_t pread(int fd, void *dst, size_t size, off_t offset)
     __attribute__((alias("esp_vfs_pread")));
 ssize_t pwrite(int fd, const void *src, size_t size, off_t offset)
     __attribute__((alias("esp_vfs_pwrite")));
+ssize_t readv(int fd, const struct iovec *iov, int iovcnt)
+    __attribute__((alias("esp_vfs_readv")));
+int writev(int fd, const struct iovec *iov, int iovcnt)
+    __attribute__((alias("esp_vfs_writev")));
 off_t _lseek_r(struct _reent *r, int fd, off_t size, int mode)
     __attribute__((alias("esp_vfs_lseek")));
 int _fcntl_r(struct _reent *r, int fd, int cmd, int arg)
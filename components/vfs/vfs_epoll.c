@@ -0,0 +1,750 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "esp_vfs_epoll.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/lock.h>
+#include <sys/param.h>
+#include <sys/select.h>
+
+#include "esp_err.h"
+#include "esp_vfs.h"
+#include "esp_vfs_private.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "spinlock.h"
+
+#define FD_INVALID -1
+#define FD_PENDING_SELECT -2
+
+/*
+ * About the ready list
+ *
+ * Each file descriptor added to an epoll set gets a vfs_epoll_watch structure.
+ * If the VFS driver of the file descriptor implements start_poll, the driver
+ * reports its readiness with esp_vfs_epoll_ready, and the watch is kept in the
+ * ready list of the set while any of the requested events is ready. Waiting
+ * then only walks the ready list.
+ *
+ * The other file descriptors are kept in the fd_sets of the set, which are
+ * passed to esp_vfs_select on each wait, together with the epoll set itself so
+ * that a readiness change reported by a driver ends the select.
+ */
+struct vfs_epoll_watch {
+    struct vfs_epoll_set_t      *set;
+    int                         fd;             // global fd
+    int                         local_fd;
+    const vfs_entry_t           *poll_vfs;      // VFS reporting the readiness, NULL if fd is checked with select
+    esp_vfs_epoll_event_t       event;          // requested events and user data
+    uint32_t                    ready;          // events reported by the driver
+    bool                        in_ready_list;
+    struct vfs_epoll_watch      *ready_prev;
+    struct vfs_epoll_watch      *ready_next;
+};
+
+typedef struct epoll_select_args_t {
+    int                         fd;
+    fd_set                      *read_fds;
+    fd_set                      *error_fds;
+    esp_vfs_select_sem_t        signal_sem;
+    // linked list node in vfs_epoll_set_t::select_args
+    struct epoll_select_args_t  *prev_in_fd;
+    struct epoll_select_args_t  *next_in_fd;
+    // linked list node in end_select_args
+    struct epoll_select_args_t  *next_in_args;
+} epoll_select_args_t;
+
+typedef struct vfs_epoll_set_t {
+    int                         fd;
+    _lock_t                     lock;           // guards the set except for the fields below, which are guarded by spin_lock
+    SemaphoreHandle_t           ready_sem;      // given when a watch enters the ready list
+    struct vfs_epoll_watch      *watches[MAX_FDS];
+    // file descriptors checked with select
+    int                         select_count;
+    int                         select_nfds;
+    fd_set                      select_readfds;
+    fd_set                      select_writefds;
+    fd_set                      select_errorfds;
+    // accessed by the drivers, possibly from ISR
+    portMUX_TYPE                spin_lock;
+    struct vfs_epoll_watch      *ready_head;
+    struct vfs_epoll_watch      *ready_tail;
+    int                         ready_count;
+    // a double-linked list for all pending select args with this fd
+    epoll_select_args_t         *select_args;
+} vfs_epoll_set_t;
+
+static esp_vfs_id_t s_epoll_vfs_id = -1;
+
+static size_t s_set_size;
+static vfs_epoll_set_t *s_sets;
+
+static inline bool watch_is_ready(const struct vfs_epoll_watch *watch)
+{
+    // Errors are always reported, even if not requested
+    return (watch->ready & (watch->event.events | POLLERR)) != 0;
+}
+
+static void ready_list_append(vfs_epoll_set_t *set, struct vfs_epoll_watch *watch)
+{
+    watch->ready_prev = set->ready_tail;
+    watch->ready_next = NULL;
+    if (set->ready_tail) {
+        set->ready_tail->ready_next = watch;
+    } else {
+        set->ready_head = watch;
+    }
+    set->ready_tail = watch;
+    watch->in_ready_list = true;
+    set->ready_count++;
+}
+
+static void ready_list_remove(vfs_epoll_set_t *set, struct vfs_epoll_watch *watch)
+{
+    if (watch->ready_prev) {
+        watch->ready_prev->ready_next = watch->ready_next;
+    } else {
+        set->ready_head = watch->ready_next;
+    }
+    if (watch->ready_next) {
+        watch->ready_next->ready_prev = watch->ready_prev;
+    } else {
+        set->ready_tail = watch->ready_prev;
+    }
+    watch->in_ready_list = false;
+    set->ready_count--;
+}
+
+/* Puts the watch in or out of the ready list, returns true if it entered it. Called with spin_lock held. */
+static bool update_ready_list(vfs_epoll_set_t *set, struct vfs_epoll_watch *watch)
+{
+    const bool ready = watch_is_ready(watch);
+    if (ready && !watch->in_ready_list) {
+        ready_list_append(set, watch);
+        return true;
+    }
+    if (!ready && watch->in_ready_list) {
+        ready_list_remove(set, watch);
+    }
+    return false;
+}
+
+static void trigger_select_for_set(vfs_epoll_set_t *set)
+{
+    epoll_select_args_t *select_args = set->select_args;
+    while (select_args != NULL) {
+        esp_vfs_select_triggered(select_args->signal_sem);
+        select_args = select_args->next_in_fd;
+    }
+}
+
+static void trigger_select_for_set_isr(vfs_epoll_set_t *set, BaseType_t *task_woken)
+{
+    epoll_select_args_t *select_args = set->select_args;
+    while (select_args != NULL) {
+        BaseType_t local_woken = pdFALSE;
+        esp_vfs_select_triggered_isr(select_args->signal_sem, &local_woken);
+        *task_woken = (local_woken || *task_woken);
+        select_args = select_args->next_in_fd;
+    }
+}
+
+void esp_vfs_epoll_ready(esp_vfs_epoll_watch_t *watch, uint32_t events)
+{
+    vfs_epoll_set_t *set = watch->set;
+    portENTER_CRITICAL(&set->spin_lock);
+    watch->ready = events;
+    const bool entered = update_ready_list(set, watch);
+    if (entered) {
+        trigger_select_for_set(set);
+    }
+    portEXIT_CRITICAL(&set->spin_lock);
+    if (entered) {
+        xSemaphoreGive(set->ready_sem);
+    }
+}
+
+void esp_vfs_epoll_ready_isr(esp_vfs_epoll_watch_t *watch, uint32_t events, BaseType_t *woken)
+{
+    vfs_epoll_set_t *set = watch->set;
+    BaseType_t task_woken = pdFALSE;
+    portENTER_CRITICAL_ISR(&set->spin_lock);
+    watch->ready = events;
+    const bool entered = update_ready_list(set, watch);
+    if (entered) {
+        trigger_select_for_set_isr(set, &task_woken);
+    }
+    portEXIT_CRITICAL_ISR(&set->spin_lock);
+    if (entered) {
+        BaseType_t local_woken = pdFALSE;
+        xSemaphoreGiveFromISR(set->ready_sem, &local_woken);
+        task_woken = (local_woken || task_woken);
+    }
+    if (woken) {
+        *woken = (task_woken || *woken);
+    }
+}
+
+static void select_fds_add(vfs_epoll_set_t *set, const struct vfs_epoll_watch *watch)
+{
+    if (watch->event.events & POLLIN) {
+        FD_SET(watch->fd, &set->select_readfds);
+    }
+    if (watch->event.events & POLLOUT) {
+        FD_SET(watch->fd, &set->select_writefds);
+    }
+    FD_SET(watch->fd, &set->select_errorfds);
+    set->select_nfds = MAX(set->select_nfds, watch->fd + 1);
+}
+
+static void select_fds_remove(vfs_epoll_set_t *set, const struct vfs_epoll_watch *watch)
+{
+    FD_CLR(watch->fd, &set->select_readfds);
+    FD_CLR(watch->fd, &set->select_writefds);
+    FD_CLR(watch->fd, &set->select_errorfds);
+    // every fd checked with select is in select_errorfds
+    while (set->select_nfds > 0 && !FD_ISSET(set->select_nfds - 1, &set->select_errorfds)) {
+        set->select_nfds--;
+    }
+}
+
+static int add_watch(vfs_epoll_set_t *set, int fd, const esp_vfs_epoll_event_t *event)
+{
+    int local_fd;
+    const vfs_entry_t *vfs = get_vfs_for_global_fd(fd, &local_fd);
+    if (vfs == NULL) {
+        errno = EBADF;
+        return -1;
+    }
+    if (!vfs->vfs.start_poll && !vfs->vfs.start_select && !vfs->vfs.socket_select) {
+        // The readiness of fd can't be known, e.g. a regular file
+        errno = EPERM;
+        return -1;
+    }
+    struct vfs_epoll_watch *watch = (struct vfs_epoll_watch *)calloc(1, sizeof(struct vfs_epoll_watch));
+    if (watch == NULL) {
+        errno = ENOMEM;
+        return -1;
+    }
+    watch->set = set;
+    watch->fd = fd;
+    watch->local_fd = local_fd;
+    watch->event = *event;
+    set->watches[fd] = watch;
+
+    if (vfs->vfs.start_poll && vfs->vfs.end_poll && vfs->vfs.start_poll(local_fd, watch) == ESP_OK) {
+        watch->poll_vfs = vfs;
+    } else {
+        set->select_count++;
+        select_fds_add(set, watch);
+    }
+    return 0;
+}
+
+static void modify_watch(vfs_epoll_set_t *set, struct vfs_epoll_watch *watch, const esp_vfs_epoll_event_t *event)
+{
+    if (watch->poll_vfs) {
+        portENTER_CRITICAL(&set->spin_lock);
+        watch->event = *event;
+        const bool entered = update_ready_list(set, watch);
+        if (entered) {
+            trigger_select_for_set(set);
+        }
+        portEXIT_CRITICAL(&set->spin_lock);
+        if (entered) {
+            xSemaphoreGive(set->ready_sem);
+        }
+    } else {
+        select_fds_remove(set, watch);
+        watch->event = *event;
+        select_fds_add(set, watch);
+    }
+}
+
+static void remove_watch(vfs_epoll_set_t *set, struct vfs_epoll_watch *watch)
+{
+    if (watch->poll_vfs) {
+        watch->poll_vfs->vfs.end_poll(watch->local_fd, watch);
+        portENTER_CRITICAL(&set->spin_lock);
+        if (watch->in_ready_list) {
+            ready_list_remove(set, watch);
+        }
+        portEXIT_CRITICAL(&set->spin_lock);
+    } else {
+        set->select_count--;
+        select_fds_remove(set, watch);
+    }
+    set->watches[watch->fd] = NULL;
+    free(watch);
+}
+
+/* Reports the watches of the ready list, which are then moved to its end. Called with lock held. */
+static int collect_ready_list(vfs_epoll_set_t *set, esp_vfs_epoll_event_t *events, int maxevents)
+{
+    int n = 0;
+    portENTER_CRITICAL(&set->spin_lock);
+    const int count = MIN(set->ready_count, maxevents);
+    for (; n < count; ++n) {
+        struct vfs_epoll_watch *watch = set->ready_head;
+        events[n].events = watch->ready & (watch->event.events | POLLERR);
+        events[n].data = watch->event.data;
+        ready_list_remove(set, watch);
+        ready_list_append(set, watch);
+    }
+    portEXIT_CRITICAL(&set->spin_lock);
+    return n;
+}
+
+/* Reports the file descriptors found ready by select. Called with lock held. */
+static int collect_selected(vfs_epoll_set_t *set, int nfds, const fd_set *readfds, const fd_set *writefds,
+                            const fd_set *errorfds, esp_vfs_epoll_event_t *events, int maxevents)
+{
+    int n = 0;
+    for (int fd = 0; fd < nfds && n < maxevents; ++fd) {
+        const struct vfs_epoll_watch *watch = set->watches[fd];
+        if (watch == NULL || watch->poll_vfs != NULL) {
+            // removed in the meantime, or the epoll set itself
+            continue;
+        }
+        uint32_t ready = 0;
+        if (FD_ISSET(fd, readfds)) {
+            ready |= POLLIN;
+        }
+        if (FD_ISSET(fd, writefds)) {
+            ready |= POLLOUT;
+        }
+        if (FD_ISSET(fd, errorfds)) {
+            ready |= POLLERR;
+        }
+        ready &= watch->event.events | POLLERR;
+        if (ready) {
+            events[n].events = ready;
+            events[n].data = watch->event.data;
+            n++;
+        }
+    }
+    return n;
+}
+
+static vfs_epoll_set_t *get_set_for_fd(int epfd, int *local_fd)
+{
+    const vfs_entry_t *vfs = get_vfs_for_global_fd(epfd, local_fd);
+    if (vfs == NULL || s_epoll_vfs_id == -1 || vfs->offset != s_epoll_vfs_id || *local_fd >= s_set_size) {
+        errno = EBADF;
+        return NULL;
+    }
+    return &s_sets[*local_fd];
+}
+
+static esp_err_t epoll_end_select(void *end_select_args);
+
+static esp_err_t epoll_start_select(int                  nfds,
+                                    fd_set              *readfds,
+                                    fd_set              *writefds,
+                                    fd_set              *exceptfds,
+                                    esp_vfs_select_sem_t signal_sem,
+                                    void               **end_select_args)
+{
+    bool should_trigger = false;
+    nfds = nfds < s_set_size ? nfds : (int)s_set_size;
+    epoll_select_args_t *select_args_list = NULL;
+
+    for (int i = 0; i < nfds; i++) {
+        vfs_epoll_set_t *set = &s_sets[i];
+        _lock_acquire(&set->lock);
+        if (set->fd == i) {
+            epoll_select_args_t *select_args = (epoll_select_args_t *)malloc(sizeof(epoll_select_args_t));
+            if (select_args == NULL) {
+                _lock_release(&set->lock);
+                epoll_end_select(select_args_list);
+                return ESP_ERR_NO_MEM;
+            }
+            select_args->fd = i;
+            select_args->signal_sem = signal_sem;
+            select_args->error_fds = FD_ISSET(i, exceptfds) ? exceptfds : NULL;
+            FD_CLR(i, exceptfds);
+            // epoll sets are never writable
+            FD_CLR(i, writefds);
+
+            portENTER_CRITICAL(&set->spin_lock);
+            if (FD_ISSET(i, readfds)) {
+                select_args->read_fds = readfds;
+                if (set->ready_count > 0) {
+                    should_trigger = true;
+                } else {
+                    FD_CLR(i, readfds);
+                }
+            } else {
+                select_args->read_fds = NULL;
+            }
+            select_args->prev_in_fd = NULL;
+            select_args->next_in_fd = set->select_args;
+            if (set->select_args) {
+                set->select_args->prev_in_fd = select_args;
+            }
+            set->select_args = select_args;
+            portEXIT_CRITICAL(&set->spin_lock);
+
+            select_args->next_in_args = select_args_list;
+            select_args_list = select_args;
+        }
+        _lock_release(&set->lock);
+    }
+
+    *end_select_args = select_args_list;
+
+    if (should_trigger) {
+        esp_vfs_select_triggered(signal_sem);
+    }
+
+    return ESP_OK;
+}
+
+static esp_err_t epoll_end_select(void *end_select_args)
+{
+    epoll_select_args_t *select_args = (epoll_select_args_t *)end_select_args;
+
+    while (select_args != NULL) {
+        vfs_epoll_set_t *set = &s_sets[select_args->fd];
+
+        _lock_acquire(&set->lock);
+        portENTER_CRITICAL(&set->spin_lock);
+
+        if (set->fd != select_args->fd) { // already closed
+            if (select_args->error_fds) {
+                FD_SET(select_args->fd, select_args->error_fds);
+            }
+        } else {
+            if (select_args->read_fds && set->ready_count > 0) {
+                FD_SET(select_args->fd, select_args->read_fds);
+            }
+        }
+
+        epoll_select_args_t *prev_in_fd = select_args->prev_in_fd;
+        epoll_select_args_t *next_in_fd = select_args->next_in_fd;
+        epoll_select_args_t *next_in_args = select_args->next_in_args;
+        if (prev_in_fd != NULL) {
+            prev_in_fd->next_in_fd = next_in_fd;
+        } else {
+            set->select_args = next_in_fd;
+        }
+        if (next_in_fd != NULL) {
+            next_in_fd->prev_in_fd = prev_in_fd;
+        }
+        if (prev_in_fd == NULL && next_in_fd == NULL) { // The last pending select
+            if (set->fd == FD_PENDING_SELECT) {
+                set->fd = FD_INVALID;
+            }
+        }
+
+        portEXIT_CRITICAL(&set->spin_lock);
+        _lock_release(&set->lock);
+
+        free(select_args);
+        select_args = next_in_args;
+    }
+
+    return ESP_OK;
+}
+
+static int epoll_close(int fd)
+{
+    if (fd >= s_set_size) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    vfs_epoll_set_t *set = &s_sets[fd];
+    _lock_acquire(&set->lock);
+    if (set->fd != fd) {
+        _lock_release(&set->lock);
+        errno = EBADF;
+        return -1;
+    }
+    for (int i = 0; i < MAX_FDS; i++) {
+        if (set->watches[i]) {
+            remove_watch(set, set->watches[i]);
+        }
+    }
+    portENTER_CRITICAL(&set->spin_lock);
+    if (set->select_args == NULL) {
+        set->fd = FD_INVALID;
+    } else {
+        set->fd = FD_PENDING_SELECT;
+        trigger_select_for_set(set);
+    }
+    portEXIT_CRITICAL(&set->spin_lock);
+    // esp_vfs_epoll_wait in progress returns with EBADF
+    xSemaphoreGive(set->ready_sem);
+    _lock_release(&set->lock);
+    return 0;
+}
+
+static void free_sets(void)
+{
+    for (size_t i = 0; i < s_set_size; i++) {
+        _lock_close(&s_sets[i].lock);
+        if (s_sets[i].ready_sem) {
+            vSemaphoreDelete(s_sets[i].ready_sem);
+        }
+    }
+    free(s_sets);
+    s_sets = NULL;
+    s_set_size = 0;
+}
+
+void esp_vfs_epoll_fd_closed(int fd)
+{
+    if (s_epoll_vfs_id == -1 || fd < 0 || fd >= MAX_FDS) {
+        return;
+    }
+    for (size_t i = 0; i < s_set_size; i++) {
+        vfs_epoll_set_t *set = &s_sets[i];
+        if (set->watches[fd] == NULL) {
+            // checked again below, the set only needs to be locked if it watches fd
+            continue;
+        }
+        _lock_acquire(&set->lock);
+        if (set->watches[fd] != NULL) {
+            remove_watch(set, set->watches[fd]);
+        }
+        _lock_release(&set->lock);
+    }
+}
+
+esp_err_t esp_vfs_epoll_register(const esp_vfs_epoll_config_t *config)
+{
+    if (config == NULL || config->max_fds == 0 || config->max_fds >= MAX_FDS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_epoll_vfs_id != -1) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_sets = (vfs_epoll_set_t *)calloc(config->max_fds, sizeof(vfs_epoll_set_t));
+    if (s_sets == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_set_size = config->max_fds;
+    for (size_t i = 0; i < s_set_size; i++) {
+        _lock_init(&s_sets[i].lock);
+        portMUX_INITIALIZE(&s_sets[i].spin_lock);
+        s_sets[i].fd = FD_INVALID;
+        s_sets[i].ready_sem = xSemaphoreCreateBinary();
+        if (s_sets[i].ready_sem == NULL) {
+            free_sets();
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    esp_vfs_t vfs = {
+        .flags        = ESP_VFS_FLAG_DEFAULT,
+        .close        = &epoll_close,
+        .start_select = &epoll_start_select,
+        .end_select   = &epoll_end_select,
+    };
+    esp_err_t error = esp_vfs_register_with_id(&vfs, NULL, &s_epoll_vfs_id);
+    if (error != ESP_OK) {
+        s_epoll_vfs_id = -1;
+        free_sets();
+    }
+    return error;
+}
+
+esp_err_t esp_vfs_epoll_unregister(void)
+{
+    if (s_epoll_vfs_id == -1) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // The drivers keep pointers to the watches of open sets, and a set stays in use
+    // until the select of a closed set has ended
+    for (size_t i = 0; i < s_set_size; i++) {
+        if (s_sets[i].fd != FD_INVALID) {
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+    esp_err_t error = esp_vfs_unregister_with_id(s_epoll_vfs_id);
+    if (error != ESP_OK) {
+        return error;
+    }
+    s_epoll_vfs_id = -1;
+    free_sets();
+    return ESP_OK;
+}
+
+int esp_vfs_epoll_create(void)
+{
+    int global_fd = FD_INVALID;
+    esp_err_t error = ESP_ERR_NOT_FOUND;
+
+    if (s_epoll_vfs_id == -1) {
+        errno = EACCES;
+        return FD_INVALID;
+    }
+
+    for (size_t i = 0; i < s_set_size; i++) {
+        vfs_epoll_set_t *set = &s_sets[i];
+        _lock_acquire(&set->lock);
+        if (set->fd == FD_INVALID) {
+            error = esp_vfs_register_fd_with_local_fd(s_epoll_vfs_id, i, /*permanent=*/false, &global_fd);
+            if (error == ESP_OK) {
+                set->fd = i;
+                set->select_count = 0;
+                set->select_nfds = 0;
+                FD_ZERO(&set->select_readfds);
+                FD_ZERO(&set->select_writefds);
+                FD_ZERO(&set->select_errorfds);
+                // clear a wakeup left by the previous user of the set
+                xSemaphoreTake(set->ready_sem, 0);
+            }
+            _lock_release(&set->lock);
+            break;
+        }
+        _lock_release(&set->lock);
+    }
+
+    switch (error) {
+    case ESP_OK:
+        return global_fd;
+    case ESP_ERR_NOT_FOUND:
+        errno = ENFILE;
+        break;
+    case ESP_ERR_NO_MEM:
+        errno = ENOMEM;
+        break;
+    case ESP_ERR_INVALID_ARG:
+        errno = EINVAL;
+        break;
+    default:
+        errno = EIO;
+        break;
+    }
+    return FD_INVALID;
+}
+
+int esp_vfs_epoll_ctl(int epfd, int op, int fd, const esp_vfs_epoll_event_t *event)
+{
+    int local_fd;
+    vfs_epoll_set_t *set = get_set_for_fd(epfd, &local_fd);
+    if (set == NULL) {
+        return -1;
+    }
+    if (fd < 0 || fd >= MAX_FDS) {
+        errno = EBADF;
+        return -1;
+    }
+    if (fd == epfd || (op != ESP_VFS_EPOLL_CTL_DEL && event == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int ret = 0;
+    _lock_acquire(&set->lock);
+    struct vfs_epoll_watch *watch = set->watches[fd];
+    if (set->fd != local_fd) {
+        errno = EBADF;
+        ret = -1;
+    } else if (op == ESP_VFS_EPOLL_CTL_ADD) {
+        if (watch != NULL) {
+            errno = EEXIST;
+            ret = -1;
+        } else {
+            ret = add_watch(set, fd, event);
+        }
+    } else if (op == ESP_VFS_EPOLL_CTL_MOD || op == ESP_VFS_EPOLL_CTL_DEL) {
+        if (watch == NULL) {
+            errno = ENOENT;
+            ret = -1;
+        } else if (op == ESP_VFS_EPOLL_CTL_MOD) {
+            modify_watch(set, watch, event);
+        } else {
+            remove_watch(set, watch);
+        }
+    } else {
+        errno = EINVAL;
+        ret = -1;
+    }
+    _lock_release(&set->lock);
+    return ret;
+}
+
+int esp_vfs_epoll_wait(int epfd, esp_vfs_epoll_event_t *events, int maxevents, int timeout_ms)
+{
+    int local_fd;
+    vfs_epoll_set_t *set = get_set_for_fd(epfd, &local_fd);
+    if (set == NULL) {
+        return -1;
+    }
+    if (events == NULL || maxevents <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    const TickType_t start = xTaskGetTickCount();
+    const TickType_t timeout_ticks = (timeout_ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;
+    while (true) {
+        TickType_t ticks_to_wait = portMAX_DELAY;
+        if (timeout_ms >= 0) {
+            const TickType_t elapsed = xTaskGetTickCount() - start;
+            ticks_to_wait = (elapsed < timeout_ticks) ? timeout_ticks - elapsed : 0;
+        }
+
+        _lock_acquire(&set->lock);
+        if (set->fd != local_fd) {
+            _lock_release(&set->lock);
+            errno = EBADF;
+            return -1;
+        }
+        int n = collect_ready_list(set, events, maxevents);
+        const bool use_select = (set->select_count > 0) && (n < maxevents);
+        fd_set readfds = set->select_readfds;
+        fd_set writefds = set->select_writefds;
+        fd_set errorfds = set->select_errorfds;
+        int nfds = set->select_nfds;
+        _lock_release(&set->lock);
+
+        if (!use_select) {
+            if (n > 0 || ticks_to_wait == 0) {
+                return n;
+            }
+            xSemaphoreTake(set->ready_sem, ticks_to_wait);
+            continue;
+        }
+
+        struct timeval tv = { 0 };
+        struct timeval *timeout = &tv;
+        if (n == 0) {
+            // Select the epoll set too, it becomes readable when a watch enters the ready list
+            FD_SET(epfd, &readfds);
+            nfds = MAX(nfds, epfd + 1);
+            if (ticks_to_wait == portMAX_DELAY) {
+                timeout = NULL;
+            } else {
+                const uint32_t wait_ms = ticks_to_wait * portTICK_PERIOD_MS;
+                tv.tv_sec = wait_ms / 1000;
+                tv.tv_usec = (wait_ms % 1000) * 1000;
+            }
+        }
+        const int ret = esp_vfs_select(nfds, &readfds, &writefds, &errorfds, timeout);
+        if (ret < 0) {
+            return (n > 0) ? n : -1;
+        }
+
+        _lock_acquire(&set->lock);
+        n += collect_selected(set, nfds, &readfds, &writefds, &errorfds, events + n, maxevents - n);
+        _lock_release(&set->lock);
+        if (n > 0 || ret == 0 || ticks_to_wait == 0) {
+            return n;
+        }
+        // The epoll set became readable, or the file descriptors found ready were removed in the meantime
+    }
+}
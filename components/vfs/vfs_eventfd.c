@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2021-2023 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2021-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -52,6 +52,17 @@ typedef struct event_select_args_t {
     struct event_select_args_t  *next_in_args;
 } event_select_args_t;
 
+#ifdef CONFIG_VFS_SUPPORT_EPOLL
+/*
+ * Each event_poll_args_t structure records an epoll set watching the file descriptor,
+ * they form a linked list in event_context_t::poll_args.
+ */
+typedef struct event_poll_args_t {
+    esp_vfs_epoll_watch_t       *watch;
+    struct event_poll_args_t    *next;
+} event_poll_args_t;
+#endif
+
 typedef struct {
     int                     fd;
     bool                    support_isr;
@@ -59,6 +70,10 @@ typedef struct {
     volatile uint64_t       value;
     // a double-linked list for all pending select args with this fd
     event_select_args_t     *select_args;
+#ifdef CONFIG_VFS_SUPPORT_EPOLL
+    // a linked list for all epoll sets watching this fd
+    event_poll_args_t       *poll_args;
+#endif
     _lock_t                 lock;
     // only for event fds that support ISR.
     portMUX_TYPE            data_spin_lock;
@@ -89,6 +104,93 @@ static void trigger_select_for_event_isr(event_context_t *event, BaseType_t *tas
     }
 }
 
+#ifdef CONFIG_VFS_SUPPORT_EPOLL
+static inline uint32_t event_poll_events(const event_context_t *event)
+{
+    // event fds are always writable
+    return POLLOUT | (event->is_set ? POLLIN : 0);
+}
+
+static void notify_poll_for_event(event_context_t *event, uint32_t events)
+{
+    event_poll_args_t *poll_args = event->poll_args;
+    while (poll_args != NULL) {
+        esp_vfs_epoll_ready(poll_args->watch, events);
+        poll_args = poll_args->next;
+    }
+}
+
+static void notify_poll_for_event_isr(event_context_t *event, uint32_t events, BaseType_t *task_woken)
+{
+    event_poll_args_t *poll_args = event->poll_args;
+    while (poll_args != NULL) {
+        esp_vfs_epoll_ready_isr(poll_args->watch, events, task_woken);
+        poll_args = poll_args->next;
+    }
+}
+
+static esp_err_t event_start_poll(int fd, esp_vfs_epoll_watch_t *watch)
+{
+    if (fd >= s_event_size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    event_poll_args_t *poll_args = (event_poll_args_t *)malloc(sizeof(event_poll_args_t));
+    if (poll_args == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    poll_args->watch = watch;
+
+    esp_err_t error = ESP_OK;
+    _lock_acquire_recursive(&s_events[fd].lock);
+    if (s_events[fd].support_isr) {
+        portENTER_CRITICAL(&s_events[fd].data_spin_lock);
+    }
+    if (s_events[fd].fd == fd) {
+        poll_args->next = s_events[fd].poll_args;
+        s_events[fd].poll_args = poll_args;
+        esp_vfs_epoll_ready(watch, event_poll_events(&s_events[fd]));
+    } else {
+        error = ESP_ERR_INVALID_STATE;
+    }
+    if (s_events[fd].support_isr) {
+        portEXIT_CRITICAL(&s_events[fd].data_spin_lock);
+    }
+    _lock_release_recursive(&s_events[fd].lock);
+
+    if (error != ESP_OK) {
+        free(poll_args);
+    }
+    return error;
+}
+
+static void event_end_poll(int fd, esp_vfs_epoll_watch_t *watch)
+{
+    if (fd >= s_event_size) {
+        return;
+    }
+    event_poll_args_t *found = NULL;
+    _lock_acquire_recursive(&s_events[fd].lock);
+    if (s_events[fd].support_isr) {
+        portENTER_CRITICAL(&s_events[fd].data_spin_lock);
+    }
+    // the list is empty if the fd was closed in the meantime
+    event_poll_args_t **poll_args = &s_events[fd].poll_args;
+    while (*poll_args != NULL) {
+        if ((*poll_args)->watch == watch) {
+            found = *poll_args;
+            *poll_args = found->next;
+            break;
+        }
+        poll_args = &(*poll_args)->next;
+    }
+    if (s_events[fd].support_isr) {
+        portEXIT_CRITICAL(&s_events[fd].data_spin_lock);
+    }
+    _lock_release_recursive(&s_events[fd].lock);
+    free(found);
+}
+#endif // CONFIG_VFS_SUPPORT_EPOLL
+
 #ifdef CONFIG_VFS_SUPPORT_SELECT
 static esp_err_t event_start_select(int                  nfds,
                                     fd_set              *readfds,
@@ -223,6 +325,11 @@ static ssize_t signal_event_fd_from_isr(int fd, const void *data, size_t size)
     portENTER_CRITICAL_ISR(&s_events[fd].data_spin_lock);
 
     if (s_events[fd].fd == fd) {
+#ifdef CONFIG_VFS_SUPPORT_EPOLL
+        if (!s_events[fd].is_set) {
+            notify_poll_for_event_isr(&s_events[fd], POLLIN | POLLOUT, &task_woken);
+        }
+#endif
         s_events[fd].is_set = true;
         s_events[fd].value += *val;
         trigger_select_for_event_isr(&s_events[fd], &task_woken);
@@ -263,6 +370,11 @@ static ssize_t event_write(int fd, const void *data, size_t size)
         }
 
         if (s_events[fd].fd == fd) {
+#ifdef CONFIG_VFS_SUPPORT_EPOLL
+            if (!s_events[fd].is_set) {
+                notify_poll_for_event(&s_events[fd], POLLIN | POLLOUT);
+            }
+#endif
             s_events[fd].is_set = true;
             s_events[fd].value += *val;
             ret = size;
@@ -297,6 +409,11 @@ static ssize_t event_read(int fd, void *data, size_t size)
     }
 
     if (s_events[fd].fd == fd) {
+#ifdef CONFIG_VFS_SUPPORT_EPOLL
+        if (s_events[fd].is_set) {
+            notify_poll_for_event(&s_events[fd], POLLOUT);
+        }
+#endif
         *val = s_events[fd].value;
         s_events[fd].is_set = false;
         ret = size;
@@ -317,6 +434,9 @@ static ssize_t event_read(int fd, void *data, size_t size)
 static int event_close(int fd)
 {
     int ret = -1;
+#ifdef CONFIG_VFS_SUPPORT_EPOLL
+    event_poll_args_t *poll_args = NULL;
+#endif
 
     if (fd >= s_event_size) {
         errno = EINVAL;
@@ -328,6 +448,12 @@ static int event_close(int fd)
         if (s_events[fd].support_isr) {
             portENTER_CRITICAL(&s_events[fd].data_spin_lock);
         }
+#ifdef CONFIG_VFS_SUPPORT_EPOLL
+        // esp_vfs_close removes the fd from the epoll sets first, this only reaches the sets of a direct call
+        notify_poll_for_event(&s_events[fd], POLLERR);
+        poll_args = s_events[fd].poll_args;
+        s_events[fd].poll_args = NULL;
+#endif
         if (s_events[fd].select_args == NULL) {
             s_events[fd].fd = FD_INVALID;
         } else {
@@ -344,6 +470,13 @@ static int event_close(int fd)
     }
     _lock_release_recursive(&s_events[fd].lock);
 
+#ifdef CONFIG_VFS_SUPPORT_EPOLL
+    while (poll_args != NULL) {
+        event_poll_args_t *next = poll_args->next;
+        free(poll_args);
+        poll_args = next;
+    }
+#endif
     return ret;
 }
 
@@ -371,6 +504,10 @@ esp_err_t esp_vfs_eventfd_register(const esp_vfs_eventfd_config_t *config)
 #ifdef CONFIG_VFS_SUPPORT_SELECT
         .start_select = &event_start_select,
         .end_select   = &event_end_select,
+#endif
+#ifdef CONFIG_VFS_SUPPORT_EPOLL
+        .start_poll   = &event_start_poll,
+        .end_poll     = &event_end_poll,
 #endif
     };
     return esp_vfs_register_with_id(&vfs, NULL, &s_eventfd_vfs_id);
@@ -429,6 +566,9 @@ int eventfd(unsigned int initval, int flags)
             s_events[i].is_set = false;
             s_events[i].value = initval;
             s_events[i].select_args = NULL;
+#ifdef CONFIG_VFS_SUPPORT_EPOLL
+            s_events[i].poll_args = NULL;
+#endif
             if (support_isr) {
                 portEXIT_CRITICAL(&s_events[i].data_spin_lock);
             }
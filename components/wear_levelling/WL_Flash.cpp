@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -523,6 +523,24 @@ size_t WL_Flash::calcAddr(size_t addr)
     return result;
 }
 
+size_t WL_Flash::calcRunSize(size_t addr, size_t size)
+{
+    // Consecutive addresses are mapped to consecutive addresses by calcAddr(), except
+    // where the result wraps around the end of the flash or skips the dummy sector
+    size_t result = (this->flash_size - this->state.wl_dummy_sec_move_count * this->cfg.wl_page_size + addr) % this->flash_size;
+    size_t dummy_addr = this->state.wl_dummy_sec_pos * this->cfg.wl_page_size;
+    size_t run_size;
+    if (result < dummy_addr) {
+        run_size = dummy_addr - result;
+    } else {
+        run_size = this->flash_size - result;
+    }
+    if (run_size > size) {
+        run_size = size;
+    }
+    return run_size;
+}
+
 
 size_t WL_Flash::get_flash_size()
 {
@@ -579,15 +597,15 @@ esp_err_t WL_Flash::write(size_t dest_addr, const void *src, size_t size)
         return ESP_ERR_INVALID_STATE;
     }
     ESP_LOGD(TAG, "%s - dest_addr= 0x%08" PRIx32 ", size= 0x%08" PRIx32 , __func__, (uint32_t) dest_addr, (uint32_t) size);
-    uint32_t count = (size - 1) / this->cfg.wl_page_size;
-    for (size_t i = 0; i < count; i++) {
-        size_t virt_addr = this->calcAddr(dest_addr + i * this->cfg.wl_page_size);
-        result = this->partition->write(this->cfg.wl_partition_start_addr + virt_addr, &((uint8_t *)src)[i * this->cfg.wl_page_size], this->cfg.wl_page_size);
+    // Write each run of pages which are consecutive in the partition at once
+    size_t offset = 0;
+    while (offset < size) {
+        size_t virt_addr = this->calcAddr(dest_addr + offset);
+        size_t run_size = this->calcRunSize(dest_addr + offset, size - offset);
+        result = this->partition->write(this->cfg.wl_partition_start_addr + virt_addr, &((uint8_t *)src)[offset], run_size);
         WL_RESULT_CHECK(result);
+        offset += run_size;
     }
-    size_t virt_addr_last = this->calcAddr(dest_addr + count * this->cfg.wl_page_size);
-    result = this->partition->write(this->cfg.wl_partition_start_addr + virt_addr_last, &((uint8_t *)src)[count * this->cfg.wl_page_size], size - count * this->cfg.wl_page_size);
-    WL_RESULT_CHECK(result);
     return result;
 }
 
@@ -598,16 +616,16 @@ esp_err_t WL_Flash::read(size_t src_addr, void *dest, size_t size)
         return ESP_ERR_INVALID_STATE;
     }
     ESP_LOGD(TAG, "%s - src_addr= 0x%08" PRIx32 ", size= 0x%08" PRIx32 , __func__, (uint32_t) src_addr, (uint32_t) size);
-    uint32_t count = (size - 1) / this->cfg.wl_page_size;
-    for (size_t i = 0; i < count; i++) {
-        size_t virt_addr = this->calcAddr(src_addr + i * this->cfg.wl_page_size);
-        ESP_LOGV(TAG, "%s - real_addr= 0x%08" PRIx32 ", size= 0x%08" PRIx32 , __func__, (uint32_t) (this->cfg.wl_partition_start_addr + virt_addr), (uint32_t) size);
-        result = this->partition->read(this->cfg.wl_partition_start_addr + virt_addr, &((uint8_t *)dest)[i * this->cfg.wl_page_size], this->cfg.wl_page_size);
+    // Read each run of pages which are consecutive in the partition at once
+    size_t offset = 0;
+    while (offset < size) {
+        size_t virt_addr = this->calcAddr(src_addr + offset);
+        size_t run_size = this->calcRunSize(src_addr + offset, size - offset);
+        ESP_LOGV(TAG, "%s - real_addr= 0x%08" PRIx32 ", size= 0x%08" PRIx32 , __func__, (uint32_t) (this->cfg.wl_partition_start_addr + virt_addr), (uint32_t) run_size);
+        result = this->partition->read(this->cfg.wl_partition_start_addr + virt_addr, &((uint8_t *)dest)[offset], run_size);
         WL_RESULT_CHECK(result);
+        offset += run_size;
     }
-    size_t virt_addr_last = this->calcAddr(src_addr + count * this->cfg.wl_page_size);
-    result = this->partition->read(this->cfg.wl_partition_start_addr + virt_addr_last, &((uint8_t *)dest)[count * this->cfg.wl_page_size], size - count * this->cfg.wl_page_size);
-    WL_RESULT_CHECK(result);
     return result;
 }
 
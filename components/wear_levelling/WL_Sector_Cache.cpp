@@ -0,0 +1,233 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "WL_Sector_Cache.h"
+
+static const char *TAG = "wl_sector_cache";
+
+#define WL_CACHE_RESULT_CHECK(result) \
+    if (result != ESP_OK) { \
+        ESP_LOGE(TAG,"%s(%d): result = 0x%08" PRIx32, __FUNCTION__, __LINE__, (uint32_t) result); \
+        return (result); \
+    }
+
+WL_Sector_Cache::WL_Sector_Cache()
+{
+}
+
+WL_Sector_Cache::~WL_Sector_Cache()
+{
+    free(this->entries);
+    free(this->data);
+}
+
+esp_err_t WL_Sector_Cache::config(Flash_Access *flash, size_t sector_count, uint32_t timeout_ms)
+{
+    ESP_LOGV(TAG, "%s sector_count=%" PRIu32 ", timeout_ms=%" PRIu32, __func__, (uint32_t) sector_count, timeout_ms);
+    if (flash == NULL || sector_count == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    this->flash = flash;
+    this->sector_size = flash->get_sector_size();
+    this->sector_count = sector_count;
+    this->timeout_ms = timeout_ms;
+
+    this->entries = (cache_entry_t *)calloc(sector_count, sizeof(cache_entry_t));
+    this->data = (uint8_t *)malloc(sector_count * this->sector_size);
+    if (this->entries == NULL || this->data == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+size_t WL_Sector_Cache::get_flash_size()
+{
+    return this->flash->get_flash_size();
+}
+
+size_t WL_Sector_Cache::get_sector_size()
+{
+    return this->sector_size;
+}
+
+WL_Sector_Cache::cache_entry_t *WL_Sector_Cache::findEntry(size_t sector)
+{
+    for (size_t i = 0; i < this->sector_count; i++) {
+        if (this->entries[i].valid && this->entries[i].sector == sector) {
+            return &this->entries[i];
+        }
+    }
+    return NULL;
+}
+
+uint8_t *WL_Sector_Cache::entryData(cache_entry_t *entry)
+{
+    return &this->data[(entry - this->entries) * this->sector_size];
+}
+
+esp_err_t WL_Sector_Cache::flushEntry(cache_entry_t *entry)
+{
+    ESP_LOGD(TAG, "%s - sector= 0x%08" PRIx32, __func__, (uint32_t) entry->sector);
+    esp_err_t result = this->flash->erase_range(entry->sector * this->sector_size, this->sector_size);
+    WL_CACHE_RESULT_CHECK(result);
+    result = this->flash->write(entry->sector * this->sector_size, this->entryData(entry), this->sector_size);
+    WL_CACHE_RESULT_CHECK(result);
+    entry->valid = false;
+    return result;
+}
+
+esp_err_t WL_Sector_Cache::flushExpired()
+{
+    esp_err_t result = ESP_OK;
+    if (this->timeout_ms == 0) {
+        return result;
+    }
+    uint32_t now = esp_log_timestamp();
+    for (size_t i = 0; i < this->sector_count; i++) {
+        if (this->entries[i].valid && now - this->entries[i].dirty_time >= this->timeout_ms) {
+            result = this->flushEntry(&this->entries[i]);
+            WL_CACHE_RESULT_CHECK(result);
+        }
+    }
+    return result;
+}
+
+esp_err_t WL_Sector_Cache::erase_sector(size_t sector)
+{
+    esp_err_t result = ESP_OK;
+    if ((sector + 1) * this->sector_size > this->get_flash_size()) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    cache_entry_t *entry = this->findEntry(sector);
+    if (entry == NULL) {
+        // Take a free entry, or flush the least recently used one
+        entry = &this->entries[0];
+        for (size_t i = 0; i < this->sector_count && entry->valid; i++) {
+            if (!this->entries[i].valid || this->entries[i].use_count - entry->use_count > UINT32_MAX / 2) {
+                entry = &this->entries[i];
+            }
+        }
+        if (entry->valid) {
+            result = this->flushEntry(entry);
+            WL_CACHE_RESULT_CHECK(result);
+        }
+        entry->sector = sector;
+        entry->dirty_time = esp_log_timestamp();
+        entry->valid = true;
+    }
+    entry->use_count = ++this->use_counter;
+    memset(this->entryData(entry), 0xff, this->sector_size);
+    return result;
+}
+
+esp_err_t WL_Sector_Cache::erase_range(size_t start_address, size_t size)
+{
+    esp_err_t result = this->flushExpired();
+    WL_CACHE_RESULT_CHECK(result);
+    ESP_LOGD(TAG, "%s - start_address= 0x%08" PRIx32 ", size= 0x%08" PRIx32 , __func__, (uint32_t) start_address, (uint32_t) size);
+    size_t erase_count = (size + this->sector_size - 1) / this->sector_size;
+    size_t start_sector = start_address / this->sector_size;
+    if (erase_count > this->sector_count) {
+        // The range would not stay in the cache, erase it directly. The cached sectors in the range are erased too
+        for (size_t i = 0; i < this->sector_count; i++) {
+            if (this->entries[i].valid && this->entries[i].sector >= start_sector && this->entries[i].sector < start_sector + erase_count) {
+                this->entries[i].valid = false;
+            }
+        }
+        return this->flash->erase_range(start_address, size);
+    }
+    for (size_t i = 0; i < erase_count; i++) {
+        result = this->erase_sector(start_sector + i);
+        WL_CACHE_RESULT_CHECK(result);
+    }
+    return result;
+}
+
+esp_err_t WL_Sector_Cache::write(size_t dest_addr, const void *src, size_t size)
+{
+    esp_err_t result = this->flushExpired();
+    WL_CACHE_RESULT_CHECK(result);
+    ESP_LOGD(TAG, "%s - dest_addr= 0x%08" PRIx32 ", size= 0x%08" PRIx32 , __func__, (uint32_t) dest_addr, (uint32_t) size);
+    // Data of the cached sectors is copied to the cache, the other data is written to flash in runs
+    size_t offset = 0;
+    size_t run_offset = 0;
+    while (offset < size) {
+        size_t sector = (dest_addr + offset) / this->sector_size;
+        size_t sector_offset = (dest_addr + offset) % this->sector_size;
+        size_t len = this->sector_size - sector_offset;
+        if (len > size - offset) {
+            len = size - offset;
+        }
+        cache_entry_t *entry = this->findEntry(sector);
+        if (entry != NULL) {
+            if (run_offset < offset) {
+                result = this->flash->write(dest_addr + run_offset, &((const uint8_t *)src)[run_offset], offset - run_offset);
+                WL_CACHE_RESULT_CHECK(result);
+            }
+            // Bits are only cleared, as when writing to flash
+            uint8_t *entry_data = this->entryData(entry) + sector_offset;
+            for (size_t i = 0; i < len; i++) {
+                entry_data[i] &= ((const uint8_t *)src)[offset + i];
+            }
+            entry->use_count = ++this->use_counter;
+            run_offset = offset + len;
+        }
+        offset += len;
+    }
+    if (run_offset < size) {
+        result = this->flash->write(dest_addr + run_offset, &((const uint8_t *)src)[run_offset], size - run_offset);
+        WL_CACHE_RESULT_CHECK(result);
+    }
+    return result;
+}
+
+esp_err_t WL_Sector_Cache::read(size_t src_addr, void *dest, size_t size)
+{
+    esp_err_t result = this->flushExpired();
+    WL_CACHE_RESULT_CHECK(result);
+    ESP_LOGD(TAG, "%s - src_addr= 0x%08" PRIx32 ", size= 0x%08" PRIx32 , __func__, (uint32_t) src_addr, (uint32_t) size);
+    // Data of the cached sectors is copied from the cache, the other data is read from flash in runs
+    size_t offset = 0;
+    size_t run_offset = 0;
+    while (offset < size) {
+        size_t sector = (src_addr + offset) / this->sector_size;
+        size_t sector_offset = (src_addr + offset) % this->sector_size;
+        size_t len = this->sector_size - sector_offset;
+        if (len > size - offset) {
+            len = size - offset;
+        }
+        cache_entry_t *entry = this->findEntry(sector);
+        if (entry != NULL) {
+            if (run_offset < offset) {
+                result = this->flash->read(src_addr + run_offset, &((uint8_t *)dest)[run_offset], offset - run_offset);
+                WL_CACHE_RESULT_CHECK(result);
+            }
+            memcpy(&((uint8_t *)dest)[offset], this->entryData(entry) + sector_offset, len);
+            run_offset = offset + len;
+        }
+        offset += len;
+    }
+    if (run_offset < size) {
+        result = this->flash->read(src_addr + run_offset, &((uint8_t *)dest)[run_offset], size - run_offset);
+        WL_CACHE_RESULT_CHECK(result);
+    }
+    return result;
+}
+
+esp_err_t WL_Sector_Cache::flush()
+{
+    esp_err_t result = ESP_OK;
+    for (size_t i = 0; i < this->sector_count; i++) {
+        if (this->entries[i].valid) {
+            result = this->flushEntry(&this->entries[i]);
+            WL_CACHE_RESULT_CHECK(result);
+        }
+    }
+    return result;
+}
@@ -1,17 +1,20 @@
 /*
- * SPDX-FileCopyrightText: 2016-2023 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2016-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <chrono>
+#include <thread>
 
 #include "esp_partition.h"
 #include "esp_private/partition_linux.h"
 
 #include "wear_levelling.h"
 #include "WL_Flash.h"
+#include "WL_Sector_Cache.h"
 #include "crc32.h"
 
 
@@ -99,6 +102,281 @@ TEST_CASE("write and read back data", "[wear_levelling]")
     free(read);
 }
 
+// Number of sectors per wl_write/wl_read call, as issued by FATFS for multi-sector transfers
+#define TRANSFER_SECTORS 8
+
+TEST_CASE("multi-sector transfers are coalesced", "[wear_levelling]")
+{
+    esp_err_t result;
+    wl_handle_t wl_handle;
+
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "storage");
+
+    // Mount wear-levelled partition
+    result = wl_mount(partition, &wl_handle);
+    REQUIRE(result == ESP_OK);
+
+    size_t sector_size = wl_sector_size(wl_handle);
+    size_t transfer_size = sector_size * TRANSFER_SECTORS;
+    size_t transfer_count = wl_size(wl_handle) / transfer_size;
+
+    uint8_t *data = (uint8_t *) malloc(transfer_size);
+    uint8_t *read = (uint8_t *) malloc(transfer_size);
+
+    // Erasing moves the dummy sector, so that some transfers cross it
+    REQUIRE(wl_erase_range(wl_handle, 0, transfer_count * transfer_size) == ESP_OK);
+
+    // Consecutive pages are consecutive in the partition, except at the dummy sector and at
+    // the end of the partition, so every transfer must be done in at most 3 partition operations
+    size_t write_ops = 0;
+    size_t read_ops = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < transfer_count; i++) {
+        for (size_t m = 0; m < transfer_size / sizeof(uint32_t); m++) {
+            ((uint32_t *) data)[m] = i * transfer_size + m;
+        }
+        esp_partition_clear_stats();
+        REQUIRE(wl_write(wl_handle, i * transfer_size, data, transfer_size) == ESP_OK);
+        REQUIRE(esp_partition_get_write_ops() <= 3);
+        write_ops += esp_partition_get_write_ops();
+    }
+    auto write_end = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < transfer_count; i++) {
+        esp_partition_clear_stats();
+        REQUIRE(wl_read(wl_handle, i * transfer_size, read, transfer_size) == ESP_OK);
+        REQUIRE(esp_partition_get_read_ops() <= 3);
+        read_ops += esp_partition_get_read_ops();
+        for (size_t m = 0; m < transfer_size / sizeof(uint32_t); m++) {
+            REQUIRE(((uint32_t *) read)[m] == i * transfer_size + m);
+        }
+    }
+    auto read_end = std::chrono::steady_clock::now();
+
+    double write_s = std::chrono::duration<double>(write_end - start).count();
+    double read_s = std::chrono::duration<double>(read_end - write_end).count();
+    double total_mb = (double)(transfer_count * transfer_size) / (1024 * 1024);
+    printf("%zu transfers of %zu bytes: %zu write ops (%.1f MB/s), %zu read ops (%.1f MB/s)\n",
+           transfer_count, transfer_size, write_ops, total_mb / write_s, read_ops, total_mb / read_s);
+
+    // Unmount
+    result = wl_unmount(wl_handle);
+    REQUIRE(result == ESP_OK);
+
+    free(data);
+    free(read);
+}
+
+// Number of times the same sectors are rewritten, e.g. when updating the FAT table and a directory entry
+#define SECTOR_REWRITE_COUNT 64
+// Number of sectors in the RAM cache
+#define CACHE_SECTORS 4
+
+// Returns the number of sector erases in the partition since the last esp_partition_clear_stats()
+static size_t partition_erase_count(const esp_partition_t *partition)
+{
+    size_t count = 0;
+    for (size_t sector = partition->address / ESP_PARTITION_EMULATED_SECTOR_SIZE;
+            sector < (partition->address + partition->size) / ESP_PARTITION_EMULATED_SECTOR_SIZE; sector++) {
+        count += esp_partition_get_sector_erase_count(sector);
+    }
+    return count;
+}
+
+// Erases and writes sectors 1 and 2 SECTOR_REWRITE_COUNT times, as FATFS does on each write
+static void rewrite_sectors(Flash_Access *flash, uint32_t *sector_data, size_t sector_size)
+{
+    for (uint32_t k = 0; k < SECTOR_REWRITE_COUNT; k++) {
+        for (size_t sector = 1; sector <= 2; sector++) {
+            for (uint32_t m = 0; m < sector_size / sizeof(uint32_t); m++) {
+                sector_data[m] = sector * sector_size + k + m;
+            }
+            REQUIRE(flash->erase_range(sector * sector_size, sector_size) == ESP_OK);
+            REQUIRE(flash->write(sector * sector_size, sector_data, sector_size) == ESP_OK);
+        }
+    }
+}
+
+TEST_CASE("sector cache merges repeated sector rewrites", "[wear_levelling]")
+{
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "storage");
+
+    // Same configuration as wl_mount
+    wl_config_t cfg;
+    cfg.wl_partition_start_addr   = 0;
+    cfg.wl_partition_size         = partition->size;
+    cfg.wl_page_size              = SPI_FLASH_SEC_SIZE;
+    cfg.flash_sector_size         = SPI_FLASH_SEC_SIZE;
+    cfg.wl_update_rate            = 16;
+    cfg.wl_pos_update_record_size = 16;
+    cfg.version                   = 2;
+    cfg.wl_temp_buff_size         = 32;
+
+    Partition part(partition);
+    WL_Flash wl_flash;
+    REQUIRE(wl_flash.config(&cfg, &part) == ESP_OK);
+    REQUIRE(wl_flash.init() == ESP_OK);
+
+    size_t sector_size = wl_flash.get_sector_size();
+    uint32_t *sector_data = new uint32_t[sector_size / sizeof(uint32_t)];
+
+    // Without the cache, each rewrite costs a sector erase, plus the erases of wear levelling updates
+    esp_partition_clear_stats();
+    rewrite_sectors(&wl_flash, sector_data, sector_size);
+    size_t direct_erases = partition_erase_count(partition);
+
+    // With the cache, the sectors are erased once, when flushed
+    WL_Sector_Cache cache;
+    REQUIRE(cache.config(&wl_flash, CACHE_SECTORS, 0) == ESP_OK);
+    esp_partition_clear_stats();
+    rewrite_sectors(&cache, sector_data, sector_size);
+    size_t cached_erases_before_flush = partition_erase_count(partition);
+    REQUIRE(cache.flush() == ESP_OK);
+    size_t cached_erases = partition_erase_count(partition);
+    printf("%d rewrites of 2 sectors: %zu sector erases without cache, %zu with cache\n",
+           SECTOR_REWRITE_COUNT, direct_erases, cached_erases);
+    REQUIRE(cached_erases_before_flush == 0);
+    REQUIRE(cached_erases * 8 < direct_erases);
+
+    // The last data written is in flash
+    for (size_t sector = 1; sector <= 2; sector++) {
+        REQUIRE(wl_flash.read(sector * sector_size, sector_data, sector_size) == ESP_OK);
+        for (uint32_t m = 0; m < sector_size / sizeof(uint32_t); m++) {
+            REQUIRE(sector_data[m] == sector * sector_size + SECTOR_REWRITE_COUNT - 1 + m);
+        }
+    }
+
+    // Write more sectors than the cache holds: the least recently used ones are flushed, and
+    // reads return the data of the cached sectors and of the flushed ones
+    size_t sectors = CACHE_SECTORS * 4;
+    uint32_t *data = new uint32_t[sectors * sector_size / sizeof(uint32_t)];
+    uint32_t *read = new uint32_t[sectors * sector_size / sizeof(uint32_t)];
+    for (uint32_t m = 0; m < sectors * sector_size / sizeof(uint32_t); m++) {
+        data[m] = 0x5a5a0000 + m;
+    }
+    for (size_t sector = 0; sector < sectors; sector++) {
+        REQUIRE(cache.erase_range(sector * sector_size, sector_size) == ESP_OK);
+        REQUIRE(cache.write(sector * sector_size, &data[sector * sector_size / sizeof(uint32_t)], sector_size) == ESP_OK);
+    }
+    REQUIRE(cache.read(0, read, sectors * sector_size) == ESP_OK);
+    REQUIRE(memcmp(data, read, sectors * sector_size) == 0);
+    REQUIRE(cache.flush() == ESP_OK);
+    REQUIRE(wl_flash.read(0, read, sectors * sector_size) == ESP_OK);
+    REQUIRE(memcmp(data, read, sectors * sector_size) == 0);
+
+    REQUIRE(wl_flash.flush() == ESP_OK);
+
+    delete[] sector_data;
+    delete[] data;
+    delete[] read;
+}
+
+// Flush timeout of the RAM cache in ms
+#define CACHE_TIMEOUT_MS 100
+
+TEST_CASE("sector cache flushes expired sectors on the next access", "[wear_levelling]")
+{
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "storage");
+
+    // Same configuration as wl_mount
+    wl_config_t cfg;
+    cfg.wl_partition_start_addr   = 0;
+    cfg.wl_partition_size         = partition->size;
+    cfg.wl_page_size              = SPI_FLASH_SEC_SIZE;
+    cfg.flash_sector_size         = SPI_FLASH_SEC_SIZE;
+    cfg.wl_update_rate            = 16;
+    cfg.wl_pos_update_record_size = 16;
+    cfg.version                   = 2;
+    cfg.wl_temp_buff_size         = 32;
+
+    Partition part(partition);
+    WL_Flash wl_flash;
+    REQUIRE(wl_flash.config(&cfg, &part) == ESP_OK);
+    REQUIRE(wl_flash.init() == ESP_OK);
+
+    size_t sector_size = wl_flash.get_sector_size();
+    uint8_t *sector_data = new uint8_t[sector_size];
+    uint8_t *read = new uint8_t[sector_size];
+
+    WL_Sector_Cache cache;
+    REQUIRE(cache.config(&wl_flash, CACHE_SECTORS, CACHE_TIMEOUT_MS) == ESP_OK);
+    esp_partition_clear_stats();
+    REQUIRE(cache.erase_range(sector_size, sector_size) == ESP_OK);
+
+    // As in flash, writing to a cached sector only clears bits
+    memset(sector_data, 0x3c, sector_size);
+    REQUIRE(cache.write(sector_size, sector_data, sector_size) == ESP_OK);
+    memset(sector_data, 0x0f, sector_size);
+    REQUIRE(cache.write(sector_size, sector_data, sector_size) == ESP_OK);
+    memset(sector_data, 0x0c, sector_size);
+    REQUIRE(cache.read(sector_size, read, sector_size) == ESP_OK);
+    REQUIRE(memcmp(sector_data, read, sector_size) == 0);
+    REQUIRE(partition_erase_count(partition) == 0);
+
+    // The sector is not flushed in the background when it expires, only on the next access
+    std::this_thread::sleep_for(std::chrono::milliseconds(CACHE_TIMEOUT_MS * 2));
+    REQUIRE(partition_erase_count(partition) == 0);
+    REQUIRE(cache.read(0, read, sector_size) == ESP_OK);
+    REQUIRE(partition_erase_count(partition) > 0);
+    REQUIRE(wl_flash.read(sector_size, read, sector_size) == ESP_OK);
+    REQUIRE(memcmp(sector_data, read, sector_size) == 0);
+
+    REQUIRE(wl_flash.flush() == ESP_OK);
+
+    delete[] sector_data;
+    delete[] read;
+}
+
+#if CONFIG_WL_SECTOR_CACHE
+TEST_CASE("mounted partition keeps erased sectors in the cache", "[wear_levelling]")
+{
+    wl_handle_t wl_handle;
+
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "storage");
+
+    REQUIRE(wl_mount(partition, &wl_handle) == ESP_OK);
+
+    size_t sector_size = wl_sector_size(wl_handle);
+    uint32_t *sector_data = new uint32_t[sector_size / sizeof(uint32_t)];
+    uint32_t *read = new uint32_t[sector_size / sizeof(uint32_t)];
+    for (uint32_t m = 0; m < sector_size / sizeof(uint32_t); m++) {
+        sector_data[m] = 0xa5a50000 + m;
+    }
+
+    // The sector is only erased in flash when it is synced
+    esp_partition_clear_stats();
+    REQUIRE(wl_erase_range(wl_handle, sector_size, sector_size) == ESP_OK);
+    REQUIRE(wl_write(wl_handle, sector_size, sector_data, sector_size) == ESP_OK);
+    REQUIRE(wl_read(wl_handle, sector_size, read, sector_size) == ESP_OK);
+    REQUIRE(memcmp(sector_data, read, sector_size) == 0);
+    REQUIRE(partition_erase_count(partition) == 0);
+    REQUIRE(wl_sync(wl_handle) == ESP_OK);
+    REQUIRE(partition_erase_count(partition) > 0);
+
+#if CONFIG_WL_SECTOR_CACHE_TIMEOUT_MS > 0
+    // Or on the first access after the timeout
+    esp_partition_clear_stats();
+    REQUIRE(wl_erase_range(wl_handle, sector_size, sector_size) == ESP_OK);
+    REQUIRE(wl_write(wl_handle, sector_size, sector_data, sector_size) == ESP_OK);
+    std::this_thread::sleep_for(std::chrono::milliseconds(CONFIG_WL_SECTOR_CACHE_TIMEOUT_MS * 2));
+    REQUIRE(partition_erase_count(partition) == 0);
+    REQUIRE(wl_read(wl_handle, 0, read, sector_size) == ESP_OK);
+    REQUIRE(partition_erase_count(partition) > 0);
+#endif // CONFIG_WL_SECTOR_CACHE_TIMEOUT_MS > 0
+
+    // The data is kept after remounting
+    REQUIRE(wl_unmount(wl_handle) == ESP_OK);
+    REQUIRE(wl_mount(partition, &wl_handle) == ESP_OK);
+    REQUIRE(wl_read(wl_handle, sector_size, read, sector_size) == ESP_OK);
+    REQUIRE(memcmp(sector_data, read, sector_size) == 0);
+    REQUIRE(wl_unmount(wl_handle) == ESP_OK);
+
+    delete[] sector_data;
+    delete[] read;
+}
+#endif // CONFIG_WL_SECTOR_CACHE
+
+// The cached sectors are lost on power down, this test checks the consistency of the flash data without the cache
+#if !CONFIG_WL_SECTOR_CACHE
 TEST_CASE("power down test", "[wear_levelling]")
 {
     esp_err_t result;
@@ -228,6 +506,7 @@ TEST_CASE("power down test", "[wear_levelling]")
     result = wl_unmount(wl_handle);
     REQUIRE(result == ESP_OK);
 }
+#endif // !CONFIG_WL_SECTOR_CACHE
 
 // Calculates wl status blocks offsets and status block size
 void calculate_wl_state_address_info(const esp_partition_t *partition, size_t *offset_state_1, size_t *offset_state_2, size_t *state_size)
@@ -421,3 +700,101 @@ TEST_CASE("power down between WL status 1 and WL status 2 update", "[wear_levell
 
     free(tmp_state);
 }
+
+// Reads the WL state in flash to get the partition offset of the dummy sector and the move count,
+// this code follows WL_Flash::recoverPos() and WL_Flash::OkBuffSet()
+static void read_dummy_sector_info(const esp_partition_t *partition, size_t *dummy_offset, uint32_t *move_count)
+{
+    size_t offset_state_1, offset_state_2, size_state = 0;
+    calculate_wl_state_address_info(partition, &offset_state_1, &offset_state_2, &size_state);
+
+    wl_state_t state;
+    REQUIRE(esp_partition_read(partition, offset_state_1, &state, sizeof(state)) == ESP_OK);
+
+    const size_t record_size = 16; // WL_DEFAULT_WRITE_SIZE
+    size_t pos;
+    for (pos = 0; pos < state.wl_part_max_sec_pos; pos++) {
+        uint32_t record[record_size / sizeof(uint32_t)];
+        REQUIRE(esp_partition_read(partition, offset_state_1 + sizeof(wl_state_t) + pos * record_size, record, record_size) == ESP_OK);
+        bool written = true;
+        for (size_t i = 0; i < record_size / sizeof(uint32_t); i++) {
+            uint32_t data = state.wl_device_id + pos * 4 + i;
+            written &= crc32::crc32_le(WL_CFG_CRC_CONST, (uint8_t *)&data, sizeof(data)) == record[i];
+        }
+        if (!written) {
+            break;
+        }
+    }
+    if (pos == state.wl_part_max_sec_pos) {
+        pos--;
+    }
+    *dummy_offset = pos * CONFIG_WL_SECTOR_SIZE;
+    *move_count = state.wl_dummy_sec_move_count;
+}
+
+TEST_CASE("transfer across the dummy sector is split around it", "[wear_levelling]")
+{
+    wl_handle_t wl_handle;
+
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "storage");
+
+    REQUIRE(wl_mount(partition, &wl_handle) == ESP_OK);
+    const size_t sector_size = wl_sector_size(wl_handle);
+    const size_t flash_size = wl_size(wl_handle);
+    const size_t transfer_size = sector_size * TRANSFER_SECTORS;
+    REQUIRE(wl_unmount(wl_handle) == ESP_OK);
+
+    // Erase the whole range until a transfer can start a few sectors before the dummy sector in the partition,
+    // without wrapping around the end of the partition or of the WL address range
+    size_t dummy_offset = 0;
+    size_t first_sectors = 0; // sectors of the transfer before the dummy sector
+    size_t addr = 0;
+    for (int attempt = 0; first_sectors == 0; attempt++) {
+        REQUIRE(attempt < 100);
+        REQUIRE(wl_mount(partition, &wl_handle) == ESP_OK);
+        REQUIRE(wl_erase_range(wl_handle, 0, flash_size) == ESP_OK);
+        REQUIRE(wl_unmount(wl_handle) == ESP_OK);
+
+        uint32_t move_count;
+        read_dummy_sector_info(partition, &dummy_offset, &move_count);
+        for (size_t n = 1; n < TRANSFER_SECTORS && n * sector_size <= dummy_offset; n++) {
+            // Inverse of WL_Flash::calcAddr() for the addresses mapped before the dummy sector
+            size_t start = dummy_offset - n * sector_size;
+            size_t candidate = (start + move_count * sector_size) % flash_size;
+            if (start + transfer_size <= flash_size && candidate + transfer_size <= flash_size) {
+                first_sectors = n;
+                addr = candidate;
+                break;
+            }
+        }
+    }
+
+    uint8_t *data = (uint8_t *) malloc(transfer_size);
+    uint8_t *read = (uint8_t *) malloc(transfer_size);
+    for (size_t m = 0; m < transfer_size / sizeof(uint32_t); m++) {
+        ((uint32_t *) data)[m] = 0x5a000000 + m;
+    }
+
+    REQUIRE(wl_mount(partition, &wl_handle) == ESP_OK);
+    esp_partition_clear_stats();
+    REQUIRE(wl_write(wl_handle, addr, data, transfer_size) == ESP_OK);
+    REQUIRE(esp_partition_get_write_ops() == 2);
+    esp_partition_clear_stats();
+    REQUIRE(wl_read(wl_handle, addr, read, transfer_size) == ESP_OK);
+    REQUIRE(esp_partition_get_read_ops() == 2);
+    REQUIRE(memcmp(read, data, transfer_size) == 0);
+
+    // The data is in the partition before and after the dummy sector. This is checked before unmounting,
+    // since flushing the state on unmount moves the dummy sector by copying the next sector into it.
+    const size_t first_size = first_sectors * sector_size;
+    REQUIRE(esp_partition_read(partition, dummy_offset - first_size, read, first_size) == ESP_OK);
+    REQUIRE(memcmp(read, data, first_size) == 0);
+    REQUIRE(esp_partition_read(partition, dummy_offset + sector_size, read, transfer_size - first_size) == ESP_OK);
+    REQUIRE(memcmp(read, data + first_size, transfer_size - first_size) == 0);
+    REQUIRE(esp_partition_read(partition, dummy_offset, read, sector_size) == ESP_OK);
+    REQUIRE(memcmp(read, data + first_size, sector_size) != 0);
+    REQUIRE(wl_unmount(wl_handle) == ESP_OK);
+
+    free(data);
+    free(read);
+}
@@ -1,4 +1,4 @@
-# SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+# SPDX-FileCopyrightText: 2023-2024 Espressif Systems (Shanghai) CO LTD
 # SPDX-License-Identifier: Unlicense OR CC0-1.0
 import pytest
 from pytest_embedded import Dut
@@ -6,5 +6,12 @@ from pytest_embedded import Dut
 
 @pytest.mark.linux
 @pytest.mark.host_test
+@pytest.mark.parametrize(
+    'config',
+    [
+        'default',
+        'sector_cache',
+    ]
+)
 def test_wear_levelling_linux(dut: Dut) -> None:
     dut.expect_exact('All tests passed', timeout=120)
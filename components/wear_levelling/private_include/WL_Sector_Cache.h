@@ -0,0 +1,63 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef _WL_Sector_Cache_H_
+#define _WL_Sector_Cache_H_
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "Flash_Access.h"
+
+/**
+* @brief This class is used to defer the erase of sectors. Class implements Flash_Access interface
+*
+* Erased sectors are kept in RAM, where the following writes are merged, and are only erased and
+* written to the underlying flash when flushed. So rewriting a sector several times, e.g. a FAT
+* table sector, costs a single erase. The sectors are flushed on flush(), when the cache is full
+* (least recently used sector first), and on the first erase_range(), write() or read() call after
+* they have been kept for longer than the timeout. As in flash, writes to a cached sector only clear bits.
+*/
+class WL_Sector_Cache : public Flash_Access
+{
+public:
+    WL_Sector_Cache();
+    ~WL_Sector_Cache() override;
+
+    esp_err_t config(Flash_Access *flash, size_t sector_count, uint32_t timeout_ms);
+
+    size_t get_flash_size() override;
+    size_t get_sector_size() override;
+
+    esp_err_t erase_sector(size_t sector) override;
+    esp_err_t erase_range(size_t start_address, size_t size) override;
+
+    esp_err_t write(size_t dest_addr, const void *src, size_t size) override;
+    esp_err_t read(size_t src_addr, void *dest, size_t size) override;
+
+    esp_err_t flush() override;
+
+protected:
+    typedef struct {
+        size_t sector;          /*!< Sector held by the entry */
+        uint32_t dirty_time;    /*!< Time when the sector was erased in the cache, in ms */
+        uint32_t use_count;     /*!< Value of use_counter when the entry was last used */
+        bool valid;             /*!< The entry holds a sector which was not flushed yet */
+    } cache_entry_t;
+
+    Flash_Access *flash = NULL;
+    size_t sector_size = 0;
+    size_t sector_count = 0;
+    uint32_t timeout_ms = 0;
+    uint32_t use_counter = 0;
+    cache_entry_t *entries = NULL;
+    uint8_t *data = NULL;           /*!< Data of the sectors, sector_size bytes for each entry */
+
+    cache_entry_t *findEntry(size_t sector);
+    uint8_t *entryData(cache_entry_t *entry);
+    esp_err_t flushEntry(cache_entry_t *entry);
+    esp_err_t flushExpired();
+};
+
+#endif // _WL_Sector_Cache_H_
@@ -1,5 +1,5 @@
 /*
- * SPDX-FileCopyrightText: 2015-2023 Espressif Systems (Shanghai) CO LTD
+ * SPDX-FileCopyrightText: 2015-2024 Espressif Systems (Shanghai) CO LTD
  *
  * SPDX-License-Identifier: Apache-2.0
  */
@@ -13,6 +13,7 @@
 #include "WL_Flash.h"
 #include "WL_Ext_Perf.h"
 #include "WL_Ext_Safe.h"
+#include "WL_Sector_Cache.h"
 #include "SPI_Flash.h"
 #include "Partition.h"
 
@@ -42,6 +43,7 @@
 
 typedef struct {
     WL_Flash *instance;
+    WL_Sector_Cache *cache;     // Sector cache on top of instance, NULL if CONFIG_WL_SECTOR_CACHE is disabled
     _lock_t lock;
 } wl_instance_t;
 
@@ -51,6 +53,15 @@ static const char *TAG = "wear_levelling";
 
 static esp_err_t check_handle(wl_handle_t handle, const char *func);
 
+// Returns the sector cache of the instance if any, or the instance itself
+static inline Flash_Access *get_access(wl_handle_t handle)
+{
+    if (s_instances[handle].cache != NULL) {
+        return s_instances[handle].cache;
+    }
+    return s_instances[handle].instance;
+}
+
 esp_err_t wl_mount(const esp_partition_t *partition, wl_handle_t *out_handle)
 {
     // Initialize variables before the first jump to cleanup label
@@ -58,6 +69,7 @@ esp_err_t wl_mount(const esp_partition_t *partition, wl_handle_t *out_handle)
     WL_Flash *wl_flash = NULL;
     void *part_ptr = NULL;
     Partition *part = NULL;
+    WL_Sector_Cache *cache = NULL;
     esp_err_t result = ESP_OK;
     *out_handle = WL_INVALID_HANDLE;
 
@@ -147,7 +159,26 @@ esp_err_t wl_mount(const esp_partition_t *partition, wl_handle_t *out_handle)
         goto out;
     }
 
+#if CONFIG_WL_SECTOR_CACHE
+    // Read-only partitions can't be erased, so they don't need a cache
+    if (!part->is_readonly()) {
+        void *cache_ptr = malloc(sizeof(WL_Sector_Cache));
+        if (cache_ptr == NULL) {
+            result = ESP_ERR_NO_MEM;
+            ESP_LOGE(TAG, "%s: can't allocate WL_Sector_Cache", __func__);
+            goto out;
+        }
+        cache = new (cache_ptr) WL_Sector_Cache();
+        result = cache->config(wl_flash, CONFIG_WL_SECTOR_CACHE_SECTORS, CONFIG_WL_SECTOR_CACHE_TIMEOUT_MS);
+        if (ESP_OK != result) {
+            ESP_LOGE(TAG, "%s: cache config instance=0x%08" PRIx32 ", result=0x%x", __func__, *out_handle, result);
+            goto out;
+        }
+    }
+#endif // CONFIG_WL_SECTOR_CACHE
+
     s_instances[*out_handle].instance = wl_flash;
+    s_instances[*out_handle].cache = cache;
     // Initialise the lock for respective WL handle
     _lock_init(&s_instances[*out_handle].lock);
 
@@ -157,6 +188,10 @@ esp_err_t wl_mount(const esp_partition_t *partition, wl_handle_t *out_handle)
 out:
     _lock_release(&s_instances_lock);
     *out_handle = WL_INVALID_HANDLE;
+    if (cache) {
+        cache->~WL_Sector_Cache();
+        free(cache);
+    }
     if (wl_flash) {
         wl_flash->~WL_Flash();
         free(wl_flash);
@@ -176,9 +211,19 @@ esp_err_t wl_unmount(wl_handle_t handle)
     if (result == ESP_OK) {
         // We use placement new in wl_mount, so call destructor directly
         Partition *part = s_instances[handle].instance->get_part();
+        // Write the cached sectors before flushing the state of the component
+        if (s_instances[handle].cache) {
+            result = s_instances[handle].cache->flush();
+            s_instances[handle].cache->~WL_Sector_Cache();
+            free(s_instances[handle].cache);
+            s_instances[handle].cache = NULL;
+        }
         // We have to flush state of the component
         if (!part->is_readonly()) {
-            result = s_instances[handle].instance->flush();
+            esp_err_t flush_result = s_instances[handle].instance->flush();
+            if (result == ESP_OK) {
+                result = flush_result;
+            }
         }
         part->~Partition();
         free(part);
@@ -198,7 +243,7 @@ esp_err_t wl_erase_range(wl_handle_t handle, size_t start_addr, size_t size)
         return result;
     }
     _lock_acquire(&s_instances[handle].lock);
-    result = s_instances[handle].instance->erase_range(start_addr, size);
+    result = get_access(handle)->erase_range(start_addr, size);
     _lock_release(&s_instances[handle].lock);
     return result;
 }
@@ -210,7 +255,7 @@ esp_err_t wl_write(wl_handle_t handle, size_t dest_addr, const void *src, size_t
         return result;
     }
     _lock_acquire(&s_instances[handle].lock);
-    result = s_instances[handle].instance->write(dest_addr, src, size);
+    result = get_access(handle)->write(dest_addr, src, size);
     _lock_release(&s_instances[handle].lock);
     return result;
 }
@@ -222,7 +267,21 @@ esp_err_t wl_read(wl_handle_t handle, size_t src_addr, void *dest, size_t size)
         return result;
     }
     _lock_acquire(&s_instances[handle].lock);
-    result = s_instances[handle].instance->read(src_addr, dest, size);
+    result = get_access(handle)->read(src_addr, dest, size);
+    _lock_release(&s_instances[handle].lock);
+    return result;
+}
+
+esp_err_t wl_sync(wl_handle_t handle)
+{
+    esp_err_t result = check_handle(handle, __func__);
+    if (result != ESP_OK) {
+        return result;
+    }
+    _lock_acquire(&s_instances[handle].lock);
+    if (s_instances[handle].cache) {
+        result = s_instances[handle].cache->flush();
+    }
     _lock_release(&s_instances[handle].lock);
     return result;
 }